@@ -58,6 +58,7 @@
 #include "gromacs/fileio/xvgr.h"
 #include "gromacs/gmxlib/network.h"
 #include "gromacs/math/utilities.h"
+#include "gromacs/mdlib/gmx_omp_nthreads.h"
 #include "gromacs/mdrunutility/multisim.h"
 #include "gromacs/mdtypes/awh_history.h"
 #include "gromacs/mdtypes/awh_params.h"
@@ -139,15 +140,21 @@ void sumOverSimulations(gmx::ArrayRef<T> arrayRef, const t_commrec* commRecord,
 /*! \brief
  * Sum PMF over multiple simulations, when requested.
  *
+ * Only the points in \p updateList can have received PMF samples since
+ * the last summation, so only those are summed. The PMF of all other points
+ * is identical in all simulations.
+ *
  * \param[in,out] pointState         The state of the points in the bias.
  * \param[in]     numSharedUpdate    The number of biases sharing the histogram.
  * \param[in]     commRecord         Struct for intra-simulation communication.
  * \param[in]     multiSimComm       Struct for multi-simulation communication.
+ * \param[in]     updateList         List of points that have been sampled in any simulation.
  */
 void sumPmf(gmx::ArrayRef<PointState> pointState,
             int                       numSharedUpdate,
             const t_commrec*          commRecord,
-            const gmx_multisim_t*     multiSimComm)
+            const gmx_multisim_t*     multiSimComm,
+            gmx::ArrayRef<const int>  updateList)
 {
     if (numSharedUpdate == 1)
     {
@@ -158,23 +165,27 @@ void sumPmf(gmx::ArrayRef<PointState> pointState,
     GMX_ASSERT(numSharedUpdate == multiSimComm->nsim,
                "Sharing within a simulation is not implemented (yet)");
 
-    std::vector<double> buffer(pointState.size());
+    std::vector<double> buffer(updateList.size());
 
     /* Need to temporarily exponentiate the log weights to sum over simulations */
     for (size_t i = 0; i < buffer.size(); i++)
     {
-        buffer[i] = pointState[i].inTargetRegion() ? std::exp(-pointState[i].logPmfSum()) : 0;
+        const PointState& ps = pointState[updateList[i]];
+
+        buffer[i] = ps.inTargetRegion() ? std::exp(-ps.logPmfSum()) : 0;
     }
 
     sumOverSimulations(gmx::ArrayRef<double>(buffer), commRecord, multiSimComm);
 
     /* Take log again to get (non-normalized) PMF */
     double normFac = 1.0 / numSharedUpdate;
-    for (gmx::index i = 0; i < pointState.ssize(); i++)
+    for (size_t i = 0; i < buffer.size(); i++)
     {
-        if (pointState[i].inTargetRegion())
+        PointState& ps = pointState[updateList[i]];
+
+        if (ps.inTargetRegion())
         {
-            pointState[i].setLogPmfSum(-std::log(buffer[i] * normFac));
+            ps.setLogPmfSum(-std::log(buffer[i] * normFac));
         }
     }
 }
@@ -609,43 +620,6 @@ void BiasState::doSkippedUpdatesInNeighborhood(const BiasParams& params, const B
 namespace
 {
 
-/*! \brief
- * Merge update lists from multiple sharing simulations.
- *
- * \param[in,out] updateList    Update list for this simulation (assumed >= npoints long).
- * \param[in]     numPoints     Total number of points.
- * \param[in]     commRecord    Struct for intra-simulation communication.
- * \param[in]     multiSimComm  Struct for multi-simulation communication.
- */
-void mergeSharedUpdateLists(std::vector<int>*     updateList,
-                            int                   numPoints,
-                            const t_commrec*      commRecord,
-                            const gmx_multisim_t* multiSimComm)
-{
-    std::vector<int> numUpdatesOfPoint;
-
-    /* Flag the update points of this sim.
-       TODO: we can probably avoid allocating this array and just use the input array. */
-    numUpdatesOfPoint.resize(numPoints, 0);
-    for (auto& pointIndex : *updateList)
-    {
-        numUpdatesOfPoint[pointIndex] = 1;
-    }
-
-    /* Sum over the sims to get all the flagged points */
-    sumOverSimulations(arrayRefFromArray(numUpdatesOfPoint.data(), numPoints), commRecord, multiSimComm);
-
-    /* Collect the indices of the flagged points in place. The resulting array will be the merged update list.*/
-    updateList->clear();
-    for (int m = 0; m < numPoints; m++)
-    {
-        if (numUpdatesOfPoint[m] > 0)
-        {
-            updateList->push_back(m);
-        }
-    }
-}
-
 /*! \brief
  * Generate an update list of points sampled since the last update.
  *
@@ -691,6 +665,63 @@ void makeLocalUpdateList(const BiasGrid&                grid,
     }
 }
 
+/*! \brief
+ * Merge update lists from multiple sharing simulations.
+ *
+ * The local update list of each simulation is fully determined by its
+ * rectangular update range. Instead of summing flags for all grid points
+ * over the simulations, we only communicate these ranges, which is
+ * independent of the grid size, and construct the merged list locally.
+ *
+ * \param[in]     grid              The AWH bias grid.
+ * \param[in]     points            The point state.
+ * \param[in]     originUpdatelist  The origin of the rectangular region sampled by this simulation.
+ * \param[in]     endUpdatelist     The end of the rectangular region sampled by this simulation.
+ * \param[out]    updateList        The merged update list, sorted on point index.
+ * \param[in]     commRecord        Struct for intra-simulation communication.
+ * \param[in]     multiSimComm      Struct for multi-simulation communication.
+ */
+void mergeSharedUpdateLists(const BiasGrid&                grid,
+                            const std::vector<PointState>& points,
+                            const awh_ivec                 originUpdatelist,
+                            const awh_ivec                 endUpdatelist,
+                            std::vector<int>*              updateList,
+                            const t_commrec*               commRecord,
+                            const gmx_multisim_t*          multiSimComm)
+{
+    const int numDim = grid.numDimensions();
+
+    /* Gather the update ranges of all simulations,
+     * each simulation fills its own slot in the buffer.
+     */
+    std::vector<int> ranges(2 * numDim * multiSimComm->nsim, 0);
+    int*             rangesOfThisSim = ranges.data() + 2 * numDim * multiSimComm->sim;
+    for (int d = 0; d < numDim; d++)
+    {
+        rangesOfThisSim[d]          = originUpdatelist[d];
+        rangesOfThisSim[numDim + d] = endUpdatelist[d];
+    }
+    sumOverSimulations(gmx::ArrayRef<int>(ranges), commRecord, multiSimComm);
+
+    /* Collect the points of all ranges, remove duplicates and sort */
+    updateList->clear();
+    std::vector<int> listOfSim;
+    for (int sim = 0; sim < multiSimComm->nsim; sim++)
+    {
+        awh_ivec origin;
+        awh_ivec end;
+        for (int d = 0; d < numDim; d++)
+        {
+            origin[d] = ranges[2 * numDim * sim + d];
+            end[d]    = ranges[2 * numDim * sim + numDim + d];
+        }
+        makeLocalUpdateList(grid, points, origin, end, &listOfSim);
+        updateList->insert(updateList->end(), listOfSim.begin(), listOfSim.end());
+    }
+    std::sort(updateList->begin(), updateList->end());
+    updateList->erase(std::unique(updateList->begin(), updateList->end()), updateList->end());
+}
+
 } // namespace
 
 void BiasState::resetLocalUpdateRange(const BiasGrid& grid)
@@ -737,30 +768,30 @@ void sumHistograms(gmx::ArrayRef<PointState> pointState,
         GMX_ASSERT(numSharedUpdate == multiSimComm->nsim,
                    "Sharing within a simulation is not implemented (yet)");
 
-        /* Collect the weights and counts in linear arrays to be able to use gmx_sumd_sim. */
-        std::vector<double> weightSum;
-        std::vector<double> coordVisits;
-
-        weightSum.resize(localUpdateList.size());
-        coordVisits.resize(localUpdateList.size());
+        /* Collect the weights and counts in one linear array to be able to use
+         * a single gmx_sumd_sim call. The weights are stored in the first half,
+         * the counts in the second half.
+         */
+        const size_t        numPoints = localUpdateList.size();
+        std::vector<double> weightSumAndCoordVisits(2 * numPoints);
 
-        for (size_t localIndex = 0; localIndex < localUpdateList.size(); localIndex++)
+        for (size_t localIndex = 0; localIndex < numPoints; localIndex++)
         {
             const PointState& ps = pointState[localUpdateList[localIndex]];
 
-            weightSum[localIndex]   = ps.weightSumIteration();
-            coordVisits[localIndex] = ps.numVisitsIteration();
+            weightSumAndCoordVisits[localIndex]             = ps.weightSumIteration();
+            weightSumAndCoordVisits[numPoints + localIndex] = ps.numVisitsIteration();
         }
 
-        sumOverSimulations(gmx::ArrayRef<double>(weightSum), commRecord, multiSimComm);
-        sumOverSimulations(gmx::ArrayRef<double>(coordVisits), commRecord, multiSimComm);
+        sumOverSimulations(gmx::ArrayRef<double>(weightSumAndCoordVisits), commRecord, multiSimComm);
 
         /* Transfer back the result */
-        for (size_t localIndex = 0; localIndex < localUpdateList.size(); localIndex++)
+        for (size_t localIndex = 0; localIndex < numPoints; localIndex++)
         {
             PointState& ps = pointState[localUpdateList[localIndex]];
 
-            ps.setPartialWeightAndCount(weightSum[localIndex], coordVisits[localIndex]);
+            ps.setPartialWeightAndCount(weightSumAndCoordVisits[localIndex],
+                                        weightSumAndCoordVisits[numPoints + localIndex]);
         }
     }
 
@@ -990,6 +1021,9 @@ bool BiasState::isSamplingRegionCovered(const BiasParams&             params,
     return allPointsCovered;
 }
 
+//! The minimum number of points per thread for threading the updates of the points
+static constexpr int c_minNumPointsPerThread = 1000;
+
 /*! \brief
  * Normalizes the free energy and PMF sum.
  *
@@ -1025,10 +1059,14 @@ void BiasState::updateFreeEnergyAndAddSamplesToHistogram(const std::vector<DimPa
        the last update. These are the points needed for summing histograms below
        (non-local points only add zeros). For local updates, this will also be the
        final update list. */
-    makeLocalUpdateList(grid, points_, originUpdatelist_, endUpdatelist_, updateList);
     if (params.numSharedUpdate > 1)
     {
-        mergeSharedUpdateLists(updateList, points_.size(), commRecord, multiSimComm);
+        mergeSharedUpdateLists(grid, points_, originUpdatelist_, endUpdatelist_, updateList,
+                               commRecord, multiSimComm);
+    }
+    else
+    {
+        makeLocalUpdateList(grid, points_, originUpdatelist_, endUpdatelist_, updateList);
     }
 
     /* Reset the range for the next update */
@@ -1037,7 +1075,7 @@ void BiasState::updateFreeEnergyAndAddSamplesToHistogram(const std::vector<DimPa
     /* Add samples to histograms for all local points and sync simulations if needed */
     sumHistograms(points_, weightSumCovering_, params.numSharedUpdate, commRecord, multiSimComm, *updateList);
 
-    sumPmf(points_, params.numSharedUpdate, commRecord, multiSimComm);
+    sumPmf(points_, params.numSharedUpdate, commRecord, multiSimComm, *updateList);
 
     /* Renormalize the free energy if values are too large. */
     bool needToNormalizeFreeEnergy = false;
@@ -1109,22 +1147,32 @@ void BiasState::updateFreeEnergyAndAddSamplesToHistogram(const std::vector<DimPa
     setHistogramUpdateScaleFactors(params, newHistogramSize, histogramSize_.histogramSize(),
                                    &weightHistScalingNew, &logPmfsumScalingNew);
 
-    /* Update free energy and reference weight histogram for points in the update list. */
-    for (int pointIndex : *updateList)
+    /* Update free energy and reference weight histogram for points in the update list.
+     * The points are independent, so we can use threads for large lists.
+     */
+    const int numPointsToUpdate = updateList->size();
+    const int numThreads        = std::max(1, std::min(gmx_omp_nthreads_get(emntDefault),
+                                                       numPointsToUpdate / c_minNumPointsPerThread));
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (int i = 0; i < numPointsToUpdate; i++)
     {
-        PointState* pointStateToUpdate = &points_[pointIndex];
-
-        /* Do updates from previous update steps that were skipped because this point was at that time non-local. */
-        if (params.skipUpdates())
+        try
         {
-            pointStateToUpdate->performPreviouslySkippedUpdates(params, histogramSize_.numUpdates(),
-                                                                weightHistScalingSkipped,
-                                                                logPmfsumScalingSkipped);
-        }
+            PointState* pointStateToUpdate = &points_[(*updateList)[i]];
 
-        /* Now do an update with new sampling data. */
-        pointStateToUpdate->updateWithNewSampling(params, histogramSize_.numUpdates(),
-                                                  weightHistScalingNew, logPmfsumScalingNew);
+            /* Do updates from previous update steps that were skipped because this point was at that time non-local. */
+            if (params.skipUpdates())
+            {
+                pointStateToUpdate->performPreviouslySkippedUpdates(
+                        params, histogramSize_.numUpdates(), weightHistScalingSkipped,
+                        logPmfsumScalingSkipped);
+            }
+
+            /* Now do an update with new sampling data. */
+            pointStateToUpdate->updateWithNewSampling(params, histogramSize_.numUpdates(),
+                                                      weightHistScalingNew, logPmfsumScalingNew);
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
     }
 
     /* Only update the histogram size after we are done with the local point updates */
@@ -1143,9 +1191,14 @@ void BiasState::updateFreeEnergyAndAddSamplesToHistogram(const std::vector<DimPa
 
     /* Update the bias. The bias is updated separately and last since it simply a function of
        the free energy and the target distribution and we want to avoid doing extra work. */
-    for (int pointIndex : *updateList)
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (int i = 0; i < numPointsToUpdate; i++)
     {
-        points_[pointIndex].updateBias();
+        try
+        {
+            points_[(*updateList)[i]].updateBias();
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
     }
 
     /* Increase the update counter. */
@@ -50,10 +50,12 @@
 
 #include "gromacs/domdec/domdec_network.h"
 #include "gromacs/math/vec.h"
+#include "gromacs/mdlib/gmx_omp_nthreads.h"
 #include "gromacs/mdtypes/commrec.h"
 #include "gromacs/mdtypes/df_history.h"
 #include "gromacs/mdtypes/state.h"
 #include "gromacs/topology/topology.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/logger.h"
 
@@ -62,6 +64,24 @@
 #include "domdec_internal.h"
 #include "utility.h"
 
+/*! \brief Copies the elements of \p globalVec for the atoms in \p atoms to \p buffer
+ *
+ * Uses multiple threads, as this is called on the master rank only,
+ * while all other ranks are waiting for their data.
+ */
+static void packAtomsOfDomain(gmx::ArrayRef<const gmx::RVec> globalVec,
+                              gmx::ArrayRef<const int>       atoms,
+                              gmx::RVec*                     buffer)
+{
+    const int numAtoms   = atoms.ssize();
+    const int numThreads = gmx_omp_nthreads_get(emntDomdec);
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (int localAtom = 0; localAtom < numAtoms; localAtom++)
+    {
+        buffer[localAtom] = globalVec[atoms[localAtom]];
+    }
+}
+
 static void distributeVecSendrecv(gmx_domdec_t*                  dd,
                                   gmx::ArrayRef<const gmx::RVec> globalVec,
                                   gmx::ArrayRef<gmx::RVec>       localVec)
@@ -78,13 +98,9 @@ static void distributeVecSendrecv(gmx_domdec_t*                  dd,
 
                 buffer.resize(domainGroups.numAtoms);
 
-                int localAtom = 0;
-                for (const int& globalAtom : domainGroups.atomGroups)
-                {
-                    buffer[localAtom++] = globalVec[globalAtom];
-                }
-                GMX_RELEASE_ASSERT(localAtom == domainGroups.numAtoms,
+                GMX_RELEASE_ASSERT(domainGroups.atomGroups.ssize() == domainGroups.numAtoms,
                                    "The index count and number of indices should match");
+                packAtomsOfDomain(globalVec, domainGroups.atomGroups, buffer.data());
 
 #if GMX_MPI
                 MPI_Send(buffer.data(), domainGroups.numAtoms * sizeof(gmx::RVec), MPI_BYTE, rank,
@@ -94,11 +110,7 @@ static void distributeVecSendrecv(gmx_domdec_t*                  dd,
         }
 
         const auto& domainGroups = dd->ma->domainGroups[dd->masterrank];
-        int         localAtom    = 0;
-        for (const int& globalAtom : domainGroups.atomGroups)
-        {
-            localVec[localAtom++] = globalVec[globalAtom];
-        }
+        packAtomsOfDomain(globalVec, domainGroups.atomGroups, localVec.data());
     }
     else
     {
@@ -128,10 +140,8 @@ static void distributeVecScatterv(gmx_domdec_t*                  dd,
         for (int rank = 0; rank < dd->nnodes; rank++)
         {
             const auto& domainGroups = ma.domainGroups[rank];
-            for (const int& globalAtom : domainGroups.atomGroups)
-            {
-                buffer[localAtom++] = globalVec[globalAtom];
-            }
+            packAtomsOfDomain(globalVec, domainGroups.atomGroups, buffer.data() + localAtom);
+            localAtom += domainGroups.atomGroups.ssize();
         }
     }
 
@@ -389,6 +399,12 @@ static std::vector<std::vector<int>> getAtomGroupDistribution(const gmx::MDLogge
 
     std::vector<std::vector<int>> indices(dd->nnodes);
 
+    /* The domain indices of the atom groups are computed with multiple
+     * threads, the groups are then assigned to the domains in order.
+     */
+    const int        numThreads = gmx_omp_nthreads_get(emntDomdec);
+    std::vector<int> domainIndices;
+
     if (dd->comm->systemInfo.useUpdateGroups)
     {
         int atomOffset = 0;
@@ -396,17 +412,33 @@ static std::vector<std::vector<int>> getAtomGroupDistribution(const gmx::MDLogge
         {
             const auto& updateGrouping =
                     dd->comm->systemInfo.updateGroupingPerMoleculetype[molblock.type];
+            const int numGroupsPerMol = updateGrouping.numBlocks();
+            const int numAtomsPerMol  = updateGrouping.fullRange().end();
 
+            domainIndices.resize(molblock.nmol * numGroupsPerMol);
+#pragma omp parallel for num_threads(numThreads) schedule(static)
             for (int mol = 0; mol < molblock.nmol; mol++)
             {
-                for (int g = 0; g < updateGrouping.numBlocks(); g++)
+                try
                 {
-                    const auto& block     = updateGrouping.block(g);
-                    const int   atomBegin = atomOffset + block.begin();
-                    const int   atomEnd   = atomOffset + block.end();
-                    const int   domainIndex =
-                            computeAtomGroupDomainIndex(*dd, ddbox, triclinicCorrectionMatrix,
-                                                        cellBoundaries, atomBegin, atomEnd, box, pos);
+                    const int molOffset = atomOffset + mol * numAtomsPerMol;
+                    for (int g = 0; g < numGroupsPerMol; g++)
+                    {
+                        const auto& block = updateGrouping.block(g);
+                        domainIndices[mol * numGroupsPerMol + g] = computeAtomGroupDomainIndex(
+                                *dd, ddbox, triclinicCorrectionMatrix, cellBoundaries,
+                                molOffset + block.begin(), molOffset + block.end(), box, pos);
+                    }
+                }
+                GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+            }
+
+            for (int mol = 0; mol < molblock.nmol; mol++)
+            {
+                for (int g = 0; g < numGroupsPerMol; g++)
+                {
+                    const auto& block       = updateGrouping.block(g);
+                    const int   domainIndex = domainIndices[mol * numGroupsPerMol + g];
 
                     for (int atomIndex : block)
                     {
@@ -415,7 +447,7 @@ static std::vector<std::vector<int>> getAtomGroupDistribution(const gmx::MDLogge
                     ma.domainGroups[domainIndex].numAtoms += block.size();
                 }
 
-                atomOffset += updateGrouping.fullRange().end();
+                atomOffset += numAtomsPerMol;
             }
         }
 
@@ -424,13 +456,23 @@ static std::vector<std::vector<int>> getAtomGroupDistribution(const gmx::MDLogge
     else
     {
         /* Compute the center of geometry for all atoms */
+        domainIndices.resize(mtop.natoms);
+#pragma omp parallel for num_threads(numThreads) schedule(static)
         for (int atom = 0; atom < mtop.natoms; atom++)
         {
-            int domainIndex = computeAtomGroupDomainIndex(*dd, ddbox, triclinicCorrectionMatrix,
-                                                          cellBoundaries, atom, atom + 1, box, pos);
+            try
+            {
+                domainIndices[atom] =
+                        computeAtomGroupDomainIndex(*dd, ddbox, triclinicCorrectionMatrix,
+                                                    cellBoundaries, atom, atom + 1, box, pos);
+            }
+            GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+        }
 
-            indices[domainIndex].push_back(atom);
-            ma.domainGroups[domainIndex].numAtoms += 1;
+        for (int atom = 0; atom < mtop.natoms; atom++)
+        {
+            indices[domainIndices[atom]].push_back(atom);
+            ma.domainGroups[domainIndices[atom]].numAtoms += 1;
         }
     }
 
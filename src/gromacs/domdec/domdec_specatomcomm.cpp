@@ -62,6 +62,7 @@
 #include "gromacs/math/vec.h"
 #include "gromacs/mdtypes/commrec.h"
 #include "gromacs/pbcutil/ishift.h"
+#include "gromacs/utility/arrayref.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/gmxassert.h"
 
@@ -459,14 +460,25 @@ int setup_specat_communication(gmx_domdec_t*             dd,
             spas->a.clear();
             spac->ibuf.clear();
             nsend[0] = 0;
+            /* Look up all requested home atoms at once, the home atoms are
+             * returned in the order of the requests.
+             */
+            const gmx::ArrayRef<const int> request =
+                    gmx::constArrayRefFromArray(ireq->data() + start, nr);
+            spac->homeLocalIndex.resize(nr);
+            spac->homeRequestIndex.resize(nr);
+            const int numHomeAtoms =
+                    dd->ga2la->findHomeBatch(request, spac->homeLocalIndex, spac->homeRequestIndex);
+            int homeAtom = 0;
             for (int i = 0; i < nr; i++)
             {
-                const int indr = (*ireq)[start + i];
+                const int indr = request[i];
                 int       ind;
                 /* Check if this is a home atom and if so ind will be set */
-                if (const int* homeIndex = dd->ga2la->findHome(indr))
+                if (homeAtom < numHomeAtoms && spac->homeRequestIndex[homeAtom] == i)
                 {
-                    ind = *homeIndex;
+                    ind = spac->homeLocalIndex[homeAtom];
+                    homeAtom++;
                 }
                 else
                 {
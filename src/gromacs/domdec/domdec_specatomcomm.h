@@ -73,8 +73,10 @@ struct gmx_domdec_specat_comm_t
     /* The number of indices to receive during the setup */
     int nreq[DIM][2][2] = { { { 0 } } }; /**< The nr. of atoms requested, per DIM, direction and direct/indirect */
     /* The atoms to send */
-    gmx_specatsend_t  spas[DIM][2]; /**< The communication setup per DIM, direction */
-    std::vector<bool> sendAtom;     /**< Work buffer that tells if spec.atoms should be sent */
+    gmx_specatsend_t  spas[DIM][2];     /**< The communication setup per DIM, direction */
+    std::vector<bool> sendAtom;         /**< Work buffer that tells if spec.atoms should be sent */
+    std::vector<int>  homeLocalIndex;   /**< Work buffer, local indices of home atoms */
+    std::vector<int>  homeRequestIndex; /**< Work buffer, request indices of home atoms */
 
     /* Send buffers */
     std::vector<int>       ibuf;  /**< Integer send buffer */
@@ -77,6 +77,7 @@
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/listoflists.h"
 #include "gromacs/utility/logger.h"
 #include "gromacs/utility/smalloc.h"
@@ -453,29 +454,38 @@ void dd_print_missing_interactions(const gmx::MDLogger&           mdlog,
     gmx_fatal_collective(FARGS, cr->mpi_comm_mygroup, MASTER(cr), "%s", errorMessage.c_str());
 }
 
-/*! \brief Return global topology molecule information for global atom index \p i_gl */
+/*! \brief Return global topology molecule information for global atom index \p i_gl
+ *
+ * The molblock index passed in \p mb is checked first, so passing the
+ * result of the previous call avoids the search for consecutive atoms
+ * in the same molblock, which is the common case.
+ */
 static void global_atomnr_to_moltype_ind(const gmx_reverse_top_t* rt, int i_gl, int* mb, int* mt, int* mol, int* i_mol)
 {
-    const MolblockIndices* mbi   = rt->mbi.data();
-    int                    start = 0;
-    int                    end   = rt->mbi.size(); /* exclusive */
-    int                    mid;
+    const MolblockIndices* mbi = rt->mbi.data();
+    int                    mid = *mb;
 
-    /* binary search for molblock_ind */
-    while (TRUE)
+    if (mid < 0 || mid >= gmx::ssize(rt->mbi) || i_gl < mbi[mid].a_start || i_gl >= mbi[mid].a_end)
     {
-        mid = (start + end) / 2;
-        if (i_gl >= mbi[mid].a_end)
-        {
-            start = mid + 1;
-        }
-        else if (i_gl < mbi[mid].a_start)
-        {
-            end = mid;
-        }
-        else
+        int start = 0;
+        int end   = rt->mbi.size(); /* exclusive */
+
+        /* binary search for molblock_ind */
+        while (TRUE)
         {
-            break;
+            mid = (start + end) / 2;
+            if (i_gl >= mbi[mid].a_end)
+            {
+                start = mid + 1;
+            }
+            else if (i_gl < mbi[mid].a_start)
+            {
+                end = mid;
+            }
+            else
+            {
+                break;
+            }
         }
     }
 
@@ -657,7 +667,23 @@ static gmx_reverse_top_t make_reverse_top(const gmx_mtop_t* mtop,
     rt.bInterAtomicInteractions = mtop->bIntermolecularInteractions;
     rt.ril_mt.resize(mtop->moltype.size());
     rt.ril_mt_tot_size = 0;
-    std::vector<int> nint_mt;
+    std::vector<int> nint_mt(mtop->moltype.size());
+    /* Make the atom to interaction lists for the molecule types,
+     * these are independent, so we can use multiple threads.
+     */
+    const int numThreads = gmx_omp_nthreads_get(emntDomdec);
+#pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+    for (int mt = 0; mt < gmx::ssize(mtop->moltype); mt++)
+    {
+        try
+        {
+            const gmx_moltype_t& molt = mtop->moltype[mt];
+
+            nint_mt[mt] = make_reverse_ilist(molt.ilist, &molt.atoms, rt.bConstr, rt.bSettle,
+                                             rt.bBCheck, FALSE, &rt.ril_mt[mt]);
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
     for (size_t mt = 0; mt < mtop->moltype.size(); mt++)
     {
         const gmx_moltype_t& molt = mtop->moltype[mt];
@@ -666,11 +692,6 @@ static gmx_reverse_top_t make_reverse_top(const gmx_mtop_t* mtop,
             rt.bInterAtomicInteractions = true;
         }
 
-        /* Make the atom to interaction list for this molecule type */
-        int numberOfInteractions = make_reverse_ilist(
-                molt.ilist, &molt.atoms, rt.bConstr, rt.bSettle, rt.bBCheck, FALSE, &rt.ril_mt[mt]);
-        nint_mt.push_back(numberOfInteractions);
-
         rt.ril_mt_tot_size += rt.ril_mt[mt].index[molt.atoms.nr];
     }
     if (debug)
@@ -756,16 +777,28 @@ void dd_make_reverse_top(FILE*                           fplog,
             make_reverse_top(mtop, ir->efep != efepNO, !dd->comm->systemInfo.haveSplitConstraints,
                              !dd->comm->systemInfo.haveSplitSettles, bBCheck, &dd->nbonded_global);
 
-    dd->haveExclusions = false;
+    /* Check the exclusions once per molecule type that is present */
+    std::vector<bool> moltypeIsPresent(mtop->moltype.size(), false);
     for (const gmx_molblock_t& molb : mtop->molblock)
     {
-        const int maxNumExclusionsPerAtom = getMaxNumExclusionsPerAtom(mtop->moltype[molb.type].excls);
-        // We checked above that max 1 exclusion means only self exclusions
-        if (maxNumExclusionsPerAtom > 1)
+        moltypeIsPresent[molb.type] = true;
+    }
+    bool      haveExclusions = false;
+    const int numThreads     = gmx_omp_nthreads_get(emntDomdec);
+#pragma omp parallel for num_threads(numThreads) schedule(dynamic) reduction(|| : haveExclusions)
+    for (int mt = 0; mt < gmx::ssize(mtop->moltype); mt++)
+    {
+        try
         {
-            dd->haveExclusions = true;
+            // We checked above that max 1 exclusion means only self exclusions
+            if (moltypeIsPresent[mt] && getMaxNumExclusionsPerAtom(mtop->moltype[mt].excls) > 1)
+            {
+                haveExclusions = true;
+            }
         }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
     }
+    dd->haveExclusions = haveExclusions;
 
     if (vsite && vsite->numInterUpdategroupVirtualSites() > 0)
     {
@@ -1178,7 +1211,27 @@ static inline void check_assign_interactions_atom(int                       i,
                 bUse = TRUE;
                 clear_ivec(k_zero);
                 clear_ivec(k_plus);
-                for (k = 1; k <= nral && bUse; k++)
+
+                /* The reverse topology links interactions to their first
+                 * atom, which is atom i in zone iz, so we do not need
+                 * to look up its local index and zone.
+                 */
+                GMX_ASSERT(iatoms[1] == (bInterMolInteractions ? i_gl : i_mol),
+                           "Interactions should be linked to their first atom");
+                tiatoms[1] = i;
+                for (int d = 0; d < DIM; d++)
+                {
+                    if (zones->shift[iz][d] == 0)
+                    {
+                        k_zero[d] = 1;
+                    }
+                    else
+                    {
+                        k_plus[d] = 1;
+                    }
+                }
+
+                for (k = 2; k <= nral && bUse; k++)
                 {
                     int k_gl;
                     if (!bInterMolInteractions)
@@ -1272,7 +1325,8 @@ static int make_bondeds_zone(gmx_domdec_t*                      dd,
                              int                                izone,
                              const gmx::Range<int>&             atomRange)
 {
-    int                mb, mt, mol, i_mol;
+    int                mb = 0;
+    int                mt, mol, i_mol;
     gmx_bool           bBCheck;
     gmx_reverse_top_t* rt;
     int                nbonded_local;
@@ -1332,13 +1386,14 @@ static void make_exclusions_zone(gmx_domdec_t*                     dd,
     const gmx::index oldNumLists = lexcls->ssize();
 
     std::vector<int> exclusionsForAtom;
+    int              mb = 0;
     for (int at = at_start; at < at_end; at++)
     {
         exclusionsForAtom.clear();
 
         if (GET_CGINFO_EXCL_INTER(cginfo[at]))
         {
-            int a_gl, mb, mt, mol, a_mol;
+            int a_gl, mt, mol, a_mol;
 
             /* Copy the exclusions from the global top */
             a_gl = dd->globalAtomIndices[at];
@@ -1775,28 +1830,39 @@ t_blocka* makeBondedLinks(const gmx_mtop_t& mtop, gmx::ArrayRef<cginfo_mb_t> cgi
 
         if (molb.nmol > mol)
         {
-            /* Copy the data for the rest of the molecules in this block */
+            /* Copy the data for the rest of the molecules in this block.
+             * All copies are shifted versions of the last molecule done
+             * above, so the molecules can be processed independently.
+             */
             link->nalloc_a += (molb.nmol - mol) * nlink_mol;
             srenew(link->a, link->nalloc_a);
-            for (; mol < molb.nmol; mol++)
+            const int numAtomsMol    = molt.atoms.nr;
+            const int firstCopiedMol = mol;
+            const int sourceOffset   = cg_offset - numAtomsMol;
+            const int numThreads     = gmx_omp_nthreads_get(emntDomdec);
+#pragma omp parallel for num_threads(numThreads) schedule(static) reduction(+ : ncgi)
+            for (int copiedMol = firstCopiedMol; copiedMol < molb.nmol; copiedMol++)
             {
-                for (int a = 0; a < molt.atoms.nr; a++)
+                const int numShifts = copiedMol - firstCopiedMol + 1;
+                const int molOffset = sourceOffset + numShifts * numAtomsMol;
+                for (int a = 0; a < numAtomsMol; a++)
                 {
-                    int cg_gl              = cg_offset + a;
-                    link->index[cg_gl + 1] = link->index[cg_gl + 1 - molt.atoms.nr] + nlink_mol;
-                    for (int j = link->index[cg_gl]; j < link->index[cg_gl + 1]; j++)
+                    const int cg_gl       = molOffset + a;
+                    const int sourceBegin = link->index[sourceOffset + a];
+                    const int sourceEnd   = link->index[sourceOffset + a + 1];
+                    link->index[cg_gl + 1] = sourceEnd + numShifts * nlink_mol;
+                    for (int j = sourceBegin; j < sourceEnd; j++)
                     {
-                        link->a[j] = link->a[j - nlink_mol] + molt.atoms.nr;
+                        link->a[j + numShifts * nlink_mol] = link->a[j] + numShifts * numAtomsMol;
                     }
-                    if (link->index[cg_gl + 1] - link->index[cg_gl] > 0
-                        && cg_gl - cgi_mb->cg_start < cgi_mb->cg_mod)
+                    if (sourceEnd - sourceBegin > 0 && cg_gl - cgi_mb->cg_start < cgi_mb->cg_mod)
                     {
                         SET_CGINFO_BOND_INTER(cgi_mb->cginfo[cg_gl - cgi_mb->cg_start]);
                         ncgi++;
                     }
                 }
-                cg_offset += molt.atoms.nr;
             }
+            cg_offset += (molb.nmol - firstCopiedMol) * numAtomsMol;
         }
     }
 
@@ -2005,6 +2071,11 @@ void dd_bonded_cg_distance(const gmx::MDLogger& mdlog,
 
     bExclRequired = inputrecExclForces(ir);
 
+    /* This is called before the thread counts of the modules are set up,
+     * while the other ranks are waiting for the result.
+     */
+    const int numThreads = gmx_omp_get_max_threads();
+
     *r_2b     = 0;
     *r_mb     = 0;
     at_offset = 0;
@@ -2023,25 +2094,55 @@ void dd_bonded_cg_distance(const gmx::MDLogger& mdlog,
                 graph = mk_graph_moltype(molt);
             }
 
-            std::vector<RVec> xs(molt.atoms.nr);
-            for (int mol = 0; mol < molb.nmol; mol++)
+            /* The molecules are independent, so we can use multiple threads.
+             * Each thread handles a contiguous range of molecules and the
+             * thread results are reduced in order, so the reported
+             * interactions do not depend on the number of threads.
+             */
+            std::vector<bonded_distance_t> bd_2b_thread(numThreads, { 0, -1, -1, -1 });
+            std::vector<bonded_distance_t> bd_mb_thread(numThreads, { 0, -1, -1, -1 });
+#pragma omp parallel num_threads(numThreads)
             {
-                getWholeMoleculeCoordinates(&molt, &mtop->ffparams, ir->pbcType, &graph, box,
-                                            x.subArray(at_offset, molt.atoms.nr), xs);
+                try
+                {
+                    const int         thread      = gmx_omp_get_thread_num();
+                    t_graph           threadGraph = graph;
+                    std::vector<RVec> xs(molt.atoms.nr);
+#pragma omp for schedule(static)
+                    for (int mol = 0; mol < molb.nmol; mol++)
+                    {
+                        const int molOffset = at_offset + mol * molt.atoms.nr;
 
-                bonded_distance_t bd_mol_2b = { 0, -1, -1, -1 };
-                bonded_distance_t bd_mol_mb = { 0, -1, -1, -1 };
+                        getWholeMoleculeCoordinates(&molt, &mtop->ffparams, ir->pbcType,
+                                                    &threadGraph, box,
+                                                    x.subArray(molOffset, molt.atoms.nr), xs);
 
-                bonded_cg_distance_mol(&molt, bBCheck, bExclRequired, xs, &bd_mol_2b, &bd_mol_mb);
+                        bonded_distance_t bd_mol_2b = { 0, -1, -1, -1 };
+                        bonded_distance_t bd_mol_mb = { 0, -1, -1, -1 };
 
-                /* Process the mol data adding the atom index offset */
-                update_max_bonded_distance(bd_mol_2b.r2, bd_mol_2b.ftype, at_offset + bd_mol_2b.a1,
-                                           at_offset + bd_mol_2b.a2, &bd_2b);
-                update_max_bonded_distance(bd_mol_mb.r2, bd_mol_mb.ftype, at_offset + bd_mol_mb.a1,
-                                           at_offset + bd_mol_mb.a2, &bd_mb);
+                        bonded_cg_distance_mol(&molt, bBCheck, bExclRequired, xs, &bd_mol_2b,
+                                               &bd_mol_mb);
 
-                at_offset += molt.atoms.nr;
+                        /* Process the mol data adding the atom index offset */
+                        update_max_bonded_distance(bd_mol_2b.r2, bd_mol_2b.ftype,
+                                                   molOffset + bd_mol_2b.a1,
+                                                   molOffset + bd_mol_2b.a2, &bd_2b_thread[thread]);
+                        update_max_bonded_distance(bd_mol_mb.r2, bd_mol_mb.ftype,
+                                                   molOffset + bd_mol_mb.a1,
+                                                   molOffset + bd_mol_mb.a2, &bd_mb_thread[thread]);
+                    }
+                }
+                GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+            }
+            for (int thread = 0; thread < numThreads; thread++)
+            {
+                const bonded_distance_t& bdt_2b = bd_2b_thread[thread];
+                const bonded_distance_t& bdt_mb = bd_mb_thread[thread];
+                update_max_bonded_distance(bdt_2b.r2, bdt_2b.ftype, bdt_2b.a1, bdt_2b.a2, &bd_2b);
+                update_max_bonded_distance(bdt_mb.r2, bdt_mb.ftype, bdt_mb.a1, bdt_mb.a2, &bd_mb);
             }
+
+            at_offset += molb.nmol * molt.atoms.nr;
         }
     }
 
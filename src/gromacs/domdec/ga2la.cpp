@@ -80,3 +80,53 @@ gmx_ga2la_t::gmx_ga2la_t(int numAtomsTotal, int numAtomsLocal) :
         new (&(data_.hashed)) gmx::HashedMap<Entry>(numAtomsLocal);
     }
 }
+
+int gmx_ga2la_t::findHomeBatch(gmx::ArrayRef<const int> globalAtomIndices,
+                               gmx::ArrayRef<int>       localAtomIndices,
+                               gmx::ArrayRef<int>       collectiveIndices) const
+{
+    GMX_ASSERT(localAtomIndices.size() >= globalAtomIndices.size(),
+               "The local index buffer should be at least as large as the global index list");
+    GMX_ASSERT(collectiveIndices.empty() || collectiveIndices.size() >= globalAtomIndices.size(),
+               "The collective index buffer should be empty or sufficiently large");
+
+    const bool storeCollectiveIndices = !collectiveIndices.empty();
+    const int  numAtoms               = globalAtomIndices.ssize();
+
+    int numHomeAtoms = 0;
+    if (usingDirect_)
+    {
+        const Entry* entries = data_.direct.data();
+        for (int i = 0; i < numAtoms; i++)
+        {
+            const Entry& entry = entries[globalAtomIndices[i]];
+            if (entry.cell == 0)
+            {
+                localAtomIndices[numHomeAtoms] = entry.la;
+                if (storeCollectiveIndices)
+                {
+                    collectiveIndices[numHomeAtoms] = i;
+                }
+                numHomeAtoms++;
+            }
+        }
+    }
+    else
+    {
+        for (int i = 0; i < numAtoms; i++)
+        {
+            const Entry* entry = data_.hashed.find(globalAtomIndices[i]);
+            if (entry != nullptr && entry->cell == 0)
+            {
+                localAtomIndices[numHomeAtoms] = entry->la;
+                if (storeCollectiveIndices)
+                {
+                    collectiveIndices[numHomeAtoms] = i;
+                }
+                numHomeAtoms++;
+            }
+        }
+    }
+
+    return numHomeAtoms;
+}
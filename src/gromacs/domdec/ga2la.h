@@ -52,6 +52,7 @@
 #include <vector>
 
 #include "gromacs/domdec/hashedmap.h"
+#include "gromacs/utility/arrayref.h"
 #include "gromacs/utility/gmxassert.h"
 
 /*! \libinternal \brief Global to local atom mapping
@@ -130,6 +131,25 @@ public:
         return (e && e->cell == 0) ? &(e->la) : nullptr;
     }
 
+    /*! \brief Finds the home atoms for a batch of global atom indices
+     *
+     * Loops over \p globalAtomIndices and, for each atom that is a home atom,
+     * stores its local index consecutively in \p localAtomIndices and,
+     * when \p collectiveIndices is not empty, its index in \p globalAtomIndices
+     * in \p collectiveIndices. This is more efficient than calling findHome()
+     * for each atom, as the choice of lookup method is made once per batch.
+     *
+     * \param[in]  globalAtomIndices  The global atom indices to look up
+     * \param[out] localAtomIndices   The local indices of the home atoms, size should be at
+     *                                least the size of \p globalAtomIndices
+     * \param[out] collectiveIndices  The indices in \p globalAtomIndices of the home atoms,
+     *                                empty or same size requirement as \p localAtomIndices
+     * \returns The number of home atoms found
+     */
+    int findHomeBatch(gmx::ArrayRef<const int> globalAtomIndices,
+                      gmx::ArrayRef<int>       localAtomIndices,
+                      gmx::ArrayRef<int>       collectiveIndices) const;
+
     /*! \brief Returns a reference to the entry for a_gl
      *
      * A non-release assert checks that a_gl is present.
@@ -68,30 +68,21 @@ LocalAtomSetData::LocalAtomSetData(ArrayRef<const index> globalIndex) :
 
 void LocalAtomSetData::setLocalAndCollectiveIndices(const gmx_ga2la_t& ga2la)
 {
-    /* Loop over all the atom indices of the set to check which ones are local.
+    /* Find the home atoms of the set in one batch, this stores, for each home
+     * atom, its local index and its index in the collective index array.
+     * The latter is needed when reducing the local arrays to a collective/global
+     * array in communicate_group_positions.
      * cf. dd_make_local_group_indices in groupcoord.cpp
      */
-    int numAtomsGlobal = globalIndex_.size();
+    localIndex_.resize(globalIndex_.size());
+    collectiveIndex_.resize(globalIndex_.size());
 
-    /* Clear vector without changing capacity,
-     * because we expect the size of the vectors to vary little. */
-    localIndex_.resize(0);
-    collectiveIndex_.resize(0);
-
-    for (int iCollective = 0; iCollective < numAtomsGlobal; iCollective++)
-    {
-        if (const int* iLocal = ga2la.findHome(globalIndex_[iCollective]))
-        {
-            /* Save the atoms index in the local atom numbers array */
-            /* The atom with this index is a home atom. */
-            localIndex_.push_back(*iLocal);
+    const int numHomeAtoms = ga2la.findHomeBatch(globalIndex_, localIndex_, collectiveIndex_);
 
-            /* Keep track of where this local atom belongs in the collective index array.
-             * This is needed when reducing the local arrays to a collective/global array
-             * in communicate_group_positions */
-            collectiveIndex_.push_back(iCollective);
-        }
-    }
+    /* Shrink the vectors without changing capacity,
+     * because we expect the size of the vectors to vary little. */
+    localIndex_.resize(numHomeAtoms);
+    collectiveIndex_.resize(numHomeAtoms);
 }
 
 } // namespace internal
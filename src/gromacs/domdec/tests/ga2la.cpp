@@ -0,0 +1,114 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the gmx_ga2la_t class.
+ *
+ * \ingroup module_domdec
+ */
+#include "gmxpre.h"
+
+#include "gromacs/domdec/ga2la.h"
+
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "testutils/testasserts.h"
+
+namespace
+{
+
+/*! \brief Tests the batched lookup of home atoms
+ *
+ * \param[in] numAtomsTotal  The total number of atoms, determines together with
+ *                           \p numAtomsLocal whether the direct or hashed
+ *                           lookup is used
+ * \param[in] numAtomsLocal  The estimated number of local atoms
+ */
+void testFindHomeBatch(int numAtomsTotal, int numAtomsLocal)
+{
+    gmx_ga2la_t ga2la(numAtomsTotal, numAtomsLocal);
+
+    // Two home atoms, one halo atom in zone 1, the rest is not local
+    ga2la.insert(3, { 0, 0 });
+    ga2la.insert(1024, { 1, 0 });
+    ga2la.insert(7, { 2, 1 });
+
+    const std::vector<int> globalIndices = { 5, 1024, 7, 3, 0 };
+    std::vector<int>       localIndices(globalIndices.size());
+    std::vector<int>       collectiveIndices(globalIndices.size());
+
+    int numHomeAtoms = ga2la.findHomeBatch(globalIndices, localIndices, collectiveIndices);
+    ASSERT_EQ(numHomeAtoms, 2);
+    EXPECT_EQ(localIndices[0], 1);
+    EXPECT_EQ(collectiveIndices[0], 1);
+    EXPECT_EQ(localIndices[1], 0);
+    EXPECT_EQ(collectiveIndices[1], 3);
+
+    // Check that the batched lookup agrees with the single lookup
+    for (int i = 0; i < numHomeAtoms; i++)
+    {
+        const int* homeIndex = ga2la.findHome(globalIndices[collectiveIndices[i]]);
+        ASSERT_NE(homeIndex, nullptr);
+        EXPECT_EQ(*homeIndex, localIndices[i]);
+    }
+
+    // Storing the collective indices is optional
+    std::fill(localIndices.begin(), localIndices.end(), -1);
+    numHomeAtoms = ga2la.findHomeBatch(globalIndices, localIndices, {});
+    EXPECT_EQ(numHomeAtoms, 2);
+    EXPECT_THAT(localIndices, testing::ElementsAre(1, 0, -1, -1, -1));
+}
+
+TEST(Ga2la, FindHomeBatchWithDirectList)
+{
+    testFindHomeBatch(2000, 1000);
+}
+
+TEST(Ga2la, FindHomeBatchWithHashedMap)
+{
+    testFindHomeBatch(100000, 100);
+}
+
+TEST(Ga2la, FindHomeBatchHandlesEmptyInput)
+{
+    gmx_ga2la_t ga2la(100, 100);
+
+    EXPECT_EQ(ga2la.findHomeBatch({}, {}, {}), 0);
+}
+
+} // namespace
@@ -43,6 +43,7 @@
 #include <cstring>
 
 #include <algorithm>
+#include <memory>
 
 #include "gromacs/fileio/gmxfio.h"
 #include "gromacs/fileio/gmxfio_xdr.h"
@@ -94,6 +95,8 @@ struct ener_file
     t_fileio*  fio;
     int        framenr;
     real       frametime;
+    int        nre;    /* The number of energy terms in the names */
+    gmx_bool   bQuiet; /* Do not report progress and problems when reading */
 };
 
 static void enxsubblock_init(t_enxsubblock* sb)
@@ -435,6 +438,8 @@ void do_enxnms(ener_file_t ef, int* nre, gmx_enxnm_t** nms)
     }
 
     edr_strings(xdr, bRead, file_version, *nre, nms);
+
+    ef->nre = *nre;
 }
 
 static gmx_bool do_eheader(ener_file_t ef,
@@ -950,16 +955,57 @@ static void convert_full_sums(ener_old_t* ener_old, t_enxframe* fr)
     ener_old->step_prev = fr->step;
 }
 
+/* Returns the size in the file of an item of type in a subblock, 0 for variable size */
+static gmx_off_t enx_datatype_size(xdr_datatype type)
+{
+    switch (type)
+    {
+        /* XDR stores all items smaller than 4 bytes in 4 bytes */
+        case xdr_datatype_float:
+        case xdr_datatype_int:
+        case xdr_datatype_char: return 4;
+        case xdr_datatype_double:
+        case xdr_datatype_int64: return 8;
+        default: return 0;
+    }
+}
+
+/* Seeks forward over *skipSize bytes of frame data that are not needed */
+static gmx_bool enx_skip(ener_file_t ef, gmx_off_t* skipSize)
+{
+    if (*skipSize > 0)
+    {
+        if (gmx_fio_seek(ef->fio, gmx_fio_ftell(ef->fio) + *skipSize) != 0)
+        {
+            return FALSE;
+        }
+        *skipSize = 0;
+    }
+
+    return TRUE;
+}
+
 gmx_bool do_enx(ener_file_t ef, t_enxframe* fr)
 {
-    int      file_version = -1;
-    int      i, b;
-    gmx_bool bRead, bOK, bOK1, bSane;
-    real     tmp1, tmp2, rdum;
+    return do_enx_selected(ef, fr, nullptr, nullptr);
+}
+
+gmx_bool do_enx_selected(ener_file_t     ef,
+                         t_enxframe*     fr,
+                         const gmx_bool* bReadTerm,
+                         const gmx_bool* bReadBlock)
+{
+    int       file_version = -1;
+    int       i, b;
+    gmx_bool  bRead, bOK, bOK1, bSane;
+    real      tmp1, tmp2, rdum;
+    gmx_off_t skipSize = 0;
     /*int       d_size;*/
 
     bOK   = TRUE;
     bRead = gmx_fio_getread(ef->fio);
+    GMX_RELEASE_ASSERT(bRead || (bReadTerm == nullptr && bReadBlock == nullptr),
+                       "Only all terms and blocks can be written");
     if (!bRead)
     {
         fr->e_size = fr->nre * sizeof(fr->ener[0].e) * 4;
@@ -970,14 +1016,17 @@ gmx_bool do_enx(ener_file_t ef, t_enxframe* fr)
     {
         if (bRead)
         {
-            fprintf(stderr, "\rLast energy frame read %d time %8.3f         ", ef->framenr - 1,
-                    ef->frametime);
-            fflush(stderr);
-
-            if (!bOK)
+            if (!ef->bQuiet)
             {
-                fprintf(stderr, "\nWARNING: Incomplete energy frame: nr %d time %8.3f\n",
-                        ef->framenr, fr->t);
+                fprintf(stderr, "\rLast energy frame read %d time %8.3f         ",
+                        ef->framenr - 1, ef->frametime);
+                fflush(stderr);
+
+                if (!bOK)
+                {
+                    fprintf(stderr, "\nWARNING: Incomplete energy frame: nr %d time %8.3f\n",
+                            ef->framenr, fr->t);
+                }
             }
         }
         else
@@ -988,7 +1037,8 @@ gmx_bool do_enx(ener_file_t ef, t_enxframe* fr)
     }
     if (bRead)
     {
-        if ((ef->framenr < 20 || ef->framenr % 10 == 0) && (ef->framenr < 200 || ef->framenr % 100 == 0)
+        if (!ef->bQuiet && (ef->framenr < 20 || ef->framenr % 10 == 0)
+            && (ef->framenr < 200 || ef->framenr % 100 == 0)
             && (ef->framenr < 2000 || ef->framenr % 1000 == 0))
         {
             fprintf(stderr, "\rReading energy frame %6d time %8.3f         ", ef->framenr, fr->t);
@@ -1002,7 +1052,7 @@ gmx_bool do_enx(ener_file_t ef, t_enxframe* fr)
     {
         bSane = bSane || (fr->block[b].nsub > 0);
     }
-    if (!((fr->step >= 0) && bSane) && bRead)
+    if (!((fr->step >= 0) && bSane) && bRead && !ef->bQuiet)
     {
         fprintf(stderr, "\nWARNING: there may be something wrong with energy file %s\n",
                 gmx_fio_getname(ef->fio));
@@ -1021,8 +1071,37 @@ gmx_bool do_enx(ener_file_t ef, t_enxframe* fr)
         fr->e_alloc = fr->nre;
     }
 
+    /* Old format files store full sums, which we can only convert
+     * to sums between frames when we read all terms.
+     */
+    if (ef->eo.bOldFileOpen)
+    {
+        bReadTerm = nullptr;
+    }
+    if (bReadTerm != nullptr && fr->nre > ef->nre)
+    {
+        gmx_fatal(FARGS, "Energy frame in %s has %d terms, but there are only %d names",
+                  gmx_fio_getname(ef->fio), fr->nre, ef->nre);
+    }
+    const gmx_off_t realSize = (gmx_fio_is_double(ef->fio) ? sizeof(double) : sizeof(float));
+
     for (i = 0; i < fr->nre; i++)
     {
+        if (bReadTerm != nullptr && !bReadTerm[i])
+        {
+            /* Skip over e and, when present, the sums */
+            fr->ener[i].e    = 0;
+            fr->ener[i].eav  = 0;
+            fr->ener[i].esum = 0;
+            skipSize += realSize;
+            if (file_version == 1 || fr->nsum > 0)
+            {
+                skipSize += (file_version == 1 ? 3 : 2) * realSize;
+            }
+            continue;
+        }
+        bOK = bOK && enx_skip(ef, &skipSize);
+
         bOK = bOK && gmx_fio_do_real(ef->fio, fr->ener[i].e);
 
         /* Do not store sums of length 1,
@@ -1069,6 +1148,28 @@ gmx_bool do_enx(ener_file_t ef, t_enxframe* fr)
         int nsub = fr->block[b].nsub; /* shortcut */
         int i;
 
+        if (bReadBlock != nullptr)
+        {
+            const int id        = fr->block[b].id;
+            gmx_bool  bSkip     = !(id >= 0 && id < enxNR && bReadBlock[id]);
+            gmx_off_t blockSize = 0;
+            for (i = 0; i < nsub && bSkip; i++)
+            {
+                const gmx_off_t itemSize = enx_datatype_size(fr->block[b].sub[i].type);
+                /* We can not skip strings, since their size is not stored */
+                bSkip = (itemSize > 0);
+                blockSize += itemSize * fr->block[b].sub[i].nr;
+            }
+            if (bSkip)
+            {
+                /* Mark the block as empty, its subblocks are not read */
+                skipSize += blockSize;
+                fr->block[b].nsub = 0;
+                continue;
+            }
+        }
+        bOK = bOK && enx_skip(ef, &skipSize);
+
         for (i = 0; i < nsub; i++)
         {
             t_enxsubblock* sub = &(fr->block[b].sub[i]); /* shortcut */
@@ -1106,6 +1207,8 @@ gmx_bool do_enx(ener_file_t ef, t_enxframe* fr)
         }
     }
 
+    bOK = bOK && enx_skip(ef, &skipSize);
+
     if (!bRead)
     {
         if (gmx_fio_flush(ef->fio) != 0)
@@ -1118,8 +1221,12 @@ gmx_bool do_enx(ener_file_t ef, t_enxframe* fr)
     {
         if (bRead)
         {
-            fprintf(stderr, "\nLast energy frame read %d", ef->framenr - 1);
-            fprintf(stderr, "\nWARNING: Incomplete energy frame: nr %d time %8.3f\n", ef->framenr, fr->t);
+            if (!ef->bQuiet)
+            {
+                fprintf(stderr, "\nLast energy frame read %d", ef->framenr - 1);
+                fprintf(stderr, "\nWARNING: Incomplete energy frame: nr %d time %8.3f\n",
+                        ef->framenr, fr->t);
+            }
         }
         else
         {
@@ -1131,6 +1238,53 @@ gmx_bool do_enx(ener_file_t ef, t_enxframe* fr)
     return TRUE;
 }
 
+std::vector<gmx_enxframe_index_t> index_enx(ener_file_t ef)
+{
+    std::vector<gmx_enxframe_index_t> frameIndex;
+
+    if (ef->eo.bOldFileOpen)
+    {
+        return frameIndex;
+    }
+
+    const gmx_off_t startPos  = gmx_fio_ftell(ef->fio);
+    const int       framenr   = ef->framenr;
+    const real      frametime = ef->frametime;
+
+    /* Read only the headers, skipping all terms and blocks */
+    ef->bQuiet = TRUE;
+    std::unique_ptr<gmx_bool[]> bReadNone(new gmx_bool[std::max(ef->nre, int(enxNR))]());
+    t_enxframe                  fr;
+    init_enxframe(&fr);
+    gmx_enxframe_index_t frame;
+    frame.offset = startPos;
+    while (do_enx_selected(ef, &fr, bReadNone.get(), bReadNone.get()))
+    {
+        frame.framenr = framenr + frameIndex.size();
+        frame.t       = fr.t;
+        frame.step    = fr.step;
+        frameIndex.push_back(frame);
+        frame.offset = gmx_fio_ftell(ef->fio);
+    }
+    free_enxframe(&fr);
+
+    ef->bQuiet = FALSE;
+    gmx_fio_seek(ef->fio, startPos);
+    ef->framenr   = framenr;
+    ef->frametime = frametime;
+
+    return frameIndex;
+}
+
+void seek_enx(ener_file_t ef, const gmx_enxframe_index_t& frame)
+{
+    if (gmx_fio_seek(ef->fio, frame.offset) != 0)
+    {
+        gmx_file(gmx_fio_getname(ef->fio));
+    }
+    ef->framenr = frame.framenr;
+}
+
 static real find_energy(const char* name, int nre, gmx_enxnm_t* enm, t_enxframe* fr)
 {
     int i;
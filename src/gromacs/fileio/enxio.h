@@ -38,6 +38,8 @@
 #ifndef GMX_FILEIO_ENXIO_H
 #define GMX_FILEIO_ENXIO_H
 
+#include <vector>
+
 #include "gromacs/fileio/xdr_datatype.h"
 #include "gromacs/utility/basedefinitions.h"
 #include "gromacs/utility/real.h"
@@ -178,6 +180,37 @@ void free_enxnms(int n, gmx_enxnm_t* nms);
 gmx_bool do_enx(ener_file_t ef, t_enxframe* fr);
 /* Reads enx_frames, memory in fr is (re)allocated if necessary */
 
+gmx_bool do_enx_selected(ener_file_t     ef,
+                         t_enxframe*     fr,
+                         const gmx_bool* bReadTerm,
+                         const gmx_bool* bReadBlock);
+/* As do_enx, but only reads energy term i when bReadTerm[i] is set and
+ * blocks with id when bReadBlock[id] is set (bReadBlock has enxNR elements).
+ * The data of other terms and blocks is skipped by seeking over it.
+ * Skipped terms are set to zero and skipped blocks have nsub=0.
+ * Blocks with strings are always read, since their size is not stored.
+ * Passing nullptr for bReadTerm or bReadBlock reads all terms or blocks.
+ */
+
+/* The position and time of an energy frame in a file */
+typedef struct
+{
+    int64_t offset;  /* position of the frame in the file */
+    int     framenr; /* index of the frame in the file */
+    double  t;       /* time of the frame */
+    int64_t step;    /* step of the frame */
+} gmx_enxframe_index_t;
+
+std::vector<gmx_enxframe_index_t> index_enx(ener_file_t ef);
+/* Returns the positions of all frames from the current position in ef
+ * up to the end of the file. Only the frame headers are read.
+ * The file is repositioned where it was on entry.
+ * Files in the pre-4.1 format can not be indexed, an empty index is returned.
+ */
+
+void seek_enx(ener_file_t ef, const gmx_enxframe_index_t& frame);
+/* Positions ef such that the next do_enx call reads frame */
+
 void get_enx_state(const char* fn, real t, const SimulationGroups& groups, t_inputrec* ir, t_state* state);
 /*
  * Reads state variables from enx file fn at time t.
@@ -0,0 +1,222 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Implements tests for selective reading and indexing of energy files
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "gromacs/fileio/enxio.h"
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/trajectory/energyframe.h"
+#include "gromacs/utility/smalloc.h"
+
+#include "testutils/testfilemanager.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The number of energy terms in the test file
+constexpr int c_numTerms = 3;
+//! The number of frames in the test file
+constexpr int c_numFrames = 3;
+
+//! Returns the value written for \p term in \p frame
+real termValue(int frame, int term)
+{
+    return 10 * frame + term;
+}
+
+class EnxioTest : public ::testing::Test
+{
+public:
+    EnxioTest() : fileName_(fileManager_.getTemporaryFilePath("test.edr"))
+    {
+        writeEnergyFile();
+    }
+
+    /*! \brief Writes frames with energies, sums in the later frames,
+     * a distance restraint block with floats and an AWH block with doubles.
+     */
+    void writeEnergyFile()
+    {
+        ener_file_t ef = open_enx(fileName_.c_str(), "w");
+
+        std::array<gmx_enxnm_t, c_numTerms> names;
+        for (auto& name : names)
+        {
+            name.name = const_cast<char*>("Term");
+            name.unit = const_cast<char*>("kJ/mol");
+        }
+        int          nre = c_numTerms;
+        gmx_enxnm_t* nms = names.data();
+        do_enxnms(ef, &nre, &nms);
+
+        std::array<float, 3>  disre = { 1, 2, 3 };
+        std::array<double, 2> awh   = { 4, 5 };
+        t_enxframe            fr;
+        init_enxframe(&fr);
+        snew(fr.ener, c_numTerms);
+        fr.e_alloc = c_numTerms;
+        add_blocks_enxframe(&fr, 2);
+        fr.block[0].id = enxDISRE;
+        add_subblocks_enxblock(&fr.block[0], 1);
+        fr.block[0].sub[0].type = xdr_datatype_float;
+        fr.block[0].sub[0].nr   = disre.size();
+        fr.block[0].sub[0].fval = disre.data();
+        fr.block[1].id          = enxAWH;
+        add_subblocks_enxblock(&fr.block[1], 1);
+        fr.block[1].sub[0].type = xdr_datatype_double;
+        fr.block[1].sub[0].nr   = awh.size();
+        fr.block[1].sub[0].dval = awh.data();
+        for (int f = 0; f < c_numFrames; f++)
+        {
+            fr.t      = 0.5 * f;
+            fr.step   = 5 * f;
+            fr.nsteps = 5;
+            fr.dt     = 0.1;
+            fr.nsum   = (f == 0 ? 1 : 5);
+            fr.nre    = c_numTerms;
+            for (int i = 0; i < c_numTerms; i++)
+            {
+                fr.ener[i].e    = termValue(f, i);
+                fr.ener[i].eav  = 1;
+                fr.ener[i].esum = 2;
+            }
+            do_enx(ef, &fr);
+        }
+        /* The subblock data is not owned by the frame */
+        fr.block[0].sub[0].fval = nullptr;
+        fr.block[1].sub[0].dval = nullptr;
+        free_enxframe(&fr);
+        done_ener_file(ef);
+    }
+
+    //! Opens the test file for reading
+    ener_file_t openForReading()
+    {
+        ener_file_t  ef  = open_enx(fileName_.c_str(), "r");
+        int          nre = 0;
+        gmx_enxnm_t* nms = nullptr;
+        do_enxnms(ef, &nre, &nms);
+        free_enxnms(nre, nms);
+        EXPECT_EQ(c_numTerms, nre);
+        return ef;
+    }
+
+private:
+    TestFileManager fileManager_;
+    std::string     fileName_;
+};
+
+TEST_F(EnxioTest, ReadsOnlySelectedTermsAndBlocks)
+{
+    ener_file_t                      ef        = openForReading();
+    std::array<gmx_bool, c_numTerms> readTerm  = { FALSE, TRUE, FALSE };
+    std::array<gmx_bool, enxNR>      readBlock = {};
+    readBlock[enxAWH]                          = TRUE;
+    t_enxframe                       fr;
+    init_enxframe(&fr);
+    int numFrames = 0;
+    while (do_enx_selected(ef, &fr, readTerm.data(), readBlock.data()))
+    {
+        EXPECT_EQ(0.5 * numFrames, fr.t);
+        ASSERT_EQ(c_numTerms, fr.nre);
+        EXPECT_EQ(0, fr.ener[0].e);
+        EXPECT_EQ(termValue(numFrames, 1), fr.ener[1].e);
+        EXPECT_EQ(0, fr.ener[2].e);
+        ASSERT_EQ(2, fr.nblock);
+        EXPECT_EQ(0, fr.block[0].nsub);
+        ASSERT_EQ(1, fr.block[1].nsub);
+        ASSERT_EQ(2, fr.block[1].sub[0].nr);
+        EXPECT_EQ(4, fr.block[1].sub[0].dval[0]);
+        EXPECT_EQ(5, fr.block[1].sub[0].dval[1]);
+        numFrames++;
+    }
+    EXPECT_EQ(c_numFrames, numFrames);
+    free_enxframe(&fr);
+    done_ener_file(ef);
+}
+
+TEST_F(EnxioTest, IndexAllowsSeekingToFrames)
+{
+    ener_file_t                             ef         = openForReading();
+    const std::vector<gmx_enxframe_index_t> frameIndex = index_enx(ef);
+    ASSERT_EQ(c_numFrames, frameIndex.size());
+    for (int f = 0; f < c_numFrames; f++)
+    {
+        EXPECT_EQ(f, frameIndex[f].framenr);
+        EXPECT_EQ(0.5 * f, frameIndex[f].t);
+        EXPECT_EQ(5 * f, frameIndex[f].step);
+    }
+
+    t_enxframe fr;
+    init_enxframe(&fr);
+    /* Indexing should not change the position in the file */
+    ASSERT_TRUE(do_enx(ef, &fr));
+    EXPECT_EQ(0, fr.t);
+
+    seek_enx(ef, frameIndex[2]);
+    ASSERT_TRUE(do_enx(ef, &fr));
+    EXPECT_EQ(frameIndex[2].t, fr.t);
+    EXPECT_EQ(termValue(2, 2), fr.ener[2].e);
+    ASSERT_EQ(2, fr.nblock);
+    ASSERT_EQ(1, fr.block[0].nsub);
+    EXPECT_EQ(3, fr.block[0].sub[0].fval[2]);
+
+    seek_enx(ef, frameIndex[1]);
+    ASSERT_TRUE(do_enx(ef, &fr));
+    EXPECT_EQ(termValue(1, 0), fr.ener[0].e);
+    EXPECT_EQ(1, fr.ener[0].eav);
+    EXPECT_EQ(2, fr.ener[0].esum);
+    free_enxframe(&fr);
+    done_ener_file(ef);
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -67,6 +67,7 @@
 #include "gromacs/topology/mtop_util.h"
 #include "gromacs/topology/symtab.h"
 #include "gromacs/topology/topology.h"
+#include "gromacs/utility/arrayref.h"
 #include "gromacs/utility/arraysize.h"
 #include "gromacs/utility/baseversion.h"
 #include "gromacs/utility/cstringutil.h"
@@ -3282,6 +3283,17 @@ PbcType completeTprDeserialization(PartialDeserializedTprFile* partialDeserializ
     return do_tpx_body(&tprBodyDeserializer, &partialDeserializedTpr->header, ir, state, x, v, mtop);
 }
 
+PbcType completeTprDeserialization(TpxFileHeader*           header,
+                                   gmx::ArrayRef<const char> body,
+                                   t_inputrec*               ir,
+                                   gmx_mtop_t*               mtop)
+{
+    // See above for the reason for swapping the endianness
+    gmx::InMemoryDeserializer tprBodyDeserializer(body, header->isDouble,
+                                                  gmx::EndianSwapBehavior::SwapIfHostIsLittleEndian);
+    return do_tpx_body(&tprBodyDeserializer, header, ir, mtop);
+}
+
 PbcType completeTprDeserialization(PartialDeserializedTprFile* partialDeserializedTpr,
                                    t_inputrec*                 ir,
                                    gmx_mtop_t*                 mtop)
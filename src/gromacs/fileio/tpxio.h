@@ -171,6 +171,24 @@ PbcType completeTprDeserialization(PartialDeserializedTprFile* partialDeserializ
                                    t_inputrec*                 ir,
                                    gmx_mtop_t*                 mtop);
 
+/*! \brief
+ * Complete deserialization of a TPR body that is not owned by a PartialDeserializedTprFile.
+ *
+ * Used when the serialized body lives in memory shared between ranks, so the
+ * ranks do not each need their own copy of the buffer.
+ *
+ * \param[in] header Header of the TPR file the body belongs to.
+ * \param[in] body   Serialized TPR body.
+ * \param[out] ir Input rec to populate.
+ * \param[out] mtop Global topology to populate.
+ *
+ * \returns PBC flag.
+ */
+PbcType completeTprDeserialization(TpxFileHeader*            header,
+                                   gmx::ArrayRef<const char> body,
+                                   t_inputrec*               ir,
+                                   gmx_mtop_t*               mtop);
+
 /*! \brief
  * Read a file to set up a simulation and close it after reading.
  *
@@ -94,6 +94,7 @@ struct t_trxstatus
     double               DT, BOX[3];
     gmx_bool             bReadBox;
     char*                persistent_line; /* Persistent line for reading g96 trajectories */
+    t_xtc_compressed_x*  xtcCompressedX;  /* Last xtc frame read with TRX_READ_COMPRESSED_X */
 #if GMX_USE_PLUGINS
     gmx_vmdplugin_t* vmdplugin;
 #endif
@@ -166,6 +167,7 @@ static void status_init(t_trxstatus* status)
     status->t0              = 0;
     status->tf              = 0;
     status->persistent_line = nullptr;
+    status->xtcCompressedX  = nullptr;
     status->tng             = nullptr;
 }
 
@@ -604,6 +606,7 @@ void close_trx(t_trxstatus* status)
         gmx_fio_close(status->fio);
     }
     sfree(status->persistent_line);
+    delete status->xtcCompressedX;
 #if GMX_USE_PLUGINS
     sfree(status->vmdplugin);
 #endif
@@ -614,6 +617,18 @@ void close_trx(t_trxstatus* status)
     sfree(status);
 }
 
+int write_trxframe_compressed(t_trxstatus* status, const t_trxframe* fr, const t_trxstatus* source)
+{
+    if (status->tng || gmx_fio_getftp(status->fio) != efXTC)
+    {
+        gmx_fatal(FARGS, "Compressed coordinates can only be written to an xtc file");
+    }
+    GMX_RELEASE_ASSERT(source->xtcCompressedX,
+                       "The source trajectory should be read with TRX_READ_COMPRESSED_X");
+
+    return write_xtc_compressed(status->fio, fr->step, fr->time, fr->box, source->xtcCompressedX);
+}
+
 t_trxstatus* open_trx(const char* outfile, const char* filemode)
 {
     t_trxstatus* stat;
@@ -816,13 +831,23 @@ bool read_next_frame(const gmx_output_env_t* oenv, t_trxstatus* status, t_trxfra
                     }
                     initcount(status);
                 }
-                bRet = (read_next_xtc(status->fio, fr->natoms, &fr->step, &fr->time, fr->box, fr->x,
-                                      &fr->prec, &bOK)
-                        != 0);
+                if (status->xtcCompressedX)
+                {
+                    bRet = (read_xtc_compressed(status->fio, &fr->natoms, &fr->step, &fr->time,
+                                                fr->box, status->xtcCompressedX, &bOK)
+                            != 0);
+                    fr->prec = status->xtcCompressedX->prec;
+                }
+                else
+                {
+                    bRet = (read_next_xtc(status->fio, fr->natoms, &fr->step, &fr->time, fr->box,
+                                          fr->x, &fr->prec, &bOK)
+                            != 0);
+                }
                 fr->bPrec = (bRet && fr->prec > 0);
                 fr->bStep = bRet;
                 fr->bTime = bRet;
-                fr->bX    = bRet;
+                fr->bX    = (bRet && !status->xtcCompressedX);
                 fr->bBox  = bRet;
                 if (!bOK)
                 {
@@ -846,7 +871,8 @@ bool read_next_frame(const gmx_output_env_t* oenv, t_trxstatus* status, t_trxfra
 
         if (bRet)
         {
-            bMissingData = ((((status->flags & TRX_NEED_X) != 0) && !fr->bX)
+            bMissingData = ((((status->flags & TRX_NEED_X) != 0) && !fr->bX
+                             && !status->xtcCompressedX)
                             || (((status->flags & TRX_NEED_V) != 0) && !fr->bV)
                             || (((status->flags & TRX_NEED_F) != 0) && !fr->bF));
             bSkip        = FALSE;
@@ -939,7 +965,20 @@ bool read_first_frame(const gmx_output_env_t* oenv, t_trxstatus** status, const
             break;
         }
         case efXTC:
-            if (read_first_xtc(fio, &fr->natoms, &fr->step, &fr->time, fr->box, &fr->x, &fr->prec, &bOK) == 0)
+            if (flags & TRX_READ_COMPRESSED_X)
+            {
+                (*status)->xtcCompressedX = new t_xtc_compressed_x;
+                if (read_xtc_compressed(fio, &fr->natoms, &fr->step, &fr->time, fr->box,
+                                        (*status)->xtcCompressedX, &bOK)
+                    == 0)
+                {
+                    fr->not_ok = DATA_NOT_OK;
+                }
+                fr->prec = (*status)->xtcCompressedX->prec;
+            }
+            else if (read_first_xtc(fio, &fr->natoms, &fr->step, &fr->time, fr->box, &fr->x,
+                                    &fr->prec, &bOK)
+                     == 0)
             {
                 GMX_RELEASE_ASSERT(!bOK,
                                    "Inconsistent results - OK status from read_first_xtc, but 0 "
@@ -956,7 +995,7 @@ bool read_first_frame(const gmx_output_env_t* oenv, t_trxstatus** status, const
                 fr->bPrec = (fr->prec > 0);
                 fr->bStep = TRUE;
                 fr->bTime = TRUE;
-                fr->bX    = TRUE;
+                fr->bX    = !(*status)->xtcCompressedX;
                 fr->bBox  = TRUE;
                 printcount(*status, oenv, fr->time, FALSE);
             }
@@ -94,6 +94,12 @@ int write_trxframe(t_trxstatus* status, struct t_trxframe* fr, gmx_conect gc);
  * gc is important for pdb file writing only and may be NULL.
  */
 
+int write_trxframe_compressed(t_trxstatus* status, const t_trxframe* fr, const t_trxstatus* source);
+/* Write the last frame read from source with TRX_READ_COMPRESSED_X
+ * to the xtc file status, copying the compressed coordinates verbatim.
+ * The step, time and box are taken from fr, so these may be changed.
+ */
+
 int write_trx(t_trxstatus*   status,
               int            nind,
               const int*     ind,
@@ -208,6 +214,11 @@ int check_times(real t);
 #define TRX_NEED_F (1u << 5u)
 /* Useful for reading natoms from a trajectory without skipping */
 #define TRX_DONT_SKIP (1u << 6u)
+/* Keep the coordinates of xtc frames compressed, for copying frames with
+ * write_trxframe_compressed(). fr->x is not set, but frames are not
+ * skipped for TRX_NEED_X. Ignored for other formats.
+ */
+#define TRX_READ_COMPRESSED_X (1u << 7u)
 
 /* For trxframe.not_ok */
 #define HEADER_NOT_OK (1u << 0u)
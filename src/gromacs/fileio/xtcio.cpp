@@ -51,6 +51,12 @@
 
 #define XTC_MAGIC 1995
 
+/* Number of atoms up to which XTC stores coordinates uncompressed */
+#define XTC_MAX_UNCOMPRESSED_ATOMS 9
+/* Size of the compressed coordinate header after the precision:
+ * minint[3], maxint[3], smallidx and the byte count */
+#define XTC_COMPRESSED_HEADER_SIZE (8 * 4)
+
 
 static int xdr_r2f(XDR* xdrs, real* r, gmx_bool gmx_unused bRead)
 {
@@ -138,15 +144,10 @@ static int xtc_header(XDR* xd, int* magic, int* natoms, int64_t* step, real* tim
     return result;
 }
 
-static int xtc_coord(XDR* xd, int* natoms, rvec* box, rvec* x, real* prec, gmx_bool bRead)
+static int xtc_box(XDR* xd, rvec* box, gmx_bool bRead)
 {
     int i, j, result;
-#if GMX_DOUBLE
-    float* ftmp;
-    float  fprec;
-#endif
 
-    /* box */
     result = 1;
     for (i = 0; ((i < DIM) && result); i++)
     {
@@ -156,6 +157,21 @@ static int xtc_coord(XDR* xd, int* natoms, rvec* box, rvec* x, real* prec, gmx_b
         }
     }
 
+    return result;
+}
+
+static int xtc_coord(XDR* xd, int* natoms, rvec* box, rvec* x, real* prec, gmx_bool bRead)
+{
+    int result;
+#if GMX_DOUBLE
+    int    i;
+    float* ftmp;
+    float  fprec;
+#endif
+
+    /* box */
+    result = xtc_box(xd, box, bRead);
+
     if (!result)
     {
         return result;
@@ -198,6 +214,51 @@ static int xtc_coord(XDR* xd, int* natoms, rvec* box, rvec* x, real* prec, gmx_b
 }
 
 
+static int xtc_compressed_coord(XDR* xd, int natoms, t_xtc_compressed_x* xc, gmx_bool bRead)
+{
+    int lsize = natoms;
+
+    if (!XTC_CHECK("natoms", xdr_int(xd, &lsize)) || lsize != natoms)
+    {
+        return 0;
+    }
+    xc->natoms = natoms;
+    if (natoms <= XTC_MAX_UNCOMPRESSED_ATOMS)
+    {
+        /* Small frames are stored as plain floats */
+        xc->prec = 0;
+        if (bRead)
+        {
+            xc->bytes.resize(natoms * DIM * sizeof(float));
+        }
+        return XTC_CHECK("x", xdr_opaque(xd, xc->bytes.data(), xc->bytes.size()));
+    }
+
+    if (!XTC_CHECK("prec", xdr_float(xd, &xc->prec)))
+    {
+        return 0;
+    }
+    if (!bRead)
+    {
+        return XTC_CHECK("x", xdr_opaque(xd, xc->bytes.data(), xc->bytes.size()));
+    }
+    xc->bytes.resize(XTC_COMPRESSED_HEADER_SIZE);
+    if (!XTC_CHECK("x", xdr_opaque(xd, xc->bytes.data(), XTC_COMPRESSED_HEADER_SIZE)))
+    {
+        return 0;
+    }
+    /* The byte count is the last int of the header, stored big-endian */
+    const auto* count = reinterpret_cast<const unsigned char*>(xc->bytes.data())
+                        + XTC_COMPRESSED_HEADER_SIZE - 4;
+    const unsigned int byteCount = (static_cast<unsigned int>(count[0]) << 24U)
+                                   | (static_cast<unsigned int>(count[1]) << 16U)
+                                   | (static_cast<unsigned int>(count[2]) << 8U)
+                                   | static_cast<unsigned int>(count[3]);
+    xc->bytes.resize(XTC_COMPRESSED_HEADER_SIZE + byteCount);
+    return XTC_CHECK("x", xdr_opaque(xd, xc->bytes.data() + XTC_COMPRESSED_HEADER_SIZE, byteCount));
+}
+
+
 int write_xtc(t_fileio* fio, int natoms, int64_t step, real time, const rvec* box, const rvec* x, real prec)
 {
     int      magic_number = XTC_MAGIC;
@@ -285,3 +346,62 @@ int read_next_xtc(t_fileio* fio, int natoms, int64_t* step, real* time, matrix b
 
     return static_cast<int>(*bOK);
 }
+
+int read_xtc_compressed(t_fileio*           fio,
+                        int*                natoms,
+                        int64_t*            step,
+                        real*               time,
+                        matrix              box,
+                        t_xtc_compressed_x* xc,
+                        gmx_bool*           bOK)
+{
+    int  magic;
+    XDR* xd;
+
+    *bOK = TRUE;
+    xd   = gmx_fio_getxdr(fio);
+
+    /* read header */
+    if (!xtc_header(xd, &magic, natoms, step, time, TRUE, bOK))
+    {
+        return 0;
+    }
+
+    /* Check magic number */
+    check_xtc_magic(magic);
+
+    *bOK = (xtc_box(xd, box, TRUE) != 0 && xtc_compressed_coord(xd, *natoms, xc, TRUE) != 0);
+
+    return static_cast<int>(*bOK);
+}
+
+int write_xtc_compressed(t_fileio*                 fio,
+                         int64_t                   step,
+                         real                      time,
+                         const rvec*               box,
+                         const t_xtc_compressed_x* xc)
+{
+    int      magic_number = XTC_MAGIC;
+    int      natoms       = xc->natoms;
+    XDR*     xd;
+    gmx_bool bDum;
+    int      bOK;
+
+    xd = gmx_fio_getxdr(fio);
+    if (xtc_header(xd, &magic_number, &natoms, &step, &time, FALSE, &bDum) == 0)
+    {
+        return 0;
+    }
+
+    bOK = (xtc_box(xd, const_cast<rvec*>(box), FALSE) != 0
+           && xtc_compressed_coord(xd, natoms, const_cast<t_xtc_compressed_x*>(xc), FALSE) != 0);
+
+    if (bOK)
+    {
+        if (gmx_fio_flush(fio) != 0)
+        {
+            bOK = 0;
+        }
+    }
+    return bOK;
+}
@@ -39,6 +39,8 @@
 #ifndef GMX_FILEIO_XTCIO_H
 #define GMX_FILEIO_XTCIO_H
 
+#include <vector>
+
 #include "gromacs/math/vectypes.h"
 #include "gromacs/utility/basedefinitions.h"
 #include "gromacs/utility/real.h"
@@ -78,4 +80,29 @@ int read_next_xtc(struct t_fileio* fio, int natoms, int64_t* step, real* time, m
 int write_xtc(struct t_fileio* fio, int natoms, int64_t step, real time, const rvec* box, const rvec* x, real prec);
 /* Write a frame to xtc file */
 
+/* Coordinates of an xtc frame as stored in the file */
+struct t_xtc_compressed_x
+{
+    int               natoms; /* number of atoms */
+    float             prec;   /* precision, 0 for small frames that are not compressed */
+    std::vector<char> bytes;  /* coordinate data following the atom count and precision */
+};
+
+int read_xtc_compressed(struct t_fileio*    fio,
+                        int*                natoms,
+                        int64_t*            step,
+                        real*               time,
+                        matrix              box,
+                        t_xtc_compressed_x* xc,
+                        gmx_bool*           bOK);
+/* Read the next frame, but keep the coordinates in compressed form */
+
+int write_xtc_compressed(struct t_fileio*          fio,
+                         int64_t                   step,
+                         real                      time,
+                         const rvec*               box,
+                         const t_xtc_compressed_x* xc);
+/* Write a frame with coordinates read by read_xtc_compressed(),
+ * copying the compressed data verbatim */
+
 #endif
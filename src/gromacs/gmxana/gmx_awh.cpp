@@ -56,6 +56,7 @@
 #include "gromacs/fileio/enxio.h"
 #include "gromacs/fileio/gmxfio.h"
 #include "gromacs/fileio/oenv.h"
+#include "gromacs/fileio/timecontrol.h"
 #include "gromacs/fileio/tpxio.h"
 #include "gromacs/fileio/trxio.h"
 #include "gromacs/fileio/xvgr.h"
@@ -570,13 +571,31 @@ int gmx_awh(int argc, char* argv[])
 
     std::unique_ptr<AwhReader> awhReader;
 
+    /* We only need the AWH blocks, skip all energy terms and other blocks */
+    std::unique_ptr<gmx_bool[]> readTerm(new gmx_bool[nre]());
+    std::array<gmx_bool, enxNR> readBlock = {};
+    readBlock[enxAWH]                     = TRUE;
+
+    if (bTimeSet(TBEGIN))
+    {
+        /* Use a frame index to jump to the first frame to analyse */
+        const std::vector<gmx_enxframe_index_t> frameIndex = index_enx(fp);
+        const auto firstFrame = std::find_if(
+                frameIndex.begin(), frameIndex.end(),
+                [](const gmx_enxframe_index_t& frame) { return check_times(frame.t) >= 0; });
+        if (firstFrame != frameIndex.end())
+        {
+            seek_enx(fp, *firstFrame);
+        }
+    }
+
     /* Initiate counters */
     gmx_bool haveFrame;
     int      awhFrameCounter = 0;
     int      timeCheck       = 0;
     do
     {
-        haveFrame = do_enx(fp, frame);
+        haveFrame = do_enx_selected(fp, frame, readTerm.get(), readBlock.data());
 
         bool useFrame = false;
 
@@ -3049,6 +3049,8 @@ static void read_barsim_edr(const char* fn, real* temp, sim_data_t* sd)
     lambda_vec_t*  native_lambda;
     int            nsamples = 0;
     lambda_vec_t   start_lambda;
+    gmx_bool*      bReadTerm;
+    gmx_bool       bReadBlock[enxNR];
 
     fp = open_enx(fn, "r");
     do_enxnms(fp, &nre, &enm);
@@ -3058,7 +3060,14 @@ static void read_barsim_edr(const char* fn, real* temp, sim_data_t* sd)
     start_lambda.lc  = nullptr;
     start_lambda.val = nullptr;
 
-    while (do_enx(fp, fr))
+    /* We only need the free-energy blocks, skip all energy terms and other blocks */
+    snew(bReadTerm, nre);
+    for (i = 0; i < enxNR; i++)
+    {
+        bReadBlock[i] = (i == enxDHCOLL || i == enxDHHIST || i == enxDH);
+    }
+
+    while (do_enx_selected(fp, fr, bReadTerm, bReadBlock))
     {
         /* count the data blocks */
         int nblocks_raw  = 0;
@@ -3314,6 +3323,7 @@ static void read_barsim_edr(const char* fn, real* temp, sim_data_t* sd)
     sfree(npts);
     sfree(nhists);
     sfree(lambdas);
+    sfree(bReadTerm);
 }
 
 
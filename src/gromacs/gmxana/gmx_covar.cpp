@@ -40,6 +40,9 @@
 #include <cmath>
 #include <cstring>
 
+#include <algorithm>
+#include <vector>
+
 #include "gromacs/commandline/pargs.h"
 #include "gromacs/fileio/confio.h"
 #include "gromacs/fileio/matio.h"
@@ -56,11 +59,95 @@
 #include "gromacs/topology/topology.h"
 #include "gromacs/utility/arraysize.h"
 #include "gromacs/utility/cstringutil.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/smalloc.h"
 #include "gromacs/utility/sysinfo.h"
 
+//! Number of frames that are added together to the covariance matrix
+static const int c_covarFrameBlockSize = 32;
+//! Number of matrix columns that are updated together, for cache efficiency
+static const int64_t c_covarColumnBlockSize = 512;
+
+/*! \brief Adds a block of frames to the upper triangle of the covariance matrix
+ *
+ * \p xblock contains \p nblock deviation vectors of length \p ndim.
+ * Element (r, c) of \p mat is updated for c >= DIM*(r/DIM), i.e. for all
+ * pairs of atoms with the second atom not before the first one.
+ * Each element gets the contributions added in frame order, so the result
+ * does not depend on the block size or the number of threads.
+ * The rows are divided over the threads such that each thread updates
+ * about the same number of elements.
+ */
+static void addFramesToCovariance(real* mat, int64_t ndim, const real* xblock, int nblock)
+{
+    const int64_t natoms = ndim / DIM;
+    const int numThreads = std::max(1, std::min(gmx_omp_get_max_threads(), static_cast<int>(natoms)));
+    /* The cost of row r is proportional to ndim - r, so we divide
+     * the triangle into parts with equal areas.
+     */
+    auto partStart = [natoms, numThreads](int part) {
+        return (part == numThreads) ? natoms
+                                    : static_cast<int64_t>(
+                                              natoms * (1 - std::sqrt(1 - double(part) / numThreads)));
+    };
+
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (int th = 0; th < numThreads; th++)
+    {
+        try
+        {
+            for (int64_t r = DIM * partStart(th); r < DIM * partStart(th + 1); r++)
+            {
+                real* matRow = mat + ndim * r;
+                for (int64_t c0 = DIM * (r / DIM); c0 < ndim; c0 += c_covarColumnBlockSize)
+                {
+                    const int64_t c1 = std::min(c0 + c_covarColumnBlockSize, ndim);
+                    for (int b = 0; b < nblock; b++)
+                    {
+                        const real* xb = xblock + ndim * b;
+                        const real  xr = xb[r];
+                        for (int64_t c = c0; c < c1; c++)
+                        {
+                            matRow[c] += xr * xb[c];
+                        }
+                    }
+                }
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+}
+
+//! Computes y = mat x for the full, symmetric, \p ndim x \p ndim matrix \p mat
+static void multiplyCovariance(const real* mat, int64_t ndim, const real* x, real* y)
+{
+    const int numThreads = std::max(1, std::min(gmx_omp_get_max_threads(), static_cast<int>(ndim)));
+
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (int th = 0; th < numThreads; th++)
+    {
+        try
+        {
+            const int64_t rowStart = (ndim * th) / numThreads;
+            const int64_t rowEnd   = (ndim * (th + 1)) / numThreads;
+            for (int64_t r = rowStart; r < rowEnd; r++)
+            {
+                const real* matRow = mat + ndim * r;
+                real        sum    = 0;
+                for (int64_t c = 0; c < ndim; c++)
+                {
+                    sum += matRow[c] * x[c];
+                }
+                y[r] = sum;
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+}
+
 int gmx_covar(int argc, char* argv[])
 {
     const char* desc[] = {
@@ -90,13 +177,35 @@ int gmx_covar(int argc, char* argv[])
         "i.e. for each atom pair the sum of the xx, yy and zz covariances is",
         "written.",
         "[PAR]",
-        "Note that the diagonalization of a matrix requires memory and time",
-        "that will increase at least as fast as than the square of the number",
-        "of atoms involved. It is easy to run out of memory, in which",
+        "Option [TT]-diag[tt] selects the diagonalization method.",
+        "[TT]full[tt], the default, computes all eigenvalues and eigenvectors",
+        "with LAPACK, which takes time proportional to the cube of the number",
+        "of atoms.",
+        "[TT]lanczos[tt] only computes the eigenvectors up to [TT]-last[tt]",
+        "with Lanczos iterations (ARPACK), which is much faster when only",
+        "a small number of eigenvectors is needed and stores only those",
+        "eigenvectors. The sum of the eigenvalues",
+        "can then not be compared with the trace of the covariance matrix.",
+        "Lanczos is not used when [TT]-last[tt] is half or more of the",
+        "number of coordinates; a full diagonalization is done instead.",
+        "[PAR]",
+        "Note that the covariance matrix requires memory",
+        "that increases as the square of the number",
+        "of atoms involved, also with [TT]-diag lanczos[tt], since the",
+        "whole matrix is still built before the diagonalization.",
+        "It is easy to run out of memory, in which",
         "case this tool will probably exit with a 'Segmentation fault'. You",
         "should consider carefully whether a reduced set of atoms will meet",
         "your needs for lower costs."
     };
+    enum
+    {
+        edSel,
+        edFull,
+        edLanczos,
+        edNR
+    };
+    const char*     diagType[edNR + 1] = { nullptr, "full", "lanczos", nullptr };
     static gmx_bool bFit = TRUE, bRef = FALSE, bM = FALSE, bPBC = TRUE;
     static int      end  = -1;
     t_pargs         pa[] = {
@@ -109,7 +218,8 @@ int gmx_covar(int argc, char* argv[])
           "average" },
         { "-mwa", FALSE, etBOOL, { &bM }, "Mass-weighted covariance analysis" },
         { "-last", FALSE, etINT, { &end }, "Last eigenvector to write away (-1 is till the last)" },
-        { "-pbc", FALSE, etBOOL, { &bPBC }, "Apply corrections for periodic boundary conditions" }
+        { "-pbc", FALSE, etBOOL, { &bPBC }, "Apply corrections for periodic boundary conditions" },
+        { "-diag", FALSE, etENUM, { diagType }, "Diagonalization method" }
     };
     FILE*             out = nullptr; /* initialization makes all compilers happy */
     t_trxstatus*      status;
@@ -120,20 +230,21 @@ int gmx_covar(int argc, char* argv[])
     matrix            box, zerobox;
     real *            sqrtm, *mat, *eigenvalues, sum, trace, inv_nframes;
     real              t, tstart, tend, **mat2;
-    real              xj, *w_rls = nullptr;
+    real*             w_rls = nullptr;
     real              min, max, *axis;
     int               natoms, nat, nframes0, nframes, nlevels;
-    int64_t           ndim, i, j, k, l;
+    int64_t           ndim, i, j, k;
     int               WriteXref;
     const char *      fitfile, *trxfile, *ndxfile;
     const char *      eigvalfile, *eigvecfile, *averfile, *logfile;
     const char *      asciifile, *xpmfile, *xpmafile;
     char              str[STRLEN], *fitname, *ananame;
-    int               d, dj, nfit;
+    int               d, dj, nfit, nblock;
     int *             index, *ifit;
     gmx_bool          bDiffMass1, bDiffMass2;
     t_rgb             rlo, rmi, rhi;
     real*             eigenvectors;
+    gmx_bool          bLanczos;
     gmx_output_env_t* oenv;
     gmx_rmpbc_t       gpbc = nullptr;
 
@@ -299,6 +410,9 @@ int gmx_covar(int argc, char* argv[])
 
     fprintf(stderr, "Constructing covariance matrix (%dx%d) ...\n", static_cast<int>(ndim),
             static_cast<int>(ndim));
+    /* The deviations of a block of frames, which are added to the matrix together */
+    std::vector<real> xblock(c_covarFrameBlockSize * ndim);
+    nblock  = 0;
     nframes = 0;
     nat     = read_first_x(oenv, &status, trxfile, &t, &xread, box);
     tstart  = t;
@@ -331,24 +445,18 @@ int gmx_covar(int argc, char* argv[])
             }
         }
 
-        for (j = 0; j < natoms; j++)
+        std::copy(x[0], x[0] + ndim, xblock.begin() + ndim * nblock);
+        nblock++;
+        if (nblock == c_covarFrameBlockSize)
         {
-            for (dj = 0; dj < DIM; dj++)
-            {
-                k  = ndim * (DIM * j + dj);
-                xj = x[j][dj];
-                for (i = j; i < natoms; i++)
-                {
-                    l = k + DIM * i;
-                    for (d = 0; d < DIM; d++)
-                    {
-                        mat[l + d] += x[i][d] * xj;
-                    }
-                }
-            }
+            addFramesToCovariance(mat, ndim, xblock.data(), nblock);
+            nblock = 0;
         }
     } while (read_next_x(oenv, status, &t, xread, box) && (bRef || nframes < nframes0));
     close_trx(status);
+    addFramesToCovariance(mat, ndim, xblock.data(), nblock);
+    xblock.clear();
+    xblock.shrink_to_fit();
     gmx_rmpbc_done(gpbc);
 
     fprintf(stderr, "Read %d frames\n", nframes);
@@ -514,45 +622,80 @@ int gmx_covar(int argc, char* argv[])
     }
 
 
+    /* Set 'end', the maximum eigenvector and -value index used for output */
+    if (end == -1)
+    {
+        if (nframes - 1 < ndim)
+        {
+            end = nframes - 1;
+            fprintf(stderr,
+                    "\nWARNING: there are fewer frames in your trajectory than there are\n");
+            fprintf(stderr, "degrees of freedom in your system. Only generating the first\n");
+            fprintf(stderr, "%d out of %d eigenvectors and eigenvalues.\n", end, static_cast<int>(ndim));
+        }
+        else
+        {
+            end = ndim;
+        }
+    }
+
+    bLanczos = (nenum(diagType) == edLanczos);
+    /* Lanczos needs 2*end basis vectors, which should be fewer than ndim */
+    if (bLanczos && (end < 1 || 2 * static_cast<int64_t>(end) >= ndim))
+    {
+        fprintf(stderr,
+                "\nNote: Lanczos can not compute %d out of %d eigenvectors,\n"
+                "      using full diagonalization\n",
+                end, static_cast<int>(ndim));
+        bLanczos = FALSE;
+    }
+
     /* call diagonalization routine */
 
-    snew(eigenvalues, ndim);
-    snew(eigenvectors, ndim * ndim);
+    if (bLanczos)
+    {
+        /* Only the requested eigenvectors are stored, the matrix is only
+         * accessed through matrix-vector products.
+         */
+        snew(eigenvalues, end);
+        snew(eigenvectors, static_cast<int64_t>(end) * ndim);
+        fprintf(stderr, "\nComputing the %d largest eigenvalues ...\n", end);
+        fflush(stderr);
+        auto multiply = [mat, ndim](real* xv, real* yv) { multiplyCovariance(mat, ndim, xv, yv); };
+        largest_eigenvalues_eigensolver(ndim, end, multiply, eigenvalues, eigenvectors, 100000);
+    }
+    else
+    {
+        snew(eigenvalues, ndim);
+        snew(eigenvectors, ndim * ndim);
 
-    std::memcpy(eigenvectors, mat, ndim * ndim * sizeof(real));
-    fprintf(stderr, "\nDiagonalizing ...\n");
-    fflush(stderr);
-    eigensolver(eigenvectors, ndim, 0, ndim, eigenvalues, mat);
-    sfree(eigenvectors);
+        std::memcpy(eigenvectors, mat, ndim * ndim * sizeof(real));
+        fprintf(stderr, "\nDiagonalizing ...\n");
+        fflush(stderr);
+        eigensolver(eigenvectors, ndim, 0, ndim, eigenvalues, mat);
+        sfree(eigenvectors);
+        eigenvectors = nullptr;
+    }
 
     /* now write the output */
 
     sum = 0;
-    for (i = 0; i < ndim; i++)
+    for (i = 0; i < (bLanczos ? end : ndim); i++)
     {
         sum += eigenvalues[i];
     }
-    fprintf(stderr, "\nSum of the eigenvalues: %g (%snm^2)\n", sum, bM ? "u " : "");
-    if (std::abs(trace - sum) > 0.01 * trace)
+    if (bLanczos)
     {
-        fprintf(stderr,
-                "\nWARNING: eigenvalue sum deviates from the trace of the covariance matrix\n");
+        fprintf(stderr, "\nSum of the %d largest eigenvalues: %g (%snm^2), %.1f%% of the trace\n",
+                end, sum, bM ? "u " : "", 100 * sum / trace);
     }
-
-    /* Set 'end', the maximum eigenvector and -value index used for output */
-    if (end == -1)
+    else
     {
-        if (nframes - 1 < ndim)
+        fprintf(stderr, "\nSum of the eigenvalues: %g (%snm^2)\n", sum, bM ? "u " : "");
+        if (std::abs(trace - sum) > 0.01 * trace)
         {
-            end = nframes - 1;
             fprintf(stderr,
-                    "\nWARNING: there are fewer frames in your trajectory than there are\n");
-            fprintf(stderr, "degrees of freedom in your system. Only generating the first\n");
-            fprintf(stderr, "%d out of %d eigenvectors and eigenvalues.\n", end, static_cast<int>(ndim));
-        }
-        else
-        {
-            end = ndim;
+                    "\nWARNING: eigenvalue sum deviates from the trace of the covariance matrix\n");
         }
     }
 
@@ -562,7 +705,8 @@ int gmx_covar(int argc, char* argv[])
     out = xvgropen(eigvalfile, "Eigenvalues of the covariance matrix", "Eigenvector index", str, oenv);
     for (i = 0; (i < end); i++)
     {
-        fprintf(out, "%10d %g\n", static_cast<int>(i + 1), eigenvalues[ndim - 1 - i]);
+        fprintf(out, "%10d %g\n", static_cast<int>(i + 1),
+                bLanczos ? eigenvalues[i] : eigenvalues[ndim - 1 - i]);
     }
     xvgrclose(out);
 
@@ -588,8 +732,11 @@ int gmx_covar(int argc, char* argv[])
         WriteXref = eWXR_NOFIT;
     }
 
-    write_eigenvectors(eigvecfile, natoms, mat, TRUE, 1, end, WriteXref, x, bDiffMass1, xproj, bM,
-                       eigenvalues);
+    /* The full diagonalization stores all eigenvectors in mat in ascending order,
+     * Lanczos only the computed ones in descending order.
+     */
+    write_eigenvectors(eigvecfile, natoms, bLanczos ? eigenvectors : mat, !bLanczos, 1, end,
+                       WriteXref, x, bDiffMass1, xproj, bM, eigenvalues);
 
     out = gmx_ffopen(logfile, "w");
 
@@ -627,10 +774,20 @@ int gmx_covar(int argc, char* argv[])
     {
         fprintf(out, "Fit is %smass weighted\n", bDiffMass1 ? "" : "non-");
     }
-    fprintf(out, "Diagonalized the %dx%d covariance matrix\n", static_cast<int>(ndim),
-            static_cast<int>(ndim));
-    fprintf(out, "Trace of the covariance matrix before diagonalizing: %g\n", trace);
-    fprintf(out, "Trace of the covariance matrix after diagonalizing: %g\n\n", sum);
+    if (bLanczos)
+    {
+        fprintf(out, "Computed the %d largest eigenvalues of the %dx%d covariance matrix\n", end,
+                static_cast<int>(ndim), static_cast<int>(ndim));
+        fprintf(out, "Trace of the covariance matrix: %g\n", trace);
+        fprintf(out, "Sum of the computed eigenvalues: %g\n\n", sum);
+    }
+    else
+    {
+        fprintf(out, "Diagonalized the %dx%d covariance matrix\n", static_cast<int>(ndim),
+                static_cast<int>(ndim));
+        fprintf(out, "Trace of the covariance matrix before diagonalizing: %g\n", trace);
+        fprintf(out, "Trace of the covariance matrix after diagonalizing: %g\n\n", sum);
+    }
 
     fprintf(out, "Wrote %d eigenvalues to %s\n", static_cast<int>(end), eigvalfile);
     if (WriteXref == eWXR_YES)
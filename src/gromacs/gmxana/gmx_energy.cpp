@@ -48,6 +48,7 @@
 #include "gromacs/correlationfunctions/autocorr.h"
 #include "gromacs/fileio/enxio.h"
 #include "gromacs/fileio/gmxfio.h"
+#include "gromacs/fileio/timecontrol.h"
 #include "gromacs/fileio/tpxio.h"
 #include "gromacs/fileio/trxio.h"
 #include "gromacs/fileio/xvgr.h"
@@ -1749,6 +1750,8 @@ int gmx_energy(int argc, char* argv[])
     real              Vaver;
     int *             set     = nullptr, i, j, nset, sss;
     gmx_bool*         bIsEner = nullptr;
+    gmx_bool*         bReadTerm;
+    gmx_bool          bReadBlock[enxNR];
     char**            leg     = nullptr;
     char              buf[256];
     gmx_output_env_t* oenv;
@@ -1894,6 +1897,30 @@ int gmx_energy(int argc, char* argv[])
     edat.bHaveSums = TRUE;
     snew(edat.s, nset);
 
+    /* Only decode the selected terms, or the free-energy blocks with -odh */
+    snew(bReadTerm, nre);
+    for (i = 0; i < nset; i++)
+    {
+        bReadTerm[set[i]] = TRUE;
+    }
+    for (i = 0; i < enxNR; i++)
+    {
+        bReadBlock[i] = (bDHDL && (i == enxDHCOLL || i == enxDHHIST || i == enxDH));
+    }
+
+    if (bTimeSet(TBEGIN))
+    {
+        /* Use a frame index to jump to the first frame to analyse */
+        const std::vector<gmx_enxframe_index_t> frameIndex = index_enx(fp);
+        const auto firstFrame = std::find_if(
+                frameIndex.begin(), frameIndex.end(),
+                [](const gmx_enxframe_index_t& frame) { return check_times(frame.t) >= 0; });
+        if (firstFrame != frameIndex.end())
+        {
+            seek_enx(fp, *firstFrame);
+        }
+    }
+
     /* Initiate counters */
     bFoundStart = FALSE;
     start_step  = 0;
@@ -1905,7 +1932,7 @@ int gmx_energy(int argc, char* argv[])
          */
         do
         {
-            bCont = do_enx(fp, &(frame[NEXT]));
+            bCont = do_enx_selected(fp, &(frame[NEXT]), bReadTerm, bReadBlock);
             if (bCont)
             {
                 timecheck = check_times(frame[NEXT].t);
@@ -2080,6 +2107,7 @@ int gmx_energy(int argc, char* argv[])
     } while (bCont && (timecheck == 0));
 
     fprintf(stderr, "\n");
+    sfree(bReadTerm);
     done_ener_file(fp);
     if (out)
     {
@@ -42,6 +42,9 @@
 #include <cstring>
 
 #include <algorithm>
+#include <numeric>
+#include <tuple>
+#include <vector>
 
 #include "gromacs/commandline/pargs.h"
 #include "gromacs/commandline/viewit.h"
@@ -54,6 +57,7 @@
 #include "gromacs/mdtypes/md_enums.h"
 #include "gromacs/pbcutil/pbc.h"
 #include "gromacs/pbcutil/rmpbc.h"
+#include "gromacs/selection/nbsearch.h"
 #include "gromacs/topology/index.h"
 #include "gromacs/topology/topology.h"
 #include "gromacs/utility/arraysize.h"
@@ -61,15 +65,140 @@
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
 #include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/listoflists.h"
 #include "gromacs/utility/smalloc.h"
 
 
-static void
-periodic_dist(PbcType pbcType, matrix box, rvec x[], int n, const int index[], real* rmin, real* rmax, int* min_ind)
+//! Relative tolerance on the search cutoff, so pairs at the cutoff are not missed due to rounding
+static const real c_searchTolerance = 1e-4;
+//! Initial cutoff (nm) for searching the minimum distance to a periodic image
+static const real c_periodicInitialCutoff = 1.0;
+//! Margin (nm) added to the minimum distance for the search cutoff in the next frame
+static const real c_periodicCutoffMargin = 0.1;
+
+/*! \brief Finds the pairs of reference and test atoms within \p cutoff
+ *
+ * With \p cutoff <= 0 all pairs are returned. For each test atom, \p pairs
+ * gets the positions in \p refIndex of the reference atoms within the
+ * cutoff. The cutoff is increased slightly so no pairs are missed due to
+ * rounding differences, callers should recompute distances themselves.
+ */
+static void findPairsWithinCutoff(real                                      cutoff,
+                                  const t_pbc*                              pbc,
+                                  const rvec                                xRef[],
+                                  gmx::ArrayRef<const int>                  refIndex,
+                                  const gmx::AnalysisNeighborhoodPositions& testPositions,
+                                  gmx::ListOfLists<int>*                    pairs)
+{
+    gmx::AnalysisNeighborhood nb;
+    nb.setCutoff(cutoff > 0 ? cutoff * (1 + c_searchTolerance) : 0);
+    /* The position count is replaced by the size of the index */
+    gmx::AnalysisNeighborhoodSearch search =
+            nb.initSearch(pbc, gmx::AnalysisNeighborhoodPositions(xRef, 0).indexed(refIndex));
+    search.findAllPairs(testPositions, pairs);
+}
+
+/*! \brief Returns the length of the diagonal of the bounding box of the atoms in both index groups
+ *
+ * No pair of these atoms can be further apart than this, also not with PBC.
+ */
+static real
+boundingBoxDiagonal(const rvec x[], int nx1, const int index1[], int nx2, const int index2[])
+{
+    rvec lower, upper;
+    copy_rvec(x[index1[0]], lower);
+    copy_rvec(x[index1[0]], upper);
+    for (int g = 0; g < 2; g++)
+    {
+        const int  n     = (g == 0) ? nx1 : nx2;
+        const int* index = (g == 0) ? index1 : index2;
+        for (int i = 0; i < n; i++)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                lower[d] = std::min(lower[d], x[index[i]][d]);
+                upper[d] = std::max(upper[d], x[index[i]][d]);
+            }
+        }
+    }
+    return std::sqrt(distance2(lower, upper));
+}
+
+/*! \brief Returns the squared maximum distance between the atoms in \p index, without PBC
+ *
+ * Two atoms are at most r_i + r_j apart, with r the distance to the
+ * center of the atoms. By processing the atoms in order of decreasing r,
+ * the search can stop as soon as r_i + r_j can no longer exceed the current
+ * maximum, which leaves only a small fraction of all pairs for compact
+ * molecules.
+ */
+static real maximumInternalDistance2(const rvec x[], int n, const int index[])
+{
+    dvec center = { 0, 0, 0 };
+    for (int i = 0; i < n; i++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            center[d] += x[index[i]][d];
+        }
+    }
+    dsvmul(1.0 / std::max(n, 1), center, center);
+
+    std::vector<std::pair<double, int>> radius(n);
+    for (int i = 0; i < n; i++)
+    {
+        dvec dx;
+        for (int d = 0; d < DIM; d++)
+        {
+            dx[d] = x[index[i]][d] - center[d];
+        }
+        radius[i] = { std::sqrt(dnorm2(dx)), i };
+    }
+    std::sort(radius.begin(), radius.end(), std::greater<>());
+
+    real   r2max = 0;
+    double limit = 0;
+    for (int a = 0; a < n && 2 * radius[a].first >= limit; a++)
+    {
+        for (int b = a + 1; b < n && radius[a].first + radius[b].first >= limit; b++)
+        {
+            const int i = std::min(radius[a].second, radius[b].second);
+            const int j = std::max(radius[a].second, radius[b].second);
+            rvec      d0;
+            rvec_sub(x[index[i]], x[index[j]], d0);
+            const real r2 = norm2(d0);
+            if (r2 > r2max)
+            {
+                r2max = r2;
+                limit = std::sqrt(r2max) * (1 - c_searchTolerance);
+            }
+        }
+    }
+
+    return r2max;
+}
+
+/*! \brief Computes the minimum distance between periodic images of the atoms in \p index
+ *
+ * Also returns the maximum internal distance in \p rmax. The minimum
+ * is found with a single grid search of the atoms against their images
+ * for all box shifts, with a cutoff that starts at \p searchCutoff and is
+ * doubled until a pair is found. On return, \p searchCutoff is set to a
+ * suitable cutoff for the next frame.
+ */
+static void periodic_dist(PbcType   pbcType,
+                          matrix    box,
+                          rvec      x[],
+                          int       n,
+                          const int index[],
+                          real*     rmin,
+                          real*     rmax,
+                          int*      min_ind,
+                          real*     searchCutoff)
 {
 #define NSHIFT_MAX 26
     int  nsz, nshift, sx, sy, sz, i, j, s;
-    real sqr_box, r2min, r2max, r2;
+    real sqr_box, r2min;
     rvec shift[NSHIFT_MAX], d0, d;
 
     sqr_box = std::min(norm2(box[XX]), norm2(box[YY]));
@@ -87,6 +216,7 @@ periodic_dist(PbcType pbcType, matrix box, rvec x[], int n, const int index[], r
         gmx_fatal(FARGS, "pbc = %s is not supported by g_mindist", c_pbcTypeNames[pbcType].c_str());
     }
 
+    /* The shifts are generated symmetrically, so shift nshift-1-s is -shift s */
     nshift = 0;
     for (sz = -nsz; sz <= nsz; sz++)
     {
@@ -106,35 +236,254 @@ periodic_dist(PbcType pbcType, matrix box, rvec x[], int n, const int index[], r
         }
     }
 
-    r2min = sqr_box;
-    r2max = 0;
+    const real               maxCutoff = std::sqrt(sqr_box);
+    real                     cutoff    = std::min(*searchCutoff, maxCutoff);
+    gmx::ArrayRef<const int> indexRef(index, index + n);
+    /* The images for all shifts are searched together, image j of shift s is at s*n + j */
+    std::vector<gmx::RVec> xShifted(nshift * n);
+    for (s = 0; s < nshift; s++)
+    {
+        for (j = 0; j < n; j++)
+        {
+            rvec_sub(x[index[j]], shift[s], xShifted[s * n + j]);
+        }
+    }
+    gmx::ListOfLists<int> pairs;
+    int                   minI     = -1;
+    int                   minJ     = -1;
+    int                   minShift = -1;
+    bool                  bDone    = false;
+    while (!bDone)
+    {
+        r2min = sqr_box;
+        minI  = -1;
+        /* The grid is only rebuilt when no pair is found within the cutoff,
+         * which does not happen often with the cutoff from the previous frame.
+         */
+        findPairsWithinCutoff(cutoff, nullptr, x, indexRef, xShifted, &pairs);
+        for (s = 0; s < nshift; s++)
+        {
+            for (j = 0; j < n; j++)
+            {
+                for (const int ref : pairs[s * n + j])
+                {
+                    if (ref == j)
+                    {
+                        continue;
+                    }
+                    /* Compute the distance as x[index[i]] - x[index[j]] + shift with i < j,
+                     * and use the same tie-breaking as a loop over i, j and the shifts.
+                     */
+                    const int ii = std::min(ref, j);
+                    const int jj = std::max(ref, j);
+                    const int ss = (ref < j) ? s : nshift - 1 - s;
+                    rvec_sub(x[index[ii]], x[index[jj]], d0);
+                    rvec_add(d0, shift[ss], d);
+                    const real r2 = norm2(d);
+                    if (r2 < r2min
+                        || (minI >= 0 && r2 == r2min
+                            && std::make_tuple(ii, jj, ss) < std::make_tuple(minI, minJ, minShift)))
+                    {
+                        r2min    = r2;
+                        minI     = ii;
+                        minJ     = jj;
+                        minShift = ss;
+                    }
+                }
+            }
+        }
+        bDone = (cutoff >= maxCutoff || r2min < gmx::square(cutoff * (1 - c_searchTolerance)));
+        cutoff = std::min(2 * cutoff, maxCutoff);
+    }
 
-    for (i = 0; i < n; i++)
+    if (minI >= 0)
     {
-        for (j = i + 1; j < n; j++)
+        min_ind[0] = minI;
+        min_ind[1] = minJ;
+    }
+    *rmin         = std::sqrt(r2min);
+    *rmax         = std::sqrt(maximumInternalDistance2(x, n, index));
+    *searchCutoff = std::max(*rmin + c_periodicCutoffMargin, c_periodicCutoffMargin);
+}
+
+/*! \brief Computes the minimum distance and the number of contacts with a grid search
+ *
+ * Computes the same minimum distance and contacts as calc_dist(), but only
+ * considers pairs within a cutoff, which starts at \p rcut and is doubled
+ * until a pair is found.
+ */
+static void calc_min_dist(real         rcut,
+                          const t_pbc* pbc,
+                          rvec         x[],
+                          int          nx1,
+                          int          nx2,
+                          const int    index1[],
+                          const int    index2[],
+                          gmx_bool     bGroup,
+                          real*        rmin,
+                          int*         nmin,
+                          int*         ixmin,
+                          int*         jxmin)
+{
+    const int* index3 = (index2 != nullptr) ? index2 : index1;
+    const int  j1     = (index2 != nullptr) ? nx2 : nx1;
+    const real rcut2  = gmx::square(rcut);
+    const real maxCutoff = boundingBoxDiagonal(x, nx1, index1, j1, index3);
+
+    gmx::ListOfLists<int> pairs;
+    real                  cutoff = (rcut > 0) ? rcut : c_periodicInitialCutoff;
+    real                  rmin2  = 1e12;
+    bool                  bDone  = false;
+    while (!bDone)
+    {
+        const bool bAllPairs = (cutoff >= maxCutoff);
+        findPairsWithinCutoff(bAllPairs ? 0 : cutoff, pbc, x, gmx::arrayRefFromArray(index1, nx1),
+                              gmx::AnalysisNeighborhoodPositions(x, 0).indexed(
+                                      gmx::arrayRefFromArray(index3, j1)),
+                              &pairs);
+        int minI = -1;
+        int minJ = -1;
+        rmin2    = 1e12;
+        *ixmin   = -1;
+        *jxmin   = -1;
+        *nmin    = 0;
+        for (int j = 0; j < j1; j++)
         {
-            rvec_sub(x[index[i]], x[index[j]], d0);
-            r2 = norm2(d0);
-            if (r2 > r2max)
+            const int jx     = index3[j];
+            int       nmin_j = 0;
+            for (const int i : pairs[j])
             {
-                r2max = r2;
+                const int ix = index1[i];
+                if ((index2 == nullptr && i <= j) || ix == jx)
+                {
+                    continue;
+                }
+                rvec dx;
+                if (pbc != nullptr)
+                {
+                    pbc_dx(pbc, x[ix], x[jx], dx);
+                }
+                else
+                {
+                    rvec_sub(x[ix], x[jx], dx);
+                }
+                const real r2 = iprod(dx, dx);
+                /* Use the same tie-breaking as a loop over j and i */
+                if (r2 < rmin2 || (r2 == rmin2 && j == minJ && i < minI))
+                {
+                    rmin2  = r2;
+                    minI   = i;
+                    minJ   = j;
+                    *ixmin = ix;
+                    *jxmin = jx;
+                }
+                if (r2 <= rcut2)
+                {
+                    nmin_j++;
+                }
             }
-            for (s = 0; s < nshift; s++)
+            if (bGroup)
             {
-                rvec_add(d0, shift[s], d);
-                r2 = norm2(d);
-                if (r2 < r2min)
+                if (nmin_j > 0)
                 {
-                    r2min      = r2;
-                    min_ind[0] = i;
-                    min_ind[1] = j;
+                    (*nmin)++;
                 }
             }
+            else
+            {
+                *nmin += nmin_j;
+            }
         }
+        bDone  = bAllPairs || (minI >= 0 && rmin2 < gmx::square(cutoff * (1 - c_searchTolerance)));
+        cutoff = 2 * cutoff;
+    }
+    *rmin = std::sqrt(rmin2);
+}
+
+/*! \brief Updates the minimum distance of each residue to the atoms in \p index2
+ *
+ * Residue \p r consists of the atoms index1[residue[r]] to
+ * index1[residue[r+1]-1]. \p mindres[r] is set to the minimum of its
+ * current value and the minimum distance in this frame. This gives the same
+ * result as calling calc_dist() for each residue, but uses a single grid
+ * search over \p index2 for all residues.
+ */
+static void calc_residue_min_dist(real      rcut,
+                                  gmx_bool  bPBC,
+                                  PbcType   pbcType,
+                                  matrix    box,
+                                  rvec      x[],
+                                  int       nres,
+                                  const int residue[],
+                                  const int index1[],
+                                  int       nx2,
+                                  const int index2[],
+                                  real      mindres[])
+{
+    t_pbc pbc;
+    if (bPBC)
+    {
+        set_pbc(&pbc, pbcType, box);
     }
+    const real maxCutoff = boundingBoxDiagonal(x, residue[nres] - residue[0], index1 + residue[0],
+                                               nx2, index2);
 
-    *rmin = std::sqrt(r2min);
-    *rmax = std::sqrt(r2max);
+    std::vector<int>      pending(nres);
+    std::vector<int>      stillPending;
+    std::vector<int>      testIndex;
+    gmx::ListOfLists<int> pairs;
+    std::iota(pending.begin(), pending.end(), 0);
+    real cutoff = (rcut > 0) ? rcut : c_periodicInitialCutoff;
+    while (!pending.empty())
+    {
+        const bool bAllPairs = (cutoff >= maxCutoff);
+        testIndex.clear();
+        for (const int r : pending)
+        {
+            testIndex.insert(testIndex.end(), index1 + residue[r], index1 + residue[r + 1]);
+        }
+        findPairsWithinCutoff(bAllPairs ? 0 : cutoff, bPBC ? &pbc : nullptr, x,
+                              gmx::arrayRefFromArray(index2, nx2),
+                              gmx::AnalysisNeighborhoodPositions(x, 0).indexed(testIndex), &pairs);
+        stillPending.clear();
+        int test = 0;
+        for (const int r : pending)
+        {
+            real rmin2 = 1e12;
+            for (int k = residue[r]; k < residue[r + 1]; k++, test++)
+            {
+                const int ix = index1[k];
+                for (const int j : pairs[test])
+                {
+                    const int jx = index2[j];
+                    if (ix == jx)
+                    {
+                        continue;
+                    }
+                    rvec dx;
+                    if (bPBC)
+                    {
+                        pbc_dx(&pbc, x[ix], x[jx], dx);
+                    }
+                    else
+                    {
+                        rvec_sub(x[ix], x[jx], dx);
+                    }
+                    rmin2 = std::min(rmin2, iprod(dx, dx));
+                }
+            }
+            if (bAllPairs || rmin2 < gmx::square(cutoff * (1 - c_searchTolerance)))
+            {
+                mindres[r] = std::min(mindres[r], std::sqrt(rmin2));
+            }
+            else
+            {
+                stillPending.push_back(r);
+            }
+        }
+        pending.swap(stillPending);
+        cutoff = 2 * cutoff;
+    }
 }
 
 static void periodic_mindist_plot(const char*             trxfn,
@@ -154,6 +503,7 @@ static void periodic_mindist_plot(const char*             trxfn,
     matrix       box;
     int          natoms, ind_min[2] = { 0, 0 }, ind_mini = 0, ind_minj = 0;
     real         rmin, rmax, rmint, tmint;
+    real         searchCutoff = c_periodicInitialCutoff;
     gmx_bool     bFirst;
     gmx_rmpbc_t  gpbc = nullptr;
 
@@ -185,7 +535,7 @@ static void periodic_mindist_plot(const char*             trxfn,
             gmx_rmpbc(gpbc, natoms, box, x);
         }
 
-        periodic_dist(pbcType, box, x, n, index, &rmin, &rmax, ind_min);
+        periodic_dist(pbcType, box, x, n, index, &rmin, &rmax, ind_min, &searchCutoff);
         if (rmin < rmint)
         {
             rmint    = rmin;
@@ -226,6 +576,7 @@ static void calc_dist(real     rcut,
                       int      index1[],
                       int      index2[],
                       gmx_bool bGroup,
+                      gmx_bool bMin,
                       real*    rmin,
                       real*    rmax,
                       int*     nmin,
@@ -270,6 +621,15 @@ static void calc_dist(real     rcut,
     }
     GMX_RELEASE_ASSERT(index1 != nullptr, "Need a valid index for plotting distances");
 
+    if (bMin)
+    {
+        /* Only the minimum distance is needed, which can use a grid search */
+        calc_min_dist(rcut, bPBC ? &pbc : nullptr, x, nx1, nx2, index1, index2, bGroup, rmin, nmin,
+                      ixmin, jxmin);
+        *rmax = 0;
+        return;
+    }
+
     rmin2 = 1e12;
     rmax2 = -1e12;
 
@@ -499,7 +859,7 @@ static void dist_plot(const char*             fn,
             if (ng == 1)
             {
                 calc_dist(rcut, bPBC, pbcType, box, x0, gnx[0], gnx[0], index[0], index[0], bGroup,
-                          &dmin, &dmax, &nmin, &nmax, &min1, &min2, &max1, &max2);
+                          bMin, &dmin, &dmax, &nmin, &nmax, &min1, &min2, &max1, &max2);
                 fprintf(dist, "  %12e", bMin ? dmin : dmax);
                 if (num)
                 {
@@ -513,7 +873,8 @@ static void dist_plot(const char*             fn,
                     for (k = i + 1; (k < ng); k++)
                     {
                         calc_dist(rcut, bPBC, pbcType, box, x0, gnx[i], gnx[k], index[i], index[k],
-                                  bGroup, &dmin, &dmax, &nmin, &nmax, &min1, &min2, &max1, &max2);
+                                  bGroup, bMin, &dmin, &dmax, &nmin, &nmax, &min1, &min2, &max1,
+                                  &max2);
                         fprintf(dist, "  %12e", bMin ? dmin : dmax);
                         if (num)
                         {
@@ -529,19 +890,24 @@ static void dist_plot(const char*             fn,
             for (i = 1; (i < ng); i++)
             {
                 calc_dist(rcut, bPBC, pbcType, box, x0, gnx[0], gnx[i], index[0], index[i], bGroup,
-                          &dmin, &dmax, &nmin, &nmax, &min1, &min2, &max1, &max2);
+                          bMin, &dmin, &dmax, &nmin, &nmax, &min1, &min2, &max1, &max2);
                 fprintf(dist, "  %12e", bMin ? dmin : dmax);
                 if (num)
                 {
                     fprintf(num, "  %8d", bMin ? nmin : nmax);
                 }
-                if (nres)
+                if (nres && bMin)
+                {
+                    calc_residue_min_dist(rcut, bPBC, pbcType, box, x0, nres, residue, index[0],
+                                          gnx[i], index[i], mindres[i - 1]);
+                }
+                else if (nres)
                 {
                     for (j = 0; j < nres; j++)
                     {
                         calc_dist(rcut, bPBC, pbcType, box, x0, residue[j + 1] - residue[j], gnx[i],
-                                  &(index[0][residue[j]]), index[i], bGroup, &dmin, &dmax, &nmin,
-                                  &nmax, &min1r, &min2r, &max1r, &max2r);
+                                  &(index[0][residue[j]]), index[i], bGroup, bMin, &dmin, &dmax,
+                                  &nmin, &nmax, &min1r, &min2r, &max1r, &max2r);
                         mindres[i - 1][j] = std::min(mindres[i - 1][j], dmin);
                         maxdres[i - 1][j] = std::max(maxdres[i - 1][j], dmax);
                     }
@@ -38,7 +38,9 @@
 
 #include "config.h"
 
+#include <algorithm>
 #include <array>
+#include <vector>
 
 #include "gromacs/commandline/pargs.h"
 #include "gromacs/fileio/confio.h"
@@ -54,6 +56,7 @@
 #include "gromacs/topology/topology.h"
 #include "gromacs/utility/arraysize.h"
 #include "gromacs/utility/cstringutil.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
 #include "gromacs/utility/gmxassert.h"
@@ -61,6 +64,17 @@
 #include "gromacs/utility/pleasecite.h"
 #include "gromacs/utility/smalloc.h"
 
+//! Coordinates of a trajectory frame buffered for parallel processing.
+struct SansFrame
+{
+    //! Coordinates.
+    std::vector<gmx::RVec> x;
+    //! Box.
+    matrix box;
+    //! Time.
+    real t;
+};
+
 int gmx_sans(int argc, char* argv[])
 {
     const char* desc[] = {
@@ -241,100 +255,134 @@ int gmx_sans(int argc, char* argv[])
                 natoms, top->atoms.nr);
     }
 
-    do
+    /* Frames are read in blocks of nthreads frames, and the histograms of
+     * the frames in a block are computed in parallel with one thread each.
+     * A block with a single frame uses all threads for that frame.
+     */
+    nthreads = std::max(1, nthreads);
+    std::vector<SansFrame>                            frames(nthreads);
+    std::vector<gmx_radial_distribution_histogram_t*> framePr(nthreads);
+    gmx_bool                                          bMoreFrames = TRUE;
+    while (bMoreFrames)
     {
-        if (bPBC)
-        {
-            gmx_rmpbc(gpbc, top->atoms.nr, box, x);
-        }
-        /* allocate memory for pr */
-        if (pr == nullptr)
-        {
-            /* in case its first frame to read */
-            snew(pr, 1);
-        }
-        /*  realy calc p(r) */
-        prframecurrent = calc_radial_distribution_histogram(gsans, x, box, index, isize, binwidth,
-                                                            bMC, bNORM, mcover, seed);
-        /* copy prframecurrent -> pr and summ up pr->gr[i] */
-        /* allocate and/or resize memory for pr->gr[i] and pr->r[i] */
-        if (pr->gr == nullptr)
+        int nframes = 0;
+        do
         {
-            /* check if we use pr->gr first time */
-            snew(pr->gr, prframecurrent->grn);
-            snew(pr->r, prframecurrent->grn);
-        }
-        else
-        {
-            /* resize pr->gr and pr->r if needed to preven overruns */
-            if (prframecurrent->grn > pr->grn)
+            if (bPBC)
             {
-                srenew(pr->gr, prframecurrent->grn);
-                srenew(pr->r, prframecurrent->grn);
+                gmx_rmpbc(gpbc, top->atoms.nr, box, x);
             }
-        }
-        pr->grn      = prframecurrent->grn;
-        pr->binwidth = prframecurrent->binwidth;
-        /* summ up gr and fill r */
-        for (i = 0; i < prframecurrent->grn; i++)
+            frames[nframes].x.assign(x, x + natoms);
+            copy_mat(box, frames[nframes].box);
+            frames[nframes].t = t;
+            nframes++;
+            bMoreFrames = read_next_x(oenv, status, &t, x, box);
+        } while (bMoreFrames && nframes < nthreads);
+
+        const int threadsPerFrame = (nframes == 1 ? nthreads : 1);
+#pragma omp parallel for num_threads(nframes) schedule(static)
+        for (int frame = 0; frame < nframes; frame++)
         {
-            pr->gr[i] += prframecurrent->gr[i];
-            pr->r[i] = prframecurrent->r[i];
+            try
+            {
+                /*  realy calc p(r) */
+                framePr[frame] = calc_radial_distribution_histogram(
+                        gsans, as_rvec_array(frames[frame].x.data()), frames[frame].box, index,
+                        isize, binwidth, bMC, bNORM, mcover, seed, threadsPerFrame);
+            }
+            GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
         }
-        /* normalize histo */
-        normalize_probability(prframecurrent->grn, prframecurrent->gr);
-        /* convert p(r) to sq */
-        sqframecurrent = convert_histogram_to_intensity_curve(prframecurrent, start_q, end_q, q_step);
-        /* print frame data if needed */
-        if (opt2fn_null("-prframe", NFILE, fnm))
+
+        for (int frame = 0; frame < nframes; frame++)
         {
-            snew(hdr, 25);
-            snew(suffix, GMX_PATH_MAX);
-            /* prepare header */
-            sprintf(hdr, "g(r), t = %f", t);
-            /* prepare output filename */
-            auto fnmdup = filenames;
-            sprintf(suffix, "-t%.2f", t);
-            add_suffix_to_output_names(fnmdup.data(), NFILE, suffix);
-            fp = xvgropen(opt2fn_null("-prframe", NFILE, fnmdup.data()), hdr, "Distance (nm)",
-                          "Probability", oenv);
+            /* allocate memory for pr */
+            if (pr == nullptr)
+            {
+                /* in case its first frame to read */
+                snew(pr, 1);
+            }
+            prframecurrent = framePr[frame];
+            /* copy prframecurrent -> pr and summ up pr->gr[i] */
+            /* allocate and/or resize memory for pr->gr[i] and pr->r[i] */
+            if (pr->gr == nullptr)
+            {
+                /* check if we use pr->gr first time */
+                snew(pr->gr, prframecurrent->grn);
+                snew(pr->r, prframecurrent->grn);
+            }
+            else
+            {
+                /* resize pr->gr and pr->r if needed to preven overruns */
+                if (prframecurrent->grn > pr->grn)
+                {
+                    srenew(pr->gr, prframecurrent->grn);
+                    srenew(pr->r, prframecurrent->grn);
+                }
+            }
+            pr->grn      = prframecurrent->grn;
+            pr->binwidth = prframecurrent->binwidth;
+            /* summ up gr and fill r */
             for (i = 0; i < prframecurrent->grn; i++)
             {
-                fprintf(fp, "%10.6f%10.6f\n", prframecurrent->r[i], prframecurrent->gr[i]);
+                pr->gr[i] += prframecurrent->gr[i];
+                pr->r[i] = prframecurrent->r[i];
             }
-            xvgrclose(fp);
-            sfree(hdr);
-            sfree(suffix);
-        }
-        if (opt2fn_null("-sqframe", NFILE, fnm))
-        {
-            snew(hdr, 25);
-            snew(suffix, GMX_PATH_MAX);
-            /* prepare header */
-            sprintf(hdr, "I(q), t = %f", t);
-            /* prepare output filename */
-            auto fnmdup = filenames;
-            sprintf(suffix, "-t%.2f", t);
-            add_suffix_to_output_names(fnmdup.data(), NFILE, suffix);
-            fp = xvgropen(opt2fn_null("-sqframe", NFILE, fnmdup.data()), hdr, "q (nm^-1)",
-                          "s(q)/s(0)", oenv);
-            for (i = 0; i < sqframecurrent->qn; i++)
+            /* normalize histo */
+            normalize_probability(prframecurrent->grn, prframecurrent->gr);
+            /* convert p(r) to sq */
+            sqframecurrent =
+                    convert_histogram_to_intensity_curve(prframecurrent, start_q, end_q, q_step);
+            /* print frame data if needed */
+            if (opt2fn_null("-prframe", NFILE, fnm))
             {
-                fprintf(fp, "%10.6f%10.6f\n", sqframecurrent->q[i], sqframecurrent->s[i]);
+                snew(hdr, 25);
+                snew(suffix, GMX_PATH_MAX);
+                /* prepare header */
+                sprintf(hdr, "g(r), t = %f", frames[frame].t);
+                /* prepare output filename */
+                auto fnmdup = filenames;
+                sprintf(suffix, "-t%.2f", frames[frame].t);
+                add_suffix_to_output_names(fnmdup.data(), NFILE, suffix);
+                fp = xvgropen(opt2fn_null("-prframe", NFILE, fnmdup.data()), hdr, "Distance (nm)",
+                              "Probability", oenv);
+                for (i = 0; i < prframecurrent->grn; i++)
+                {
+                    fprintf(fp, "%10.6f%10.6f\n", prframecurrent->r[i], prframecurrent->gr[i]);
+                }
+                xvgrclose(fp);
+                sfree(hdr);
+                sfree(suffix);
             }
-            xvgrclose(fp);
-            sfree(hdr);
-            sfree(suffix);
+            if (opt2fn_null("-sqframe", NFILE, fnm))
+            {
+                snew(hdr, 25);
+                snew(suffix, GMX_PATH_MAX);
+                /* prepare header */
+                sprintf(hdr, "I(q), t = %f", frames[frame].t);
+                /* prepare output filename */
+                auto fnmdup = filenames;
+                sprintf(suffix, "-t%.2f", frames[frame].t);
+                add_suffix_to_output_names(fnmdup.data(), NFILE, suffix);
+                fp = xvgropen(opt2fn_null("-sqframe", NFILE, fnmdup.data()), hdr, "q (nm^-1)",
+                              "s(q)/s(0)", oenv);
+                for (i = 0; i < sqframecurrent->qn; i++)
+                {
+                    fprintf(fp, "%10.6f%10.6f\n", sqframecurrent->q[i], sqframecurrent->s[i]);
+                }
+                xvgrclose(fp);
+                sfree(hdr);
+                sfree(suffix);
+            }
+            /* free pr structure */
+            sfree(prframecurrent->gr);
+            sfree(prframecurrent->r);
+            sfree(prframecurrent);
+            /* free sq structure */
+            sfree(sqframecurrent->q);
+            sfree(sqframecurrent->s);
+            sfree(sqframecurrent);
         }
-        /* free pr structure */
-        sfree(prframecurrent->gr);
-        sfree(prframecurrent->r);
-        sfree(prframecurrent);
-        /* free sq structure */
-        sfree(sqframecurrent->q);
-        sfree(sqframecurrent->s);
-        sfree(sqframecurrent);
-    } while (read_next_x(oenv, status, &t, x, box));
+    }
     close_trx(status);
 
     /* normalize histo */
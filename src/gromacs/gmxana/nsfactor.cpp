@@ -39,13 +39,20 @@
 
 #include "config.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <cstring>
 
+#include <vector>
+
 #include "gromacs/math/vec.h"
 #include "gromacs/random/threefry.h"
 #include "gromacs/random/uniformintdistribution.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/simd/simd_math.h"
 #include "gromacs/topology/topology.h"
+#include "gromacs/utility/alignedallocator.h"
 #include "gromacs/utility/cstringutil.h"
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
@@ -54,6 +61,90 @@
 #include "gromacs/utility/smalloc.h"
 #include "gromacs/utility/strdb.h"
 
+namespace
+{
+
+//! Positions and scattering lengths of a group, packed for SIMD access.
+struct PackedScatterers
+{
+    //! X coordinates.
+    std::vector<real, gmx::AlignedAllocator<real>> x;
+    //! Y coordinates.
+    std::vector<real, gmx::AlignedAllocator<real>> y;
+    //! Z coordinates.
+    std::vector<real, gmx::AlignedAllocator<real>> z;
+    //! Scattering lengths.
+    std::vector<double> slength;
+};
+
+//! Copies the positions and scattering lengths of the atoms in \p index.
+PackedScatterers packScatterers(const gmx_sans_t* gsans, const rvec* x, const int* index, int isize)
+{
+    PackedScatterers packed;
+    packed.x.resize(isize);
+    packed.y.resize(isize);
+    packed.z.resize(isize);
+    packed.slength.resize(isize);
+    for (int i = 0; i < isize; i++)
+    {
+        packed.x[i]       = x[index[i]][XX];
+        packed.y[i]       = x[index[i]][YY];
+        packed.z[i]       = x[index[i]][ZZ];
+        packed.slength[i] = gsans->slength[index[i]];
+    }
+    return packed;
+}
+
+/*! \brief
+ * Adds all pairs (i, j) with iStart <= i < iEnd and j < i to a histogram.
+ *
+ * The distances are binned with SIMD over j; the products of the
+ * scattering lengths are accumulated in double precision.
+ */
+void addPairsToHistogram(const PackedScatterers& packed,
+                         int                     iStart,
+                         int                     iEnd,
+                         real                    invBinwidth,
+                         double*                 gr)
+{
+#if GMX_SIMD_HAVE_REAL
+    const gmx::SimdReal invBinwidthS(invBinwidth);
+    alignas(GMX_SIMD_ALIGNMENT) std::int32_t bin[GMX_SIMD_REAL_WIDTH];
+#endif
+    for (int i = iStart; i < iEnd; i++)
+    {
+        const double slengthI = packed.slength[i];
+        int          j        = 0;
+#if GMX_SIMD_HAVE_REAL
+        const gmx::SimdReal xi(packed.x[i]);
+        const gmx::SimdReal yi(packed.y[i]);
+        const gmx::SimdReal zi(packed.z[i]);
+        for (; j + GMX_SIMD_REAL_WIDTH <= i; j += GMX_SIMD_REAL_WIDTH)
+        {
+            const gmx::SimdReal dx = xi - gmx::load<gmx::SimdReal>(packed.x.data() + j);
+            const gmx::SimdReal dy = yi - gmx::load<gmx::SimdReal>(packed.y.data() + j);
+            const gmx::SimdReal dz = zi - gmx::load<gmx::SimdReal>(packed.z.data() + j);
+            const gmx::SimdReal r2 = dx * dx + dy * dy + dz * dz;
+            gmx::store(bin, gmx::cvttR2I(gmx::sqrt(r2) * invBinwidthS));
+            for (int k = 0; k < GMX_SIMD_REAL_WIDTH; k++)
+            {
+                gr[bin[k]] += slengthI * packed.slength[j + k];
+            }
+        }
+#endif
+        for (; j < i; j++)
+        {
+            const real dx = packed.x[i] - packed.x[j];
+            const real dy = packed.y[i] - packed.y[j];
+            const real dz = packed.z[i] - packed.z[j];
+            gr[static_cast<int>(std::sqrt(dx * dx + dy * dy + dz * dz) * invBinwidth)] +=
+                    slengthI * packed.slength[j];
+        }
+    }
+}
+
+} // namespace
+
 void check_binwidth(real binwidth)
 {
     real smallest_bin = 0.1;
@@ -197,7 +288,8 @@ gmx_radial_distribution_histogram_t* calc_radial_distribution_histogram(gmx_sans
                                                                         gmx_bool     bMC,
                                                                         gmx_bool     bNORM,
                                                                         real         mcover,
-                                                                        unsigned int seed)
+                                                                        unsigned int seed,
+                                                                        int          nthreads)
 {
     gmx_radial_distribution_histogram_t* pr = nullptr;
     rvec                                 dist;
@@ -206,7 +298,6 @@ gmx_radial_distribution_histogram_t* calc_radial_distribution_histogram(gmx_sans
 #if GMX_OPENMP
     double**                  tgr;
     int                       tid;
-    int                       nthreads;
     gmx::DefaultRandomEngine* trng = nullptr;
 #endif
     int64_t                  mc = 0, mc_max;
@@ -242,7 +333,6 @@ gmx_radial_distribution_histogram_t* calc_radial_distribution_histogram(gmx_sans
             mc_max = static_cast<int64_t>(std::floor(0.5 * mcover * isize * (isize - 1)));
         }
 #if GMX_OPENMP
-        nthreads = gmx_omp_get_max_threads();
         snew(tgr, nthreads);
         trng = new gmx::DefaultRandomEngine[nthreads];
         for (i = 0; i < nthreads; i++)
@@ -250,7 +340,7 @@ gmx_radial_distribution_histogram_t* calc_radial_distribution_histogram(gmx_sans
             snew(tgr[i], pr->grn);
             trng[i].seed(rng());
         }
-#    pragma omp parallel shared(tgr, trng, mc) private(tid, i, j)
+#    pragma omp parallel num_threads(nthreads) shared(tgr, trng, mc) private(tid, i, j)
         {
             gmx::UniformIntDistribution<int> tdist(0, isize - 1);
             tid = gmx_omp_get_thread_num();
@@ -302,56 +392,35 @@ gmx_radial_distribution_histogram_t* calc_radial_distribution_histogram(gmx_sans
     }
     else
     {
-#if GMX_OPENMP
-        nthreads = gmx_omp_get_max_threads();
-        /* Allocating memory for tgr arrays */
-        snew(tgr, nthreads);
-        for (i = 0; i < nthreads; i++)
+        const PackedScatterers packed = packScatterers(gsans, x, index, isize);
+        const real             invBinwidth = 1.0 / binwidth;
+        /* Row i has i pairs, so split the rows into parts of equal area
+         * of the pair triangle.
+         */
+        const int  numThreads = std::max(1, std::min(nthreads, isize));
+        const auto partStart  = [isize, numThreads](int part) {
+            return static_cast<int>(
+                    std::round(isize * std::sqrt(static_cast<double>(part) / numThreads)));
+        };
+        std::vector<std::vector<double>> threadGr(numThreads);
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+        for (int thread = 0; thread < numThreads; thread++)
         {
-            snew(tgr[i], pr->grn);
-        }
-#    pragma omp parallel shared(tgr) private(tid, i, j)
-        {
-            tid = gmx_omp_get_thread_num();
-/* starting parallel threads */
-#    pragma omp for
-            for (i = 0; i < isize; i++)
+            try
             {
-                try
-                {
-                    for (j = 0; j < i; j++)
-                    {
-                        tgr[tid][static_cast<int>(std::floor(std::sqrt(distance2(x[index[i]], x[index[j]])) / binwidth))] +=
-                                gsans->slength[index[i]] * gsans->slength[index[j]];
-                    }
-                }
-                GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+                threadGr[thread].resize(pr->grn);
+                addPairsToHistogram(packed, partStart(thread), partStart(thread + 1), invBinwidth,
+                                    threadGr[thread].data());
             }
+            GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
         }
-        /* collecating data for pr->gr */
-        for (i = 0; i < pr->grn; i++)
+        for (const auto& gr : threadGr)
         {
-            for (j = 0; j < nthreads; j++)
+            for (i = 0; i < pr->grn; i++)
             {
-                pr->gr[i] += tgr[j][i];
-            }
-        }
-        /* freeing memory for tgr */
-        for (i = 0; i < nthreads; i++)
-        {
-            sfree(tgr[i]);
-        }
-        sfree(tgr);
-#else
-        for (i = 0; i < isize; i++)
-        {
-            for (j = 0; j < i; j++)
-            {
-                pr->gr[static_cast<int>(std::floor(std::sqrt(distance2(x[index[i]], x[index[j]])) / binwidth))] +=
-                        gsans->slength[index[i]] * gsans->slength[index[j]];
+                pr->gr[i] += gr[i];
             }
         }
-#endif
     }
 
     /* normalize if needed */
@@ -83,6 +83,13 @@ gmx_neutron_atomic_structurefactors_t* gmx_neutronstructurefactors_init(const ch
 
 gmx_sans_t* gmx_sans_init(const t_topology* top, gmx_neutron_atomic_structurefactors_t* gnsf);
 
+/*! \brief
+ * Computes the histogram of pair distances in \p index, weighted by the
+ * products of the scattering lengths.
+ *
+ * The direct method loops over all pairs using \p nthreads OpenMP threads;
+ * with \p bMC, pairs are sampled randomly.
+ */
 gmx_radial_distribution_histogram_t* calc_radial_distribution_histogram(gmx_sans_t*  gsans,
                                                                         rvec*        x,
                                                                         matrix       box,
@@ -92,7 +99,8 @@ gmx_radial_distribution_histogram_t* calc_radial_distribution_histogram(gmx_sans
                                                                         gmx_bool     bMC,
                                                                         gmx_bool     bNORM,
                                                                         real         mcover,
-                                                                        unsigned int seed);
+                                                                        unsigned int seed,
+                                                                        int          nthreads);
 
 gmx_static_structurefactor_t* convert_histogram_to_intensity_curve(gmx_radial_distribution_histogram_t* pr,
                                                                    double start_q,
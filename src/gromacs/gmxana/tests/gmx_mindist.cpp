@@ -54,6 +54,7 @@
 #include "testutils/stdiohelper.h"
 #include "testutils/testfilemanager.h"
 #include "testutils/textblockmatchers.h"
+#include "testutils/tprfilegenerator.h"
 #include "testutils/xvgtest.h"
 
 namespace
@@ -61,6 +62,7 @@ namespace
 
 using gmx::test::CommandLine;
 using gmx::test::StdioTestHelper;
+using gmx::test::TprAndFileManager;
 using gmx::test::XvgMatch;
 
 class MindistTest : public gmx::test::CommandLineTestBase
@@ -192,6 +194,33 @@ TEST_F(MindistTest, matrixWorks)
     runTest(CommandLine(cmdline), stdIn);
 }
 
-// TODO test periodic image - needs a tpr?
+//! Test fixture for -pi, which needs a run input file for the periodic boundary conditions.
+class MindistPeriodicImageTest : public gmx::test::CommandLineTestBase
+{
+public:
+    void runTest(const CommandLine& args, const char* stringForStdin)
+    {
+        StdioTestHelper stdioHelper(&fileManager());
+        stdioHelper.redirectStringToStdin(stringForStdin);
+
+        CommandLine& cmdline = commandLine();
+        cmdline.merge(args);
+        ASSERT_EQ(0, gmx_mindist(cmdline.argc(), cmdline.argv()));
+        checkOutputFiles();
+    }
+};
+
+// Minimum distance of a protein to its periodic images, with enough
+// atoms that the images for all box shifts are searched on a grid
+TEST_F(MindistPeriodicImageTest, periodicImageWorksWithProtein)
+{
+    TprAndFileManager tprFileHandle("lysozyme");
+    setInputFile("-f", "lysozyme.pdb");
+    commandLine().addOption("-s", tprFileHandle.tprName());
+    setOutputFile("-od", "mindist.xvg", XvgMatch());
+    const char* const cmdline[] = { "mindist", "-pi" };
+    const char* const stdIn     = "1";
+    runTest(CommandLine(cmdline), stdIn);
+}
 
 } // namespace
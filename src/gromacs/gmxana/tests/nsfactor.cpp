@@ -0,0 +1,157 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the pair distance histogram used by gmx sans
+ */
+#include "gmxpre.h"
+
+#include "gromacs/gmxana/nsfactor.h"
+
+#include <cmath>
+
+#include <vector>
+
+#include "gromacs/math/vec.h"
+#include "gromacs/random/threefry.h"
+#include "gromacs/random/uniformrealdistribution.h"
+#include "gromacs/utility/smalloc.h"
+
+#include "testutils/testasserts.h"
+
+namespace gmx
+{
+
+namespace
+{
+
+class RadialDistributionHistogramTest : public ::testing::Test
+{
+protected:
+    static constexpr double c_binwidth = 0.2;
+
+    RadialDistributionHistogramTest()
+    {
+        clear_mat(box_);
+        box_[XX][XX] = 2.5;
+        box_[YY][YY] = 2.5;
+        box_[ZZ][ZZ] = 2.5;
+        // Place atoms such that no pair distance is close to a bin edge,
+        // so that the binning is unambiguous.
+        DefaultRandomEngine           rng(1234);
+        UniformRealDistribution<real> dist(0, 2.5);
+        while (x_.size() < 67)
+        {
+            const RVec x(dist(rng), dist(rng), dist(rng));
+            bool       bNearEdge = false;
+            for (const RVec& other : x_)
+            {
+                const real bin = std::sqrt(distance2(x, other)) / c_binwidth;
+                bNearEdge      = bNearEdge || std::abs(bin - std::round(bin)) < 1e-3;
+            }
+            if (!bNearEdge)
+            {
+                x_.push_back(x);
+                slength_.push_back(-3.7 + 0.5 * (x_.size() % 7));
+                index_.push_back(x_.size() - 1);
+            }
+        }
+        gsans_.top     = nullptr;
+        gsans_.slength = slength_.data();
+    }
+
+    gmx_radial_distribution_histogram_t* computeHistogram(int nthreads)
+    {
+        return calc_radial_distribution_histogram(&gsans_, as_rvec_array(x_.data()), box_,
+                                                  index_.data(), index_.size(), c_binwidth, FALSE,
+                                                  FALSE, -1, 0, nthreads);
+    }
+
+    static void freeHistogram(gmx_radial_distribution_histogram_t* pr)
+    {
+        sfree(pr->gr);
+        sfree(pr->r);
+        sfree(pr);
+    }
+
+    std::vector<RVec>   x_;
+    std::vector<double> slength_;
+    std::vector<int>    index_;
+    matrix              box_;
+    gmx_sans_t          gsans_;
+};
+
+TEST_F(RadialDistributionHistogramTest, DirectMethodMatchesPairLoop)
+{
+    gmx_radial_distribution_histogram_t* pr = computeHistogram(1);
+
+    std::vector<double> reference(pr->grn);
+    for (size_t i = 0; i < x_.size(); i++)
+    {
+        for (size_t j = 0; j < i; j++)
+        {
+            const int bin = static_cast<int>(std::sqrt(distance2(x_[i], x_[j])) / c_binwidth);
+            ASSERT_LT(bin, pr->grn);
+            reference[bin] += slength_[i] * slength_[j];
+        }
+    }
+    for (int bin = 0; bin < pr->grn; bin++)
+    {
+        EXPECT_DOUBLE_EQ_TOL(reference[bin], pr->gr[bin],
+                             test::relativeToleranceAsFloatingPoint(1, 1e-12))
+                << "bin " << bin;
+    }
+    freeHistogram(pr);
+}
+
+TEST_F(RadialDistributionHistogramTest, DirectMethodIsIndependentOfThreadCount)
+{
+    gmx_radial_distribution_histogram_t* pr1 = computeHistogram(1);
+    gmx_radial_distribution_histogram_t* pr3 = computeHistogram(3);
+
+    ASSERT_EQ(pr1->grn, pr3->grn);
+    for (int bin = 0; bin < pr1->grn; bin++)
+    {
+        EXPECT_DOUBLE_EQ_TOL(pr1->gr[bin], pr3->gr[bin],
+                             test::relativeToleranceAsFloatingPoint(1, 1e-12))
+                << "bin " << bin;
+    }
+    freeHistogram(pr1);
+    freeHistogram(pr3);
+}
+
+} // namespace
+
+} // namespace gmx
@@ -68,9 +68,7 @@ static void copy_atom(const t_atoms* atoms1, int a1, t_atoms* atoms2, int a2, t_
 
 static int pdbasearch_atom(const char* name, int resind, const t_atoms* pdba, const char* searchtype, bool bAllowMissing)
 {
-    int i;
-
-    for (i = 0; (i < pdba->nr) && (pdba->atom[i].resind != resind); i++) {}
+    int i = first_atom_of_residue(resind, pdba);
 
     return search_atom(name, i, pdba, searchtype, bAllowMissing);
 }
@@ -90,8 +88,8 @@ static void hacksearch_atom(int*                                            ii,
         name++;
         resind--;
     }
-    for (i = 0; (i < pdba->nr) && (pdba->atom[i].resind != resind); i++) {}
-    for (; (i < pdba->nr) && (pdba->atom[i].resind == resind) && (*ii < 0); i++)
+    for (i = first_atom_of_residue(resind, pdba);
+         (i < pdba->nr) && (pdba->atom[i].resind == resind) && (*ii < 0); i++)
     {
         int j = 0;
         for (const auto& patch : patches[i])
@@ -56,6 +56,7 @@
 #include "gromacs/pbcutil/pbc.h"
 #include "gromacs/random/threefry.h"
 #include "gromacs/random/uniformintdistribution.h"
+#include "gromacs/selection/nbsearch.h"
 #include "gromacs/topology/index.h"
 #include "gromacs/topology/topology.h"
 #include "gromacs/utility/arrayref.h"
@@ -67,37 +68,33 @@
 #include "gromacs/utility/smalloc.h"
 
 
-/*! \brief Return whether any atoms of two groups are below minimum distance.
+/*! \brief Mark solvent molecules with any atom below minimum distance of a set of positions.
  *
- * \param[in] pbc the periodic boundary conditions
- * \param[in] x the coordinates
- * \param[in] smallerGroupIndices the atom indices of the first group to check
- * \param[in] largerGroupIndices the atom indices of the second group to check
- * \param[in] minimumDistance the minimum required distance betwenn any atom in
- *                            the first and second group
- * \returns true if any distance between an atom from group A and group B is
- *               smaller than a minimum distance.
+ * \param[in] solventSearch neighborhood search over the atoms of the continuous solvent group
+ * \param[in] positions the positions to check
+ * \param[in] numberAtomsPerSolventMolecule how many atoms each solvent molecule contains
+ * \param[in] minimumDistance the minimum required distance between any solvent atom
+ *                            and the positions
+ * \param[in,out] isTooClose for each solvent molecule, set to true when it has an atom
+ *                           closer than the minimum distance to any of the positions
  */
-static bool groupsCloserThanCutoffWithPbc(t_pbc*                   pbc,
-                                          rvec                     x[],
-                                          gmx::ArrayRef<const int> smallerGroupIndices,
-                                          gmx::ArrayRef<const int> largerGroupIndices,
-                                          real                     minimumDistance)
+static void markSolventMoleculesCloserThanCutoff(const gmx::AnalysisNeighborhoodSearch&    solventSearch,
+                                                 const gmx::AnalysisNeighborhoodPositions& positions,
+                                                 int numberAtomsPerSolventMolecule,
+                                                 real minimumDistance,
+                                                 std::vector<bool>* isTooClose)
 {
     const real minimumDistance2 = minimumDistance * minimumDistance;
-    for (int aIndex : largerGroupIndices)
+
+    gmx::AnalysisNeighborhoodPairSearch pairSearch = solventSearch.startPairSearch(positions);
+    gmx::AnalysisNeighborhoodPair       pair;
+    while (pairSearch.findNextPair(&pair))
     {
-        for (int bIndex : smallerGroupIndices)
+        if (pair.distance2() < minimumDistance2)
         {
-            rvec dx;
-            pbc_dx(pbc, x[aIndex], x[bIndex], dx);
-            if (norm2(dx) < minimumDistance2)
-            {
-                return true;
-            }
+            (*isTooClose)[pair.refIndex() / numberAtomsPerSolventMolecule] = true;
         }
     }
-    return false;
 }
 
 /*! \brief Calculate the solvent molecule atom indices from molecule number.
@@ -123,31 +120,31 @@ static std::vector<int> solventMoleculeIndices(int solventMoleculeNumber,
     return indices;
 }
 
-static void insert_ion(int                      nsa,
-                       std::vector<int>*        solventMoleculesForReplacement,
-                       int                      repl[],
-                       gmx::ArrayRef<const int> index,
-                       rvec                     x[],
-                       t_pbc*                   pbc,
-                       int                      sign,
-                       int                      q,
-                       const char*              ionname,
-                       t_atoms*                 atoms,
-                       real                     rmin,
-                       std::vector<int>*        notSolventGroup)
+/*! \brief Replace a randomly chosen solvent molecule by an ion.
+ *
+ * When \p solventSearch is not null, solvent molecules marked in \p isTooCloseToNonSolvent
+ * are skipped and the solvent molecules within the search cutoff of the ion are marked.
+ */
+static void insert_ion(int                                    nsa,
+                       std::vector<int>*                      solventMoleculesForReplacement,
+                       int                                    repl[],
+                       gmx::ArrayRef<const int>               index,
+                       rvec                                   x[],
+                       const gmx::AnalysisNeighborhoodSearch* solventSearch,
+                       int                                    sign,
+                       int                                    q,
+                       const char*                            ionname,
+                       t_atoms*                               atoms,
+                       real                                   rmin,
+                       std::vector<bool>*                     isTooCloseToNonSolvent)
 {
-    std::vector<int> solventMoleculeAtomsToBeReplaced =
-            solventMoleculeIndices(solventMoleculesForReplacement->back(), nsa, index);
-
-    if (rmin > 0.0)
+    if (solventSearch != nullptr)
     {
-        // check for proximity to non-solvent
-        while (groupsCloserThanCutoffWithPbc(pbc, x, solventMoleculeAtomsToBeReplaced, *notSolventGroup, rmin)
-               && !solventMoleculesForReplacement->empty())
+        // skip molecules close to non-solvent or to ions placed before
+        while (!solventMoleculesForReplacement->empty()
+               && (*isTooCloseToNonSolvent)[solventMoleculesForReplacement->back()])
         {
             solventMoleculesForReplacement->pop_back();
-            solventMoleculeAtomsToBeReplaced =
-                    solventMoleculeIndices(solventMoleculesForReplacement->back(), nsa, index);
         }
     }
 
@@ -156,11 +153,20 @@ static void insert_ion(int                      nsa,
         gmx_fatal(FARGS, "No more replaceable solvent!");
     }
 
+    std::vector<int> solventMoleculeAtomsToBeReplaced =
+            solventMoleculeIndices(solventMoleculesForReplacement->back(), nsa, index);
+
     fprintf(stderr, "Replacing solvent molecule %d (atom %d) with %s\n",
             solventMoleculesForReplacement->back(), solventMoleculeAtomsToBeReplaced[0], ionname);
 
+    if (solventSearch != nullptr)
+    {
+        gmx::AnalysisNeighborhoodPositions ionPosition(x[solventMoleculeAtomsToBeReplaced[0]]);
+        markSolventMoleculesCloserThanCutoff(*solventSearch, ionPosition, nsa, rmin,
+                                             isTooCloseToNonSolvent);
+    }
+
     /* Replace solvent molecule charges with ion charge */
-    notSolventGroup->push_back(solventMoleculeAtomsToBeReplaced[0]);
     repl[solventMoleculesForReplacement->back()] = sign;
 
     // The first solvent molecule atom is replaced with an ion and the respective
@@ -644,16 +650,35 @@ int gmx_genion(int argc, char* argv[])
         std::shuffle(std::begin(solventMoleculesForReplacement),
                      std::end(solventMoleculesForReplacement), rng);
 
+        // With a minimum distance, a grid search over the solvent atoms is used
+        // to mark the solvent molecules close to non-solvent atoms once and
+        // close to each placed ion, so checking a candidate is a lookup.
+        gmx::AnalysisNeighborhood              nb;
+        gmx::AnalysisNeighborhoodSearch        solventSearch;
+        const gmx::AnalysisNeighborhoodSearch* solventSearchPtr = nullptr;
+        std::vector<bool>                      isTooCloseToNonSolvent(nw, false);
+        if (rmin > 0.0)
+        {
+            nb.setCutoff(rmin);
+            solventSearch = nb.initSearch(
+                    &pbc, gmx::AnalysisNeighborhoodPositions(x, atoms.nr).indexed(solventGroup));
+            solventSearchPtr = &solventSearch;
+            markSolventMoleculesCloserThanCutoff(
+                    solventSearch,
+                    gmx::AnalysisNeighborhoodPositions(x, atoms.nr).indexed(notSolventGroup), nsa,
+                    rmin, &isTooCloseToNonSolvent);
+        }
+
         /* Now loop over the ions that have to be placed */
         while (p_num-- > 0)
         {
-            insert_ion(nsa, &solventMoleculesForReplacement, repl, solventGroup, x, &pbc, 1, p_q,
-                       p_name, &atoms, rmin, &notSolventGroup);
+            insert_ion(nsa, &solventMoleculesForReplacement, repl, solventGroup, x, solventSearchPtr,
+                       1, p_q, p_name, &atoms, rmin, &isTooCloseToNonSolvent);
         }
         while (n_num-- > 0)
         {
-            insert_ion(nsa, &solventMoleculesForReplacement, repl, solventGroup, x, &pbc, -1, n_q,
-                       n_name, &atoms, rmin, &notSolventGroup);
+            insert_ion(nsa, &solventMoleculesForReplacement, repl, solventGroup, x, solventSearchPtr,
+                       -1, n_q, n_name, &atoms, rmin, &isTooCloseToNonSolvent);
         }
         fprintf(stderr, "\n");
 
@@ -43,7 +43,8 @@
 #include <cmath>
 #include <cstring>
 
-#include <algorithm>
+#include <string>
+#include <unordered_map>
 
 #include "gromacs/gmxpreprocess/grompp_impl.h"
 #include "gromacs/gmxpreprocess/notset.h"
@@ -84,10 +85,23 @@ class PreprocessingAtomTypes::Impl
 public:
     //! The number for currently loaded entries.
     size_t size() const { return types.size(); }
+    //! Rebuild \p nameToType after types were renamed or renumbered.
+    void rebuildNameIndex();
     //! The actual atom type data.
     std::vector<AtomTypeData> types;
+    //! Index of the first type with each name, for fast lookup by name.
+    std::unordered_map<std::string, int> nameToType;
 };
 
+void PreprocessingAtomTypes::Impl::rebuildNameIndex()
+{
+    nameToType.clear();
+    for (size_t i = 0; i < types.size(); i++)
+    {
+        nameToType.emplace(*types[i].name_, i);
+    }
+}
+
 bool PreprocessingAtomTypes::isSet(int nt) const
 {
     return ((nt >= 0) && (nt < gmx::ssize(*this)));
@@ -96,15 +110,14 @@ bool PreprocessingAtomTypes::isSet(int nt) const
 int PreprocessingAtomTypes::atomTypeFromName(const std::string& str) const
 {
     /* Atom types are always case sensitive */
-    auto found = std::find_if(impl_->types.begin(), impl_->types.end(),
-                              [&str](const auto& type) { return str == *type.name_; });
-    if (found == impl_->types.end())
+    auto found = impl_->nameToType.find(str);
+    if (found == impl_->nameToType.end())
     {
         return NOTSET;
     }
     else
     {
-        return std::distance(impl_->types.begin(), found);
+        return found->second;
     }
 }
 
@@ -182,6 +195,7 @@ int PreprocessingAtomTypes::addType(t_symtab*                tab,
     int position = atomTypeFromName(name);
     if (position == NOTSET)
     {
+        impl_->nameToType.emplace(name, impl_->types.size());
         impl_->types.emplace_back(a, put_symtab(tab, name.c_str()), nb, bondAtomType, atomNumber);
         return atomTypeFromName(name);
     }
@@ -204,12 +218,19 @@ int PreprocessingAtomTypes::setType(int                      nt,
         return NOTSET;
     }
 
+    const bool renamed = (name != *impl_->types[nt].name_);
+
     impl_->types[nt].atom_         = a;
     impl_->types[nt].name_         = put_symtab(tab, name.c_str());
     impl_->types[nt].nb_           = nb;
     impl_->types[nt].bondAtomType_ = bondAtomType;
     impl_->types[nt].atomNumber_   = atomNumber;
 
+    if (renamed)
+    {
+        impl_->rebuildNameIndex();
+    }
+
     return nt;
 }
 
@@ -367,6 +388,7 @@ void PreprocessingAtomTypes::renumberTypes(gmx::ArrayRef<InteractionsOfType> pli
 
     impl_->types                  = new_types;
     plist[ftype].interactionTypes = nbsnew;
+    impl_->rebuildNameIndex();
 }
 
 void PreprocessingAtomTypes::copyTot_atomtypes(t_atomtypes* atomtypes) const
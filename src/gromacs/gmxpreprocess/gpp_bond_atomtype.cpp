@@ -41,7 +41,7 @@
 
 #include <cstring>
 
-#include <algorithm>
+#include <unordered_map>
 #include <vector>
 
 #include "gromacs/gmxpreprocess/notset.h"
@@ -54,21 +54,21 @@ class PreprocessingBondAtomType::Impl
 public:
     //! The atom type names.
     std::vector<char**> typeNames;
+    //! Index of each type name in \p typeNames, for fast lookup by name.
+    std::unordered_map<std::string, int> typeIndex;
 };
 
 int PreprocessingBondAtomType::bondAtomTypeFromName(const std::string& str) const
 {
     /* Atom types are always case sensitive */
-    auto found =
-            std::find_if(impl_->typeNames.begin(), impl_->typeNames.end(),
-                         [&str](const auto& type) { return str == const_cast<const char*>(*type); });
-    if (found == impl_->typeNames.end())
+    auto found = impl_->typeIndex.find(str);
+    if (found == impl_->typeIndex.end())
     {
         return NOTSET;
     }
     else
     {
-        return std::distance(impl_->typeNames.begin(), found);
+        return found->second;
     }
 }
 
@@ -86,6 +86,7 @@ int PreprocessingBondAtomType::addBondAtomType(t_symtab* tab, const std::string&
     int position = bondAtomTypeFromName(name);
     if (position == NOTSET)
     {
+        impl_->typeIndex.emplace(name, impl_->typeNames.size());
         impl_->typeNames.emplace_back(put_symtab(tab, name.c_str()));
         return bondAtomTypeFromName(name);
     }
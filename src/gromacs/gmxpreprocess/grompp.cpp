@@ -46,6 +46,7 @@
 
 #include <algorithm>
 #include <memory>
+#include <numeric>
 #include <vector>
 
 #include <sys/types.h>
@@ -65,6 +66,7 @@
 #include "gromacs/gmxpreprocess/gen_maxwell_velocities.h"
 #include "gromacs/gmxpreprocess/gpp_atomtype.h"
 #include "gromacs/gmxpreprocess/grompp_impl.h"
+#include "gromacs/gmxpreprocess/moltypeparallel.h"
 #include "gromacs/gmxpreprocess/notset.h"
 #include "gromacs/gmxpreprocess/readir.h"
 #include "gromacs/gmxpreprocess/tomorse.h"
@@ -339,10 +341,8 @@ static void check_bonds_timestep(const gmx_mtop_t* mtop, double dt, warninp* wi)
      */
     int  min_steps_warn = 5;
     int  min_steps_note = 10;
-    int  ftype;
-    int  i, a1, a2, w_a1, w_a2, j;
-    real twopi2, limit2, fc, re, m1, m2, period2, w_period2;
-    bool bFound, bWater, bWarn;
+    real twopi2, limit2;
+    bool bWater, bWarn;
 
     /* Get the interaction parameters */
     gmx::ArrayRef<const t_iparams> ip = mtop->ffparams.iparams;
@@ -351,79 +351,111 @@ static void check_bonds_timestep(const gmx_mtop_t* mtop, double dt, warninp* wi)
 
     limit2 = gmx::square(min_steps_note * dt);
 
-    w_a1 = w_a2 = -1;
-    w_period2   = -1.0;
+    /* The unconstrained bond with the shortest period for each molecule type,
+     * with a1 = -1 when there is none. The molecule types are checked in parallel.
+     */
+    struct ShortPeriodBond
+    {
+        real period2 = -1.0;
+        int  a1      = -1;
+        int  a2      = -1;
+    };
+    std::vector<ShortPeriodBond> shortPeriodBonds(mtop->moltype.size());
 
-    const gmx_moltype_t* w_moltype = nullptr;
-    for (const gmx_moltype_t& moltype : mtop->moltype)
+    const int numThreads = numThreadsForMoleculeTypes();
+#pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+    for (gmx::index mt = 0; mt < gmx::ssize(mtop->moltype); mt++)
     {
-        const t_atom*           atom  = moltype.atoms.atom;
-        const InteractionLists& ilist = moltype.ilist;
-        const InteractionList&  ilc   = ilist[F_CONSTR];
-        const InteractionList&  ils   = ilist[F_SETTLE];
-        for (ftype = 0; ftype < F_NRE; ftype++)
+        try
         {
-            if (!(ftype == F_BONDS || ftype == F_G96BONDS || ftype == F_HARMONIC))
+            const gmx_moltype_t&    moltype = mtop->moltype[mt];
+            ShortPeriodBond*        w       = &shortPeriodBonds[mt];
+            const t_atom*           atom    = moltype.atoms.atom;
+            const InteractionLists& ilist   = moltype.ilist;
+            const InteractionList&  ilc     = ilist[F_CONSTR];
+            const InteractionList&  ils     = ilist[F_SETTLE];
+            for (int ftype = 0; ftype < F_NRE; ftype++)
             {
-                continue;
-            }
-
-            const InteractionList& ilb = ilist[ftype];
-            for (i = 0; i < ilb.size(); i += 3)
-            {
-                fc = ip[ilb.iatoms[i]].harmonic.krA;
-                re = ip[ilb.iatoms[i]].harmonic.rA;
-                if (ftype == F_G96BONDS)
-                {
-                    /* Convert squared sqaure fc to harmonic fc */
-                    fc = 2 * fc * re;
-                }
-                a1 = ilb.iatoms[i + 1];
-                a2 = ilb.iatoms[i + 2];
-                m1 = atom[a1].m;
-                m2 = atom[a2].m;
-                if (fc > 0 && m1 > 0 && m2 > 0)
-                {
-                    period2 = twopi2 * m1 * m2 / ((m1 + m2) * fc);
-                }
-                else
-                {
-                    period2 = GMX_FLOAT_MAX;
-                }
-                if (debug)
+                if (!(ftype == F_BONDS || ftype == F_G96BONDS || ftype == F_HARMONIC))
                 {
-                    fprintf(debug, "fc %g m1 %g m2 %g period %g\n", fc, m1, m2, std::sqrt(period2));
+                    continue;
                 }
-                if (period2 < limit2)
+
+                const InteractionList& ilb = ilist[ftype];
+                for (int i = 0; i < ilb.size(); i += 3)
                 {
-                    bFound = false;
-                    for (j = 0; j < ilc.size(); j += 3)
+                    real fc = ip[ilb.iatoms[i]].harmonic.krA;
+                    real re = ip[ilb.iatoms[i]].harmonic.rA;
+                    if (ftype == F_G96BONDS)
                     {
-                        if ((ilc.iatoms[j + 1] == a1 && ilc.iatoms[j + 2] == a2)
-                            || (ilc.iatoms[j + 1] == a2 && ilc.iatoms[j + 2] == a1))
-                        {
-                            bFound = true;
-                        }
+                        /* Convert squared sqaure fc to harmonic fc */
+                        fc = 2 * fc * re;
                     }
-                    for (j = 0; j < ils.size(); j += 4)
+                    int  a1 = ilb.iatoms[i + 1];
+                    int  a2 = ilb.iatoms[i + 2];
+                    real m1 = atom[a1].m;
+                    real m2 = atom[a2].m;
+                    real period2;
+                    if (fc > 0 && m1 > 0 && m2 > 0)
                     {
-                        if ((a1 == ils.iatoms[j + 1] || a1 == ils.iatoms[j + 2] || a1 == ils.iatoms[j + 3])
-                            && (a2 == ils.iatoms[j + 1] || a2 == ils.iatoms[j + 2]
-                                || a2 == ils.iatoms[j + 3]))
-                        {
-                            bFound = true;
-                        }
+                        period2 = twopi2 * m1 * m2 / ((m1 + m2) * fc);
                     }
-                    if (!bFound && (w_moltype == nullptr || period2 < w_period2))
+                    else
                     {
-                        w_moltype = &moltype;
-                        w_a1      = a1;
-                        w_a2      = a2;
-                        w_period2 = period2;
+                        period2 = GMX_FLOAT_MAX;
+                    }
+                    if (debug)
+                    {
+                        fprintf(debug, "fc %g m1 %g m2 %g period %g\n", fc, m1, m2, std::sqrt(period2));
+                    }
+                    if (period2 < limit2)
+                    {
+                        bool bFound = false;
+                        for (int j = 0; j < ilc.size(); j += 3)
+                        {
+                            if ((ilc.iatoms[j + 1] == a1 && ilc.iatoms[j + 2] == a2)
+                                || (ilc.iatoms[j + 1] == a2 && ilc.iatoms[j + 2] == a1))
+                            {
+                                bFound = true;
+                            }
+                        }
+                        for (int j = 0; j < ils.size(); j += 4)
+                        {
+                            if ((a1 == ils.iatoms[j + 1] || a1 == ils.iatoms[j + 2]
+                                 || a1 == ils.iatoms[j + 3])
+                                && (a2 == ils.iatoms[j + 1] || a2 == ils.iatoms[j + 2]
+                                    || a2 == ils.iatoms[j + 3]))
+                            {
+                                bFound = true;
+                            }
+                        }
+                        if (!bFound && (w->a1 < 0 || period2 < w->period2))
+                        {
+                            w->a1      = a1;
+                            w->a2      = a2;
+                            w->period2 = period2;
+                        }
                     }
                 }
             }
         }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
+    }
+
+    const gmx_moltype_t* w_moltype = nullptr;
+    int                  w_a1      = -1;
+    int                  w_a2      = -1;
+    real                 w_period2 = -1.0;
+    for (size_t mt = 0; mt < mtop->moltype.size(); mt++)
+    {
+        const ShortPeriodBond& w = shortPeriodBonds[mt];
+        if (w.a1 >= 0 && (w_moltype == nullptr || w.period2 < w_period2))
+        {
+            w_moltype = &mtop->moltype[mt];
+            w_a1      = w.a1;
+            w_a2      = w.a2;
+            w_period2 = w.period2;
+        }
     }
 
     if (w_moltype != nullptr)
@@ -1559,13 +1591,19 @@ static void checkDecoupledModeAccuracy(const gmx_mtop_t* mtop, const t_inputrec*
         return;
     }
 
-    bool haveDecoupledMode = false;
-    for (const gmx_moltype_t& molt : mtop->moltype)
+    bool      haveDecoupledMode = false;
+    const int numThreads        = numThreadsForMoleculeTypes();
+#pragma omp parallel for num_threads(numThreads) schedule(dynamic) reduction(|| : haveDecoupledMode)
+    for (gmx::index mt = 0; mt < gmx::ssize(mtop->moltype); mt++)
     {
-        if (haveDecoupledModeInMol(molt, mtop->ffparams.iparams, massFactorThreshold))
+        try
         {
-            haveDecoupledMode = true;
+            if (haveDecoupledModeInMol(mtop->moltype[mt], mtop->ffparams.iparams, massFactorThreshold))
+            {
+                haveDecoupledMode = true;
+            }
         }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
     }
 
     if (haveDecoupledMode)
@@ -1918,19 +1956,30 @@ int gmx_grompp(int argc, char* argv[])
         pr_symtab(debug, 0, "After new_status", &sys.symtab);
     }
 
-    nvsite = 0;
     /* set parameters for virtual site construction (not for vsiten) */
-    for (size_t mt = 0; mt < sys.moltype.size(); mt++)
+    std::vector<int> numVsites(sys.moltype.size());
+    auto             moltypeLoggers = forEachMoleculeTypeInParallel(
+            sys.moltype.size(), logger, [&](int mt, const gmx::MDLogger& moltypeLogger) {
+                numVsites[mt] = set_vsites(bVerbose, &sys.moltype[mt].atoms, &atypes,
+                                           mi[mt].interactions, moltypeLogger);
+            });
+    for (auto& moltypeLogger : moltypeLoggers)
     {
-        nvsite += set_vsites(bVerbose, &sys.moltype[mt].atoms, &atypes, mi[mt].interactions, logger);
+        moltypeLogger->flush();
     }
+    nvsite = std::accumulate(numVsites.begin(), numVsites.end(), 0);
     /* now throw away all obsolete bonds, angles and dihedrals: */
     /* note: constraints are ALWAYS removed */
     if (nvsite)
     {
-        for (size_t mt = 0; mt < sys.moltype.size(); mt++)
+        moltypeLoggers = forEachMoleculeTypeInParallel(
+                sys.moltype.size(), logger, [&](int mt, const gmx::MDLogger& moltypeLogger) {
+                    clean_vsite_bondeds(mi[mt].interactions, sys.moltype[mt].atoms.nr, bRmVSBds,
+                                        moltypeLogger);
+                });
+        for (auto& moltypeLogger : moltypeLoggers)
         {
-            clean_vsite_bondeds(mi[mt].interactions, sys.moltype[mt].atoms.nr, bRmVSBds, logger);
+            moltypeLogger->flush();
         }
     }
 
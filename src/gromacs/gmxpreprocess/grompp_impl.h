@@ -39,7 +39,9 @@
 #ifndef GMX_GMXPREPROCESS_GROMPP_IMPL_H
 #define GMX_GMXPREPROCESS_GROMPP_IMPL_H
 
+#include <array>
 #include <string>
+#include <unordered_map>
 
 #include "gromacs/gmxpreprocess/notset.h"
 #include "gromacs/topology/atoms.h"
@@ -128,6 +130,24 @@ private:
     std::string interactionTypeName_;
 };
 
+//! Atom (type) tuple of an interaction type, padded to MAXATOMLIST entries.
+using InteractionTypeKey = std::array<int, MAXATOMLIST>;
+
+//! Hash for InteractionTypeKey.
+struct InteractionTypeKeyHash
+{
+    //! Combines the hashes of all tuple entries.
+    size_t operator()(const InteractionTypeKey& key) const
+    {
+        size_t hash = 0;
+        for (int value : key)
+        {
+            hash = hash * 1000003 ^ std::hash<int>()(value);
+        }
+        return hash;
+    }
+};
+
 /*! \libinternal \brief
  * A set of interactions of a given type
  * (found in the enumeration in ifunc.h), complete with
@@ -149,6 +169,14 @@ struct InteractionsOfType
     std::vector<real> cmap;
     //! The five atomtypes followed by a number that identifies the type.
     std::vector<int> cmapAtomTypes;
+    /*! \brief Index of the first entry in \p interactionTypes for each atom type tuple.
+     *
+     * Built on demand when looking up force-field parameters and only valid
+     * for the first \p numIndexedInteractionTypes entries.
+     */
+    std::unordered_map<InteractionTypeKey, int, InteractionTypeKeyHash> interactionTypeIndex;
+    //! Number of entries of \p interactionTypes that are in \p interactionTypeIndex.
+    size_t numIndexedInteractionTypes = 0;
 
     //! Number of parameters.
     size_t size() const { return interactionTypes.size(); }
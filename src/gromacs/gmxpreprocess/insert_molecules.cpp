@@ -60,7 +60,6 @@
 #include "gromacs/pbcutil/pbc.h"
 #include "gromacs/random/threefry.h"
 #include "gromacs/random/uniformrealdistribution.h"
-#include "gromacs/selection/nbsearch.h"
 #include "gromacs/selection/selection.h"
 #include "gromacs/selection/selectioncollection.h"
 #include "gromacs/selection/selectionoption.h"
@@ -76,10 +75,14 @@
 #include "gromacs/utility/enumerationhelpers.h"
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/smalloc.h"
 
 using gmx::RVec;
 
+//! The number of trial insertions per thread in each batch of random insertions
+static const int c_trialsPerThread = 4;
+
 /* enum for random rotations of inserted solutes */
 enum class RotationType : int
 {
@@ -139,35 +142,238 @@ static void generate_trial_conf(gmx::ArrayRef<RVec>       xin,
     }
 }
 
-static bool isInsertionAllowed(gmx::AnalysisNeighborhoodSearch* search,
-                               const std::vector<real>&         exclusionDistances,
-                               const std::vector<RVec>&         x,
-                               const std::vector<real>&         exclusionDistances_insrt,
-                               const t_atoms&                   atoms,
-                               const std::set<int>&             removableAtoms,
-                               gmx::AtomsRemover*               remover)
+/*! \brief
+ * Cell grid over atom positions that new atoms can be added to.
+ *
+ * In contrast to AnalysisNeighborhoodSearch, adding atoms does not require
+ * building the whole grid again, so the cost of checking a trial insertion
+ * does not grow with the number of inserted molecules.
+ * The cells are at least as wide as the cutoff, so only neighboring cells
+ * need to be searched. Atoms outside the box are put in the periodic image
+ * of their cell, or in the closest edge cell along non-periodic dimensions.
+ */
+class InsertionGrid
 {
-    gmx::AnalysisNeighborhoodPositions  pos(x);
-    gmx::AnalysisNeighborhoodPairSearch pairSearch = search->startPairSearch(pos);
-    gmx::AnalysisNeighborhoodPair       pair;
-    while (pairSearch.findNextPair(&pair))
+public:
+    /*! \brief Creates an empty grid
+     *
+     * \param[in] pbcType           The periodic boundary conditions
+     * \param[in] box               The box to make the grid for
+     * \param[in] cutoff            The largest distance to search atoms within
+     * \param[in] numAtomsEstimate  The expected number of atoms, to limit the number of cells
+     */
+    InsertionGrid(PbcType pbcType, const matrix box, real cutoff, int numAtomsEstimate);
+
+    //! Adds atoms with positions \p x, the indices continue from the atoms added before
+    void addAtoms(gmx::ArrayRef<const RVec> x);
+
+    /*! \brief Calls \p func(index, distance2) for all atoms within the cutoff of \p x
+     *
+     * Stops and returns false as soon as \p func returns false, returns true otherwise.
+     */
+    template<typename Func>
+    bool forEachAtomWithinCutoff(const rvec x, Func func) const;
+
+private:
+    //! Returns the cell coordinates for position \p x
+    void cellOfPosition(const rvec x, ivec cell) const;
+    //! Returns the index of the cell with coordinates \p cell
+    int cellIndex(const ivec cell) const
     {
-        const real r1 = exclusionDistances[pair.refIndex()];
-        const real r2 = exclusionDistances_insrt[pair.testIndex()];
-        if (pair.distance2() < gmx::square(r1 + r2))
+        return (cell[XX] * numCells_[YY] + cell[YY]) * numCells_[ZZ] + cell[ZZ];
+    }
+
+    //! PBC information for the distances
+    t_pbc pbc_;
+    //! The box the cells are made for
+    matrix box_;
+    //! The number of periodic dimensions, the first dimensions are periodic
+    int numPeriodicDimensions_;
+    //! The squared cutoff
+    real cutoff2_;
+    //! The number of cells along each box vector
+    ivec numCells_;
+    //! For each cell the index of the last atom added, -1 when empty
+    std::vector<int> cellLastAtom_;
+    //! For each atom the index of the previous atom added to the same cell, -1 for none
+    std::vector<int> previousAtomInCell_;
+    //! The positions of the atoms
+    std::vector<RVec> x_;
+};
+
+InsertionGrid::InsertionGrid(PbcType pbcType, const matrix box, real cutoff, int numAtomsEstimate) :
+    cutoff2_(gmx::square(cutoff))
+{
+    // set_pbc() also handles an unset PBC type
+    set_pbc(&pbc_, pbcType, box);
+    numPeriodicDimensions_ = pbc_.ndim_ePBC;
+    copy_mat(box, box_);
+
+    // Use at least as many atoms as cells, to avoid large, mostly empty grids
+    const real volume   = det(box_);
+    real       cellSize = cutoff;
+    if (volume > 0 && numAtomsEstimate > 0)
+    {
+        cellSize = std::max(cellSize, std::cbrt(volume / numAtomsEstimate));
+    }
+    int numCellsTotal = 1;
+    for (int d = 0; d < DIM; d++)
+    {
+        // The distance between the faces of the box spanned by the other two vectors
+        rvec normal;
+        cprod(box_[(d + 1) % DIM], box_[(d + 2) % DIM], normal);
+        const real width = (box_[d][d] > 0 ? volume / norm(normal) : 0);
+        numCells_[d]     = std::max(1, static_cast<int>(std::floor(width / cellSize)));
+        numCellsTotal *= numCells_[d];
+    }
+    cellLastAtom_.resize(numCellsTotal, -1);
+}
+
+void InsertionGrid::cellOfPosition(const rvec x, ivec cell) const
+{
+    // Fractional coordinates for the lower triangular box
+    rvec s = { 0, 0, 0 };
+    for (int d = DIM - 1; d >= 0; d--)
+    {
+        if (box_[d][d] > 0)
         {
-            if (removableAtoms.count(pair.refIndex()) == 0)
+            real xd = x[d];
+            for (int e = d + 1; e < DIM; e++)
             {
-                return false;
+                xd -= s[e] * box_[e][d];
+            }
+            s[d] = xd / box_[d][d];
+        }
+    }
+    for (int d = 0; d < DIM; d++)
+    {
+        if (d < numPeriodicDimensions_)
+        {
+            s[d] -= std::floor(s[d]);
+        }
+        cell[d] = std::min(std::max(static_cast<int>(std::floor(s[d] * numCells_[d])), 0),
+                           numCells_[d] - 1);
+    }
+}
+
+void InsertionGrid::addAtoms(gmx::ArrayRef<const RVec> x)
+{
+    for (const RVec& xi : x)
+    {
+        ivec cell;
+        cellOfPosition(xi, cell);
+        const int ci = cellIndex(cell);
+        previousAtomInCell_.push_back(cellLastAtom_[ci]);
+        cellLastAtom_[ci] = x_.size();
+        x_.push_back(xi);
+    }
+}
+
+template<typename Func>
+bool InsertionGrid::forEachAtomWithinCutoff(const rvec x, Func func) const
+{
+    ivec cell;
+    cellOfPosition(x, cell);
+
+    // The neighboring cells along each dimension, each cell only once
+    int neighborCells[DIM][3];
+    int numNeighborCells[DIM];
+    for (int d = 0; d < DIM; d++)
+    {
+        numNeighborCells[d] = 0;
+        if (d < numPeriodicDimensions_ && numCells_[d] <= 3)
+        {
+            for (int c = 0; c < numCells_[d]; c++)
+            {
+                neighborCells[d][numNeighborCells[d]++] = c;
+            }
+            continue;
+        }
+        for (int c = cell[d] - 1; c <= cell[d] + 1; c++)
+        {
+            if (d < numPeriodicDimensions_)
+            {
+                neighborCells[d][numNeighborCells[d]++] = (c + numCells_[d]) % numCells_[d];
+            }
+            else if (c >= 0 && c < numCells_[d])
+            {
+                neighborCells[d][numNeighborCells[d]++] = c;
+            }
+        }
+    }
+
+    for (int ix = 0; ix < numNeighborCells[XX]; ix++)
+    {
+        for (int iy = 0; iy < numNeighborCells[YY]; iy++)
+        {
+            for (int iz = 0; iz < numNeighborCells[ZZ]; iz++)
+            {
+                const ivec neighborCell = { neighborCells[XX][ix], neighborCells[YY][iy],
+                                            neighborCells[ZZ][iz] };
+                for (int j = cellLastAtom_[cellIndex(neighborCell)]; j >= 0; j = previousAtomInCell_[j])
+                {
+                    rvec dx;
+                    pbc_dx(&pbc_, x, x_[j], dx);
+                    const real distance2 = norm2(dx);
+                    if (distance2 <= cutoff2_ && !func(j, distance2))
+                    {
+                        return false;
+                    }
+                }
             }
-            // TODO: If molecule information is available, this should ideally
-            // use it to remove whole molecules.
-            remover->markResidue(atoms, pair.refIndex(), true);
         }
     }
     return true;
 }
 
+/*! \brief Returns whether the molecule with positions \p x can be inserted
+ *
+ * Only overlap with atoms in \p removableAtoms is allowed, the indices of
+ * these atoms are returned in \p replacedAtoms.
+ */
+static bool isInsertionAllowed(const InsertionGrid&     grid,
+                               const std::vector<real>& exclusionDistances,
+                               const std::vector<RVec>& x,
+                               const std::vector<real>& exclusionDistances_insrt,
+                               const std::set<int>&     removableAtoms,
+                               std::vector<int>*        replacedAtoms)
+{
+    replacedAtoms->clear();
+    for (size_t i = 0; i < x.size(); ++i)
+    {
+        const real r2 = exclusionDistances_insrt[i];
+        const bool bAllowed =
+                grid.forEachAtomWithinCutoff(x[i], [&](int refIndex, real distance2) {
+                    const real r1 = exclusionDistances[refIndex];
+                    if (distance2 < gmx::square(r1 + r2))
+                    {
+                        if (removableAtoms.count(refIndex) == 0)
+                        {
+                            return false;
+                        }
+                        replacedAtoms->push_back(refIndex);
+                    }
+                    return true;
+                });
+        if (!bAllowed)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+//! A trial configuration for inserting a molecule
+struct TrialInsertion
+{
+    //! The positions of the inserted molecule
+    std::vector<RVec> x;
+    //! Whether the insertion is allowed, given the atoms before the current batch of trials
+    bool bAllowed = false;
+    //! The atoms whose residues are replaced by the inserted molecule
+    std::vector<int> replacedAtoms;
+};
+
 static void insert_mols(int                  nmol_insrt,
                         int                  ntry,
                         int                  seed,
@@ -201,11 +407,6 @@ static void insert_mols(int                  nmol_insrt,
         maxRadius = std::max(maxInsertRadius, maxExistingRadius);
     }
 
-    // TODO: Make all of this exception-safe.
-    gmx::AnalysisNeighborhood nb;
-    nb.setCutoff(maxInsertRadius + maxRadius);
-
-
     if (seed == 0)
     {
         seed = static_cast<int>(gmx::makeRandomSeed());
@@ -214,9 +415,6 @@ static void insert_mols(int                  nmol_insrt,
 
     gmx::DefaultRandomEngine rng(seed);
 
-    t_pbc pbc;
-    set_pbc(&pbc, pbcType, box);
-
     /* With -ip, take nmol_insrt from file posfn */
     double**   rpos              = nullptr;
     const bool insertAtPositions = !posfn.empty();
@@ -241,7 +439,17 @@ static void insert_mols(int                  nmol_insrt,
         exclusionDistances.reserve(finalAtomCount);
     }
 
-    std::vector<RVec> x_n(x_insrt.size());
+    InsertionGrid grid(pbcType, box, maxInsertRadius + maxRadius,
+                       atoms->nr + nmol_insrt * atoms_insrt.nr);
+    grid.addAtoms(*x);
+
+    // Random trial insertions are checked in batches over OpenMP threads.
+    // The trials are generated and accepted in the same order as when
+    // checking them one at a time, so the result only depends on the seed.
+    // With -ip the next trial depends on the outcome of the previous one.
+    const int                   numThreads = gmx_omp_get_max_threads();
+    const int                   batchSize  = insertAtPositions ? 1 : c_trialsPerThread * numThreads;
+    std::vector<TrialInsertion> trials(batchSize);
 
     int                                mol        = 0;
     int                                trial      = 0;
@@ -251,47 +459,82 @@ static void insert_mols(int                  nmol_insrt,
 
     while (mol < nmol_insrt && trial < ntry * nmol_insrt)
     {
-        rvec offset_x;
-        if (!insertAtPositions)
+        const int numTrials = std::min(batchSize, ntry * nmol_insrt - trial);
+        for (int t = 0; t < numTrials; t++)
+        {
+            rvec offset_x;
+            if (!insertAtPositions)
+            {
+                // Insert at random positions.
+                offset_x[XX] = box[XX][XX] * dist(rng);
+                offset_x[YY] = box[YY][YY] * dist(rng);
+                offset_x[ZZ] = box[ZZ][ZZ] * dist(rng);
+            }
+            else
+            {
+                // Insert at positions taken from option -ip file.
+                offset_x[XX] = rpos[XX][mol] + deltaR[XX] * (2 * dist(rng) - 1);
+                offset_x[YY] = rpos[YY][mol] + deltaR[YY] * (2 * dist(rng) - 1);
+                offset_x[ZZ] = rpos[ZZ][mol] + deltaR[ZZ] * (2 * dist(rng) - 1);
+            }
+            generate_trial_conf(x_insrt, offset_x, enum_rot, &rng, &trials[t].x);
+        }
+
+#pragma omp parallel for num_threads(numThreads) schedule(dynamic) if (numTrials > 1)
+        for (int t = 0; t < numTrials; t++)
         {
-            // Insert at random positions.
-            offset_x[XX] = box[XX][XX] * dist(rng);
-            offset_x[YY] = box[YY][YY] * dist(rng);
-            offset_x[ZZ] = box[ZZ][ZZ] * dist(rng);
+            try
+            {
+                trials[t].bAllowed = isInsertionAllowed(grid, exclusionDistances, trials[t].x,
+                                                        exclusionDistances_insrt, removableAtoms,
+                                                        &trials[t].replacedAtoms);
+            }
+            GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
         }
-        else
+
+        bool bInsertedInBatch = false;
+        for (int t = 0; t < numTrials && mol < nmol_insrt; t++)
         {
-            // Skip a position if ntry trials were not successful.
-            if (trial >= firstTrial + ntry)
+            fprintf(stderr, "\rTry %d", ++trial);
+            fflush(stderr);
+
+            TrialInsertion* trialInsertion = &trials[t];
+            if (trialInsertion->bAllowed && bInsertedInBatch)
             {
-                fprintf(stderr, " skipped position (%.3f, %.3f, %.3f)\n", rpos[XX][mol],
-                        rpos[YY][mol], rpos[ZZ][mol]);
+                // Check again for overlap with the molecules inserted in this batch
+                trialInsertion->bAllowed = isInsertionAllowed(
+                        grid, exclusionDistances, trialInsertion->x, exclusionDistances_insrt,
+                        removableAtoms, &trialInsertion->replacedAtoms);
+            }
+            if (trialInsertion->bAllowed)
+            {
+                // TODO: If molecule information is available, this should ideally
+                // use it to remove whole molecules.
+                for (int replacedAtom : trialInsertion->replacedAtoms)
+                {
+                    remover.markResidue(*atoms, replacedAtom, true);
+                }
+                x->insert(x->end(), trialInsertion->x.begin(), trialInsertion->x.end());
+                exclusionDistances.insert(exclusionDistances.end(), exclusionDistances_insrt.begin(),
+                                          exclusionDistances_insrt.end());
+                builder.mergeAtoms(atoms_insrt);
+                grid.addAtoms(trialInsertion->x);
                 ++mol;
-                ++failed;
-                firstTrial = trial;
-                continue;
+                firstTrial       = trial;
+                bInsertedInBatch = true;
+                fprintf(stderr, " success (now %d atoms)!\n", builder.currentAtomCount());
             }
-            // Insert at positions taken from option -ip file.
-            offset_x[XX] = rpos[XX][mol] + deltaR[XX] * (2 * dist(rng) - 1);
-            offset_x[YY] = rpos[YY][mol] + deltaR[YY] * (2 * dist(rng) - 1);
-            offset_x[ZZ] = rpos[ZZ][mol] + deltaR[ZZ] * (2 * dist(rng) - 1);
         }
-        fprintf(stderr, "\rTry %d", ++trial);
-        fflush(stderr);
-
-        generate_trial_conf(x_insrt, offset_x, enum_rot, &rng, &x_n);
-        gmx::AnalysisNeighborhoodPositions pos(*x);
-        gmx::AnalysisNeighborhoodSearch    search = nb.initSearch(&pbc, pos);
-        if (isInsertionAllowed(&search, exclusionDistances, x_n, exclusionDistances_insrt, *atoms,
-                               removableAtoms, &remover))
+
+        // Skip a position if ntry trials were not successful.
+        if (insertAtPositions && mol < nmol_insrt && trial < ntry * nmol_insrt
+            && trial >= firstTrial + ntry)
         {
-            x->insert(x->end(), x_n.begin(), x_n.end());
-            exclusionDistances.insert(exclusionDistances.end(), exclusionDistances_insrt.begin(),
-                                      exclusionDistances_insrt.end());
-            builder.mergeAtoms(atoms_insrt);
+            fprintf(stderr, " skipped position (%.3f, %.3f, %.3f)\n", rpos[XX][mol],
+                    rpos[YY][mol], rpos[ZZ][mol]);
             ++mol;
+            ++failed;
             firstTrial = trial;
-            fprintf(stderr, " success (now %d atoms)!\n", builder.currentAtomCount());
         }
     }
 
@@ -0,0 +1,117 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Implements DeferredLogger.
+ *
+ * \ingroup module_preprocessing
+ */
+#include "gmxpre.h"
+
+#include "moltypeparallel.h"
+
+/*! \internal \brief
+ * Log target that stores entries for one log level in the DeferredLogger.
+ */
+class DeferredLogger::LevelTarget : public gmx::ILogTarget
+{
+public:
+    //! Creates a target storing entries for \p level in \p entries.
+    LevelTarget(gmx::MDLogger::LogLevel                                         level,
+                std::vector<std::pair<gmx::MDLogger::LogLevel, gmx::LogEntry>>* entries) :
+        level_(level),
+        entries_(entries)
+    {
+    }
+
+    void writeEntry(const gmx::LogEntry& entry) override { entries_->emplace_back(level_, entry); }
+
+private:
+    //! The log level of this target.
+    gmx::MDLogger::LogLevel level_;
+    //! Where the entries are stored.
+    std::vector<std::pair<gmx::MDLogger::LogLevel, gmx::LogEntry>>* entries_;
+};
+
+//! Returns the helper of \p logger for \p level.
+static const gmx::LogLevelHelper& logLevelHelper(const gmx::MDLogger& logger, gmx::MDLogger::LogLevel level)
+{
+    switch (level)
+    {
+        case gmx::MDLogger::LogLevel::Error: return logger.error;
+        case gmx::MDLogger::LogLevel::Warning: return logger.warning;
+        case gmx::MDLogger::LogLevel::Info: return logger.info;
+        case gmx::MDLogger::LogLevel::Debug: return logger.debug;
+        default: return logger.verboseDebug;
+    }
+}
+
+DeferredLogger::DeferredLogger(const gmx::MDLogger& target) : target_(target)
+{
+    gmx::ILogTarget* targets[gmx::MDLogger::LogLevelCount];
+    for (int i = 0; i < gmx::MDLogger::LogLevelCount; i++)
+    {
+        const auto level = static_cast<gmx::MDLogger::LogLevel>(i);
+        if (logLevelHelper(target_, level))
+        {
+            levelTargets_.emplace_back(std::make_unique<LevelTarget>(level, &entries_));
+        }
+        else
+        {
+            levelTargets_.emplace_back(nullptr);
+        }
+        targets[i] = levelTargets_.back().get();
+    }
+    logger_ = gmx::MDLogger(targets);
+}
+
+DeferredLogger::~DeferredLogger() = default;
+
+void DeferredLogger::flush()
+{
+    for (const auto& entry : entries_)
+    {
+        const gmx::LogLevelHelper& level = logLevelHelper(target_, entry.first);
+        if (entry.second.asParagraph)
+        {
+            GMX_LOG(level).asParagraph().appendText(entry.second.text);
+        }
+        else
+        {
+            GMX_LOG(level).appendText(entry.second.text);
+        }
+    }
+    entries_.clear();
+}
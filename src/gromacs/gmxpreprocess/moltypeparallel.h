@@ -0,0 +1,123 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Declares helpers for processing molecule types in parallel.
+ *
+ * \ingroup module_preprocessing
+ */
+#ifndef GMX_GMXPREPROCESS_MOLTYPEPARALLEL_H
+#define GMX_GMXPREPROCESS_MOLTYPEPARALLEL_H
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/fatalerror.h"
+#include "gromacs/utility/gmxomp.h"
+#include "gromacs/utility/logger.h"
+
+/*! \internal \brief
+ * Logger that stores all entries and writes them to another logger on request.
+ *
+ * This allows work that logs to run on multiple threads, while the log
+ * output is written in a deterministic order.
+ */
+class DeferredLogger
+{
+public:
+    //! Creates a logger with the same active log levels as \p target.
+    explicit DeferredLogger(const gmx::MDLogger& target);
+    ~DeferredLogger();
+
+    //! Returns the logger that stores entries.
+    const gmx::MDLogger& logger() const { return logger_; }
+    //! Writes all stored entries to the target logger and clears them.
+    void flush();
+
+private:
+    class LevelTarget;
+
+    //! The logger the entries are written to by flush().
+    const gmx::MDLogger& target_;
+    //! One target per log level, nullptr for inactive levels.
+    std::vector<std::unique_ptr<LevelTarget>> levelTargets_;
+    //! Stored entries with their log level, in order of writing.
+    std::vector<std::pair<gmx::MDLogger::LogLevel, gmx::LogEntry>> entries_;
+    //! The logger that stores entries.
+    gmx::MDLogger logger_;
+};
+
+//! Returns the number of OpenMP threads to use for processing molecule types.
+inline int numThreadsForMoleculeTypes()
+{
+    /* Debug output is written directly, use a single thread to keep it ordered */
+    return debug == nullptr ? gmx_omp_get_max_threads() : 1;
+}
+
+/*! \brief
+ * Calls \p func(index, logger) for all \p numMoleculeTypes molecule type indices using OpenMP threads.
+ *
+ * \p func should only modify data of the molecule type it is called for.
+ *
+ * \returns The loggers with the output for each index, which the caller should
+ * flush in the desired order, so the output does not depend on the number of threads.
+ */
+template<typename Func>
+std::vector<std::unique_ptr<DeferredLogger>>
+forEachMoleculeTypeInParallel(int numMoleculeTypes, const gmx::MDLogger& logger, Func func)
+{
+    std::vector<std::unique_ptr<DeferredLogger>> loggers;
+    for (int mt = 0; mt < numMoleculeTypes; mt++)
+    {
+        loggers.emplace_back(std::make_unique<DeferredLogger>(logger));
+    }
+
+    const int numThreads = numThreadsForMoleculeTypes();
+#pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+    for (int mt = 0; mt < numMoleculeTypes; mt++)
+    {
+        try
+        {
+            func(mt, loggers[mt]->logger());
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
+    }
+
+    return loggers;
+}
+
+#endif
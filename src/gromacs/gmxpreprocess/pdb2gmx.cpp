@@ -1399,6 +1399,7 @@ private:
     std::string inputConfFile_;
     std::string outFile_;
     std::string ff_;
+    std::string rtpCacheDir_;
 
     ChainSeparationType chainSeparation_;
     VSitesType          vsitesType_;
@@ -1446,6 +1447,12 @@ void pdb2gmx::initOptions(IOptionsContainer* options, ICommandLineOptionsModuleS
         "Check Chapter 5 of the manual for more information about file formats.",
         "[PAR]",
 
+        "With [TT]-rtpcache[tt], the parsed residue databases ([REF].rtp[ref] files)",
+        "are stored in binary form in the given directory, and later runs",
+        "read them from there as long as the files are unchanged. This helps",
+        "when preparing many systems with the same force field.",
+        "[PAR]",
+
         "Note that a [REF].pdb[ref] file is nothing more than a file format, and it",
         "need not necessarily contain a protein structure. Every kind of",
         "molecule for which there is support in the database can be converted.",
@@ -1613,6 +1620,8 @@ void pdb2gmx::initOptions(IOptionsContainer* options, ICommandLineOptionsModuleS
                                .store(&bRTPresname_)
                                .defaultValue(false)
                                .description("Use [REF].rtp[ref] entry names as residue names"));
+    options->addOption(StringOption("rtpcache").store(&rtpCacheDir_).description(
+            "Directory for caching the parsed [REF].rtp[ref] files between runs"));
     options->addOption(FileNameOption("f")
                                .legacyType(efSTX)
                                .inputFile()
@@ -2059,6 +2068,10 @@ int pdb2gmx::run()
 
     check_occupancy(&pdba_all, inputConfFile_.c_str(), bVerbose_, logger);
 
+    /* The chains have their own copies of the atoms and coordinates */
+    done_atom(&pdba_all);
+    sfree(pdbx);
+
     /* Read atomtypes... */
     PreprocessingAtomTypes atype = read_atype(ffdir_, &symtab);
 
@@ -2068,7 +2081,7 @@ int pdb2gmx::run()
     std::vector<PreprocessResidue> rtpFFDB;
     for (const auto& filename : rtpf)
     {
-        readResidueDatabase(filename, &rtpFFDB, &atype, &symtab, logger, false);
+        readResidueDatabase(filename, &rtpFFDB, &atype, &symtab, logger, false, rtpCacheDir_);
     }
     if (bNewRTP_)
     {
@@ -2532,7 +2545,6 @@ int pdb2gmx::run()
                    pbcType, box);
 
     done_symtab(&symtab);
-    done_atom(&pdba_all);
     done_atom(atoms);
     for (int chain = 0; chain < numChains; chain++)
     {
@@ -2543,7 +2555,6 @@ int pdb2gmx::run()
     sfree(localAtoms);
     sfree(atoms);
     sfree(title);
-    sfree(pdbx);
 
     GMX_LOG(logger.info)
             .asParagraph()
@@ -703,24 +703,24 @@ void write_top(FILE*                                   out,
         fprintf(out, "%-15s %5d\n\n", molname ? molname : "Protein", nrexcl);
 
         print_atoms(out, atype, at, cgnr, bRTPresname);
-        print_bondeds(out, at->nr, Directive::d_bonds, F_BONDS, bts[ebtsBONDS], plist);
-        print_bondeds(out, at->nr, Directive::d_constraints, F_CONSTR, 0, plist);
-        print_bondeds(out, at->nr, Directive::d_constraints, F_CONSTRNC, 0, plist);
-        print_bondeds(out, at->nr, Directive::d_pairs, F_LJ14, 0, plist);
+        print_bondeds(out, Directive::d_bonds, F_BONDS, bts[ebtsBONDS], plist);
+        print_bondeds(out, Directive::d_constraints, F_CONSTR, 0, plist);
+        print_bondeds(out, Directive::d_constraints, F_CONSTRNC, 0, plist);
+        print_bondeds(out, Directive::d_pairs, F_LJ14, 0, plist);
         print_excl(out, at->nr, excls);
-        print_bondeds(out, at->nr, Directive::d_angles, F_ANGLES, bts[ebtsANGLES], plist);
-        print_bondeds(out, at->nr, Directive::d_dihedrals, F_PDIHS, bts[ebtsPDIHS], plist);
-        print_bondeds(out, at->nr, Directive::d_dihedrals, F_IDIHS, bts[ebtsIDIHS], plist);
-        print_bondeds(out, at->nr, Directive::d_cmap, F_CMAP, bts[ebtsCMAP], plist);
-        print_bondeds(out, at->nr, Directive::d_polarization, F_POLARIZATION, 0, plist);
-        print_bondeds(out, at->nr, Directive::d_thole_polarization, F_THOLE_POL, 0, plist);
-        print_bondeds(out, at->nr, Directive::d_vsites2, F_VSITE2, 0, plist);
-        print_bondeds(out, at->nr, Directive::d_vsites3, F_VSITE3, 0, plist);
-        print_bondeds(out, at->nr, Directive::d_vsites3, F_VSITE3FD, 0, plist);
-        print_bondeds(out, at->nr, Directive::d_vsites3, F_VSITE3FAD, 0, plist);
-        print_bondeds(out, at->nr, Directive::d_vsites3, F_VSITE3OUT, 0, plist);
-        print_bondeds(out, at->nr, Directive::d_vsites4, F_VSITE4FD, 0, plist);
-        print_bondeds(out, at->nr, Directive::d_vsites4, F_VSITE4FDN, 0, plist);
+        print_bondeds(out, Directive::d_angles, F_ANGLES, bts[ebtsANGLES], plist);
+        print_bondeds(out, Directive::d_dihedrals, F_PDIHS, bts[ebtsPDIHS], plist);
+        print_bondeds(out, Directive::d_dihedrals, F_IDIHS, bts[ebtsIDIHS], plist);
+        print_bondeds(out, Directive::d_cmap, F_CMAP, bts[ebtsCMAP], plist);
+        print_bondeds(out, Directive::d_polarization, F_POLARIZATION, 0, plist);
+        print_bondeds(out, Directive::d_thole_polarization, F_THOLE_POL, 0, plist);
+        print_bondeds(out, Directive::d_vsites2, F_VSITE2, 0, plist);
+        print_bondeds(out, Directive::d_vsites3, F_VSITE3, 0, plist);
+        print_bondeds(out, Directive::d_vsites3, F_VSITE3FD, 0, plist);
+        print_bondeds(out, Directive::d_vsites3, F_VSITE3FAD, 0, plist);
+        print_bondeds(out, Directive::d_vsites3, F_VSITE3OUT, 0, plist);
+        print_bondeds(out, Directive::d_vsites4, F_VSITE4FD, 0, plist);
+        print_bondeds(out, Directive::d_vsites4, F_VSITE4FDN, 0, plist);
 
         if (pr)
         {
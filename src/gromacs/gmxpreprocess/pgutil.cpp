@@ -43,6 +43,8 @@
 
 #include <cstring>
 
+#include <algorithm>
+
 #include "gromacs/topology/atoms.h"
 #include "gromacs/utility/cstringutil.h"
 #include "gromacs/utility/fatalerror.h"
@@ -156,16 +158,23 @@ int search_atom(const char* type, int start, const t_atoms* atoms, const char* b
     return -1;
 }
 
+int first_atom_of_residue(int resind, const t_atoms* atoms)
+{
+    const t_atom* begin = atoms->atom;
+    const t_atom* end   = atoms->atom + atoms->nr;
+    const t_atom* found = std::lower_bound(
+            begin, end, resind, [](const t_atom& atom, int index) { return atom.resind < index; });
+
+    return (found != end && found->resind == resind) ? found - begin : atoms->nr;
+}
+
 int search_res_atom(const char* type, int resind, const t_atoms* atoms, const char* bondtype, bool bAllowMissing)
 {
-    int i;
+    int i = first_atom_of_residue(resind, atoms);
 
-    for (i = 0; (i < atoms->nr); i++)
+    if (i < atoms->nr)
     {
-        if (atoms->atom[i].resind == resind)
-        {
-            return search_atom(type, i, atoms, bondtype, bAllowMissing);
-        }
+        return search_atom(type, i, atoms, bondtype, bAllowMissing);
     }
 
     return -1;
@@ -52,6 +52,12 @@ struct t_atoms;
  */
 int search_atom(const char* type, int start, const t_atoms* atoms, const char* bondtype, bool bAllowMissing);
 
+/* Returns the index of the first atom in residue resind, or atoms->nr when
+ * the residue has no atoms. The atoms should be ordered by residue index,
+ * so the search takes logarithmic time.
+ */
+int first_atom_of_residue(int resind, const t_atoms* atoms);
+
 /* Similar to search_atom, but this routine searches for the specified
  * atom in residue resind.
  */
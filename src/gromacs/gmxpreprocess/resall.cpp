@@ -44,9 +44,11 @@
 #include <cstring>
 
 #include <algorithm>
+#include <array>
 #include <string>
 #include <vector>
 
+#include "gromacs/fileio/md5.h"
 #include "gromacs/gmxpreprocess/fflibutil.h"
 #include "gromacs/gmxpreprocess/gpp_atomtype.h"
 #include "gromacs/gmxpreprocess/grompp_impl.h"
@@ -54,12 +56,17 @@
 #include "gromacs/gmxpreprocess/pgutil.h"
 #include "gromacs/topology/atoms.h"
 #include "gromacs/topology/symtab.h"
+#include "gromacs/utility/baseversion.h"
 #include "gromacs/utility/cstringutil.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
+#include "gromacs/utility/inmemoryserializer.h"
 #include "gromacs/utility/logger.h"
+#include "gromacs/utility/path.h"
 #include "gromacs/utility/smalloc.h"
 #include "gromacs/utility/strdb.h"
+#include "gromacs/utility/stringutil.h"
+#include "gromacs/utility/sysinfo.h"
 
 #include "hackblock.h"
 
@@ -123,7 +130,32 @@ static void print_resatoms(FILE* out, const PreprocessingAtomTypes& atype, const
     }
 }
 
-static bool read_atoms(FILE* in, char* line, PreprocessResidue* r0, t_symtab* tab, PreprocessingAtomTypes* atype)
+/*! \brief
+ * Contents of a single residue database file.
+ *
+ * Atom names and types are stored as strings, so the contents do not
+ * depend on the symbol table and atom type database they are later
+ * added to and can be cached between runs.
+ */
+struct ResidueDatabaseFile
+{
+    //! Number of values in the [ bondedtypes ] header, or -1 when there is no header.
+    int numHeaderValues = -1;
+    //! Settings from the header, used for all residues.
+    PreprocessResidue headerSettings;
+    //! The residues, without atom names and with atom types not set.
+    std::vector<PreprocessResidue> residues;
+    //! The atom names for each residue.
+    std::vector<std::vector<std::string>> atomNames;
+    //! The atom type names for each residue.
+    std::vector<std::vector<std::string>> atomTypeNames;
+};
+
+static bool read_atoms(FILE*                     in,
+                       char*                     line,
+                       PreprocessResidue*        r0,
+                       std::vector<std::string>* atomNames,
+                       std::vector<std::string>* atomTypeNames)
 {
     int    cg;
     char   buf[256], buf1[256];
@@ -131,28 +163,20 @@ static bool read_atoms(FILE* in, char* line, PreprocessResidue* r0, t_symtab* ta
 
     /* Read Atoms */
     r0->atom.clear();
-    r0->atomname.clear();
     r0->cgnr.clear();
+    atomNames->clear();
+    atomTypeNames->clear();
     while (get_a_line(in, line, STRLEN) && (strchr(line, '[') == nullptr))
     {
         if (sscanf(line, "%s%s%lf%d", buf, buf1, &q, &cg) != 4)
         {
             return FALSE;
         }
-        r0->atomname.push_back(put_symtab(tab, buf));
+        atomNames->push_back(buf);
+        atomTypeNames->push_back(buf1);
         r0->atom.emplace_back();
         r0->atom.back().q = q;
         r0->cgnr.push_back(cg);
-        int j = atype->atomTypeFromName(buf1);
-        if (j == NOTSET)
-        {
-            gmx_fatal(FARGS,
-                      "Atom type %s (residue %s) not found in atomtype "
-                      "database",
-                      buf1, r0->resname.c_str());
-        }
-        r0->atom.back().type = j;
-        r0->atom.back().m    = atype->atomMassFromAtomType(j);
     }
 
     return TRUE;
@@ -299,24 +323,18 @@ void print_resall(FILE* out, gmx::ArrayRef<const PreprocessResidue> rtpDBEntry,
     }
 }
 
-void readResidueDatabase(const std::string&              rrdb,
-                         std::vector<PreprocessResidue>* rtpDBEntry,
-                         PreprocessingAtomTypes*         atype,
-                         t_symtab*                       tab,
-                         const gmx::MDLogger&            logger,
-                         bool                            bAllowOverrideRTP)
+/*! \brief
+ * Parse the residue database file \p in with name \p rrdb.
+ */
+static ResidueDatabaseFile parseResidueDatabase(FILE* in, const std::string& rrdb)
 {
-    FILE* in;
-    char  filebase[STRLEN], line[STRLEN], header[STRLEN];
-    int   bt, nparam;
-    int   dum1, dum2, dum3;
-    bool  bNextResidue, bError;
-
-    fflib_filename_base(rrdb.c_str(), filebase, STRLEN);
-
-    in = fflib_open(rrdb);
+    char line[STRLEN], header[STRLEN];
+    int  bt;
+    int  dum1, dum2, dum3;
+    bool bNextResidue, bError;
 
-    PreprocessResidue header_settings;
+    ResidueDatabaseFile contents;
+    PreprocessResidue&  header_settings = contents.headerSettings;
 
     /* these bonded parameters will overwritten be when  *
      * there is a [ bondedtypes ] entry in the .rtp file */
@@ -357,6 +375,7 @@ void readResidueDatabase(const std::string&              rrdb,
     if (gmx::equalCaseInsensitive("bondedtypes", header, 5))
     {
         get_a_line(in, line, STRLEN);
+        int nparam;
         if ((nparam = sscanf(line, "%d %d %d %d %d %d %d %d", &header_settings.rb[ebtsBONDS].type,
                              &header_settings.rb[ebtsANGLES].type,
                              &header_settings.rb[ebtsPDIHS].type, &header_settings.rb[ebtsIDIHS].type,
@@ -372,57 +391,34 @@ void readResidueDatabase(const std::string&              rrdb,
         get_a_line(in, line, STRLEN);
         if (nparam < 5)
         {
-            GMX_LOG(logger.info)
-                    .asParagraph()
-                    .appendTextFormatted("Using default: not generating all possible dihedrals");
             header_settings.bKeepAllGeneratedDihedrals = FALSE;
         }
         if (nparam < 6)
         {
-            GMX_LOG(logger.info)
-                    .asParagraph()
-                    .appendTextFormatted("Using default: excluding 3 bonded neighbors");
             header_settings.nrexcl = 3;
         }
         if (nparam < 7)
         {
-            GMX_LOG(logger.info)
-                    .asParagraph()
-                    .appendTextFormatted("Using default: generating 1,4 H--H interactions");
             header_settings.bGenerateHH14Interactions = TRUE;
         }
         if (nparam < 8)
         {
-            GMX_LOG(logger.warning)
-                    .asParagraph()
-                    .appendTextFormatted(
-                            "Using default: removing proper dihedrals found on the same bond as a "
-                            "proper dihedral");
             header_settings.bRemoveDihedralIfWithImproper = TRUE;
         }
+        contents.numHeaderValues = nparam;
     }
-    else
-    {
-        GMX_LOG(logger.warning)
-                .asParagraph()
-                .appendTextFormatted(
-                        "Reading .rtp file without '[ bondedtypes ]' directive, "
-                        "Will proceed as if the entry was:");
-        print_resall_log(logger, gmx::arrayRefFromArray(&header_settings, 1));
-    }
-    /* We don't know the current size of rrtp, but simply realloc immediately */
-    auto oldArrayEnd = rtpDBEntry->end();
     while (!feof(in))
     {
         /* Initialise rtp entry structure */
-        rtpDBEntry->push_back(header_settings);
-        PreprocessResidue* res = &rtpDBEntry->back();
+        contents.residues.push_back(header_settings);
+        contents.atomNames.emplace_back();
+        contents.atomTypeNames.emplace_back();
+        PreprocessResidue* res = &contents.residues.back();
         if (!get_header(line, header))
         {
             gmx_fatal(FARGS, "in .rtp file at line:\n%s\n", line);
         }
-        res->resname  = header;
-        res->filebase = filebase;
+        res->resname = header;
 
         get_a_line(in, line, STRLEN);
         bError       = FALSE;
@@ -444,7 +440,8 @@ void readResidueDatabase(const std::string&              rrdb,
                 else if (gmx::equalCaseInsensitive("atoms", header, 5))
                 {
                     /* header is the atoms directive */
-                    bError = !read_atoms(in, line, res, tab, atype);
+                    bError = !read_atoms(in, line, res, &contents.atomNames.back(),
+                                         &contents.atomTypeNames.back());
                 }
                 else
                 {
@@ -462,6 +459,330 @@ void readResidueDatabase(const std::string&              rrdb,
         {
             gmx_fatal(FARGS, "No atoms found in .rtp file in residue %s\n", res->resname.c_str());
         }
+    }
+
+    return contents;
+}
+
+//! Serialize the settings of \p res that are read from the .rtp header.
+static void serializeResidueSettings(gmx::ISerializer* serializer, PreprocessResidue* res)
+{
+    for (auto& bondeds : res->rb)
+    {
+        serializer->doInt(&bondeds.type);
+    }
+    serializer->doBool(&res->bKeepAllGeneratedDihedrals);
+    serializer->doInt(&res->nrexcl);
+    serializer->doBool(&res->bGenerateHH14Interactions);
+    serializer->doBool(&res->bRemoveDihedralIfWithImproper);
+}
+
+//! Serialize the parsed residue database file \p contents.
+static void serializeResidueDatabaseFile(gmx::ISerializer* serializer, ResidueDatabaseFile* contents)
+{
+    serializer->doInt(&contents->numHeaderValues);
+    serializeResidueSettings(serializer, &contents->headerSettings);
+    int numResidues = contents->residues.size();
+    serializer->doInt(&numResidues);
+    if (serializer->reading())
+    {
+        contents->residues.resize(numResidues);
+        contents->atomNames.resize(numResidues);
+        contents->atomTypeNames.resize(numResidues);
+    }
+    for (int i = 0; i < numResidues; i++)
+    {
+        PreprocessResidue* res = &contents->residues[i];
+        serializer->doString(&res->resname);
+        serializeResidueSettings(serializer, res);
+        int numAtoms = res->natom();
+        serializer->doInt(&numAtoms);
+        if (serializer->reading())
+        {
+            res->atom.resize(numAtoms);
+            res->cgnr.resize(numAtoms);
+            contents->atomNames[i].resize(numAtoms);
+            contents->atomTypeNames[i].resize(numAtoms);
+        }
+        for (int j = 0; j < numAtoms; j++)
+        {
+            serializer->doString(&contents->atomNames[i][j]);
+            serializer->doString(&contents->atomTypeNames[i][j]);
+            serializer->doReal(&res->atom[j].q);
+            serializer->doInt(&res->cgnr[j]);
+        }
+        for (int bt = 0; bt < ebtsNR; bt++)
+        {
+            std::vector<BondedInteraction>& bondeds    = res->rb[bt].b;
+            int                             numBondeds = bondeds.size();
+            serializer->doInt(&numBondeds);
+            if (serializer->reading())
+            {
+                bondeds.resize(numBondeds);
+            }
+            for (auto& bonded : bondeds)
+            {
+                for (int j = 0; j < btsNiatoms[bt]; j++)
+                {
+                    serializer->doString(&bonded.a[j]);
+                }
+                serializer->doString(&bonded.s);
+            }
+        }
+    }
+}
+
+/*! \brief Identifies residue database cache files and their layout.
+ *
+ * Must be changed when the layout changes, since the cache contents
+ * are only checked after the header has been read.
+ */
+static const char* const c_residueDatabaseCacheMagic = "GROMACS residue database cache 2";
+
+//! Returns the MD5 checksum of the contents of \p in as a hexadecimal string.
+static std::string residueDatabaseChecksum(FILE* in)
+{
+    md5_state_t state;
+    gmx_md5_init(&state);
+    std::array<char, 4096> buffer;
+    size_t                 numRead;
+    while ((numRead = fread(buffer.data(), 1, buffer.size(), in)) > 0)
+    {
+        gmx_md5_append(&state, reinterpret_cast<md5_byte_t*>(buffer.data()), numRead);
+    }
+    rewind(in);
+
+    std::string checksum;
+    for (unsigned char byte : gmx_md5_finish(&state))
+    {
+        checksum += gmx::formatString("%02x", byte);
+    }
+    return checksum;
+}
+
+/*! \brief
+ * Read \p contents from cache file \p cacheFileName.
+ *
+ * \returns Whether a valid cache was found for the database file with
+ * checksum \p sourceChecksum, this GROMACS version and precision.
+ */
+static bool readResidueDatabaseCache(const std::string&   cacheFileName,
+                                     const std::string&   sourceChecksum,
+                                     ResidueDatabaseFile* contents)
+{
+    FILE* fp = std::fopen(cacheFileName.c_str(), "rb");
+    if (fp == nullptr)
+    {
+        return false;
+    }
+    std::vector<char>      data;
+    std::array<char, 4096> buffer;
+    size_t                 numRead;
+    while ((numRead = fread(buffer.data(), 1, buffer.size(), fp)) > 0)
+    {
+        data.insert(data.end(), buffer.begin(), buffer.begin() + numRead);
+    }
+    std::fclose(fp);
+
+    /* The file starts with the checksum of the rest of the file,
+     * which guards against truncated or corrupted caches.
+     */
+    std::array<unsigned char, 16> checksum;
+    if (data.size() < checksum.size())
+    {
+        return false;
+    }
+    md5_state_t state;
+    gmx_md5_init(&state);
+    gmx_md5_append(&state, reinterpret_cast<md5_byte_t*>(data.data() + checksum.size()),
+                   data.size() - checksum.size());
+    checksum = gmx_md5_finish(&state);
+    if (!std::equal(checksum.begin(), checksum.end(), data.begin(),
+                    [](unsigned char a, char b) { return a == static_cast<unsigned char>(b); }))
+    {
+        return false;
+    }
+
+    gmx::InMemoryDeserializer serializer(
+            gmx::arrayRefFromArray(data.data() + checksum.size(), data.size() - checksum.size()),
+            sizeof(real) == sizeof(double));
+    std::string magic, source, version;
+    int         realSize;
+    serializer.doString(&magic);
+    serializer.doString(&source);
+    serializer.doString(&version);
+    serializer.doInt(&realSize);
+    if (magic != c_residueDatabaseCacheMagic || source != sourceChecksum
+        || version != gmx_version() || realSize != sizeof(real))
+    {
+        return false;
+    }
+    serializeResidueDatabaseFile(&serializer, contents);
+
+    return true;
+}
+
+/*! \brief
+ * Write \p contents of the database file with checksum \p sourceChecksum
+ * to cache file \p cacheFileName.
+ *
+ * The file is written under a temporary name and then renamed,
+ * so concurrent runs never see a partially written cache.
+ *
+ * \returns Whether the cache could be written.
+ */
+static bool writeResidueDatabaseCache(const std::string&   cacheFileName,
+                                      const std::string&   sourceChecksum,
+                                      ResidueDatabaseFile* contents)
+{
+    gmx::InMemorySerializer serializer;
+    std::string             magic    = c_residueDatabaseCacheMagic;
+    std::string             source   = sourceChecksum;
+    std::string             version  = gmx_version();
+    int                     realSize = sizeof(real);
+    serializer.doString(&magic);
+    serializer.doString(&source);
+    serializer.doString(&version);
+    serializer.doInt(&realSize);
+    serializeResidueDatabaseFile(&serializer, contents);
+    std::vector<char> data = serializer.finishAndGetBuffer();
+
+    md5_state_t state;
+    gmx_md5_init(&state);
+    gmx_md5_append(&state, reinterpret_cast<md5_byte_t*>(data.data()), data.size());
+    std::array<unsigned char, 16> checksum = gmx_md5_finish(&state);
+
+    const std::string tempFileName = gmx::formatString("%s.%d", cacheFileName.c_str(), gmx_getpid());
+    FILE*             fp           = std::fopen(tempFileName.c_str(), "wb");
+    if (fp == nullptr)
+    {
+        return false;
+    }
+    bool success = (fwrite(checksum.data(), 1, checksum.size(), fp) == checksum.size()
+                    && fwrite(data.data(), 1, data.size(), fp) == data.size());
+    success      = (std::fclose(fp) == 0) && success;
+    if (success)
+    {
+        success = (std::rename(tempFileName.c_str(), cacheFileName.c_str()) == 0);
+    }
+    if (!success)
+    {
+        std::remove(tempFileName.c_str());
+    }
+    return success;
+}
+
+/*! \brief Case-insensitive ordering of residue names
+ *
+ * The residue database is kept sorted in this order, so entries can be found
+ * by binary search.
+ */
+static bool residueNameLess(const std::string& a, const std::string& b)
+{
+    return std::lexicographical_compare(
+            a.begin(), a.end(), b.begin(), b.end(),
+            [](const char& c1, const char& c2) { return std::toupper(c1) < std::toupper(c2); });
+}
+
+void readResidueDatabase(const std::string&              rrdb,
+                         std::vector<PreprocessResidue>* rtpDBEntry,
+                         PreprocessingAtomTypes*         atype,
+                         t_symtab*                       tab,
+                         const gmx::MDLogger&            logger,
+                         bool                            bAllowOverrideRTP,
+                         const std::string&              cacheDirectory)
+{
+    char filebase[STRLEN];
+
+    fflib_filename_base(rrdb.c_str(), filebase, STRLEN);
+
+    FILE* in = fflib_open(rrdb);
+
+    /* With a cache directory set, the parsed file is stored in binary form
+     * and reused by later runs, as long as the file contents are unchanged.
+     * The cache file is named after the checksum of the contents.
+     */
+    ResidueDatabaseFile contents;
+    std::string         checksum;
+    std::string         cacheFileName;
+    if (!cacheDirectory.empty())
+    {
+        checksum      = residueDatabaseChecksum(in);
+        cacheFileName = gmx::Path::join(cacheDirectory, checksum + ".rtpcache");
+    }
+    if (cacheFileName.empty() || !readResidueDatabaseCache(cacheFileName, checksum, &contents))
+    {
+        contents = parseResidueDatabase(in, rrdb);
+        if (!cacheFileName.empty() && !writeResidueDatabaseCache(cacheFileName, checksum, &contents))
+        {
+            GMX_LOG(logger.info)
+                    .asParagraph()
+                    .appendTextFormatted("Could not write residue database cache file %s",
+                                         cacheFileName.c_str());
+        }
+    }
+    gmx_ffclose(in);
+
+    const int nparam = contents.numHeaderValues;
+    if (nparam >= 0)
+    {
+        if (nparam < 5)
+        {
+            GMX_LOG(logger.info)
+                    .asParagraph()
+                    .appendTextFormatted("Using default: not generating all possible dihedrals");
+        }
+        if (nparam < 6)
+        {
+            GMX_LOG(logger.info)
+                    .asParagraph()
+                    .appendTextFormatted("Using default: excluding 3 bonded neighbors");
+        }
+        if (nparam < 7)
+        {
+            GMX_LOG(logger.info)
+                    .asParagraph()
+                    .appendTextFormatted("Using default: generating 1,4 H--H interactions");
+        }
+        if (nparam < 8)
+        {
+            GMX_LOG(logger.warning)
+                    .asParagraph()
+                    .appendTextFormatted(
+                            "Using default: removing proper dihedrals found on the same bond as a "
+                            "proper dihedral");
+        }
+    }
+    else
+    {
+        GMX_LOG(logger.warning)
+                .asParagraph()
+                .appendTextFormatted(
+                        "Reading .rtp file without '[ bondedtypes ]' directive, "
+                        "Will proceed as if the entry was:");
+        print_resall_log(logger, gmx::arrayRefFromArray(&contents.headerSettings, 1));
+    }
+
+    const auto oldSize = rtpDBEntry->size();
+    for (size_t i = 0; i < contents.residues.size(); i++)
+    {
+        rtpDBEntry->push_back(std::move(contents.residues[i]));
+        PreprocessResidue* res = &rtpDBEntry->back();
+        res->filebase          = filebase;
+        for (int j = 0; j < res->natom(); j++)
+        {
+            res->atomname.push_back(put_symtab(tab, contents.atomNames[i][j].c_str()));
+            int type = atype->atomTypeFromName(contents.atomTypeNames[i][j]);
+            if (type == NOTSET)
+            {
+                gmx_fatal(FARGS,
+                          "Atom type %s (residue %s) not found in atomtype "
+                          "database",
+                          contents.atomTypeNames[i][j].c_str(), res->resname.c_str());
+            }
+            res->atom[j].type = type;
+            res->atom[j].m    = atype->atomMassFromAtomType(type);
+        }
 
         auto found = std::find_if(rtpDBEntry->begin(), rtpDBEntry->end() - 1,
                                   [&res](const PreprocessResidue& entry) {
@@ -470,7 +791,7 @@ void readResidueDatabase(const std::string&              rrdb,
 
         if (found != rtpDBEntry->end() - 1)
         {
-            if (found >= oldArrayEnd)
+            if (static_cast<size_t>(found - rtpDBEntry->begin()) >= oldSize)
             {
                 gmx_fatal(FARGS, "Found a second entry for '%s' in '%s'", res->resname.c_str(),
                           rrdb.c_str());
@@ -497,12 +818,9 @@ void readResidueDatabase(const std::string&              rrdb,
             }
         }
     }
-    gmx_ffclose(in);
 
     std::sort(rtpDBEntry->begin(), rtpDBEntry->end(), [](const PreprocessResidue& a, const PreprocessResidue& b) {
-        return std::lexicographical_compare(
-                a.resname.begin(), a.resname.end(), b.resname.begin(), b.resname.end(),
-                [](const char& c1, const char& c2) { return std::toupper(c1) < std::toupper(c2); });
+        return residueNameLess(a.resname, b.resname);
     });
 
     check_rtp(*rtpDBEntry, rrdb, logger);
@@ -540,10 +858,32 @@ static int neq_str_sign(const char* a1, const char* a2)
     }
 }
 
+//! Returns the entry named \p rtpname in the sorted residue database, or its end when absent.
+static gmx::ArrayRef<const PreprocessResidue>::const_iterator
+findDatabaseEntry(const std::string& rtpname, gmx::ArrayRef<const PreprocessResidue> rtpDBEntry)
+{
+    auto found = std::lower_bound(rtpDBEntry.begin(), rtpDBEntry.end(), rtpname,
+                                  [](const PreprocessResidue& entry, const std::string& name) {
+                                      return residueNameLess(entry.resname, name);
+                                  });
+    if (found != rtpDBEntry.end() && gmx::equalCaseInsensitive(rtpname, found->resname))
+    {
+        return found;
+    }
+    return rtpDBEntry.end();
+}
+
 std::string searchResidueDatabase(const std::string&                     key,
                                   gmx::ArrayRef<const PreprocessResidue> rtpDBEntry,
                                   const gmx::MDLogger&                   logger)
 {
+    /* An exact match is always preferred, so look that up first */
+    auto exactMatch = findDatabaseEntry(key, rtpDBEntry);
+    if (exactMatch != rtpDBEntry.end())
+    {
+        return exactMatch->resname;
+    }
+
     int         nbest, best, besti;
     std::string bestbuf;
 
@@ -612,10 +952,7 @@ std::string searchResidueDatabase(const std::string&                     key,
 gmx::ArrayRef<const PreprocessResidue>::const_iterator
 getDatabaseEntry(const std::string& rtpname, gmx::ArrayRef<const PreprocessResidue> rtpDBEntry)
 {
-    auto found = std::find_if(rtpDBEntry.begin(), rtpDBEntry.end(),
-                              [&rtpname](const PreprocessResidue& entry) {
-                                  return gmx::equalCaseInsensitive(rtpname, entry.resname);
-                              });
+    auto found = findDatabaseEntry(rtpname, rtpDBEntry);
     if (found == rtpDBEntry.end())
     {
         /* This should never happen, since searchResidueDatabase should have been called
@@ -76,7 +76,7 @@ std::string searchResidueDatabase(const std::string&                     key,
  * Returns matching entry in database.
  *
  * \param[in] rtpname Name of the entry looked for.
- * \param[in] rtpDBEntry Database to search.
+ * \param[in] rtpDBEntry Database to search, sorted as by readResidueDatabase().
  * \throws If the name can not be found in the database.
  */
 gmx::ArrayRef<const PreprocessResidue>::const_iterator
@@ -100,13 +100,16 @@ PreprocessingAtomTypes read_atype(const char* ffdir, t_symtab* tab);
  * \param[inout] tab Symbol table for names.
  * \param[in] logger MDLogger interface.
  * \param[in] bAllowOverrideRTP If entries can be overwritten in the database.
+ * \param[in] cacheDirectory Directory where the parsed database is cached
+ *                           between runs, no caching when empty.
  */
 void readResidueDatabase(const std::string&              resdb,
                          std::vector<PreprocessResidue>* rtpDBEntry,
                          PreprocessingAtomTypes*         atype,
                          t_symtab*                       tab,
                          const gmx::MDLogger&            logger,
-                         bool                            bAllowOverrideRTP);
+                         bool                            bAllowOverrideRTP,
+                         const std::string&              cacheDirectory);
 
 /*! \brief
  * Print out database.
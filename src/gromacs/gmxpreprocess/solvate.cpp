@@ -42,6 +42,7 @@
 #include <cstring>
 
 #include <algorithm>
+#include <map>
 #include <random>
 #include <vector>
 
@@ -66,6 +67,7 @@
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
 #include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/listoflists.h"
 #include "gromacs/utility/smalloc.h"
 
 using gmx::RVec;
@@ -366,6 +368,23 @@ static void replicateSolventBox(t_atoms*           atoms,
     fprintf(stderr, "Solvent box contains %d atoms in %d residues\n", atoms->nr, atoms->nres);
 }
 
+//! Relative margin on the overlap search cutoffs, so that no pairs are missed due to rounding.
+static const real c_overlapSearchMargin = 1e-4;
+
+/*! \brief
+ * Returns the squared distance between two positions with PBC.
+ *
+ * The neighborhood search can round distances differently depending on
+ * whether it uses SIMD (e.g., with FMA), so the overlap checks recompute
+ * the distances of the candidate pairs with this function instead.
+ */
+static real pbcDistance2(const t_pbc& pbc, const rvec x1, const rvec x2)
+{
+    rvec dx;
+    pbc_dx(&pbc, x1, x2, dx);
+    return norm2(dx);
+}
+
 /*! \brief
  * Removes overlap of solvent atoms across the edges.
  *
@@ -398,26 +417,30 @@ static void removeSolventBoxOverlap(t_atoms*           atoms,
     // opposite edges.
     const real                maxRadius = *std::max_element(r->begin(), r->end());
     gmx::AnalysisNeighborhood nb;
-    nb.setCutoff(2 * maxRadius);
-    gmx::AnalysisNeighborhoodPositions  pos(*x);
-    gmx::AnalysisNeighborhoodSearch     search     = nb.initSearch(&pbc, pos);
-    gmx::AnalysisNeighborhoodPairSearch pairSearch = search.startPairSearch(pos);
-    gmx::AnalysisNeighborhoodPair       pair;
-    while (pairSearch.findNextPair(&pair))
+    nb.setCutoff(2 * maxRadius * (1 + c_overlapSearchMargin));
+    gmx::AnalysisNeighborhoodPositions pos(*x);
+    gmx::AnalysisNeighborhoodSearch    search = nb.initSearch(&pbc, pos);
+
+    // The marking below is greedy, so it depends on the order of the pairs.
+    // findAllPairs() finds the pairs in parallel, but returns them in the
+    // same order as a serial pair search, so the result does not depend on
+    // the number of threads.
+    gmx::ListOfLists<int> pairRefIndices;
+    search.findAllPairs(pos, &pairRefIndices);
+    for (int i2 = 0; i2 < pairRefIndices.ssize(); ++i2)
     {
-        const int i1 = pair.refIndex();
-        const int i2 = pair.testIndex();
-        if (remover.isMarked(i2))
-        {
-            pairSearch.skipRemainingPairsForTestPosition();
-            continue;
-        }
-        if (remover.isMarked(i1) || atoms->atom[i1].resind == atoms->atom[i2].resind)
-        {
-            continue;
-        }
-        if (pair.distance2() < gmx::square((*r)[i1] + (*r)[i2]))
+        gmx::ArrayRef<const int> refIndices = pairRefIndices[i2];
+        for (gmx::index p = 0; p < refIndices.ssize() && !remover.isMarked(i2); ++p)
         {
+            const int i1 = refIndices[p];
+            if (remover.isMarked(i1) || atoms->atom[i1].resind == atoms->atom[i2].resind)
+            {
+                continue;
+            }
+            if (pbcDistance2(pbc, (*x)[i1], (*x)[i2]) >= gmx::square((*r)[i1] + (*r)[i2]))
+            {
+                continue;
+            }
             rvec dx;
             rvec_sub((*x)[i2], (*x)[i1], dx);
             bool bCandidate1 = false, bCandidate2 = false;
@@ -443,7 +466,6 @@ static void removeSolventBoxOverlap(t_atoms*           atoms,
             if (bCandidate2 && (!bCandidate1 || i2 > i1))
             {
                 remover.markResidue(*atoms, i2, true);
-                pairSearch.skipRemainingPairsForTestPosition();
             }
             else if (bCandidate1)
             {
@@ -486,19 +508,21 @@ static void removeSolventOutsideShell(t_atoms*                 atoms,
     gmx::AtomsRemover         remover(*atoms);
     gmx::AnalysisNeighborhood nb;
     nb.setCutoff(rshell);
-    gmx::AnalysisNeighborhoodPositions  posSolute(x_solute);
-    gmx::AnalysisNeighborhoodSearch     search = nb.initSearch(&pbc, posSolute);
-    gmx::AnalysisNeighborhoodPositions  pos(*x_solvent);
-    gmx::AnalysisNeighborhoodPairSearch pairSearch = search.startPairSearch(pos);
-    gmx::AnalysisNeighborhoodPair       pair;
+    gmx::AnalysisNeighborhoodPositions posSolute(x_solute);
+    gmx::AnalysisNeighborhoodSearch    search = nb.initSearch(&pbc, posSolute);
+    gmx::AnalysisNeighborhoodPositions pos(*x_solvent);
+    gmx::ListOfLists<int>              pairRefIndices;
+    search.findAllPairs(pos, &pairRefIndices);
 
     // Remove everything
     remover.markAll();
     // Now put back those within the shell without checking for overlap
-    while (pairSearch.findNextPair(&pair))
+    for (int i = 0; i < pairRefIndices.ssize(); ++i)
     {
-        remover.markResidue(*atoms, pair.testIndex(), false);
-        pairSearch.skipRemainingPairsForTestPosition();
+        if (!pairRefIndices[i].empty())
+        {
+            remover.markResidue(*atoms, i, false);
+        }
     }
     remover.removeMarkedElements(x_solvent);
     if (!v_solvent->empty())
@@ -536,24 +560,29 @@ static void removeSolventOverlappingWithSolute(t_atoms*                 atoms,
     const real        maxRadius2 = *std::max_element(r_solute.begin(), r_solute.end());
 
     // Now check for overlap.
-    gmx::AnalysisNeighborhood     nb;
-    gmx::AnalysisNeighborhoodPair pair;
-    nb.setCutoff(maxRadius1 + maxRadius2);
-    gmx::AnalysisNeighborhoodPositions  posSolute(x_solute);
-    gmx::AnalysisNeighborhoodSearch     search = nb.initSearch(&pbc, posSolute);
-    gmx::AnalysisNeighborhoodPositions  pos(*x);
-    gmx::AnalysisNeighborhoodPairSearch pairSearch = search.startPairSearch(pos);
-    while (pairSearch.findNextPair(&pair))
+    gmx::AnalysisNeighborhood nb;
+    nb.setCutoff((maxRadius1 + maxRadius2) * (1 + c_overlapSearchMargin));
+    gmx::AnalysisNeighborhoodPositions posSolute(x_solute);
+    gmx::AnalysisNeighborhoodSearch    search = nb.initSearch(&pbc, posSolute);
+    gmx::AnalysisNeighborhoodPositions pos(*x);
+    gmx::ListOfLists<int>              pairRefIndices;
+    search.findAllPairs(pos, &pairRefIndices);
+    // A solvent residue is removed if any of its atoms overlaps with any
+    // solute atom, which does not depend on the order of the pairs.
+    for (int i = 0; i < pairRefIndices.ssize(); ++i)
     {
-        if (remover.isMarked(pair.testIndex()))
+        if (remover.isMarked(i))
         {
-            pairSearch.skipRemainingPairsForTestPosition();
             continue;
         }
-        const real r1      = r_solute[pair.refIndex()];
-        const real r2      = (*r)[pair.testIndex()];
-        const bool bRemove = (pair.distance2() < gmx::square(r1 + r2));
-        remover.markResidue(*atoms, pair.testIndex(), bRemove);
+        for (const int j : pairRefIndices[i])
+        {
+            if (pbcDistance2(pbc, x_solute[j], (*x)[i]) < gmx::square(r_solute[j] + (*r)[i]))
+            {
+                remover.markResidue(*atoms, i, true);
+                break;
+            }
+        }
     }
 
     remover.removeMarkedElements(x);
@@ -741,11 +770,24 @@ static void update_top(t_atoms*        atoms,
 
     int nsol = atoms->nres - firstSolventResidueIndex;
 
+    /* The solvent consists of many copies of a few residues, so look up
+     * the mass of each residue and atom name combination only once */
+    std::map<std::pair<std::string, std::string>, real> massOfResidueAtom;
     mtot = 0;
     for (i = 0; (i < atoms->nr); i++)
     {
-        aps->setAtomProperty(epropMass, std::string(*atoms->resinfo[atoms->atom[i].resind].name),
-                             std::string(*atoms->atomname[i]), &mm);
+        const auto nameKey = std::make_pair(std::string(*atoms->resinfo[atoms->atom[i].resind].name),
+                                            std::string(*atoms->atomname[i]));
+        const auto massIt  = massOfResidueAtom.find(nameKey);
+        if (massIt != massOfResidueAtom.end())
+        {
+            mm = massIt->second;
+        }
+        else
+        {
+            aps->setAtomProperty(epropMass, nameKey.first, nameKey.second, &mm);
+            massOfResidueAtom[nameKey] = mm;
+        }
         mtot += mm;
     }
 
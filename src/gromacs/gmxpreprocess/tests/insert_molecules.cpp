@@ -43,8 +43,18 @@
 
 #include "gromacs/gmxpreprocess/insert_molecules.h"
 
+#include <string>
+#include <vector>
+
+#include "gromacs/gmxpreprocess/grompp.h"
+#include "gromacs/utility/gmxomp.h"
+#include "gromacs/utility/stringutil.h"
+#include "gromacs/utility/textreader.h"
+#include "gromacs/utility/textwriter.h"
+
 #include "testutils/cmdlinetest.h"
 #include "testutils/refdata.h"
+#include "testutils/testfilemanager.h"
 #include "testutils/textblockmatchers.h"
 
 namespace
@@ -52,6 +62,7 @@ namespace
 
 using gmx::test::CommandLine;
 using gmx::test::ExactTextMatch;
+using gmx::test::TestFileManager;
 
 class InsertMoleculesTest : public gmx::test::CommandLineTestBase
 {
@@ -116,4 +127,54 @@ TEST_F(InsertMoleculesTest, InsertsMoleculesIntoFixedPositions)
     runTest(CommandLine(cmdline));
 }
 
+TEST_F(InsertMoleculesTest, InsertsMoleculesIntoTriclinicBoxWithPbcXY)
+{
+    // The periodic boundary conditions can only be read from a run input file
+    const std::string mdpInputFileName(fileManager().getTemporaryFilePath("input.mdp"));
+    gmx::TextWriter::writeFileFromString(
+            mdpInputFileName,
+            "pbc = xy\nnwall = 2\nwall-type = 12-6\nwall-atomtype = opls_116 opls_116\n"
+            "verlet-buffer-tolerance = -1\nrcoulomb = 0.5\nrvdw = 0.5\nrlist = 0.5\n");
+    const std::string tprFileName(fileManager().getTemporaryFilePath("spc5-triclinic.tpr"));
+    {
+        CommandLine caller;
+        caller.append("grompp");
+        caller.addOption("-f", mdpInputFileName);
+        caller.addOption("-c", TestFileManager::getInputFilePath("spc5-triclinic.gro"));
+        caller.addOption("-p", TestFileManager::getInputFilePath("spc5.top"));
+        caller.addOption("-o", tprFileName);
+        ASSERT_EQ(0, gmx_grompp(caller.argc(), caller.argv()));
+    }
+
+    const char* const cmdline[] = { "insert-molecules", "-nmol", "3", "-seed", "1997" };
+    commandLine().addOption("-f", tprFileName);
+    setInputFile("-ci", "x.gro");
+    runTest(CommandLine(cmdline));
+}
+
+TEST_F(InsertMoleculesTest, OutputIsIndependentOfThreadCount)
+{
+    const char* const cmdline[] = { "insert-molecules", "-nmol", "20", "-seed", "1997" };
+
+    const int                maxThreads = gmx_omp_get_max_threads();
+    std::vector<std::string> outputs;
+    for (const int numThreads : { 1, 4 })
+    {
+        SCOPED_TRACE(gmx::formatString("With %d OpenMP threads", numThreads));
+        const std::string outputFileName(
+                fileManager().getTemporaryFilePath(gmx::formatString("out%d.gro", numThreads)));
+        CommandLine caller(cmdline);
+        caller.addOption("-f", TestFileManager::getInputFilePath("spc216.gro"));
+        caller.addOption("-ci", TestFileManager::getInputFilePath("x.gro"));
+        caller.addOption("-o", outputFileName);
+        gmx_omp_set_num_threads(numThreads);
+        ASSERT_EQ(0, gmx::test::CommandLineTestHelper::runModuleFactory(
+                             &gmx::InsertMoleculesInfo::create, &caller));
+        outputs.push_back(gmx::TextReader::readFileToString(outputFileName));
+    }
+    gmx_omp_set_num_threads(maxThreads);
+
+    EXPECT_EQ(outputs[0], outputs[1]);
+}
+
 } // namespace
@@ -0,0 +1,261 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the binary cache of residue databases.
+ */
+#include "gmxpre.h"
+
+#include "gromacs/gmxpreprocess/resall.h"
+
+#include <cstdio>
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/gmxpreprocess/gpp_atomtype.h"
+#include "gromacs/gmxpreprocess/grompp_impl.h"
+#include "gromacs/gmxpreprocess/hackblock.h"
+#include "gromacs/topology/atoms.h"
+#include "gromacs/topology/symtab.h"
+#include "gromacs/utility/directoryenumerator.h"
+#include "gromacs/utility/futil.h"
+#include "gromacs/utility/logger.h"
+#include "gromacs/utility/path.h"
+#include "gromacs/utility/textreader.h"
+#include "gromacs/utility/textwriter.h"
+
+#include "testutils/testfilemanager.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! Residue database with two residues, using all sections that are cached.
+const char* const c_residueDatabase =
+        "[ bondedtypes ]\n"
+        "; bonds angles dihedrals impropers all_dihedrals nrexcl HH14 RemoveDih\n"
+        "     1      1         3         1             1      3    1         0\n"
+        "\n"
+        "[ RA ]\n"
+        " [ atoms ]\n"
+        "     N    N   -0.30  0\n"
+        "     H    H    0.30  0\n"
+        "    CA   CT    0.10  1\n"
+        "    HA   HC   -0.10  1\n"
+        " [ bonds ]\n"
+        "     N     H\n"
+        "     N    CA\n"
+        "    CA    HA    gb_3\n"
+        " [ angles ]\n"
+        "     H     N    CA\n"
+        " [ impropers ]\n"
+        "     N     H    CA    HA\n"
+        "\n"
+        "[ RB ]\n"
+        " [ atoms ]\n"
+        "    C1   CT    0.00  0\n"
+        "    H1   HC    0.00  0\n"
+        " [ bonds ]\n"
+        "    C1    H1\n";
+
+//! Another residue database, with other contents.
+const char* const c_otherResidueDatabase =
+        "[ RC ]\n"
+        " [ atoms ]\n"
+        "    C1   CT    0.20  0\n"
+        "    H1   HC   -0.20  0\n"
+        " [ bonds ]\n"
+        "    C1    H1\n";
+
+//! Returns the contents of binary file \p filename.
+std::string readBinaryFile(const std::string& filename)
+{
+    std::ifstream stream(filename, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+}
+
+//! Writes \p contents to binary file \p filename.
+void writeBinaryFile(const std::string& filename, const std::string& contents)
+{
+    std::ofstream stream(filename, std::ios::binary);
+    stream << contents;
+}
+
+//! Test fixture for reading residue databases with a cache directory.
+class ResidueDatabaseCacheTest : public ::testing::Test
+{
+public:
+    ResidueDatabaseCacheTest() :
+        cacheDir_(fileManager_.getTemporaryFilePath("cache")),
+        bUseCache_(false)
+    {
+        open_symtab(&symtab_);
+        t_atom atom = {};
+        for (const char* name : { "N", "H", "CT", "HC" })
+        {
+            atom.m = 1;
+            atypes_.addType(&symtab_, atom, name, InteractionOfType({}, {}), 0, 0);
+        }
+        Directory::create(cacheDir_);
+    }
+
+    ~ResidueDatabaseCacheTest() override
+    {
+        for (const auto& file : cacheFiles())
+        {
+            std::remove(file.c_str());
+        }
+        std::remove(cacheDir_.c_str());
+        done_symtab(&symtab_);
+    }
+
+    //! Writes a residue database file with \p contents and returns its name.
+    std::string writeDatabase(const char* suffix, const char* contents)
+    {
+        std::string filename = fileManager_.getTemporaryFilePath(suffix);
+        TextWriter::writeFileFromString(filename, contents);
+        return filename;
+    }
+
+    //! Enables the cache for the following reads.
+    void enableCache() { bUseCache_ = true; }
+
+    //! Reads database \p filename, and returns it as written by print_resall().
+    std::string readDatabase(const std::string& filename)
+    {
+        std::vector<PreprocessResidue> database;
+        readResidueDatabase(filename, &database, &atypes_, &symtab_, logger_, false,
+                            bUseCache_ ? cacheDir_ : std::string());
+        const std::string printedFilename = fileManager_.getTemporaryFilePath("printed.rtp");
+        FILE*             fp              = gmx_ffopen(printedFilename, "w");
+        print_resall(fp, database, atypes_);
+        gmx_ffclose(fp);
+        return TextReader::readFileToString(printedFilename);
+    }
+
+    //! Returns the paths of all cache files.
+    std::vector<std::string> cacheFiles() const
+    {
+        std::vector<std::string> files = DirectoryEnumerator::enumerateFilesWithExtension(
+                cacheDir_.c_str(), ".rtpcache", false);
+        for (auto& file : files)
+        {
+            file = Path::join(cacheDir_, file);
+        }
+        return files;
+    }
+
+protected:
+    TestFileManager        fileManager_;
+    std::string            cacheDir_;
+    bool                   bUseCache_;
+    PreprocessingAtomTypes atypes_;
+    t_symtab               symtab_;
+    MDLogger               logger_;
+};
+
+TEST_F(ResidueDatabaseCacheTest, CachedDatabaseMatchesParsedDatabase)
+{
+    const std::string filename  = writeDatabase("db.rtp", c_residueDatabase);
+    const std::string reference = readDatabase(filename);
+
+    enableCache();
+    EXPECT_EQ(reference, readDatabase(filename));
+    const std::vector<std::string> files = cacheFiles();
+    ASSERT_EQ(1, files.size());
+    const std::string cache = readBinaryFile(files[0]);
+
+    // This read uses the cache, which should not be modified
+    EXPECT_EQ(reference, readDatabase(filename));
+    EXPECT_EQ(cache, readBinaryFile(files[0]));
+}
+
+TEST_F(ResidueDatabaseCacheTest, IgnoresAndRewritesCorruptCache)
+{
+    const std::string filename  = writeDatabase("db.rtp", c_residueDatabase);
+    const std::string reference = readDatabase(filename);
+
+    enableCache();
+    readDatabase(filename);
+    const std::vector<std::string> files = cacheFiles();
+    ASSERT_EQ(1, files.size());
+    const std::string cache = readBinaryFile(files[0]);
+
+    writeBinaryFile(files[0], cache.substr(0, cache.size() / 2));
+    EXPECT_EQ(reference, readDatabase(filename));
+    EXPECT_EQ(cache, readBinaryFile(files[0]));
+
+    std::string corruptCache = cache;
+    corruptCache[corruptCache.size() / 2] ^= 1;
+    writeBinaryFile(files[0], corruptCache);
+    EXPECT_EQ(reference, readDatabase(filename));
+    EXPECT_EQ(cache, readBinaryFile(files[0]));
+}
+
+TEST_F(ResidueDatabaseCacheTest, IgnoresAndRewritesCacheOfOtherDatabase)
+{
+    const std::string filename      = writeDatabase("db.rtp", c_residueDatabase);
+    const std::string otherFilename = writeDatabase("other.rtp", c_otherResidueDatabase);
+    const std::string reference     = readDatabase(filename);
+
+    enableCache();
+    readDatabase(filename);
+    const std::string cacheFilename = cacheFiles()[0];
+    const std::string cache         = readBinaryFile(cacheFilename);
+    readDatabase(otherFilename);
+    ASSERT_EQ(2, cacheFiles().size());
+
+    // A valid cache under the name of the cache for another database
+    std::string otherCacheFilename = cacheFiles()[0];
+    if (otherCacheFilename == cacheFilename)
+    {
+        otherCacheFilename = cacheFiles()[1];
+    }
+    writeBinaryFile(cacheFilename, readBinaryFile(otherCacheFilename));
+    EXPECT_EQ(reference, readDatabase(filename));
+    EXPECT_EQ(cache, readBinaryFile(cacheFilename));
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -60,6 +60,7 @@
 #include "gromacs/gmxpreprocess/gpp_bond_atomtype.h"
 #include "gromacs/gmxpreprocess/gpp_nextnb.h"
 #include "gromacs/gmxpreprocess/grompp_impl.h"
+#include "gromacs/gmxpreprocess/moltypeparallel.h"
 #include "gromacs/gmxpreprocess/readir.h"
 #include "gromacs/gmxpreprocess/topdirs.h"
 #include "gromacs/gmxpreprocess/toppush.h"
@@ -365,6 +366,67 @@ static void make_atoms_sys(gmx::ArrayRef<const gmx_molblock_t>      molblock,
 }
 
 
+//! An entry in the [ molecules ] section.
+struct MoleculesEntry
+{
+    //! The molecule type index.
+    int moleculeType;
+    //! Whether this is the first entry for this molecule type, which needs processing.
+    bool processMoleculeType;
+};
+
+//! Logs the number of excluded neighbours for a [ molecules ] entry of \p mol.
+static void logExclusions(const MoleculeInformation& mol, const gmx::MDLogger& logger)
+{
+    GMX_LOG(logger.info)
+            .asParagraph()
+            .appendTextFormatted("Excluding %d bonded neighbours molecule type '%s'", mol.nrexcl,
+                                 *mol.name);
+}
+
+/*! \brief
+ * Generates the exclusions and constraints for the molecule types of \p entries
+ *
+ * The molecule types are processed in parallel, the log output is written
+ * in the order of \p entries, which are cleared.
+ */
+static void processMoleculeTypes(std::vector<MoleculesEntry>*                          entries,
+                                 gmx::ArrayRef<MoleculeInformation>                    molinfo,
+                                 gmx::ArrayRef<std::vector<gmx::ExclusionBlock>>       exclusionBlocks,
+                                 int                                                   nshake,
+                                 const gmx::MDLogger&                                  logger)
+{
+    std::vector<int> moleculeTypes;
+    for (const MoleculesEntry& entry : *entries)
+    {
+        if (entry.processMoleculeType)
+        {
+            moleculeTypes.push_back(entry.moleculeType);
+        }
+    }
+
+    auto loggers = forEachMoleculeTypeInParallel(
+            moleculeTypes.size(), logger, [&](int index, const gmx::MDLogger& moltypeLogger) {
+                const int            whichmol = moleculeTypes[index];
+                MoleculeInformation* mol      = &molinfo[whichmol];
+                generate_excl(mol->nrexcl, mol->atoms.nr, mol->interactions, &(mol->excls));
+                gmx::mergeExclusions(&(mol->excls), exclusionBlocks[whichmol]);
+                make_shake(mol->interactions, &mol->atoms, nshake, moltypeLogger);
+                stupid_fill_block(&mol->mols, mol->atoms.nr, TRUE);
+            });
+
+    auto moltypeLogger = loggers.begin();
+    for (const MoleculesEntry& entry : *entries)
+    {
+        logExclusions(molinfo[entry.moleculeType], logger);
+        if (entry.processMoleculeType)
+        {
+            (*moltypeLogger++)->flush();
+        }
+    }
+    entries->clear();
+}
+
 static char** read_topol(const char*                           infile,
                          const char*                           outfile,
                          const char*                           define,
@@ -438,6 +500,7 @@ static char** read_topol(const char*                           infile,
     nbparam = nullptr;              /* The temporary non-bonded matrix */
     pair    = nullptr;              /* The temporary pair interaction matrix */
     std::vector<std::vector<gmx::ExclusionBlock>> exclusionBlocks;
+    std::vector<MoleculesEntry>                   moleculesEntries;
     nb_funct = F_LJ;
 
     *reppow = 12.0; /* Default value for repulsion power     */
@@ -824,26 +887,31 @@ static char** read_topol(const char*                           infile,
                             {
                                 gmx_fatal(FARGS, "Molecule type '%s' contains no atoms", *mi0->name);
                             }
-                            GMX_LOG(logger.info)
-                                    .asParagraph()
-                                    .appendTextFormatted(
-                                            "Excluding %d bonded neighbours molecule type '%s'",
-                                            mi0->nrexcl, *mi0->name);
                             sum_q(&mi0->atoms, nrcopies, &qt, &qBt);
-                            if (!mi0->bProcessed)
+                            if (!bCouple)
                             {
-                                generate_excl(mi0->nrexcl, mi0->atoms.nr, mi0->interactions, &(mi0->excls));
-                                gmx::mergeExclusions(&(mi0->excls), exclusionBlocks[whichmol]);
-                                make_shake(mi0->interactions, &mi0->atoms, opts->nshake, logger);
-
-                                if (bCouple)
+                                /* Defer processing, so we can process molecule types in parallel */
+                                moleculesEntries.push_back({ whichmol, !mi0->bProcessed });
+                                mi0->bProcessed = TRUE;
+                            }
+                            else
+                            {
+                                processMoleculeTypes(&moleculesEntries, *molinfo, exclusionBlocks,
+                                                     opts->nshake, logger);
+                                logExclusions(*mi0, logger);
+                                if (!mi0->bProcessed)
                                 {
+                                    generate_excl(mi0->nrexcl, mi0->atoms.nr, mi0->interactions,
+                                                  &(mi0->excls));
+                                    gmx::mergeExclusions(&(mi0->excls), exclusionBlocks[whichmol]);
+                                    make_shake(mi0->interactions, &mi0->atoms, opts->nshake, logger);
+
                                     convert_moltype_couple(mi0, dcatt, *fudgeQQ, opts->couple_lam0,
                                                            opts->couple_lam1, opts->bCoupleIntra,
                                                            nb_funct, &(interactions[nb_funct]), wi);
+                                    stupid_fill_block(&mi0->mols, mi0->atoms.nr, TRUE);
+                                    mi0->bProcessed = TRUE;
                                 }
-                                stupid_fill_block(&mi0->mols, mi0->atoms.nr, TRUE);
-                                mi0->bProcessed = TRUE;
                             }
                             break;
                         }
@@ -860,6 +928,8 @@ static char** read_topol(const char*                           infile,
         }
     } while (!done);
 
+    processMoleculeTypes(&moleculesEntries, *molinfo, exclusionBlocks, opts->nshake, logger);
+
     // Check that all strings defined with -D were used when processing topology
     std::string unusedDefineWarning = checkAndWarnForUnusedDefines(*handle);
     if (!unusedDefineWarning.empty())
@@ -45,6 +45,8 @@
 #include <cstring>
 
 #include <algorithm>
+#include <array>
+#include <limits>
 #include <string>
 
 #include "gromacs/fileio/warninp.h"
@@ -1672,84 +1674,44 @@ static bool default_cmap_params(gmx::ArrayRef<InteractionsOfType> bondtype,
     return bFound;
 }
 
-/* Returns the number of exact atom type matches, i.e. non wild-card matches,
- * returns -1 when there are no matches at all.
+/*! \brief Returns the lookup key for the bond atom types in \p bondAtomTypes
+ *
+ * Unused entries are padded with a value that is never a bond atom type,
+ * so tuples of different length never compare equal.
  */
-static int natom_match(const InteractionOfType&      pi,
-                       int                           type_i,
-                       int                           type_j,
-                       int                           type_k,
-                       int                           type_l,
-                       const PreprocessingAtomTypes* atypes)
+static InteractionTypeKey interactionTypeKey(gmx::ArrayRef<const int> bondAtomTypes)
 {
-    if ((pi.ai() == -1 || atypes->bondAtomTypeFromAtomType(type_i) == pi.ai())
-        && (pi.aj() == -1 || atypes->bondAtomTypeFromAtomType(type_j) == pi.aj())
-        && (pi.ak() == -1 || atypes->bondAtomTypeFromAtomType(type_k) == pi.ak())
-        && (pi.al() == -1 || atypes->bondAtomTypeFromAtomType(type_l) == pi.al()))
-    {
-        return (pi.ai() == -1 ? 0 : 1) + (pi.aj() == -1 ? 0 : 1) + (pi.ak() == -1 ? 0 : 1)
-               + (pi.al() == -1 ? 0 : 1);
-    }
-    else
-    {
-        return -1;
-    }
+    InteractionTypeKey key;
+    key.fill(std::numeric_limits<int>::min());
+    std::copy(bondAtomTypes.begin(), bondAtomTypes.end(), key.begin());
+    return key;
 }
 
-static int findNumberOfDihedralAtomMatches(const InteractionOfType& currentParamFromParameterArray,
-                                           const InteractionOfType& parameterToAdd,
-                                           const t_atoms*           at,
-                                           const PreprocessingAtomTypes* atypes,
-                                           bool                          bB)
+/*! \brief Adds the interaction types that are not indexed yet to the index of \p bt
+ *
+ * Force-field interaction types are only ever appended, so the existing
+ * entries stay valid. Only the first entry for each atom type tuple is
+ * stored, which is the one a linear search from the start would find.
+ */
+static void updateInteractionTypeIndex(InteractionsOfType* bt)
 {
-    if (bB)
+    if (bt->numIndexedInteractionTypes > bt->size())
     {
-        return natom_match(currentParamFromParameterArray, at->atom[parameterToAdd.ai()].typeB,
-                           at->atom[parameterToAdd.aj()].typeB, at->atom[parameterToAdd.ak()].typeB,
-                           at->atom[parameterToAdd.al()].typeB, atypes);
+        bt->interactionTypeIndex.clear();
+        bt->numIndexedInteractionTypes = 0;
     }
-    else
+    for (size_t i = bt->numIndexedInteractionTypes; i < bt->size(); i++)
     {
-        return natom_match(currentParamFromParameterArray, at->atom[parameterToAdd.ai()].type,
-                           at->atom[parameterToAdd.aj()].type, at->atom[parameterToAdd.ak()].type,
-                           at->atom[parameterToAdd.al()].type, atypes);
+        bt->interactionTypeIndex.emplace(interactionTypeKey(bt->interactionTypes[i].atoms()), i);
     }
+    bt->numIndexedInteractionTypes = bt->size();
 }
 
-static bool findIfAllParameterAtomsMatch(gmx::ArrayRef<const int>      atomsFromParameterArray,
-                                         gmx::ArrayRef<const int>      atomsFromCurrentParameter,
-                                         const t_atoms*                at,
-                                         const PreprocessingAtomTypes* atypes,
-                                         bool                          bB)
+//! Returns the index of the first interaction type with exactly atom types \p key, or -1.
+static int findInteractionType(const InteractionsOfType& bt, const InteractionTypeKey& key)
 {
-    if (atomsFromParameterArray.size() != atomsFromCurrentParameter.size())
-    {
-        return false;
-    }
-    else if (bB)
-    {
-        for (gmx::index i = 0; i < atomsFromCurrentParameter.ssize(); i++)
-        {
-            if (atypes->bondAtomTypeFromAtomType(at->atom[atomsFromCurrentParameter[i]].typeB)
-                != atomsFromParameterArray[i])
-            {
-                return false;
-            }
-        }
-        return true;
-    }
-    else
-    {
-        for (gmx::index i = 0; i < atomsFromCurrentParameter.ssize(); i++)
-        {
-            if (atypes->bondAtomTypeFromAtomType(at->atom[atomsFromCurrentParameter[i]].type)
-                != atomsFromParameterArray[i])
-            {
-                return false;
-            }
-        }
-        return true;
-    }
+    auto found = bt.interactionTypeIndex.find(key);
+    return found != bt.interactionTypeIndex.end() ? found->second : -1;
 }
 
 static std::vector<InteractionOfType>::iterator defaultInteractionsOfType(int ftype,
@@ -1770,29 +1732,44 @@ static std::vector<InteractionOfType>::iterator defaultInteractionsOfType(int ft
     }
 
 
+    updateInteractionTypeIndex(&bt[ftype]);
+
     nparam_found = 0;
     if (ftype == F_PDIHS || ftype == F_RBDIHS || ftype == F_IDIHS || ftype == F_PIDIHS)
     {
-        int nmatch_max = -1;
-
         /* For dihedrals we allow wildcards. We choose the first type
          * that has the most real matches, i.e. non-wildcard matches.
+         * Look up all 16 combinations of wildcards for the atom types.
          */
-        auto prevPos = bt[ftype].interactionTypes.end();
-        auto pos     = bt[ftype].interactionTypes.begin();
-        while (pos != bt[ftype].interactionTypes.end() && nmatch_max < 4)
-        {
-            pos = std::find_if(bt[ftype].interactionTypes.begin(), bt[ftype].interactionTypes.end(),
-                               [&p, &at, &atypes, &bB, &nmatch_max](const auto& param) {
-                                   return (findNumberOfDihedralAtomMatches(param, p, at, atypes, bB)
-                                           > nmatch_max);
-                               });
-            if (pos != bt[ftype].interactionTypes.end())
+        std::array<int, 4> types;
+        for (int i = 0; i < 4; i++)
+        {
+            const t_atom& atom = at->atom[p.atoms()[i]];
+            types[i]           = atypes->bondAtomTypeFromAtomType(bB ? atom.typeB : atom.type);
+        }
+        int bestIndex  = -1;
+        int nmatch_max = -1;
+        for (int wildcards = 0; wildcards < 16; wildcards++)
+        {
+            std::array<int, 4> pattern = types;
+            int                nmatch  = 4;
+            for (int i = 0; i < 4; i++)
             {
-                prevPos    = pos;
-                nmatch_max = findNumberOfDihedralAtomMatches(*pos, p, at, atypes, bB);
+                if (wildcards & (1 << i))
+                {
+                    pattern[i] = -1;
+                    nmatch--;
+                }
+            }
+            const int index = findInteractionType(bt[ftype], interactionTypeKey(pattern));
+            if (index >= 0 && (nmatch > nmatch_max || (nmatch == nmatch_max && index < bestIndex)))
+            {
+                bestIndex  = index;
+                nmatch_max = nmatch;
             }
         }
+        auto prevPos = (bestIndex >= 0 ? bt[ftype].interactionTypes.begin() + bestIndex
+                                       : bt[ftype].interactionTypes.end());
 
         if (prevPos != bt[ftype].interactionTypes.end())
         {
@@ -1828,12 +1805,15 @@ static std::vector<InteractionOfType>::iterator defaultInteractionsOfType(int ft
     }
     else /* Not a dihedral */
     {
-        gmx::ArrayRef<const int> atomParam = p.atoms();
-        auto                     found     = std::find_if(
-                bt[ftype].interactionTypes.begin(), bt[ftype].interactionTypes.end(),
-                [&atomParam, &at, &atypes, &bB](const auto& param) {
-                    return findIfAllParameterAtomsMatch(param.atoms(), atomParam, at, atypes, bB);
-                });
+        std::vector<int> types;
+        for (int atomIndex : p.atoms())
+        {
+            const t_atom& atom = at->atom[atomIndex];
+            types.push_back(atypes->bondAtomTypeFromAtomType(bB ? atom.typeB : atom.type));
+        }
+        const int index = findInteractionType(bt[ftype], interactionTypeKey(types));
+        auto      found = (index >= 0 ? bt[ftype].interactionTypes.begin() + index
+                                 : bt[ftype].interactionTypes.end());
         if (found != bt[ftype].interactionTypes.end())
         {
             nparam_found = 1;
@@ -51,7 +51,6 @@
 #include "gromacs/gmxpreprocess/topdirs.h"
 #include "gromacs/topology/block.h"
 #include "gromacs/topology/ifunc.h"
-#include "gromacs/topology/symtab.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/gmxassert.h"
 #include "gromacs/utility/smalloc.h"
@@ -67,7 +66,6 @@ void add_param_to_list(InteractionsOfType* list, const InteractionOfType& b)
 
 static void print_bt(FILE*                                   out,
                      Directive                               d,
-                     PreprocessingAtomTypes*                 at,
                      int                                     ftype,
                      int                                     fsubtype,
                      gmx::ArrayRef<const InteractionsOfType> plist,
@@ -162,14 +160,14 @@ static void print_bt(FILE*                                   out,
         {
             for (int j = 0; (j < nral); j++)
             {
-                fprintf(out, "%5s ", at->atomNameFromAtomType(atoms[j]));
+                fprintf(out, "%5d ", atoms[j] + 1);
             }
         }
         else
         {
             for (int j = 0; (j < 2); j++)
             {
-                fprintf(out, "%5s ", at->atomNameFromAtomType(atoms[dihp[f][j]]));
+                fprintf(out, "%5d ", atoms[dihp[f][j]] + 1);
             }
         }
         fprintf(out, "%5d ", bSwapParity ? -f - 1 : f + 1);
@@ -326,22 +324,11 @@ void print_atoms(FILE* out, PreprocessingAtomTypes* atype, t_atoms* at, int* cgn
     fflush(out);
 }
 
-void print_bondeds(FILE* out, int natoms, Directive d, int ftype, int fsubtype, gmx::ArrayRef<const InteractionsOfType> plist)
+void print_bondeds(FILE*                                   out,
+                   Directive                               d,
+                   int                                     ftype,
+                   int                                     fsubtype,
+                   gmx::ArrayRef<const InteractionsOfType> plist)
 {
-    t_symtab stab;
-    t_atom*  a;
-
-    PreprocessingAtomTypes atype;
-    snew(a, 1);
-    open_symtab(&stab);
-    for (int i = 0; (i < natoms); i++)
-    {
-        char buf[12];
-        sprintf(buf, "%4d", (i + 1));
-        atype.addType(&stab, *a, buf, InteractionOfType({}, {}), 0, 0);
-    }
-    print_bt(out, d, &atype, ftype, fsubtype, plist, TRUE);
-
-    done_symtab(&stab);
-    sfree(a);
+    print_bt(out, d, ftype, fsubtype, plist, TRUE);
 }
@@ -64,7 +64,6 @@ void add_param_to_list(InteractionsOfType* list, const InteractionOfType& b);
 void print_atoms(FILE* out, PreprocessingAtomTypes* atype, t_atoms* at, int* cgnr, bool bRTPresname);
 
 void print_bondeds(FILE*                                   out,
-                   int                                     natoms,
                    Directive                               d,
                    int                                     ftype,
                    int                                     fsubtype,
@@ -39,8 +39,12 @@
 
 #include "eigensolver.h"
 
+#include <algorithm>
+#include <functional>
+
 #include "gromacs/linearalgebra/sparsematrix.h"
 #include "gromacs/utility/fatalerror.h"
+#include "gromacs/utility/gmxassert.h"
 #include "gromacs/utility/real.h"
 #include "gromacs/utility/smalloc.h"
 
@@ -250,7 +254,16 @@ void sparse_parallel_eigensolver(gmx_sparsematrix_t* A, int neig, real* eigenval
 #endif
 
 
-void sparse_eigensolver(gmx_sparsematrix_t* A, int neig, real* eigenvalues, real* eigenvectors, int maxiter)
+/*! \brief Computes the neig smallest eigenvalues of a symmetric operator with ARPACK.
+ *
+ * \p multiply is called with (x, y) to compute y = A x.
+ */
+static void arpack_eigensolver(int                                          n,
+                               int                                          neig,
+                               const std::function<void(real* x, real* y)>& multiply,
+                               real*                                        eigenvalues,
+                               real*                                        eigenvectors,
+                               int                                          maxiter)
 {
     int   iwork[80];
     int   iparam[11];
@@ -259,21 +272,11 @@ void sparse_eigensolver(gmx_sparsematrix_t* A, int neig, real* eigenvalues, real
     real* workd;
     real* workl;
     real* v;
-    int   n;
     int   ido, info, lworkl, i, ncv, dovec;
     real  abstol;
     int*  select;
     int   iter;
 
-#ifdef GMX_MPI_NOT
-    MPI_Comm_size(MPI_COMM_WORLD, &n);
-    if (n > 1)
-    {
-        sparse_parallel_eigensolver(A, neig, eigenvalues, eigenvectors, maxiter);
-        return;
-    }
-#endif
-
     if (eigenvectors != nullptr)
     {
         dovec = 1;
@@ -283,7 +286,6 @@ void sparse_eigensolver(gmx_sparsematrix_t* A, int neig, real* eigenvalues, real
         dovec = 0;
     }
 
-    n   = A->nrow;
     ncv = 2 * neig;
 
     if (ncv > n)
@@ -327,7 +329,7 @@ void sparse_eigensolver(gmx_sparsematrix_t* A, int neig, real* eigenvalues, real
 #endif
         if (ido == -1 || ido == 1)
         {
-            gmx_sparsematrix_vector_multiply(A, workd + ipntr[0] - 1, workd + ipntr[1] - 1);
+            multiply(workd + ipntr[0] - 1, workd + ipntr[1] - 1);
         }
 
         fprintf(stderr, "\rIteration %4d: %3d out of %3d Ritz values converged.", iter++, iparam[4], neig);
@@ -367,3 +369,55 @@ void sparse_eigensolver(gmx_sparsematrix_t* A, int neig, real* eigenvalues, real
     sfree(workl);
     sfree(select);
 }
+
+
+void sparse_eigensolver(gmx_sparsematrix_t* A, int neig, real* eigenvalues, real* eigenvectors, int maxiter)
+{
+#ifdef GMX_MPI_NOT
+    int nnodes;
+    MPI_Comm_size(MPI_COMM_WORLD, &nnodes);
+    if (nnodes > 1)
+    {
+        sparse_parallel_eigensolver(A, neig, eigenvalues, eigenvectors, maxiter);
+        return;
+    }
+#endif
+
+    arpack_eigensolver(A->nrow, neig,
+                       [A](real* x, real* y) { gmx_sparsematrix_vector_multiply(A, x, y); },
+                       eigenvalues, eigenvectors, maxiter);
+}
+
+
+void largest_eigenvalues_eigensolver(int                                          n,
+                                     int                                          neig,
+                                     const std::function<void(real* x, real* y)>& multiply,
+                                     real*                                        eigenvalues,
+                                     real*                                        eigenvectors,
+                                     int                                          maxiter)
+{
+    GMX_RELEASE_ASSERT(neig >= 1 && 2 * neig < n,
+                       "Lanczos needs more than 2*neig dimensions, use eigensolver() instead");
+
+    /* We compute the smallest eigenvalues of -A, since selecting the largest
+     * ("LA") eigenvalues in ARPACK does not reliably give all of them.
+     * This also gives the eigenvalues of A in descending order.
+     */
+    auto multiplyNegated = [&multiply, n](real* x, real* y) {
+        multiply(x, y);
+        for (int i = 0; i < n; i++)
+        {
+            y[i] = -y[i];
+        }
+    };
+    arpack_eigensolver(n, neig, multiplyNegated, eigenvalues, eigenvectors, maxiter);
+    for (int i = 0; i < neig; i++)
+    {
+        eigenvalues[i] = -eigenvalues[i];
+    }
+    if (eigenvectors == nullptr)
+    {
+        /* Without eigenvectors ARPACK does not sort the eigenvalues */
+        std::sort(eigenvalues, eigenvalues + neig, std::greater<real>());
+    }
+}
@@ -37,6 +37,8 @@
 #ifndef GMX_LINEARALGEBRA_EIGENSOLVER_H
 #define GMX_LINEARALGEBRA_EIGENSOLVER_H
 
+#include <functional>
+
 #include "gromacs/linearalgebra/sparsematrix.h"
 #include "gromacs/utility/real.h"
 
@@ -75,4 +77,26 @@ void eigensolver(real* a, int n, int index_lower, int index_upper, real* eigenva
  */
 void sparse_eigensolver(gmx_sparsematrix_t* A, int neig, real* eigenvalues, real* eigenvectors, int maxiter);
 
+/*! \brief Eigensolver for the largest eigenvalues of a symmetric operator.
+ *
+ *  This routine uses Lanczos iterations (ARPACK) and only accesses the
+ *  matrix through products with vectors, which are computed by calling
+ *  \p multiply(x, y) to set y = A x, with x and y of length n.
+ *  This is much cheaper than a full diagonalization when only a small
+ *  number of eigenvectors is needed, and the matrix does not need to be
+ *  stored explicitly.
+ *
+ *  It will determine the neig largest eigenvalues, and if the eigenvectors
+ *  pointer is non-NULL also the corresponding eigenvectors. Both are
+ *  returned in descending order of eigenvalue, eigenvector j starts at
+ *  offset j*n. 2*neig must be smaller than n, use eigensolver() when
+ *  more eigenvalues are needed.
+ */
+void largest_eigenvalues_eigensolver(int                                          n,
+                                     int                                          neig,
+                                     const std::function<void(real* x, real* y)>& multiply,
+                                     real*                                        eigenvalues,
+                                     real*                                        eigenvectors,
+                                     int                                          maxiter);
+
 #endif
@@ -0,0 +1,164 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the Lanczos eigensolver.
+ */
+#include "gmxpre.h"
+
+#include "gromacs/linearalgebra/eigensolver.h"
+
+#include <cmath>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/math/units.h"
+#include "gromacs/utility/real.h"
+
+#include "testutils/testasserts.h"
+
+namespace gmx
+{
+
+namespace test
+{
+
+namespace
+{
+
+//! Returns the n x n tridiagonal matrix with 2 on the diagonal and -1 next to it
+std::vector<real> tridiagonalMatrix(int n)
+{
+    std::vector<real> matrix(n * n, 0);
+    for (int i = 0; i < n; i++)
+    {
+        matrix[i * n + i] = 2;
+        if (i + 1 < n)
+        {
+            matrix[i * n + i + 1]   = -1;
+            matrix[(i + 1) * n + i] = -1;
+        }
+    }
+    return matrix;
+}
+
+//! Sets y = matrix x for the full, symmetric, n x n \p matrix
+void multiply(const std::vector<real>& matrix, int n, const real* x, real* y)
+{
+    for (int i = 0; i < n; i++)
+    {
+        real sum = 0;
+        for (int j = 0; j < n; j++)
+        {
+            sum += matrix[i * n + j] * x[j];
+        }
+        y[i] = sum;
+    }
+}
+
+TEST(LargestEigenvaluesEigensolverTest, ComputesEigenpairsOfTridiagonalMatrix)
+{
+    const int         n      = 40;
+    const int         neig   = 5;
+    std::vector<real> matrix = tridiagonalMatrix(n);
+
+    std::vector<real> eigenvalues(neig);
+    std::vector<real> eigenvectors(neig * n);
+    largest_eigenvalues_eigensolver(
+            n, neig, [&matrix](real* x, real* y) { multiply(matrix, n, x, y); },
+            eigenvalues.data(), eigenvectors.data(), 100000);
+
+    // Eigenvalue k is 2 - 2 cos(k pi/(n + 1)) with eigenvector sin(i k pi/(n + 1))
+    const FloatingPointTolerance tolerance = relativeToleranceAsFloatingPoint(1, 1e-4);
+    for (int e = 0; e < neig; e++)
+    {
+        const int    k        = n - e;
+        const double angle    = k * M_PI / (n + 1);
+        const double expected = 2 - 2 * std::cos(angle);
+        EXPECT_REAL_EQ_TOL(expected, eigenvalues[e], tolerance);
+
+        double dot   = 0;
+        double norm2 = 0;
+        for (int i = 0; i < n; i++)
+        {
+            const double component = std::sin((i + 1) * angle);
+            dot += component * eigenvectors[e * n + i];
+            norm2 += component * component;
+        }
+        EXPECT_REAL_EQ_TOL(1.0, std::abs(dot) / std::sqrt(norm2), tolerance)
+                << "eigenvector " << e << " differs";
+    }
+}
+
+TEST(LargestEigenvaluesEigensolverTest, MatchesFullDiagonalization)
+{
+    const int n    = 30;
+    const int neig = 4;
+    // A symmetric matrix with non-trivial, distinct eigenvalues
+    std::vector<real> matrix(n * n);
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = 0; j <= i; j++)
+        {
+            const real value  = std::sin(real(1 + i * n + j)) + ((i == j) ? real(0.1) * i : 0);
+            matrix[i * n + j] = value;
+            matrix[j * n + i] = value;
+        }
+    }
+
+    std::vector<real> eigenvalues(neig);
+    largest_eigenvalues_eigensolver(
+            n, neig, [&matrix](real* x, real* y) { multiply(matrix, n, x, y); },
+            eigenvalues.data(), nullptr, 100000);
+
+    // eigensolver() destroys its input and returns eigenvalues in ascending order
+    std::vector<real> matrixCopy = matrix;
+    std::vector<real> allEigenvalues(n);
+    eigensolver(matrixCopy.data(), n, 0, n, allEigenvalues.data(), nullptr);
+
+    const FloatingPointTolerance tolerance = relativeToleranceAsFloatingPoint(10, 1e-4);
+    for (int e = 0; e < neig; e++)
+    {
+        EXPECT_REAL_EQ_TOL(allEigenvalues[n - 1 - e], eigenvalues[e], tolerance);
+    }
+}
+
+} // namespace
+
+} // namespace test
+
+} // namespace gmx
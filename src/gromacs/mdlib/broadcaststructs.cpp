@@ -40,8 +40,15 @@
 
 #include "broadcaststructs.h"
 
+#include "config.h"
+
+#include <cstring>
+
 #include "gromacs/fileio/tpxio.h"
 #include "gromacs/mdtypes/state.h"
+#include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/physicalnodecommunicator.h"
 
 template<typename AllocatorType>
 static void bcastPaddedRVecVector(MPI_Comm                                     communicator,
@@ -110,6 +117,91 @@ static void bc_tpxheader(MPI_Comm communicator, TpxFileHeader* tpx)
     block_bc(communicator, tpx->isDouble);
 }
 
+#if GMX_THREAD_MPI
+/*! \brief Deserializes the TPR body directly from the buffer of the master rank
+ *
+ * All thread-MPI ranks share one address space, so instead of copying
+ * the serialized body to every rank, only its address is broadcast.
+ */
+static void deserializeTprBodyOfMasterRank(MPI_Comm                    communicator,
+                                           bool                        isMasterRank,
+                                           t_inputrec*                 inputrec,
+                                           gmx_mtop_t*                 mtop,
+                                           PartialDeserializedTprFile* partialDeserializedTpr)
+{
+    const char* body     = partialDeserializedTpr->body.data();
+    int         numBytes = partialDeserializedTpr->body.size();
+    block_bc(communicator, body);
+    block_bc(communicator, numBytes);
+    if (!isMasterRank)
+    {
+        completeTprDeserialization(&partialDeserializedTpr->header,
+                                   gmx::arrayRefFromArray(body, numBytes), inputrec, mtop);
+    }
+    // The master rank should keep its buffer until all ranks are done reading
+    gmx_barrier(communicator);
+}
+#elif GMX_LIB_MPI && MPI_VERSION >= 3
+/*! \brief Deserializes the TPR body from a buffer shared by all ranks on a node
+ *
+ * The body is broadcast only between one rank per shared-memory node,
+ * into an MPI-3 shared window. The other ranks on the node deserialize
+ * directly from that window, so there is one copy of the body per node.
+ */
+static void deserializeTprBodyFromNodeSharedMemory(MPI_Comm                    communicator,
+                                                   bool                        isMasterRank,
+                                                   t_inputrec*                 inputrec,
+                                                   gmx_mtop_t*                 mtop,
+                                                   PartialDeserializedTprFile* partialDeserializedTpr)
+{
+    int numBytes = partialDeserializedTpr->body.size();
+    block_bc(communicator, numBytes);
+
+    // Ranks are ordered as in communicator, so the master rank is
+    // the first rank on its node and the first node leader
+    int rank;
+    MPI_Comm_rank(communicator, &rank);
+    MPI_Comm nodeComm;
+    MPI_Comm_split_type(communicator, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &nodeComm);
+    gmx::MPI_Comm_ptr nodeCommGuard(&nodeComm);
+    int               rankWithinNode;
+    MPI_Comm_rank(nodeComm, &rankWithinNode);
+    const bool isNodeLeader = (rankWithinNode == 0);
+    GMX_RELEASE_ASSERT(!isMasterRank || isNodeLeader,
+                       "The master rank should be the first rank on its node");
+
+    MPI_Comm leaderComm;
+    MPI_Comm_split(communicator, isNodeLeader ? 0 : MPI_UNDEFINED, rank, &leaderComm);
+    gmx::MPI_Comm_ptr leaderCommGuard(isNodeLeader ? &leaderComm : nullptr);
+
+    char*   body = nullptr;
+    MPI_Win window;
+    MPI_Win_allocate_shared(isNodeLeader ? numBytes : 0, 1, MPI_INFO_NULL, nodeComm, &body, &window);
+    if (isNodeLeader)
+    {
+        if (isMasterRank)
+        {
+            std::memcpy(body, partialDeserializedTpr->body.data(), numBytes);
+        }
+        nblock_bc(leaderComm, numBytes, body);
+    }
+    else
+    {
+        MPI_Aint bodySize;
+        int      displacementUnit;
+        MPI_Win_shared_query(window, 0, &bodySize, &displacementUnit, &body);
+    }
+    // Makes the body written by the node leader visible to the other ranks
+    MPI_Win_fence(0, window);
+
+    if (!isMasterRank)
+    {
+        completeTprDeserialization(&partialDeserializedTpr->header,
+                                   gmx::arrayRefFromArray<const char>(body, numBytes), inputrec, mtop);
+    }
+    MPI_Win_free(&window);
+}
+#else
 static void bc_tprCharBuffer(MPI_Comm communicator, bool isMasterRank, std::vector<char>* charBuffer)
 {
     int elements = charBuffer->size();
@@ -117,6 +209,7 @@ static void bc_tprCharBuffer(MPI_Comm communicator, bool isMasterRank, std::vect
 
     nblock_abc(isMasterRank, communicator, elements, charBuffer);
 }
+#endif
 
 void init_parallel(MPI_Comm                    communicator,
                    bool                        isMasterRank,
@@ -125,9 +218,16 @@ void init_parallel(MPI_Comm                    communicator,
                    PartialDeserializedTprFile* partialDeserializedTpr)
 {
     bc_tpxheader(communicator, &partialDeserializedTpr->header);
+#if GMX_THREAD_MPI
+    deserializeTprBodyOfMasterRank(communicator, isMasterRank, inputrec, mtop, partialDeserializedTpr);
+#elif GMX_LIB_MPI && MPI_VERSION >= 3
+    deserializeTprBodyFromNodeSharedMemory(communicator, isMasterRank, inputrec, mtop,
+                                           partialDeserializedTpr);
+#else
     bc_tprCharBuffer(communicator, isMasterRank, &partialDeserializedTpr->body);
     if (!isMasterRank)
     {
         completeTprDeserialization(partialDeserializedTpr, inputrec, mtop);
     }
+#endif
 }
@@ -116,7 +116,12 @@ void broadcastStateWithoutDynamics(MPI_Comm communicator,
                                    bool     isParallelRun,
                                    t_state* state);
 
-//! \brief Broadcast inputrec and mtop and allocate node-specific settings
+/*! \brief Broadcast inputrec and mtop and allocate node-specific settings
+ *
+ * The serialized TPR body is distributed with one copy per node: thread-MPI
+ * ranks read the buffer of the master rank, and with MPI-3 the body is
+ * broadcast only between nodes, into memory shared by the ranks of a node.
+ */
 void init_parallel(MPI_Comm                    communicator,
                    bool                        isMasterRank,
                    t_inputrec*                 inputrec,
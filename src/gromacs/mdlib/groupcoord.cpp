@@ -46,8 +46,6 @@
 #include "gromacs/pbcutil/pbc.h"
 #include "gromacs/utility/smalloc.h"
 
-#define MIN(a, b) (((a) < (b)) ? (a) : (b))
-
 
 /* Select the indices of the group's atoms which are local and store them in
  * anrs_loc[0..nr_loc]. The indices are saved in coll_ind[] for later reduction
@@ -63,37 +61,22 @@ void dd_make_local_group_indices(const gmx_ga2la_t* ga2la,
 {
     GMX_ASSERT(ga2la, "We need a valid ga2la object");
 
-    /* Loop over all the atom indices of the group to check
-     * which ones are on the local node */
-    int localnr = 0;
-    for (int i = 0; i < nr; i++)
+    /* We never need more memory than the number of atoms in the group */
+    if (*nalloc_loc < nr)
     {
-        if (const int* ii = ga2la->findHome(anrs[i]))
-        {
-            /* The atom with this index is a home atom */
-            if (localnr >= *nalloc_loc) /* Check whether memory suffices */
-            {
-                *nalloc_loc = over_alloc_dd(localnr + 1);
-                /* We never need more memory than the number of atoms in the group */
-                *nalloc_loc = MIN(*nalloc_loc, nr);
-                srenew(*anrs_loc, *nalloc_loc);
-            }
-            /* Save the atoms index in the local atom numbers array */
-            (*anrs_loc)[localnr] = *ii;
-
-            if (coll_ind != nullptr)
-            {
-                /* Keep track of where this local atom belongs in the collective index array.
-                 * This is needed when reducing the local arrays to a collective/global array
-                 * in communicate_group_positions */
-                coll_ind[localnr] = i;
-            }
-
-            /* add one to the local atom count */
-            localnr++;
-        }
+        *nalloc_loc = nr;
+        srenew(*anrs_loc, *nalloc_loc);
     }
 
+    /* Look up which atoms of the group are home atoms, in one batch.
+     * When requested, keep track of where each local atom belongs in the
+     * collective index array. This is needed when reducing the local arrays
+     * to a collective/global array in communicate_group_positions.
+     */
+    const int localnr = ga2la->findHomeBatch(
+            gmx::constArrayRefFromArray(anrs, nr), gmx::arrayRefFromArray(*anrs_loc, nr),
+            coll_ind != nullptr ? gmx::arrayRefFromArray(coll_ind, nr) : gmx::ArrayRef<int>());
+
     /* Return the number of local atoms that were found */
     *nr_loc = localnr;
 }
@@ -111,17 +111,9 @@ typedef struct
  * molblock from the global atom nr. */
 static int get_mol_id(int at, gmx_mtop_t* mtop, int* type, int* block)
 {
-    int mol_id = 0;
-    int i;
-    int atnr_mol;
-
-    *block = 0;
-    mtopGetMolblockIndex(mtop, at, block, &mol_id, &atnr_mol);
-    for (i = 0; i < *block; i++)
-    {
-        mol_id += mtop->molblock[i].nmol;
-    }
-    *type = mtop->molblock[*block].type;
+    *block     = 0;
+    int mol_id = mtopGetMoleculeIndex(mtop, at, block);
+    *type      = mtop->molblock[*block].type;
 
     return mol_id;
 }
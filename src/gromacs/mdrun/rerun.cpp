@@ -313,9 +313,11 @@ void gmx::LegacySimulator::do_rerun()
         dd_init_local_state(cr->dd, state_global, state);
 
         /* Distribute the charge groups over the nodes from the master node */
+        wallcycle_start(wcycle, ewcDDINITIALPARTITION);
         dd_partition_system(fplog, mdlog, ir->init_step, cr, TRUE, 1, state_global, *top_global, ir,
                             imdSession, pull_work, state, &f, mdAtoms, &top, fr, vsite, constr,
                             nrnb, nullptr, FALSE);
+        wallcycle_stop(wcycle, ewcDDINITIALPARTITION);
         shouldCheckNumberOfBondedInteractions = true;
     }
     else
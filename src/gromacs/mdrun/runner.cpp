@@ -140,6 +140,7 @@
 #include "gromacs/taskassignment/resourcedivision.h"
 #include "gromacs/taskassignment/taskassignment.h"
 #include "gromacs/taskassignment/usergpuids.h"
+#include "gromacs/timing/cyclecounter.h"
 #include "gromacs/timing/gpu_timing.h"
 #include "gromacs/timing/wallcycle.h"
 #include "gromacs/timing/wallcyclereporting.h"
@@ -1111,6 +1112,10 @@ int Mdrunner::mdrunner()
                           useGpuForNonbonded || (emulateGpuNonbonded == EmulateGpuNonbonded::Yes),
                           *hwinfo->cpuInfo);
 
+    // The cycle counting can only be set up once the domain decomposition
+    // has split the communicator, so the setup is timed here and added later.
+    double ddSetupCycles = 0;
+
     const bool prefer1DAnd1PulseDD = (devFlags.enableGpuHaloExchange && useGpuForNonbonded);
     // This builder is necessary while we have multi-part construction
     // of DD. Before DD is constructed, we use the existence of
@@ -1119,9 +1124,11 @@ int Mdrunner::mdrunner()
     std::unique_ptr<DomainDecompositionBuilder> ddBuilder;
     if (useDomainDecomposition)
     {
+        const gmx_cycles_t ddSetupStart = gmx_cycles_read();
         ddBuilder = std::make_unique<DomainDecompositionBuilder>(
                 mdlog, cr, domdecOptions, mdrunOptions, prefer1DAnd1PulseDD, mtop, *inputrec, box,
                 positionsFromStatePointer(globalState.get()));
+        ddSetupCycles += static_cast<double>(gmx_cycles_read()) - static_cast<double>(ddSetupStart);
     }
     else
     {
@@ -1173,7 +1180,9 @@ int Mdrunner::mdrunner()
     {
         // TODO Pass the GPU streams to ddBuilder to use in buffer
         // transfers (e.g. halo exchange)
-        cr->dd = ddBuilder->build(&atomSets);
+        const gmx_cycles_t ddSetupStart = gmx_cycles_read();
+        cr->dd                          = ddBuilder->build(&atomSets);
+        ddSetupCycles += static_cast<double>(gmx_cycles_read()) - static_cast<double>(ddSetupStart);
         // The builder's job is done, so destruct it
         ddBuilder.reset(nullptr);
         // Note that local state still does not exist yet.
@@ -1335,6 +1344,11 @@ int Mdrunner::mdrunner()
         wcycle_set_reset_counters(wcycle, reset_counters);
     }
 
+    if (useDomainDecomposition)
+    {
+        wallcycle_add_cycles(wcycle, ewcDDSETUP, ddSetupCycles);
+    }
+
     // Membrane embedding must be initialized before we call init_forcerec()
     if (doMembed)
     {
@@ -1602,8 +1616,10 @@ int Mdrunner::mdrunner()
             /* This call is not included in init_domain_decomposition mainly
              * because fr->cginfo_mb is set later.
              */
+            wallcycle_start(wcycle, ewcDDSETUPBONDEDS);
             dd_init_bondeds(fplog, cr->dd, mtop, vsite.get(), inputrec,
                             domdecOptions.checkBondedInteractions, fr->cginfo_mb);
+            wallcycle_stop(wcycle, ewcDDSETUPBONDEDS);
         }
 
         // TODO This is not the right place to manage the lifetime of
@@ -49,6 +49,7 @@
 #include "gromacs/mdtypes/inputrec.h"
 #include "gromacs/mdtypes/state.h"
 #include "gromacs/pbcutil/pbc.h"
+#include "gromacs/timing/wallcycle.h"
 
 #include "statepropagatordata.h"
 #include "topologyholder.h"
@@ -109,11 +110,13 @@ void DomDecHelper::setup()
     gmx_wallcycle* wcycle        = nullptr;
 
     // Distribute the charge groups over the nodes from the master node
+    wallcycle_start(wcycle_, ewcDDINITIALPARTITION);
     dd_partition_system(fplog_, mdlog_, inputrec_->init_step, cr_, isMasterState, nstglobalcomm,
                         globalState, topologyHolder_->globalTopology(), inputrec_, imdSession_,
                         pull_work_, localState.get(), forcePointer, mdAtoms_,
                         topologyHolder_->localTopology_.get(), fr_, vsite_, constr_, nrnb_, wcycle,
                         verbose);
+    wallcycle_stop(wcycle_, ewcDDINITIALPARTITION);
     topologyHolder_->updateLocalTopology();
     (*checkBondedInteractionsCallback_)();
     statePropagatorData_->setLocalState(std::move(localState));
@@ -989,6 +989,7 @@ void Grid::sortColumnsCpuGeometry(GridSetData*                   gridSetData,
                                   int                            dd_zone,
                                   const int*                     atinfo,
                                   gmx::ArrayRef<const gmx::RVec> x,
+                                  gmx::ArrayRef<const gmx::RVec> sortX,
                                   nbnxn_atomdata_t*              nbat,
                                   const gmx::Range<int>          columnRange,
                                   gmx::ArrayRef<int>             sort_work)
@@ -1012,8 +1013,9 @@ void Grid::sortColumnsCpuGeometry(GridSetData*                   gridSetData,
 
         /* Sort the atoms within each x,y column on z coordinate */
         sort_atoms(ZZ, FALSE, dd_zone, relevantAtomsAreWithinGridBounds,
-                   gridSetData->atomIndices.data() + atomOffset, numAtoms, x, dimensions_.lowerCorner[ZZ],
-                   1.0 / dimensions_.gridSize[ZZ], numCellsZ * numAtomsPerCell, sort_work);
+                   gridSetData->atomIndices.data() + atomOffset, numAtoms, sortX,
+                   dimensions_.lowerCorner[ZZ], 1.0 / dimensions_.gridSize[ZZ],
+                   numCellsZ * numAtomsPerCell, sort_work);
 
         /* Fill the ncz cells in this column */
         const int firstCell  = firstCellInColumn(cxy);
@@ -1039,6 +1041,24 @@ void Grid::sortColumnsCpuGeometry(GridSetData*                   gridSetData,
             bbcz_[cell].upper = bb_[cellFilled].upper.z;
         }
 
+        if (sortX.data() != x.data())
+        {
+            /* The atoms are not sorted on their own z-coordinate, so the
+             * z-bounds of consecutive cells can overlap and are not
+             * monotonically increasing. The pair search relies on the
+             * monotonicity, so we store the running envelopes, which are
+             * monotonic and (slightly) conservative.
+             */
+            for (int cell = firstCell + 1; cell < firstCell + numCellsZ; cell++)
+            {
+                bbcz_[cell].upper = std::max(bbcz_[cell].upper, bbcz_[cell - 1].upper);
+            }
+            for (int cell = firstCell + numCellsZ - 2; cell >= firstCell; cell--)
+            {
+                bbcz_[cell].lower = std::min(bbcz_[cell].lower, bbcz_[cell + 1].lower);
+            }
+        }
+
         /* Set the unused atom indices to -1 */
         for (int ind = numAtoms; ind < numCellsZ * numAtomsPerCell; ind++)
         {
@@ -1291,9 +1311,13 @@ void Grid::setCellIndices(int                            ddZone,
                           const gmx::Range<int>          atomRange,
                           const int*                     atinfo,
                           gmx::ArrayRef<const gmx::RVec> x,
+                          gmx::ArrayRef<const gmx::RVec> updateGroupCogs,
                           const int                      numAtomsMoved,
                           nbnxn_atomdata_t*              nbat)
 {
+    GMX_ASSERT(updateGroupCogs.empty() || geometry_.isSimple,
+               "Sorting on update group COGs is only supported with the CPU geometry");
+
     cellOffset_ = cellOffset;
 
     srcAtomBegin_ = *atomRange.begin();
@@ -1402,8 +1426,9 @@ void Grid::setCellIndices(int                            ddZone,
                                         ((thread + 1) * numColumns()) / nthread);
             if (geometry_.isSimple)
             {
-                sortColumnsCpuGeometry(gridSetData, ddZone, atinfo, x, nbat, columnRange,
-                                       gridWork[thread].sortBuffer);
+                sortColumnsCpuGeometry(gridSetData, ddZone, atinfo, x,
+                                       updateGroupCogs.empty() ? x : updateGroupCogs, nbat,
+                                       columnRange, gridWork[thread].sortBuffer);
             }
             else
             {
@@ -345,7 +345,14 @@ public:
                        bool               haveFep,
                        gmx::PinningPolicy pinningPolicy);
 
-    //! Sets the cell indices using indices in \p gridSetData and \p gridWork
+    /*! \brief Sets the cell indices using indices in \p gridSetData and \p gridWork
+     *
+     * When \p updateGroupCogs is not empty, the atoms are sorted along z
+     * on the center of geometry of their update group instead of on their
+     * own coordinate, so the atoms of an update group end up contiguous
+     * in the grid order and thus in the local state. This is only
+     * supported for the CPU cluster geometry.
+     */
     void setCellIndices(int                            ddZone,
                         int                            cellOffset,
                         GridSetData*                   gridSetData,
@@ -353,6 +360,7 @@ public:
                         gmx::Range<int>                atomRange,
                         const int*                     atinfo,
                         gmx::ArrayRef<const gmx::RVec> x,
+                        gmx::ArrayRef<const gmx::RVec> updateGroupCogs,
                         int                            numAtomsMoved,
                         nbnxn_atomdata_t*              nbat);
 
@@ -381,11 +389,16 @@ private:
                   gmx::ArrayRef<const gmx::RVec> x,
                   BoundingBox gmx_unused* bb_work_aligned);
 
-    //! Spatially sort the atoms within the given column range, for CPU geometry
+    /*! \brief Spatially sort the atoms within the given column range, for CPU geometry
+     *
+     * The atoms are sorted on the z-coordinates in \p sortX, the bounding
+     * boxes are computed from \p x.
+     */
     void sortColumnsCpuGeometry(GridSetData*                   gridSetData,
                                 int                            dd_zone,
                                 const int*                     atinfo,
                                 gmx::ArrayRef<const gmx::RVec> x,
+                                gmx::ArrayRef<const gmx::RVec> sortX,
                                 nbnxn_atomdata_t*              nbat,
                                 gmx::Range<int>                columnRange,
                                 gmx::ArrayRef<int>             sort_work);
@@ -46,6 +46,8 @@
 
 #include "gridset.h"
 
+#include <cstdlib>
+
 #include "gromacs/mdlib/gmx_omp_nthreads.h"
 #include "gromacs/mdlib/updategroupscog.h"
 #include "gromacs/nbnxm/atomdata.h"
@@ -105,7 +107,8 @@ GridSet::GridSet(const PbcType             pbcType,
     haveFep_(haveFep),
     numRealAtomsLocal_(0),
     numRealAtomsTotal_(0),
-    gridWork_(numThreads)
+    gridWork_(numThreads),
+    sortOnUpdateGroupCogs_(getenv("GMX_NBNXN_SORT_UPDATE_GROUPS") != nullptr)
 {
     clear_mat(box_);
     changePinningPolicy(&gridSetData_.cells, pinningPolicy);
@@ -207,6 +210,17 @@ void GridSet::putOnGrid(const matrix                   box,
     const int nthread = gmx_omp_nthreads_get(emntPairsearch);
     GMX_ASSERT(nthread > 0, "We expect the OpenMP thread count to be set");
 
+    /* With update groups we can sort the home atoms on the update group
+     * COGs, which keeps the atoms of each update group contiguous in
+     * the local atom order for update, constraints and the local topology.
+     */
+    const bool sortOnCogs =
+            (sortOnUpdateGroupCogs_ && updateGroupsCog != nullptr && grid.geometry().isSimple);
+    if (sortOnCogs)
+    {
+        updateGroupCogs_.resize(*atomRange.end());
+    }
+
 #pragma omp parallel for num_threads(nthread) schedule(static)
     for (int thread = 0; thread < nthread; thread++)
     {
@@ -214,12 +228,27 @@ void GridSet::putOnGrid(const matrix                   box,
         {
             Grid::calcColumnIndices(grid.dimensions(), updateGroupsCog, atomRange, x, ddZone, move, thread,
                                     nthread, gridSetData_.cells, gridWork_[thread].numAtomsPerColumn);
+
+            if (sortOnCogs)
+            {
+                const int atomStart = *atomRange.begin() + (thread * atomRange.size()) / nthread;
+                const int atomEnd = *atomRange.begin() + ((thread + 1) * atomRange.size()) / nthread;
+                for (int a = atomStart; a < atomEnd; a++)
+                {
+                    /* Moved atoms are not sorted, their COGs might be invalid */
+                    updateGroupCogs_[a] = (move == nullptr || move[a] >= 0)
+                                                  ? updateGroupsCog->cogForAtom(a)
+                                                  : x[a];
+                }
+            }
         }
         GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
     }
 
     /* Copy the already computed cell indices to the grid and sort, when needed */
     grid.setCellIndices(ddZone, cellOffset, &gridSetData_, gridWork_, atomRange, atomInfo.data(), x,
+                        sortOnCogs ? gmx::makeConstArrayRef(updateGroupCogs_)
+                                   : gmx::ArrayRef<const gmx::RVec>(),
                         numAtomsMoved, nbat);
 
     if (gridIndex == 0)
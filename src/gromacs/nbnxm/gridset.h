@@ -195,6 +195,10 @@ private:
     int numRealAtomsTotal_;
     //! Working data for constructing a single grid, one entry per thread
     std::vector<GridWork> gridWork_;
+    //! Whether to keep update groups contiguous by sorting the local atoms on update group COGs
+    bool sortOnUpdateGroupCogs_;
+    //! Per local atom the COG of its update group, used as sorting key when sortOnUpdateGroupCogs_
+    std::vector<gmx::RVec> updateGroupCogs_;
     //! Maximum number of columns across all grids
     int numColumnsMax_;
 };
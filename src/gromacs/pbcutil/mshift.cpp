@@ -48,6 +48,7 @@
 #include "gromacs/topology/idef.h"
 #include "gromacs/topology/ifunc.h"
 #include "gromacs/topology/topology.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/strconvert.h"
 #include "gromacs/utility/stringutil.h"
@@ -561,6 +562,31 @@ static void mk_1shift_screw(const matrix box, const rvec hbox, const rvec xi, co
     }
 }
 
+/* Calculate the periodicity mj of xj given xi with periodicity mi */
+static void mk_1shift_pbc(const t_graph& g,
+                          int            npbcdim,
+                          gmx_bool       bTriclinic,
+                          const matrix   box,
+                          const rvec     hbox,
+                          const rvec     xi,
+                          const rvec     xj,
+                          const int*     mi,
+                          int*           mj)
+{
+    if (g.useScrewPbc)
+    {
+        mk_1shift_screw(box, hbox, xi, xj, mi, mj);
+    }
+    else if (bTriclinic)
+    {
+        mk_1shift_tric(npbcdim, box, hbox, xi, xj, mi, mj);
+    }
+    else
+    {
+        mk_1shift(npbcdim, hbox, xi, xj, mi, mj);
+    }
+}
+
 static int mk_grey(ArrayRef<egCol> edgeColor,
                    t_graph*        g,
                    int*            AtomI,
@@ -589,18 +615,7 @@ static int mk_grey(ArrayRef<egCol> edgeColor,
     for (const int aj : g->edges[ai - g0])
     {
         /* If there is a white one, make it grey and set pbc */
-        if (g->useScrewPbc)
-        {
-            mk_1shift_screw(box, hbox, x[ai], x[aj], g->ishift[ai], is_aj);
-        }
-        else if (bTriclinic)
-        {
-            mk_1shift_tric(npbcdim, box, hbox, x[ai], x[aj], g->ishift[ai], is_aj);
-        }
-        else
-        {
-            mk_1shift(npbcdim, hbox, x[ai], x[aj], g->ishift[ai], is_aj);
-        }
+        mk_1shift_pbc(*g, npbcdim, bTriclinic, box, hbox, x[ai], x[aj], g->ishift[ai], is_aj);
 
         if (edgeColor[aj - g0] == egcolWhite)
         {
@@ -650,6 +665,61 @@ static gmx::index first_colour(const int fC, const egCol Col, const t_graph* g,
     return -1;
 }
 
+void mk_graph_walk(t_graph* g)
+{
+    g->walkAtoms.clear();
+    g->walkParents.clear();
+    g->walkPartStart.clear();
+
+    /* Color the graph exactly as mk_mshift() does. This only depends
+     * on the connectivity, so we can record the order here.
+     */
+    const int          g0 = g->edgeAtomBegin;
+    std::vector<egCol> edgeColor(g->edges.size(), egcolWhite);
+    int                nW = g->numConnectedAtoms;
+    gmx::index         fW = 0;
+    while (nW > 0)
+    {
+        fW = first_colour(fW, egcolWhite, g, edgeColor);
+        GMX_RELEASE_ASSERT(fW >= 0, "There should be white nodes left");
+
+        edgeColor[fW] = egcolGrey;
+        nW--;
+        int nG = 1;
+        g->walkPartStart.push_back(g->walkAtoms.size());
+        g->walkAtoms.push_back(g0 + fW);
+        g->walkParents.push_back(-1);
+
+        gmx::index fG = fW;
+        while (nG > 0)
+        {
+            fG = first_colour(fG, egcolGrey, g, edgeColor);
+            GMX_RELEASE_ASSERT(fG >= 0, "There should be grey nodes left");
+
+            edgeColor[fG] = egcolBlack;
+            nG--;
+
+            const int ai = g0 + fG;
+            for (const int aj : g->edges[ai - g0])
+            {
+                if (edgeColor[aj - g0] == egcolWhite)
+                {
+                    if (aj - g0 < fG)
+                    {
+                        fG = aj - g0;
+                    }
+                    edgeColor[aj - g0] = egcolGrey;
+                    nG++;
+                    nW--;
+                    g->walkAtoms.push_back(aj);
+                    g->walkParents.push_back(ai);
+                }
+            }
+        }
+    }
+    g->walkPartStart.push_back(g->walkAtoms.size());
+}
+
 /* Returns the maximum length of the graph edges for coordinates x */
 static real maxEdgeLength(const t_graph& g, PbcType pbcType, const matrix box, const rvec x[])
 {
@@ -831,6 +901,93 @@ void mk_mshift(FILE* log, t_graph* g, PbcType pbcType, const matrix box, const r
     }
 }
 
+void mk_mshift_walk(FILE*        log,
+                    t_graph*     g,
+                    PbcType      pbcType,
+                    const matrix box,
+                    const rvec   x[],
+                    int          numThreads)
+{
+    GCHECK(g);
+    GMX_RELEASE_ASSERT(g->numConnectedAtoms == 0 || !g->walkPartStart.empty(),
+                       "mk_graph_walk() should be called before mk_mshift_walk()");
+
+    g->useScrewPbc = (pbcType == PbcType::Screw);
+
+    const int npbcdim = (pbcType == PbcType::XY ? 2 : 3);
+
+    for (int i = 0; i < g->shiftAtomEnd; i++)
+    {
+        g->ishift[i][XX] = g->ishift[i][YY] = g->ishift[i][ZZ] = 0;
+    }
+
+    if (!g->numConnectedAtoms)
+    {
+        return;
+    }
+
+    rvec hbox;
+    for (int m = 0; m < DIM; m++)
+    {
+        hbox[m] = box[m][m] * 0.5;
+    }
+    const gmx_bool bTriclinic = TRICLINIC(box);
+
+    const int               g0        = g->edgeAtomBegin;
+    const std::vector<int>& partStart = g->walkPartStart;
+    const int64_t           numWalk   = g->walkAtoms.size();
+
+    int nerror = 0;
+#pragma omp parallel for num_threads(numThreads) schedule(static) reduction(+ : nerror)
+    for (int thread = 0; thread < numThreads; thread++)
+    {
+        try
+        {
+            /* Assign whole parts to threads, balanced by atom count */
+            const int walkBegin = *std::lower_bound(partStart.begin(), partStart.end(),
+                                                    (numWalk * thread) / numThreads);
+            const int walkEnd   = *std::lower_bound(partStart.begin(), partStart.end(),
+                                                  (numWalk * (thread + 1)) / numThreads);
+
+            /* Parents precede their children in the walk */
+            for (int w = walkBegin; w < walkEnd; w++)
+            {
+                const int ai = g->walkParents[w];
+                if (ai >= 0)
+                {
+                    const int aj = g->walkAtoms[w];
+                    mk_1shift_pbc(*g, npbcdim, bTriclinic, box, hbox, x[ai], x[aj], g->ishift[ai],
+                                  g->ishift[aj]);
+                }
+            }
+
+            /* Check all edges for consistency, as mk_mshift() does */
+            for (int w = walkBegin; w < walkEnd; w++)
+            {
+                const int ai = g->walkAtoms[w];
+                for (const int aj : g->edges[ai - g0])
+                {
+                    ivec is_aj;
+                    mk_1shift_pbc(*g, npbcdim, bTriclinic, box, hbox, x[ai], x[aj], g->ishift[ai],
+                                  is_aj);
+                    if ((is_aj[XX] != g->ishift[aj][XX]) || (is_aj[YY] != g->ishift[aj][YY])
+                        || (is_aj[ZZ] != g->ishift[aj][ZZ]))
+                    {
+                        nerror++;
+                    }
+                }
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+
+    if (nerror > 0)
+    {
+        /* Let mk_mshift() handle and report the inconsistencies */
+        mk_mshift(log, g, pbcType, box, x);
+    }
+}
+
 /************************************************************
  *
  *      A C T U A L   S H I F T   C O D E
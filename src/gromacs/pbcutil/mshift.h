@@ -97,6 +97,12 @@ struct t_graph
     std::vector<egCol> edgeColor;
     // Tells how connected this graph is
     BondedParts parts = BondedParts::Single;
+    // The atoms in the order in which mk_mshift() assigns their shifts, set by mk_graph_walk()
+    std::vector<int> walkAtoms;
+    // For each atom in walkAtoms, the atom its shift derives from, -1 for the first atom of a part
+    std::vector<int> walkParents;
+    // The start indices in walkAtoms of the disconnected parts of the graph, plus the end
+    std::vector<int> walkPartStart;
 };
 
 #define SHIFT_IVEC(g, i) ((g)->ishift[i])
@@ -142,6 +148,24 @@ void p_graph(FILE* log, const char* title, const t_graph* g);
 void mk_mshift(FILE* log, t_graph* g, PbcType pbcType, const matrix box, const rvec x[]);
 /* Calculate the mshift codes, based on the connection graph in g. */
 
+void mk_graph_walk(t_graph* g);
+/* Precompute the order in which mk_mshift() walks the graph.
+ * This order only depends on the connectivity, so it can be reused
+ * by mk_mshift_walk() for any set of coordinates.
+ */
+
+void mk_mshift_walk(FILE*        log,
+                    t_graph*     g,
+                    PbcType      pbcType,
+                    const matrix box,
+                    const rvec   x[],
+                    int          numThreads);
+/* Calculate the same mshift codes as mk_mshift(), but using the walk
+ * precomputed by mk_graph_walk(). The disconnected parts of the graph,
+ * usually molecules, are distributed over numThreads OpenMP threads.
+ * When the shifts are inconsistent, mk_mshift() is called for the reporting.
+ */
+
 void shift_x(const t_graph* g, const matrix box, const rvec x[], rvec x_s[]);
 /* Add the shift vector to x, and store in x_s (may be same array as x) */
 
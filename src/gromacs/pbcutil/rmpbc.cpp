@@ -52,6 +52,7 @@
 #include "gromacs/trajectory/trajectoryframe.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/smalloc.h"
 
 typedef struct
@@ -69,6 +70,7 @@ struct gmx_rmpbc
     int                           ePBC;
     int                           ngraph;
     rmpbc_graph_t*                graph;
+    int                           numThreads;
 };
 
 static t_graph* gmx_rmpbc_get_graph(gmx_rmpbc_t gpbc, PbcType pbcType, int natoms)
@@ -114,6 +116,8 @@ static t_graph* gmx_rmpbc_get_graph(gmx_rmpbc_t gpbc, PbcType pbcType, int natom
         {
             gr->gr = mk_graph(nullptr, gpbc->idef, natoms, FALSE, FALSE);
         }
+        /* The walk over the graph is the same for every frame */
+        mk_graph_walk(gr->gr);
     }
 
     return gr->gr;
@@ -134,6 +138,8 @@ gmx_rmpbc_t gmx_rmpbc_init(const InteractionDefinitions& idef, PbcType pbcType,
 
     gpbc->interactionDefinitions = &idef;
 
+    gpbc->numThreads = gmx_omp_get_max_threads();
+
     return gpbc;
 }
 
@@ -151,6 +157,9 @@ gmx_rmpbc_t gmx_rmpbc_init(const t_idef* idef, PbcType pbcType, int natoms)
     gpbc->pbcType = pbcType;
 
     gpbc->idef = idef;
+
+    gpbc->numThreads = gmx_omp_get_max_threads();
+
     if (gpbc->idef->ntypes <= 0)
     {
         fprintf(stderr,
@@ -203,7 +212,7 @@ void gmx_rmpbc(gmx_rmpbc_t gpbc, int natoms, const matrix box, rvec x[])
     gr      = gmx_rmpbc_get_graph(gpbc, pbcType, natoms);
     if (gr != nullptr)
     {
-        mk_mshift(stdout, gr, pbcType, box, x);
+        mk_mshift_walk(stdout, gr, pbcType, box, x, gpbc->numThreads);
         shift_self(gr, box, x);
     }
 }
@@ -218,7 +227,7 @@ void gmx_rmpbc_copy(gmx_rmpbc_t gpbc, int natoms, const matrix box, rvec x[], rv
     gr      = gmx_rmpbc_get_graph(gpbc, pbcType, natoms);
     if (gr != nullptr)
     {
-        mk_mshift(stdout, gr, pbcType, box, x);
+        mk_mshift_walk(stdout, gr, pbcType, box, x, gpbc->numThreads);
         shift_x(gr, box, x, x_s);
     }
     else
@@ -241,7 +250,7 @@ void gmx_rmpbc_trxfr(gmx_rmpbc_t gpbc, t_trxframe* fr)
         gr      = gmx_rmpbc_get_graph(gpbc, pbcType, fr->natoms);
         if (gr != nullptr)
         {
-            mk_mshift(stdout, gr, pbcType, fr->box, fr->x);
+            mk_mshift_walk(stdout, gr, pbcType, fr->box, fr->x, gpbc->numThreads);
             shift_self(gr, fr->box, fr->x);
         }
     }
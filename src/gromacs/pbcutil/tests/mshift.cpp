@@ -153,6 +153,40 @@ TEST(MShift, shiftsAndUnshiftsSelf)
     EXPECT_THAT(coordinates(), Pointwise(RVecEq(defaultFloatTolerance()), x));
 }
 
+//! Tests that the precomputed walk gives the same shifts as mk_mshift
+TEST(MShift, walkGivesSameShifts)
+{
+    /* Two copies of moleculeType() in one graph, so the walk has
+     * multiple parts which can be distributed over threads.
+     */
+    gmx_moltype_t molType             = {};
+    molType.atoms.nr                  = 10;
+    molType.ilist[F_CONSTR].iatoms    = { 0, 1, 2, 0, 6, 7 };
+    molType.ilist[F_ANGLES].iatoms    = { 1, 2, 1, 3, 1, 7, 6, 8 };
+    const std::vector<RVec> xMolecule = coordinates();
+    std::vector<RVec>       x(xMolecule);
+    x.insert(x.end(), xMolecule.begin(), xMolecule.end());
+
+    t_graph graph = mk_graph_moltype(molType);
+    mk_mshift(nullptr, &graph, PbcType::Xyz, c_box, as_rvec_array(x.data()));
+    const std::vector<IVec> shifts = graph.ishift;
+
+    mk_graph_walk(&graph);
+    ASSERT_EQ(3, ssize(graph.walkPartStart));
+    for (int numThreads : { 1, 2, 3 })
+    {
+        mk_mshift_walk(nullptr, &graph, PbcType::Xyz, c_box, as_rvec_array(x.data()), numThreads);
+        for (int i = 0; i < molType.atoms.nr; i++)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                EXPECT_EQ(shifts[i][d], graph.ishift[i][d])
+                        << "atom " << i << ", " << numThreads << " threads";
+            }
+        }
+    }
+}
+
 } // namespace
 } // namespace test
 } // namespace gmx
@@ -2237,6 +2237,11 @@ struct pull_t* init_pull(FILE*                     fplog,
     /* The gmx_omp_nthreads module might not be initialized here, so max(1,) */
     pull->nthreads = std::max(1, gmx_omp_nthreads_get(emntDefault));
     pull->comSums.resize(pull->nthreads);
+    pull->comTaskThreadStart.resize(pull->nthreads + 1);
+    if (pull->bCylinder)
+    {
+        pull->cylinderThreadSums.resize(pull->nthreads * c_cylinderThreadSumsStride);
+    }
 
     comm = &pull->comm;
 
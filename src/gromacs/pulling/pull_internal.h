@@ -192,12 +192,23 @@ struct ComSums
     int dummy[32];
 };
 
+/* Part of the local atoms of a normal pull group in the COM work list */
+struct PullComTask
+{
+    int group;    /* Index of the pull group */
+    int indStart; /* Start index in the local atom set of the group */
+    int indEnd;   /* End index (exclusive) in the local atom set of the group */
+};
+
 /*! \brief The normal COM buffer needs 3 elements per group */
 static constexpr int c_comBufferStride = 3;
 
 /*! \brief The cylinder buffer needs 9 elements per group */
 static constexpr int c_cylinderBufferStride = 9;
 
+/*! \brief Stride for the per-thread cylinder sums, padded to 128 bytes to avoid false sharing */
+static constexpr int c_cylinderThreadSumsStride = 16;
+
 struct pull_comm_t
 {
     gmx_bool bParticipateAll; /* Do all ranks always participate in pulling? */
@@ -247,6 +258,13 @@ struct pull_t
     int                  nthreads; /* Number of threads used by the pull code */
     std::vector<ComSums> comSums;  /* Work array for summing for COM, 1 entry per thread */
 
+    /* Work list for summing the COMs of all normal groups in one parallel region */
+    std::vector<int>         normalComGroups;    /* Groups summed through the work list */
+    std::vector<PullComTask> comTasks;           /* Tasks, ordered by thread and then by group */
+    std::vector<int>         comTaskThreadStart; /* Start index in comTasks per thread, +1 */
+    std::vector<ComSums>     comTaskSums;        /* Sums, 1 entry per task */
+    std::vector<double> cylinderThreadSums; /* Cylinder sums, c_cylinderThreadSumsStride per thread */
+
     pull_comm_t comm; /* Communication parameters, communicator and buffers */
 
     FILE* out_x; /* Output file for pull data */
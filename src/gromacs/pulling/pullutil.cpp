@@ -39,6 +39,7 @@
 
 #include "config.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
 
@@ -178,6 +179,98 @@ static void pull_set_pbcatoms(const t_commrec* cr, struct pull_t* pull, const rv
     }
 }
 
+/* Computes the cylinder weights for atoms ind_start to ind_end in the local atom set
+ * of the reference group pref, stores them in pdyna and sets the sums in sums,
+ * which should have c_cylinderBufferStride elements.
+ */
+static void sumCylinderPart(const pull_group_work_t& pref,
+                            pull_group_work_t*       pdyna,
+                            int                      ind_start,
+                            int                      ind_end,
+                            const rvec*              x,
+                            const real*              masses,
+                            const t_pbc*             pbc,
+                            const rvec               reference,
+                            const rvec               direction,
+                            double                   inv_cyl_r2,
+                            double*                  sums)
+{
+    double sum_a  = 0;
+    double wmass  = 0;
+    double wwmass = 0;
+    dvec   radf_fac0, radf_fac1;
+    clear_dvec(radf_fac0);
+    clear_dvec(radf_fac1);
+
+    auto localAtomIndices = pref.atomSet.localIndex();
+
+    /* loop over our part of the atoms in the main ref group */
+    for (gmx::index indexInSet = ind_start; indexInSet < ind_end; indexInSet++)
+    {
+        int  atomIndex = localAtomIndices[indexInSet];
+        rvec dx;
+        pbc_dx_aiuc(pbc, x[atomIndex], reference, dx);
+        double axialLocation = iprod(direction, dx);
+        dvec   radialLocation;
+        double dr2 = 0;
+        for (int m = 0; m < DIM; m++)
+        {
+            /* Determine the radial components */
+            radialLocation[m] = dx[m] - axialLocation * direction[m];
+            dr2 += gmx::square(radialLocation[m]);
+        }
+        double dr2_rel = dr2 * inv_cyl_r2;
+
+        if (dr2_rel < 1)
+        {
+            /* add atom to sum of COM and to weight array */
+
+            double mass = masses[atomIndex];
+            /* The radial weight function is 1-2x^2+x^4,
+             * where x=r/cylinder_r. Since this function depends
+             * on the radial component, we also get radial forces
+             * on both groups.
+             */
+            double weight                   = 1 + (-2 + dr2_rel) * dr2_rel;
+            double dweight_r                = (-4 + 4 * dr2_rel) * inv_cyl_r2;
+            pdyna->localWeights[indexInSet] = weight;
+            sum_a += mass * weight * axialLocation;
+            wmass += mass * weight;
+            wwmass += mass * weight * weight;
+            dvec mdw;
+            dsvmul(mass * dweight_r, radialLocation, mdw);
+            copy_dvec(mdw, pdyna->mdw[indexInSet]);
+            /* Currently we only have the axial component of the
+             * offset from the cylinder COM up to an unkown offset.
+             * We add this offset after the reduction needed
+             * for determining the COM of the cylinder group.
+             */
+            pdyna->dv[indexInSet] = axialLocation;
+            for (int m = 0; m < DIM; m++)
+            {
+                radf_fac0[m] += mdw[m];
+                radf_fac1[m] += mdw[m] * axialLocation;
+            }
+        }
+        else
+        {
+            pdyna->localWeights[indexInSet] = 0;
+        }
+    }
+
+    sums[0] = wmass;
+    sums[1] = wwmass;
+    sums[2] = sum_a;
+
+    sums[3] = radf_fac0[XX];
+    sums[4] = radf_fac0[YY];
+    sums[5] = radf_fac0[ZZ];
+
+    sums[6] = radf_fac1[XX];
+    sums[7] = radf_fac1[YY];
+    sums[8] = radf_fac1[ZZ];
+}
+
 static void
 make_cyl_refgrps(const t_commrec* cr, pull_t* pull, const real* masses, t_pbc* pbc, double t, const rvec* x)
 {
@@ -191,17 +284,11 @@ make_cyl_refgrps(const t_commrec* cr, pull_t* pull, const real* masses, t_pbc* p
     /* loop over all groups to make a reference group for each*/
     for (size_t c = 0; c < pull->coord.size(); c++)
     {
-        pull_coord_work_t* pcrd;
-        double             sum_a, wmass, wwmass;
-        dvec               radf_fac0, radf_fac1;
-
-        pcrd = &pull->coord[c];
+        pull_coord_work_t* pcrd = &pull->coord[c];
 
-        sum_a  = 0;
-        wmass  = 0;
-        wwmass = 0;
-        clear_dvec(radf_fac0);
-        clear_dvec(radf_fac1);
+        auto buffer = gmx::arrayRefFromArray(
+                comm->cylinderBuffer.data() + c * c_cylinderBufferStride, c_cylinderBufferStride);
+        std::fill(buffer.begin(), buffer.end(), 0.0);
 
         if (pcrd->params.eGeom == epullgCYL)
         {
@@ -238,75 +325,36 @@ make_cyl_refgrps(const t_commrec* cr, pull_t* pull, const real* masses, t_pbc* p
             pdyna.mdw.resize(localAtomIndices.size());
             pdyna.dv.resize(localAtomIndices.size());
 
-            /* loop over all atoms in the main ref group */
-            for (gmx::index indexInSet = 0; indexInSet < localAtomIndices.ssize(); indexInSet++)
+            const int numAtomsLocal = localAtomIndices.ssize();
+            if (numAtomsLocal <= c_pullMaxNumLocalAtomsSingleThreaded)
             {
-                int  atomIndex = localAtomIndices[indexInSet];
-                rvec dx;
-                pbc_dx_aiuc(pbc, x[atomIndex], reference, dx);
-                double axialLocation = iprod(direction, dx);
-                dvec   radialLocation;
-                double dr2 = 0;
-                for (int m = 0; m < DIM; m++)
+                sumCylinderPart(pref, &pdyna, 0, numAtomsLocal, x, masses, pbc, reference,
+                                direction, inv_cyl_r2, buffer.data());
+            }
+            else
+            {
+#pragma omp parallel for num_threads(pull->nthreads) schedule(static)
+                for (int th = 0; th < pull->nthreads; th++)
                 {
-                    /* Determine the radial components */
-                    radialLocation[m] = dx[m] - axialLocation * direction[m];
-                    dr2 += gmx::square(radialLocation[m]);
+                    int ind_start = (numAtomsLocal * (th + 0)) / pull->nthreads;
+                    int ind_end   = (numAtomsLocal * (th + 1)) / pull->nthreads;
+                    sumCylinderPart(pref, &pdyna, ind_start, ind_end, x, masses, pbc, reference,
+                                    direction, inv_cyl_r2,
+                                    pull->cylinderThreadSums.data() + th * c_cylinderThreadSumsStride);
                 }
-                double dr2_rel = dr2 * inv_cyl_r2;
 
-                if (dr2_rel < 1)
+                /* Reduce the thread contributions, in fixed order */
+                for (int th = 0; th < pull->nthreads; th++)
                 {
-                    /* add atom to sum of COM and to weight array */
-
-                    double mass = masses[atomIndex];
-                    /* The radial weight function is 1-2x^2+x^4,
-                     * where x=r/cylinder_r. Since this function depends
-                     * on the radial component, we also get radial forces
-                     * on both groups.
-                     */
-                    double weight                  = 1 + (-2 + dr2_rel) * dr2_rel;
-                    double dweight_r               = (-4 + 4 * dr2_rel) * inv_cyl_r2;
-                    pdyna.localWeights[indexInSet] = weight;
-                    sum_a += mass * weight * axialLocation;
-                    wmass += mass * weight;
-                    wwmass += mass * weight * weight;
-                    dvec mdw;
-                    dsvmul(mass * dweight_r, radialLocation, mdw);
-                    copy_dvec(mdw, pdyna.mdw[indexInSet]);
-                    /* Currently we only have the axial component of the
-                     * offset from the cylinder COM up to an unkown offset.
-                     * We add this offset after the reduction needed
-                     * for determining the COM of the cylinder group.
-                     */
-                    pdyna.dv[indexInSet] = axialLocation;
-                    for (int m = 0; m < DIM; m++)
+                    const double* threadSums =
+                            pull->cylinderThreadSums.data() + th * c_cylinderThreadSumsStride;
+                    for (int i = 0; i < c_cylinderBufferStride; i++)
                     {
-                        radf_fac0[m] += mdw[m];
-                        radf_fac1[m] += mdw[m] * axialLocation;
+                        buffer[i] += threadSums[i];
                     }
                 }
-                else
-                {
-                    pdyna.localWeights[indexInSet] = 0;
-                }
             }
         }
-
-        auto buffer = gmx::arrayRefFromArray(
-                comm->cylinderBuffer.data() + c * c_cylinderBufferStride, c_cylinderBufferStride);
-
-        buffer[0] = wmass;
-        buffer[1] = wwmass;
-        buffer[2] = sum_a;
-
-        buffer[3] = radf_fac0[XX];
-        buffer[4] = radf_fac0[YY];
-        buffer[5] = radf_fac0[ZZ];
-
-        buffer[6] = radf_fac1[XX];
-        buffer[7] = radf_fac1[YY];
-        buffer[8] = radf_fac1[ZZ];
     }
 
     if (cr != nullptr && PAR(cr))
@@ -517,6 +565,115 @@ static void sum_com_part_cosweight(const pull_group_work_t* pgrp,
     sum_com->sum_smp = sum_smp;
 }
 
+/* Sums the local COM contributions of all normal, i.e. not cosine weighted,
+ * groups in groupIndices into comm->comBuffer.
+ *
+ * Instead of threading over the atoms of each group separately, which leaves
+ * small groups single-threaded and costs a parallel region per group,
+ * the local atoms of all groups are concatenated into one work list which
+ * is divided evenly over the threads. Each thread sums the parts of
+ * the groups it covers and the parts are reduced in a fixed order,
+ * so the result does not depend on the thread scheduling.
+ */
+static void sumNormalComs(pull_t*                  pull,
+                          gmx::ArrayRef<const int> groupIndices,
+                          const rvec*              x,
+                          const rvec*              xp,
+                          const real*              masses,
+                          const t_pbc*             pbc)
+{
+    pull_comm_t* comm = &pull->comm;
+
+    int numAtomsTotal = 0;
+    for (int g : groupIndices)
+    {
+        numAtomsTotal += pull->group[g].atomSet.numAtomsLocal();
+    }
+
+    /* Only use as many threads as useful for the total atom count */
+    const int numThreads = std::max(
+            1, std::min(pull->nthreads, numAtomsTotal / c_pullMaxNumLocalAtomsSingleThreaded));
+
+    /* Cut the concatenated local atom list into equal parts per thread */
+    std::vector<PullComTask>& tasks = pull->comTasks;
+    tasks.clear();
+    size_t groupListIndex = 0;
+    int    groupOffset    = 0;
+    for (int th = 0; th < numThreads; th++)
+    {
+        pull->comTaskThreadStart[th] = tasks.size();
+
+        const int atomStart = (numAtomsTotal * (th + 0)) / numThreads;
+        const int atomEnd   = (numAtomsTotal * (th + 1)) / numThreads;
+        while (groupListIndex < groupIndices.size())
+        {
+            const int g             = groupIndices[groupListIndex];
+            const int numAtomsGroup = pull->group[g].atomSet.numAtomsLocal();
+            const int indStart      = std::max(0, atomStart - groupOffset);
+            const int indEnd        = std::min(numAtomsGroup, atomEnd - groupOffset);
+            /* Empty groups also get a task, so their buffer is cleared */
+            if (indEnd > indStart || numAtomsGroup == 0)
+            {
+                tasks.push_back({ g, indStart, indEnd });
+            }
+            if (groupOffset + numAtomsGroup > atomEnd)
+            {
+                /* The rest of this group goes to the next thread */
+                break;
+            }
+            groupOffset += numAtomsGroup;
+            groupListIndex++;
+        }
+    }
+    pull->comTaskThreadStart[numThreads] = tasks.size();
+
+    if (pull->comTaskSums.size() < tasks.size())
+    {
+        pull->comTaskSums.resize(tasks.size());
+    }
+
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (int th = 0; th < numThreads; th++)
+    {
+        for (int t = pull->comTaskThreadStart[th]; t < pull->comTaskThreadStart[th + 1]; t++)
+        {
+            const PullComTask& task = tasks[t];
+            sum_com_part(&pull->group[task.group], task.indStart, task.indEnd, x, xp, masses, pbc,
+                         comm->pbcAtomBuffer[task.group], &pull->comTaskSums[t]);
+        }
+    }
+
+    /* Reduce the task contributions, tasks of the same group are consecutive */
+    for (size_t t = 0; t < tasks.size(); t++)
+    {
+        const int      g        = tasks[t].group;
+        const ComSums& taskSums = pull->comTaskSums[t];
+        auto           comBuffer =
+                gmx::arrayRefFromArray(comm->comBuffer.data() + g * c_comBufferStride, c_comBufferStride);
+        if (t == 0 || tasks[t - 1].group != g)
+        {
+            clear_dvec(comBuffer[0]);
+            clear_dvec(comBuffer[1]);
+            clear_dvec(comBuffer[2]);
+        }
+
+        dvec_inc(comBuffer[0], taskSums.sum_wmx);
+        if (xp)
+        {
+            dvec_inc(comBuffer[1], taskSums.sum_wmxp);
+        }
+        comBuffer[2][0] += taskSums.sum_wm;
+        if (pull->group[g].localWeights.empty())
+        {
+            comBuffer[2][1] += taskSums.sum_wm;
+        }
+        else
+        {
+            comBuffer[2][1] += taskSums.sum_wwm;
+        }
+    }
+}
+
 /* calculates center of mass of selection index from all coordinates x */
 // Compiler segfault with 2019_update_5 and 2020_initial
 #if defined(__INTEL_COMPILER) \
@@ -568,6 +725,10 @@ void pull_calc_coms(const t_commrec* cr, pull_t* pull, const real* masses, t_pbc
         twopi_box = 2.0 * M_PI / pbc->box[pull->cosdim][pull->cosdim];
     }
 
+    /* The normal groups are summed together in a single work list below */
+    std::vector<int>& normalComGroups = pull->normalComGroups;
+    normalComGroups.clear();
+
     for (size_t g = 0; g < pull->group.size(); g++)
     {
         pull_group_work_t* pgrp = &pull->group[g];
@@ -588,23 +749,12 @@ void pull_calc_coms(const t_commrec* cr, pull_t* pull, const real* masses, t_pbc
         {
             if (pgrp->epgrppbc != epgrppbcCOS)
             {
-                rvec x_pbc = { 0, 0, 0 };
-
-                switch (pgrp->epgrppbc)
+                if (pgrp->epgrppbc == epgrppbcPREVSTEPCOM)
                 {
-                    case epgrppbcREFAT:
-                        /* Set the pbc atom */
-                        copy_rvec(comm->pbcAtomBuffer[g], x_pbc);
-                        break;
-                    case epgrppbcPREVSTEPCOM:
-                        /* Set the pbc reference to the COM of the group of the last step */
-                        copy_dvec_to_rvec(pgrp->x_prev_step, comm->pbcAtomBuffer[g]);
-                        copy_dvec_to_rvec(pgrp->x_prev_step, x_pbc);
+                    /* Set the pbc reference to the COM of the group of the last step */
+                    copy_dvec_to_rvec(pgrp->x_prev_step, comm->pbcAtomBuffer[g]);
                 }
 
-                /* The final sums should end up in comSums[0] */
-                ComSums& comSumsTotal = pull->comSums[0];
-
                 /* If we have a single-atom group the mass is irrelevant, so
                  * we can remove the mass factor to avoid division by zero.
                  * Note that with constraint pulling the mass does matter, but
@@ -617,54 +767,23 @@ void pull_calc_coms(const t_commrec* cr, pull_t* pull, const real* masses, t_pbc
                                "We should not have groups with zero mass with constraints, i.e. "
                                "xp!=NULL");
 
-                    /* Copy the single atom coordinate */
+                    /* Copy the single atom coordinate and set all mass factors
+                     * to 1 to get the correct COM
+                     */
                     for (int d = 0; d < DIM; d++)
                     {
-                        comSumsTotal.sum_wmx[d] = x[pgrp->atomSet.localIndex()[0]][d];
+                        comBuffer[0][d] = x[pgrp->atomSet.localIndex()[0]][d];
                     }
-                    /* Set all mass factors to 1 to get the correct COM */
-                    comSumsTotal.sum_wm  = 1;
-                    comSumsTotal.sum_wwm = 1;
-                }
-                else if (pgrp->atomSet.numAtomsLocal() <= c_pullMaxNumLocalAtomsSingleThreaded)
-                {
-                    sum_com_part(pgrp, 0, pgrp->atomSet.numAtomsLocal(), x, xp, masses, pbc, x_pbc,
-                                 &comSumsTotal);
+                    clear_dvec(comBuffer[1]);
+                    comBuffer[2][0] = 1;
+                    comBuffer[2][1] = 1;
+                    comBuffer[2][2] = 0;
                 }
                 else
                 {
-#pragma omp parallel for num_threads(pull->nthreads) schedule(static)
-                    for (int t = 0; t < pull->nthreads; t++)
-                    {
-                        int ind_start = (pgrp->atomSet.numAtomsLocal() * (t + 0)) / pull->nthreads;
-                        int ind_end   = (pgrp->atomSet.numAtomsLocal() * (t + 1)) / pull->nthreads;
-                        sum_com_part(pgrp, ind_start, ind_end, x, xp, masses, pbc, x_pbc,
-                                     &pull->comSums[t]);
-                    }
-
-                    /* Reduce the thread contributions to sum_com[0] */
-                    for (int t = 1; t < pull->nthreads; t++)
-                    {
-                        comSumsTotal.sum_wm += pull->comSums[t].sum_wm;
-                        comSumsTotal.sum_wwm += pull->comSums[t].sum_wwm;
-                        dvec_inc(comSumsTotal.sum_wmx, pull->comSums[t].sum_wmx);
-                        dvec_inc(comSumsTotal.sum_wmxp, pull->comSums[t].sum_wmxp);
-                    }
-                }
-
-                if (pgrp->localWeights.empty())
-                {
-                    comSumsTotal.sum_wwm = comSumsTotal.sum_wm;
+                    /* Add the group to the work list, summed after this loop */
+                    normalComGroups.push_back(g);
                 }
-
-                /* Copy local sums to a buffer for global summing */
-                copy_dvec(comSumsTotal.sum_wmx, comBuffer[0]);
-
-                copy_dvec(comSumsTotal.sum_wmxp, comBuffer[1]);
-
-                comBuffer[2][0] = comSumsTotal.sum_wm;
-                comBuffer[2][1] = comSumsTotal.sum_wwm;
-                comBuffer[2][2] = 0;
             }
             else
             {
@@ -714,6 +833,8 @@ void pull_calc_coms(const t_commrec* cr, pull_t* pull, const real* masses, t_pbc
         }
     }
 
+    sumNormalComs(pull, normalComGroups, x, xp, masses, pbc);
+
     pullAllReduce(cr, comm, pull->group.size() * c_comBufferStride * DIM,
                   static_cast<double*>(comm->comBuffer[0]));
 
@@ -64,9 +64,12 @@
 #include "gromacs/math/functions.h"
 #include "gromacs/math/vec.h"
 #include "gromacs/pbcutil/pbc.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/utility/alignedallocator.h"
 #include "gromacs/utility/arrayref.h"
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/listoflists.h"
 #include "gromacs/utility/mutex.h"
 #include "gromacs/utility/stringutil.h"
@@ -109,6 +112,31 @@ void computeBoundingBox(int posCount, const rvec x[], rvec origin, rvec size)
     rvec_sub(maxBound, origin, size);
 }
 
+/*! \brief
+ * Checks whether a cell in the cell pair loop is within the loop bounds.
+ *
+ * For a test position outside a non-periodic grid, the initial cell range
+ * (or the range for a later grid row) can be empty, in which case the cell
+ * produced by initCellRange() must not be searched.
+ */
+bool isCellInRange(const ivec cell, const ivec upperBound)
+{
+    return cell[XX] <= upperBound[XX] && cell[YY] <= upperBound[YY] && cell[ZZ] <= upperBound[ZZ];
+}
+
+//! Number of positions per batch in the packed grid cells, matches the SIMD width.
+#if GMX_SIMD_HAVE_REAL
+constexpr int c_packedBatchSize = GMX_SIMD_REAL_WIDTH;
+#else
+constexpr int c_packedBatchSize = 1;
+#endif
+
+//! Coordinate for padding entries in the packed grid cells, never within the cutoff.
+constexpr real c_packedPaddingCoordinate = 1e10;
+
+//! Minimum number of test positions per thread in bulk searches.
+constexpr int c_minTestPositionsPerThread = 64;
+
 } // namespace
 
 namespace internal
@@ -147,7 +175,37 @@ public:
     real cutoffSquared() const { return cutoff2_; }
     bool usesGridSearch() const { return bGrid_; }
 
+    //! Implements AnalysisNeighborhoodSearch::findAllPairs().
+    void findAllPairs(const AnalysisNeighborhoodPositions& positions,
+                      ListOfLists<int>*                    refIndices,
+                      ListOfLists<real>*                   distances2) const;
+
 private:
+    /*! \brief
+     * Copies the reference positions into the packed cell arrays.
+     *
+     * Should be called after the grid cells have been filled.
+     */
+    void initPackedCells();
+    /*! \brief
+     * Finds all reference positions within the cutoff of a test position.
+     *
+     * \param[in]  x          Test position.
+     * \param[in]  excl       Sorted exclusion ids for the test position.
+     * \param[out] refIndices Indices of the found reference positions are
+     *     appended here.
+     * \param[out] distances2 Squared distances for \p refIndices are
+     *     appended here.
+     *
+     * Uses the packed cell arrays with grid searching and a simple loop
+     * over all reference positions otherwise.
+     */
+    void findPairsForPosition(const rvec          x,
+                              ArrayRef<const int> excl,
+                              std::vector<int>*   refIndices,
+                              std::vector<real>*  distances2) const;
+    //! Checks whether reference position \p j is in the sorted exclusions \p excl.
+    bool isExcludedFromTest(ArrayRef<const int> excl, int j) const;
     /*! \brief
      * Determines a suitable grid size and sets up the cells.
      *
@@ -319,6 +377,20 @@ private:
     ivec ncelldim_;
     //! Data structure to hold the grid cell contents.
     CellList cells_;
+    /*! \brief
+     * Start of each grid cell in the packed arrays, plus the total size.
+     *
+     * Each cell is padded to a multiple of #c_packedBatchSize.
+     */
+    std::vector<int> packedCellStart_;
+    //! Reference position index for each packed entry, -1 for padding.
+    std::vector<int> packedRefIndex_;
+    //! Reference position X coordinates ordered by grid cell.
+    std::vector<real, AlignedAllocator<real>> packedX_;
+    //! Reference position Y coordinates ordered by grid cell.
+    std::vector<real, AlignedAllocator<real>> packedY_;
+    //! Reference position Z coordinates ordered by grid cell.
+    std::vector<real, AlignedAllocator<real>> packedZ_;
 
     Mutex          createPairSearchMutex_;
     PairSearchList pairSearchList_;
@@ -922,6 +994,7 @@ void AnalysisNeighborhoodSearchImpl::init(AnalysisNeighborhood::SearchMode     m
             mapPointToGridCell(positions.x_[ii], refcell, xrefAlloc_[i]);
             addToGridCell(refcell, i);
         }
+        initPackedCells();
     }
     else if (refIndices_ != nullptr)
     {
@@ -948,6 +1021,207 @@ void AnalysisNeighborhoodSearchImpl::init(AnalysisNeighborhood::SearchMode     m
     }
 }
 
+void AnalysisNeighborhoodSearchImpl::initPackedCells()
+{
+    const int cellCount = ncelldim_[XX] * ncelldim_[YY] * ncelldim_[ZZ];
+    packedCellStart_.resize(cellCount + 1);
+    int packedCount = 0;
+    for (int ci = 0; ci < cellCount; ++ci)
+    {
+        packedCellStart_[ci] = packedCount;
+        const int cellSize   = ssize(cells_[ci]);
+        packedCount += ((cellSize + c_packedBatchSize - 1) / c_packedBatchSize) * c_packedBatchSize;
+    }
+    packedCellStart_[cellCount] = packedCount;
+
+    packedRefIndex_.assign(packedCount, -1);
+    packedX_.assign(packedCount, c_packedPaddingCoordinate);
+    packedY_.assign(packedCount, c_packedPaddingCoordinate);
+    packedZ_.assign(packedCount, c_packedPaddingCoordinate);
+    for (int ci = 0; ci < cellCount; ++ci)
+    {
+        int j = packedCellStart_[ci];
+        for (int i : cells_[ci])
+        {
+            packedRefIndex_[j] = i;
+            packedX_[j]        = xref_[i][XX];
+            packedY_[j]        = xref_[i][YY];
+            packedZ_[j]        = xref_[i][ZZ];
+            ++j;
+        }
+    }
+}
+
+bool AnalysisNeighborhoodSearchImpl::isExcludedFromTest(ArrayRef<const int> excl, int j) const
+{
+    if (excl.empty())
+    {
+        return false;
+    }
+    const int index = (refIndices_ != nullptr ? refIndices_[j] : j);
+    return std::binary_search(excl.begin(), excl.end(), refExclusionIds_[index]);
+}
+
+void AnalysisNeighborhoodSearchImpl::findPairsForPosition(const rvec          x,
+                                                          ArrayRef<const int> excl,
+                                                          std::vector<int>*   refIndices,
+                                                          std::vector<real>*  distances2) const
+{
+    if (!bGrid_)
+    {
+        for (int i = 0; i < nref_; ++i)
+        {
+            rvec dx;
+            if (pbc_.pbcType != PbcType::No)
+            {
+                pbc_dx(&pbc_, xref_[i], x, dx);
+            }
+            else
+            {
+                rvec_sub(xref_[i], x, dx);
+            }
+            const real r2 = bXY_ ? dx[XX] * dx[XX] + dx[YY] * dx[YY] : norm2(dx);
+            if (r2 <= cutoff2_ && !isExcludedFromTest(excl, i))
+            {
+                refIndices->push_back(i);
+                distances2->push_back(r2);
+            }
+        }
+        return;
+    }
+
+    rvec testcell, xtest;
+    ivec cell, upperBound;
+    mapPointToGridCell(x, testcell, xtest);
+    initCellRange(testcell, cell, upperBound, ZZ);
+    initCellRange(testcell, cell, upperBound, YY);
+    initCellRange(testcell, cell, upperBound, XX);
+
+#if GMX_SIMD_HAVE_REAL
+    const SimdReal                    cutoff2S(cutoff2_);
+    alignas(GMX_SIMD_ALIGNMENT) real r2Batch[GMX_SIMD_REAL_WIDTH];
+#endif
+    do
+    {
+        if (!isCellInRange(cell, upperBound))
+        {
+            continue;
+        }
+        rvec      shift;
+        const int ci = shiftCell(cell, shift);
+        for (int j = packedCellStart_[ci]; j < packedCellStart_[ci + 1]; j += c_packedBatchSize)
+        {
+#if GMX_SIMD_HAVE_REAL
+            // Same operation order as the scalar searchNext(), but with
+            // FMA the distances can still differ in the last bits.
+            const SimdReal dx = (load<SimdReal>(packedX_.data() + j) - SimdReal(xtest[XX]))
+                                - SimdReal(shift[XX]);
+            const SimdReal dy = (load<SimdReal>(packedY_.data() + j) - SimdReal(xtest[YY]))
+                                - SimdReal(shift[YY]);
+            SimdReal r2 = dx * dx + dy * dy;
+            if (!bXY_)
+            {
+                const SimdReal dz = (load<SimdReal>(packedZ_.data() + j) - SimdReal(xtest[ZZ]))
+                                    - SimdReal(shift[ZZ]);
+                r2 = r2 + dz * dz;
+            }
+            if (!anyTrue(r2 <= cutoff2S))
+            {
+                continue;
+            }
+            store(r2Batch, r2);
+            for (int k = 0; k < GMX_SIMD_REAL_WIDTH; ++k)
+            {
+                const int i = packedRefIndex_[j + k];
+                if (r2Batch[k] <= cutoff2_ && i >= 0 && !isExcludedFromTest(excl, i))
+                {
+                    refIndices->push_back(i);
+                    distances2->push_back(r2Batch[k]);
+                }
+            }
+#else
+            const int i = packedRefIndex_[j];
+            rvec      dx;
+            rvec_sub(xref_[i], xtest, dx);
+            rvec_sub(dx, shift, dx);
+            const real r2 = bXY_ ? dx[XX] * dx[XX] + dx[YY] * dx[YY] : norm2(dx);
+            if (r2 <= cutoff2_ && !isExcludedFromTest(excl, i))
+            {
+                refIndices->push_back(i);
+                distances2->push_back(r2);
+            }
+#endif
+        }
+    } while (nextCell(testcell, cell, upperBound));
+}
+
+void AnalysisNeighborhoodSearchImpl::findAllPairs(const AnalysisNeighborhoodPositions& positions,
+                                                  ListOfLists<int>*                    refIndices,
+                                                  ListOfLists<real>* distances2) const
+{
+    GMX_RELEASE_ASSERT(positions.index_ == -1,
+                       "Individual indexed positions not supported in bulk searches");
+    GMX_RELEASE_ASSERT(excls_ == nullptr || positions.exclusionIds_ != nullptr,
+                       "Exclusion IDs must be set when exclusions are enabled");
+    GMX_RELEASE_ASSERT(refIndices != nullptr, "Need a list to store the pairs in");
+
+    const int testPosCount = positions.count_;
+    const int numThreads   = std::max(
+            1, std::min(gmx_omp_get_max_threads(), testPosCount / c_minTestPositionsPerThread));
+
+    std::vector<ListOfLists<int>>  threadRefIndices(numThreads);
+    std::vector<ListOfLists<real>> threadDistances2(numThreads);
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (int th = 0; th < numThreads; ++th)
+    {
+        try
+        {
+            std::vector<int>  pairRefIndices;
+            std::vector<real> pairDistances2;
+            const int         testStart = (testPosCount * (th + 0)) / numThreads;
+            const int         testEnd   = (testPosCount * (th + 1)) / numThreads;
+            for (int t = testStart; t < testEnd; ++t)
+            {
+                const int index = (positions.indices_ != nullptr ? positions.indices_[t] : t);
+
+                ArrayRef<const int> excl;
+                if (excls_ != nullptr)
+                {
+                    const int exclIndex = positions.exclusionIds_[index];
+                    if (exclIndex < excls_->ssize())
+                    {
+                        excl = (*excls_)[exclIndex];
+                    }
+                }
+
+                pairRefIndices.clear();
+                pairDistances2.clear();
+                findPairsForPosition(positions.x_[index], excl, &pairRefIndices, &pairDistances2);
+                threadRefIndices[th].pushBack(pairRefIndices);
+                if (distances2 != nullptr)
+                {
+                    threadDistances2[th].pushBack(pairDistances2);
+                }
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+
+    refIndices->clear();
+    for (const auto& list : threadRefIndices)
+    {
+        refIndices->appendListOfLists(list);
+    }
+    if (distances2 != nullptr)
+    {
+        distances2->clear();
+        for (const auto& list : threadDistances2)
+        {
+            distances2->appendListOfLists(list);
+        }
+    }
+}
+
 /********************************************************************
  * AnalysisNeighborhoodPairSearchImpl
  */
@@ -1072,6 +1346,10 @@ bool AnalysisNeighborhoodPairSearchImpl::searchNext(Action action)
 
             do
             {
+                if (!isCellInRange(currCell_, cellBound_))
+                {
+                    continue;
+                }
                 rvec      shift;
                 const int ci = search_.shiftCell(currCell_, shift);
                 if (selfSearchMode_ && ci > testCellIndex_)
@@ -1379,6 +1657,14 @@ AnalysisNeighborhoodPair AnalysisNeighborhoodSearch::nearestPoint(const Analysis
     return AnalysisNeighborhoodPair(closestPoint, 0, minDist2, dx);
 }
 
+void AnalysisNeighborhoodSearch::findAllPairs(const AnalysisNeighborhoodPositions& positions,
+                                              ListOfLists<int>*                    refIndices,
+                                              ListOfLists<real>*                   distances2) const
+{
+    GMX_RELEASE_ASSERT(impl_, "Accessing an invalid search object");
+    impl_->findAllPairs(positions, refIndices, distances2);
+}
+
 AnalysisNeighborhoodPairSearch AnalysisNeighborhoodSearch::startSelfPairSearch() const
 {
     GMX_RELEASE_ASSERT(impl_, "Accessing an invalid search object");
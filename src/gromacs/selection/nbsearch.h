@@ -504,6 +504,37 @@ public:
      */
     AnalysisNeighborhoodPair nearestPoint(const AnalysisNeighborhoodPositions& positions) const;
 
+    /*! \brief
+     * Finds all reference positions within the cutoff of each test position.
+     *
+     * \param[in]  positions  Set of test positions to use.
+     * \param[out] refIndices For each test position, the indices of the
+     *     reference positions within the cutoff.
+     * \param[out] distances2 If not NULL, the squared distances of the pairs
+     *     in \p refIndices, with the same layout.
+     * \throws    std::bad_alloc if out of memory.
+     *
+     * Returns the same pairs as looping over startPairSearch() with
+     * findNextPair(), but computes all of them in one call: with grid
+     * searching the distances are computed in SIMD batches over the
+     * positions in a grid cell, and the test positions are divided over
+     * OpenMP threads.  List `i` in the output corresponds to test position
+     * `i`; the reference indices are as for
+     * AnalysisNeighborhoodPair::refIndex().
+     * The pairs for each test position are in the same order as
+     * findNextPair() returns them for that position, independent of the
+     * number of threads, so callers can rely on the order to resolve ties
+     * deterministically.
+     *
+     * Like isWithin(), this method does not modify the search object, and it
+     * can be called concurrently from several threads.
+     * The input positions cannot use
+     * AnalysisNeighborhoodPositions::selectSingleFromArray().
+     */
+    void findAllPairs(const AnalysisNeighborhoodPositions& positions,
+                      ListOfLists<int>*                    refIndices,
+                      ListOfLists<real>*                   distances2 = nullptr) const;
+
     /*! \brief
      * Starts a search to find all reference position pairs within a cutoff.
      *
@@ -46,10 +46,18 @@
  */
 #include "gmxpre.h"
 
+#include <cmath>
+
+#include <algorithm>
+#include <vector>
+
+#include "gromacs/math/functions.h"
 #include "gromacs/math/vec.h"
+#include "gromacs/pbcutil/pbc.h"
 #include "gromacs/selection/nbsearch.h"
 #include "gromacs/utility/arraysize.h"
 #include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/listoflists.h"
 
 #include "position.h"
 #include "selmethod.h"
@@ -65,7 +73,7 @@
  */
 struct t_methoddata_distance
 {
-    t_methoddata_distance() : cutoff(-1.0) {}
+    t_methoddata_distance() : cutoff(-1.0), buffer(0), bListValid(false) { clear_mat(boxAtBuild); }
 
     /** Cutoff distance. */
     real cutoff;
@@ -75,6 +83,29 @@ struct t_methoddata_distance
     gmx::AnalysisNeighborhood nb;
     /** Neighborhood search for an invididual frame. */
     gmx::AnalysisNeighborhoodSearch nbsearch;
+
+    /*! \brief
+     * Buffer for the incremental evaluation of \p within, 0 if not used.
+     *
+     * The remaining fields are only used when this is > 0.
+     */
+    real buffer;
+    /** Neighborhood search data with cutoff + buffer. */
+    gmx::AnalysisNeighborhood nbBuffered;
+    /** Whether the candidate list can be used. */
+    bool bListValid;
+    /** Reference position ids (gmx_ana_indexmap_t::refid) when the list was built. */
+    std::vector<int> refIdsAtBuild;
+    /** Reference positions when the list was built. */
+    std::vector<gmx::RVec> refXAtBuild;
+    /** Test positions when the list was built, indexed by refid. */
+    std::vector<gmx::RVec> testXAtBuild;
+    /** Index into \p candidates for each test refid, -1 if not in the list. */
+    std::vector<int> testListIndex;
+    /** For each listed test position, reference positions within cutoff + buffer. */
+    gmx::ListOfLists<int> candidates;
+    /** Box when the list was built. */
+    matrix boxAtBuild;
 };
 
 /*! \brief
@@ -93,6 +124,13 @@ struct t_methoddata_distance
  *    stored in \c t_methoddata_distance::p.
  */
 static void* init_data_common(int npar, gmx_ana_selparam_t* param);
+/*! \brief
+ * Allocates data for the \p within selection method.
+ *
+ * As init_data_common(), and additionally the third parameter defines the
+ * value for \c t_methoddata_distance::buffer.
+ */
+static void* init_data_within(int npar, gmx_ana_selparam_t* param);
 /*! \brief
  * Initializes a distance-based selection method.
  *
@@ -108,6 +146,13 @@ static void* init_data_common(int npar, gmx_ana_selparam_t* param);
  * Also checks that the cutoff is valid.
  */
 static void init_common(const gmx_mtop_t* top, int npar, gmx_ana_selparam_t* param, void* data);
+/*! \brief
+ * Initializes the \p within selection method.
+ *
+ * As init_common(), and additionally enables incremental evaluation if
+ * a positive buffer is given.
+ */
+static void init_within(const gmx_mtop_t* top, int npar, gmx_ana_selparam_t* param, void* data);
 /** Frees the data allocated for a distance-based selection method. */
 static void free_data_common(void* data);
 /*! \brief
@@ -121,16 +166,23 @@ static void free_data_common(void* data);
  * Initializes the neighborhood search for the current frame.
  */
 static void init_frame_common(const gmx::SelMethodEvalContext& context, void* data);
+/*! \brief
+ * Initializes the evaluation of the \p within selection method for a frame.
+ *
+ * As init_frame_common(), except that with incremental evaluation the
+ * neighborhood search is only initialized when it is needed.
+ */
+static void init_frame_within(const gmx::SelMethodEvalContext& context, void* data);
 /** Evaluates the \p distance selection method. */
 static void evaluate_distance(const gmx::SelMethodEvalContext& /*context*/,
                               gmx_ana_pos_t*      pos,
                               gmx_ana_selvalue_t* out,
                               void*               data);
 /** Evaluates the \p within selection method. */
-static void evaluate_within(const gmx::SelMethodEvalContext& /*context*/,
-                            gmx_ana_pos_t*      pos,
-                            gmx_ana_selvalue_t* out,
-                            void*               data);
+static void evaluate_within(const gmx::SelMethodEvalContext& context,
+                            gmx_ana_pos_t*                   pos,
+                            gmx_ana_selvalue_t*              out,
+                            void*                            data);
 
 /** Parameters for the \p distance selection method. */
 static gmx_ana_selparam_t smparams_distance[] = {
@@ -148,6 +200,7 @@ static gmx_ana_selparam_t smparams_mindistance[] = {
 static gmx_ana_selparam_t smparams_within[] = {
     { nullptr, { REAL_VALUE, 1, { nullptr } }, nullptr, 0 },
     { "of", { POS_VALUE, -1, { nullptr } }, nullptr, SPAR_DYNAMIC | SPAR_VARNUM },
+    { "buffer", { REAL_VALUE, 1, { nullptr } }, nullptr, SPAR_OPTIONAL },
 };
 
 //! Help title for distance selection methods.
@@ -158,7 +211,7 @@ static const char* const help_distance[] = {
     "",
     "  distance from POS [cutoff REAL]",
     "  mindistance from POS_EXPR [cutoff REAL]",
-    "  within REAL of POS_EXPR",
+    "  within REAL of POS_EXPR [buffer REAL]",
     "",
     "[TT]distance[tt] and [TT]mindistance[tt] calculate the distance from the",
     "given position(s), the only difference being in that [TT]distance[tt]",
@@ -170,7 +223,14 @@ static const char* const help_distance[] = {
 
     "For the first two keywords, it is possible to specify a cutoff to speed",
     "up the evaluation: all distances above the specified cutoff are",
-    "returned as equal to the cutoff.",
+    "returned as equal to the cutoff.[PAR]",
+
+    "For [TT]within[tt], a buffer can be specified to speed up the",
+    "evaluation for trajectories where the positions move little between",
+    "frames. The positions of [TT]POS_EXPR[tt] within the distance plus",
+    "the buffer are then stored, and only these are checked in later",
+    "frames until the positions have moved more than the buffer allows.",
+    "The selected atoms do not depend on the buffer.",
 };
 
 /** Selection method data for the \p distance method. */
@@ -216,15 +276,15 @@ gmx_ana_selmethod_t sm_within = {
     SMETH_DYNAMIC,
     asize(smparams_within),
     smparams_within,
-    &init_data_common,
+    &init_data_within,
     nullptr,
-    &init_common,
+    &init_within,
     nullptr,
     &free_data_common,
-    &init_frame_common,
+    &init_frame_within,
     nullptr,
     &evaluate_within,
-    { "within REAL of POS_EXPR", helptitle_distance, asize(help_distance), help_distance },
+    { "within REAL of POS_EXPR [buffer REAL]", helptitle_distance, asize(help_distance), help_distance },
 };
 
 static void* init_data_common(int /* npar */, gmx_ana_selparam_t* param)
@@ -235,6 +295,13 @@ static void* init_data_common(int /* npar */, gmx_ana_selparam_t* param)
     return data;
 }
 
+static void* init_data_within(int npar, gmx_ana_selparam_t* param)
+{
+    auto* data       = static_cast<t_methoddata_distance*>(init_data_common(npar, param));
+    param[2].val.u.r = &data->buffer;
+    return data;
+}
+
 static void init_common(const gmx_mtop_t* /* top */, int /* npar */, gmx_ana_selparam_t* param, void* data)
 {
     t_methoddata_distance* d = static_cast<t_methoddata_distance*>(data);
@@ -246,6 +313,21 @@ static void init_common(const gmx_mtop_t* /* top */, int /* npar */, gmx_ana_sel
     d->nb.setCutoff(d->cutoff);
 }
 
+static void init_within(const gmx_mtop_t* top, int npar, gmx_ana_selparam_t* param, void* data)
+{
+    t_methoddata_distance* d = static_cast<t_methoddata_distance*>(data);
+
+    init_common(top, npar, param, data);
+    if ((param[2].flags & SPAR_SET) && d->buffer < 0)
+    {
+        GMX_THROW(gmx::InvalidInputError("Distance buffer should be >= 0"));
+    }
+    if (d->buffer > 0)
+    {
+        d->nbBuffered.setCutoff(d->cutoff + d->buffer);
+    }
+}
+
 /*!
  * \param data Data to free (should point to a \c t_methoddata_distance).
  *
@@ -266,6 +348,20 @@ static void init_frame_common(const gmx::SelMethodEvalContext& context, void* da
     d->nbsearch = d->nb.initSearch(context.pbc, pos);
 }
 
+static void init_frame_within(const gmx::SelMethodEvalContext& context, void* data)
+{
+    t_methoddata_distance* d = static_cast<t_methoddata_distance*>(data);
+
+    if (d->buffer > 0)
+    {
+        d->nbsearch.reset();
+    }
+    else
+    {
+        init_frame_common(context, data);
+    }
+}
+
 /*!
  * See sel_updatefunc_pos() for description of the parameters.
  * \p data should point to a \c t_methoddata_distance.
@@ -287,6 +383,89 @@ static void evaluate_distance(const gmx::SelMethodEvalContext& /*context*/,
     }
 }
 
+/*! \brief
+ * Checks whether the candidate list of \p within can be used for \p pos.
+ *
+ * The list is valid as long as the reference positions are the same as when
+ * it was built, all positions in \p pos are in the list, and the sum of
+ * the largest displacement of the test and the reference positions and
+ * the change in the box vectors is not larger than the buffer.
+ * Then no pair outside the list can have come within the cutoff.
+ */
+static bool isWithinListValid(const gmx::SelMethodEvalContext& context,
+                              const gmx_ana_pos_t&             pos,
+                              const t_methoddata_distance&     d)
+{
+    if (!d.bListValid || d.p.count() != gmx::ssize(d.refIdsAtBuild)
+        || !std::equal(d.refIdsAtBuild.begin(), d.refIdsAtBuild.end(), d.p.m.refid))
+    {
+        return false;
+    }
+    real maxDisplacement2 = 0;
+    for (int i = 0; i < d.p.count(); ++i)
+    {
+        maxDisplacement2 = std::max(maxDisplacement2, distance2(d.p.x[i], d.refXAtBuild[i]));
+    }
+    real maxDisplacement = std::sqrt(maxDisplacement2);
+    maxDisplacement2     = 0;
+    for (int b = 0; b < pos.count(); ++b)
+    {
+        const int id = pos.m.refid[b];
+        if (id < 0 || id >= gmx::ssize(d.testListIndex) || d.testListIndex[id] < 0)
+        {
+            return false;
+        }
+        maxDisplacement2 = std::max(maxDisplacement2, distance2(pos.x[b], d.testXAtBuild[id]));
+    }
+    maxDisplacement += std::sqrt(maxDisplacement2);
+    if (context.pbc != nullptr)
+    {
+        for (int dim = 0; dim < DIM; ++dim)
+        {
+            maxDisplacement += std::sqrt(distance2(context.pbc->box[dim], d.boxAtBuild[dim]));
+        }
+    }
+    return maxDisplacement <= d.buffer;
+}
+
+/*! \brief
+ * Builds the candidate list of \p within for \p pos.
+ *
+ * \returns false if \p pos cannot be stored in the list, in which case the
+ *     list is marked invalid.
+ */
+static bool buildWithinList(const gmx::SelMethodEvalContext& context,
+                            const gmx_ana_pos_t&             pos,
+                            t_methoddata_distance*           d)
+{
+    d->bListValid = false;
+    if (std::any_of(d->p.m.refid, d->p.m.refid + d->p.count(), [](int id) { return id < 0; })
+        || std::any_of(pos.m.refid, pos.m.refid + pos.count(), [](int id) { return id < 0; }))
+    {
+        return false;
+    }
+
+    gmx::AnalysisNeighborhoodSearch search =
+            d->nbBuffered.initSearch(context.pbc, gmx::AnalysisNeighborhoodPositions(d->p.x, d->p.count()));
+    search.findAllPairs(gmx::AnalysisNeighborhoodPositions(pos.x, pos.count()), &d->candidates);
+
+    d->refIdsAtBuild.assign(d->p.m.refid, d->p.m.refid + d->p.count());
+    d->refXAtBuild.assign(d->p.x, d->p.x + d->p.count());
+    d->testListIndex.assign(pos.m.b.nr, -1);
+    d->testXAtBuild.resize(pos.m.b.nr);
+    for (int b = 0; b < pos.count(); ++b)
+    {
+        d->testListIndex[pos.m.refid[b]] = b;
+        copy_rvec(pos.x[b], d->testXAtBuild[pos.m.refid[b]]);
+    }
+    if (context.pbc != nullptr)
+    {
+        copy_mat(context.pbc->box, d->boxAtBuild);
+    }
+    d->bListValid = true;
+    return true;
+}
+
 /*!
  * See sel_updatefunc() for description of the parameters.
  * \p data should point to a \c t_methoddata_distance.
@@ -294,14 +473,45 @@ static void evaluate_distance(const gmx::SelMethodEvalContext& /*context*/,
  * Finds the atoms that are closer than the defined cutoff to
  * \c t_methoddata_distance::xref and puts them in \p out.g.
  */
-static void evaluate_within(const gmx::SelMethodEvalContext& /*context*/,
-                            gmx_ana_pos_t*      pos,
-                            gmx_ana_selvalue_t* out,
-                            void*               data)
+static void evaluate_within(const gmx::SelMethodEvalContext& context,
+                            gmx_ana_pos_t*                   pos,
+                            gmx_ana_selvalue_t*              out,
+                            void*                            data)
 {
     t_methoddata_distance* d = static_cast<t_methoddata_distance*>(data);
 
     out->u.g->isize = 0;
+    if (d->buffer > 0 && (isWithinListValid(context, *pos, *d) || buildWithinList(context, *pos, d)))
+    {
+        // Only the candidates from the buffered list need to be checked.
+        const real cutoff2 = gmx::square(d->cutoff);
+        for (int b = 0; b < pos->count(); ++b)
+        {
+            for (const int i : d->candidates[d->testListIndex[pos->m.refid[b]]])
+            {
+                rvec dx;
+                if (context.pbc != nullptr)
+                {
+                    pbc_dx(context.pbc, d->p.x[i], pos->x[b], dx);
+                }
+                else
+                {
+                    rvec_sub(d->p.x[i], pos->x[b], dx);
+                }
+                if (norm2(dx) <= cutoff2)
+                {
+                    gmx_ana_pos_add_to_group(out->u.g, pos, b);
+                    break;
+                }
+            }
+        }
+        return;
+    }
+    if (d->buffer > 0)
+    {
+        // The positions cannot be used with the list, search this frame.
+        init_frame_common(context, data);
+    }
     for (int b = 0; b < pos->count(); ++b)
     {
         if (d->nbsearch.isWithin(pos->x[b]))
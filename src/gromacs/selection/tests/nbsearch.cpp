@@ -65,6 +65,7 @@
 #include "gromacs/random/threefry.h"
 #include "gromacs/random/uniformrealdistribution.h"
 #include "gromacs/topology/block.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/listoflists.h"
 #include "gromacs/utility/smalloc.h"
 #include "gromacs/utility/stringutil.h"
@@ -407,6 +408,10 @@ public:
                                    const gmx::ArrayRef<const int>&           refIndices,
                                    const gmx::ArrayRef<const int>&           testIndices,
                                    bool                                      selfPairs);
+    static void testAllPairs(gmx::AnalysisNeighborhoodSearch*          search,
+                             const NeighborhoodSearchTestData&         data,
+                             const gmx::AnalysisNeighborhoodPositions& pos,
+                             const gmx::ListOfLists<int>*              excls);
 
     gmx::AnalysisNeighborhood nb_;
 };
@@ -642,6 +647,80 @@ void NeighborhoodSearchTest::testPairSearchFull(gmx::AnalysisNeighborhoodSearch*
     }
 }
 
+void NeighborhoodSearchTest::testAllPairs(gmx::AnalysisNeighborhoodSearch*          search,
+                                          const NeighborhoodSearchTestData&         data,
+                                          const gmx::AnalysisNeighborhoodPositions& pos,
+                                          const gmx::ListOfLists<int>*              excls)
+{
+    gmx::ListOfLists<int>  refIndices;
+    gmx::ListOfLists<real> distances2;
+    search->findAllPairs(pos, &refIndices, &distances2);
+    ASSERT_EQ(data.testPositions_.size(), refIndices.size());
+    ASSERT_EQ(data.testPositions_.size(), distances2.size());
+
+    for (size_t testIndex = 0; testIndex < data.testPositions_.size(); ++testIndex)
+    {
+        RefPairList refPairs = data.testPositions_[testIndex].refPairs;
+        if (excls != nullptr)
+        {
+            ExclusionsHelper::markExcludedPairs(&refPairs, testIndex, excls);
+        }
+        const auto foundRefIndices = refIndices[testIndex];
+        const auto foundDistances2 = distances2[testIndex];
+        ASSERT_EQ(foundRefIndices.size(), foundDistances2.size());
+        for (size_t k = 0; k < foundRefIndices.size(); ++k)
+        {
+            const int                           refIndex = foundRefIndices[k];
+            NeighborhoodSearchTestData::RefPair searchPair(refIndex, std::sqrt(foundDistances2[k]));
+            const auto foundRefPair = std::lower_bound(refPairs.begin(), refPairs.end(), searchPair);
+            if (foundRefPair == refPairs.end() || foundRefPair->refIndex != refIndex)
+            {
+                ADD_FAILURE() << "Expected: Pair (ref: " << refIndex << ", test: " << testIndex
+                              << ") is not within the cutoff.\n"
+                              << "  Actual: It is returned.";
+            }
+            else if (foundRefPair->bExcluded)
+            {
+                ADD_FAILURE() << "Expected: Pair (ref: " << refIndex << ", test: " << testIndex
+                              << ") is excluded from the search.\n"
+                              << "  Actual: It is returned.";
+            }
+            else if (foundRefPair->bFound)
+            {
+                ADD_FAILURE() << "Expected: Pair (ref: " << refIndex << ", test: " << testIndex
+                              << ") is returned only once.\n"
+                              << "  Actual: It is returned multiple times.";
+            }
+            else
+            {
+                foundRefPair->bFound = true;
+                EXPECT_REAL_EQ_TOL(foundRefPair->distance, searchPair.distance, data.relativeTolerance())
+                        << "Distance computed by the neighborhood search does not match.";
+            }
+        }
+        checkAllPairsFound(refPairs, data.refPos_, testIndex, data.testPositions_[testIndex].x);
+    }
+
+    // The pairs for each test position should be in the same order as
+    // returned by the incremental pair search.
+    std::vector<std::vector<int>>       pairSearchRefIndices(data.testPositions_.size());
+    gmx::AnalysisNeighborhoodPairSearch pairSearch = search->startPairSearch(pos);
+    gmx::AnalysisNeighborhoodPair       pair;
+    while (pairSearch.findNextPair(&pair))
+    {
+        pairSearchRefIndices[pair.testIndex()].push_back(pair.refIndex());
+    }
+    for (size_t testIndex = 0; testIndex < data.testPositions_.size(); ++testIndex)
+    {
+        const auto foundRefIndices = refIndices[testIndex];
+        EXPECT_TRUE(std::equal(foundRefIndices.begin(), foundRefIndices.end(),
+                               pairSearchRefIndices[testIndex].begin(),
+                               pairSearchRefIndices[testIndex].end()))
+                << "Pairs for test position " << testIndex
+                << " are not in the order of the incremental pair search.";
+    }
+}
+
 /********************************************************************
  * Test data generation
  */
@@ -873,6 +952,66 @@ private:
     NeighborhoodSearchTestData data_;
 };
 
+class RandomBoxNoPBCOutsideData
+{
+public:
+    static const NeighborhoodSearchTestData& get()
+    {
+        static RandomBoxNoPBCOutsideData singleton;
+        return singleton.data_;
+    }
+
+    RandomBoxNoPBCOutsideData() : data_(12345, 1.0)
+    {
+        data_.box_[XX][XX] = 10.0;
+        data_.box_[YY][YY] = 5.0;
+        data_.box_[ZZ][ZZ] = 7.0;
+        data_.generateRandomRefPositions(1000);
+        // Spread the test positions to twice the size of the box, so that
+        // many of them are outside the grid, also by more than the cutoff.
+        for (int i = 0; i < 100; ++i)
+        {
+            rvec x;
+            copy_rvec(data_.generateRandomPosition(), x);
+            for (int d = 0; d < DIM; ++d)
+            {
+                x[d] = 2 * x[d] - 0.5 * data_.box_[d][d];
+            }
+            data_.addTestPosition(x);
+        }
+        set_pbc(&data_.pbc_, PbcType::No, data_.box_);
+        data_.computeReferences(nullptr);
+    }
+
+private:
+    NeighborhoodSearchTestData data_;
+};
+
+class RandomBoxManyTestPositionsData
+{
+public:
+    static const NeighborhoodSearchTestData& get()
+    {
+        static RandomBoxManyTestPositionsData singleton;
+        return singleton.data_;
+    }
+
+    RandomBoxManyTestPositionsData() : data_(12345, 1.0)
+    {
+        data_.box_[XX][XX] = 10.0;
+        data_.box_[YY][YY] = 5.0;
+        data_.box_[ZZ][ZZ] = 7.0;
+        // Enough test positions for findAllPairs() to use several threads.
+        data_.generateRandomRefPositions(1000);
+        data_.generateRandomTestPositions(5000);
+        set_pbc(&data_.pbc_, PbcType::Xyz, data_.box_);
+        data_.computeReferences(&data_.pbc_);
+    }
+
+private:
+    NeighborhoodSearchTestData data_;
+};
+
 /********************************************************************
  * Actual tests
  */
@@ -890,6 +1029,7 @@ TEST_F(NeighborhoodSearchTest, SimpleSearch)
     testMinimumDistance(&search, data);
     testNearestPoint(&search, data);
     testPairSearch(&search, data);
+    testAllPairs(&search, data, data.testPositions(), nullptr);
 
     search.reset();
     testPairSearchIndexed(&nb_, data, 123);
@@ -924,6 +1064,7 @@ TEST_F(NeighborhoodSearchTest, GridSearchBox)
     testMinimumDistance(&search, data);
     testNearestPoint(&search, data);
     testPairSearch(&search, data);
+    testAllPairs(&search, data, data.testPositions(), nullptr);
 
     search.reset();
     testPairSearchIndexed(&nb_, data, 456);
@@ -939,6 +1080,7 @@ TEST_F(NeighborhoodSearchTest, GridSearchTriclinic)
     ASSERT_EQ(gmx::AnalysisNeighborhood::eSearchMode_Grid, search.mode());
 
     testPairSearch(&search, data);
+    testAllPairs(&search, data, data.testPositions(), nullptr);
 }
 
 TEST_F(NeighborhoodSearchTest, GridSearch2DPBC)
@@ -954,6 +1096,7 @@ TEST_F(NeighborhoodSearchTest, GridSearch2DPBC)
     testMinimumDistance(&search, data);
     testNearestPoint(&search, data);
     testPairSearch(&search, data);
+    testAllPairs(&search, data, data.testPositions(), nullptr);
 }
 
 TEST_F(NeighborhoodSearchTest, GridSearchNoPBC)
@@ -966,6 +1109,22 @@ TEST_F(NeighborhoodSearchTest, GridSearchNoPBC)
     ASSERT_EQ(gmx::AnalysisNeighborhood::eSearchMode_Grid, search.mode());
 
     testPairSearch(&search, data);
+    testAllPairs(&search, data, data.testPositions(), nullptr);
+}
+
+TEST_F(NeighborhoodSearchTest, GridSearchNoPBCOutsideGrid)
+{
+    const NeighborhoodSearchTestData& data = RandomBoxNoPBCOutsideData::get();
+
+    nb_.setCutoff(data.cutoff_);
+    nb_.setMode(gmx::AnalysisNeighborhood::eSearchMode_Grid);
+    gmx::AnalysisNeighborhoodSearch search = nb_.initSearch(&data.pbc_, data.refPositions());
+    ASSERT_EQ(gmx::AnalysisNeighborhood::eSearchMode_Grid, search.mode());
+
+    testMinimumDistance(&search, data);
+    testNearestPoint(&search, data);
+    testPairSearch(&search, data);
+    testAllPairs(&search, data, data.testPositions(), nullptr);
 }
 
 TEST_F(NeighborhoodSearchTest, GridSearchXYBox)
@@ -982,6 +1141,7 @@ TEST_F(NeighborhoodSearchTest, GridSearchXYBox)
     testMinimumDistance(&search, data);
     testNearestPoint(&search, data);
     testPairSearch(&search, data);
+    testAllPairs(&search, data, data.testPositions(), nullptr);
 }
 
 TEST_F(NeighborhoodSearchTest, SimpleSelfPairsSearch)
@@ -1008,6 +1168,61 @@ TEST_F(NeighborhoodSearchTest, GridSelfPairsSearch)
     testPairSearchFull(&search, data, data.testPositions(), nullptr, {}, {}, true);
 }
 
+TEST_F(NeighborhoodSearchTest, AllPairsSearchIsIndependentOfThreadCount)
+{
+    const NeighborhoodSearchTestData& data = RandomBoxManyTestPositionsData::get();
+
+    nb_.setCutoff(data.cutoff_);
+    nb_.setMode(gmx::AnalysisNeighborhood::eSearchMode_Grid);
+    gmx::AnalysisNeighborhoodSearch search = nb_.initSearch(&data.pbc_, data.refPositions());
+    ASSERT_EQ(gmx::AnalysisNeighborhood::eSearchMode_Grid, search.mode());
+
+    // Serial reference: a separate pair search for each test position.
+    gmx::ListOfLists<int>  serialRefIndices;
+    gmx::ListOfLists<real> serialDistances2;
+    for (size_t t = 0; t < data.testPositions_.size(); ++t)
+    {
+        gmx::AnalysisNeighborhoodPairSearch pairSearch = search.startPairSearch(data.testPosition(t));
+        gmx::AnalysisNeighborhoodPair       pair;
+        std::vector<int>                    refIndices;
+        std::vector<real>                   distances2;
+        while (pairSearch.findNextPair(&pair))
+        {
+            refIndices.push_back(pair.refIndex());
+            distances2.push_back(pair.distance2());
+        }
+        serialRefIndices.pushBack(refIndices);
+        serialDistances2.pushBack(distances2);
+    }
+
+    const int maxThreads = gmx_omp_get_max_threads();
+    for (const int numThreads : { 1, 4 })
+    {
+        SCOPED_TRACE(gmx::formatString("With %d OpenMP threads", numThreads));
+        gmx_omp_set_num_threads(numThreads);
+        gmx::ListOfLists<int>  refIndices;
+        gmx::ListOfLists<real> distances2;
+        search.findAllPairs(data.testPositions(), &refIndices, &distances2);
+        ASSERT_EQ(serialRefIndices.size(), refIndices.size());
+        ASSERT_EQ(serialDistances2.size(), distances2.size());
+        for (size_t t = 0; t < refIndices.size(); ++t)
+        {
+            const auto expectedRefIndices = serialRefIndices[t];
+            const auto expectedDistances2 = serialDistances2[t];
+            ASSERT_EQ(expectedRefIndices.size(), refIndices[t].size());
+            ASSERT_EQ(expectedDistances2.size(), distances2[t].size());
+            for (size_t k = 0; k < refIndices[t].size(); ++k)
+            {
+                EXPECT_EQ(expectedRefIndices[k], refIndices[t][k]);
+                EXPECT_REAL_EQ_TOL(expectedDistances2[k], distances2[t][k], data.relativeTolerance());
+            }
+        }
+    }
+    gmx_omp_set_num_threads(maxThreads);
+
+    testAllPairs(&search, data, data.testPositions(), nullptr);
+}
+
 TEST_F(NeighborhoodSearchTest, HandlesConcurrentSearches)
 {
     const NeighborhoodSearchTestData& data = TrivialTestData::get();
@@ -1113,6 +1328,8 @@ TEST_F(NeighborhoodSearchTest, SimpleSearchExclusions)
 
     testPairSearchFull(&search, data, data.testPositions().exclusionIds(helper.testPosIds()),
                        helper.exclusions(), {}, {}, false);
+    testAllPairs(&search, data, data.testPositions().exclusionIds(helper.testPosIds()),
+                 helper.exclusions());
 }
 
 TEST_F(NeighborhoodSearchTest, GridSearchExclusions)
@@ -1131,6 +1348,8 @@ TEST_F(NeighborhoodSearchTest, GridSearchExclusions)
 
     testPairSearchFull(&search, data, data.testPositions().exclusionIds(helper.testPosIds()),
                        helper.exclusions(), {}, {}, false);
+    testAllPairs(&search, data, data.testPositions().exclusionIds(helper.testPosIds()),
+                 helper.exclusions());
 }
 
 } // namespace
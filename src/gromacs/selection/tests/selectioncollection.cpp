@@ -44,6 +44,8 @@
 
 #include "gromacs/selection/selectioncollection.h"
 
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include "gromacs/options/basicoptions.h"
@@ -633,6 +635,48 @@ TEST_F(SelectionCollectionTest, HandlesFramesWithTooSmallAtomSubsets4)
     EXPECT_THROW_GMX(sc_.evaluate(topManager_.frame(), nullptr), gmx::InconsistentInputError);
 }
 
+TEST_F(SelectionCollectionTest, HandlesNegativeWithinBuffer)
+{
+    ASSERT_NO_THROW_GMX(sc_.parseFromString("within 1 of atomnr 1 buffer -0.1"));
+    ASSERT_NO_FATAL_FAILURE(loadTopology("simple.gro"));
+    EXPECT_THROW_GMX(sc_.compile(), gmx::InvalidInputError);
+}
+
+TEST_F(SelectionCollectionTest, HandlesWithinWithBufferedCandidateList)
+{
+    ASSERT_NO_FATAL_FAILURE(loadTopology("simple.gro"));
+    gmx::SelectionCollection bufferedSc;
+    bufferedSc.setReferencePosType("atom");
+    bufferedSc.setOutputPosType("atom");
+    ASSERT_NO_THROW_GMX(bufferedSc.setTopology(topManager_.topology(), -1));
+
+    gmx::SelectionList sel, bufferedSel;
+    ASSERT_NO_THROW_GMX(sel = sc_.parseFromString("within 1.1 of resnr 2"));
+    ASSERT_NO_THROW_GMX(
+            bufferedSel = bufferedSc.parseFromString("within 1.1 of resnr 2 buffer 0.3"));
+    ASSERT_NO_THROW_GMX(sc_.compile());
+    ASSERT_NO_THROW_GMX(bufferedSc.compile());
+
+    // Move the atoms by different amounts such that the candidate list
+    // is both reused and rebuilt.
+    t_trxframe* frame = topManager_.frame();
+    for (int step = 0; step < 10; ++step)
+    {
+        SCOPED_TRACE(gmx::formatString("Frame %d", step));
+        for (int i = 0; i < frame->natoms; ++i)
+        {
+            frame->x[i][XX] += 0.04 * ((i % 3) - 1);
+            frame->x[i][YY] += 0.03 * ((i % 2) - 0.5);
+        }
+        ASSERT_NO_THROW_GMX(sc_.evaluate(frame, nullptr));
+        ASSERT_NO_THROW_GMX(bufferedSc.evaluate(frame, nullptr));
+        gmx::ArrayRef<const int> atoms         = sel[0].atomIndices();
+        gmx::ArrayRef<const int> bufferedAtoms = bufferedSel[0].atomIndices();
+        EXPECT_EQ(std::vector<int>(atoms.begin(), atoms.end()),
+                  std::vector<int>(bufferedAtoms.begin(), bufferedAtoms.end()));
+    }
+}
+
 // TODO: Tests for more evaluation errors
 
 /********************************************************************
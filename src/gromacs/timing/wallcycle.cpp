@@ -146,6 +146,9 @@ static const char* wcn[ewcNR] = { "Run",
                                   "Add rot. forces",
                                   "Position swapping",
                                   "IMD",
+                                  "DD setup",
+                                  "DD setup bondeds",
+                                  "DD init. partition",
                                   "Test" };
 
 static const char* wcsn[ewcsNR] = {
@@ -421,12 +424,37 @@ double wallcycle_stop(gmx_wallcycle_t wc, int ewc)
     return last;
 }
 
+void wallcycle_add_cycles(gmx_wallcycle_t wc, int ewc, double cycles)
+{
+    if (wc == nullptr)
+    {
+        return;
+    }
+    if (cycles >= 0)
+    {
+        wc->wcc[ewc].c += static_cast<gmx_cycles_t>(cycles);
+    }
+    else
+    {
+        wc->haveInvalidCount = TRUE;
+    }
+    wc->wcc[ewc].n++;
+}
+
 void wallcycle_get(gmx_wallcycle_t wc, int ewc, int* n, double* c)
 {
     *n = wc->wcc[ewc].n;
     *c = static_cast<double>(wc->wcc[ewc].c);
 }
 
+/* Counters for the setup before the run, these are not reset
+ * and are reported separately from the run time.
+ */
+static gmx_bool is_startup_counter(int ewc)
+{
+    return (ewc >= ewcDDSETUP && ewc <= ewcDDINITIALPARTITION);
+}
+
 void wallcycle_reset_all(gmx_wallcycle_t wc)
 {
     int i;
@@ -438,6 +466,10 @@ void wallcycle_reset_all(gmx_wallcycle_t wc)
 
     for (i = 0; i < ewcNR; i++)
     {
+        if (is_startup_counter(i))
+        {
+            continue;
+        }
         wc->wcc[i].n = 0;
         wc->wcc[i].c = 0;
     }
@@ -497,7 +529,7 @@ void wallcycle_scale_by_num_threads(gmx_wallcycle_t wc, bool isPmeRank, int nthr
 
     for (int i = 0; i < ewcNR; i++)
     {
-        if (is_pme_counter(i) || (i == ewcRUN && isPmeRank))
+        if (is_pme_counter(i) || ((i == ewcRUN || i == ewcDDSETUP) && isPmeRank))
         {
             wc->wcc[i].c *= nthreads_pme;
 
@@ -859,7 +891,7 @@ void wallcycle_print(FILE*                            fplog,
     fprintf(fplog, "%s\n", hline);
     for (i = ewcPPDURINGPME + 1; i < ewcNR; i++)
     {
-        if (is_pme_subcounter(i))
+        if (is_pme_subcounter(i) || is_startup_counter(i))
         {
             /* Do not count these at all */
         }
@@ -908,6 +940,23 @@ void wallcycle_print(FILE*                            fplog,
                 hline);
     }
 
+    if (wc->wcc[ewcDDSETUP].n > 0)
+    {
+        /* All ranks take part in the setup, so we report the average
+         * over all ranks for the setup, as for the total, and the average
+         * over the PP ranks for the PP-only bonded setup and distribution.
+         */
+        fprintf(fplog, " Domain decomposition setup, not included in the total\n");
+        fprintf(fplog, "%s\n", hline);
+        print_cycles(fplog, c2t, wcn[ewcDDSETUP], nnodes, nth_pp, wc->wcc[ewcDDSETUP].n,
+                     cyc_sum[ewcDDSETUP], tot);
+        for (i = ewcDDSETUP + 1; i <= ewcDDINITIALPARTITION; i++)
+        {
+            print_cycles(fplog, c2t_pp, wcn[i], npp, nth_pp, wc->wcc[i].n, cyc_sum[i], tot);
+        }
+        fprintf(fplog, "%s\n", hline);
+    }
+
     if (wc->wcc[ewcPMEMESH].n > 0)
     {
         // A workaround to not print breakdown when no subcounters were recorded.
@@ -95,6 +95,9 @@ enum
     ewcROTadd,
     ewcSWAP,
     ewcIMD,
+    ewcDDSETUP,
+    ewcDDSETUPBONDEDS,
+    ewcDDINITIALPARTITION,
     ewcTEST,
     ewcNR
 };
@@ -154,6 +157,10 @@ double wallcycle_stop(gmx_wallcycle_t wc, int ewc);
 void wallcycle_increment_event_count(gmx_wallcycle_t wc, int ewc);
 /* Only increment call count for ewc by one */
 
+void wallcycle_add_cycles(gmx_wallcycle_t wc, int ewc, double cycles);
+/* Increment the call count for ewc by one and add cycles that were
+ * counted before the wall cycle structure was set up */
+
 void wallcycle_get(gmx_wallcycle_t wc, int ewc, int* n, double* c);
 /* Returns the cumulative count and cycle count for ewc */
 
@@ -45,9 +45,15 @@
 
 #include "config.h"
 
+#include "gromacs/fileio/oenv.h"
+#include "gromacs/fileio/trxio.h"
+#include "gromacs/trajectory/trajectoryframe.h"
+
 #include "testutils/cmdlinetest.h"
 #include "testutils/simulationdatabase.h"
 #include "testutils/stdiohelper.h"
+#include "testutils/testasserts.h"
+#include "testutils/testfilemanager.h"
 #include "testutils/textblockmatchers.h"
 
 namespace
@@ -134,4 +140,52 @@ TEST_P(TrjconvWithoutTopologyFile, WithDifferentInputFormats)
 INSTANTIATE_TEST_CASE_P(NoFatalErrorWhenWritingFrom,
                         TrjconvWithoutTopologyFile,
                         ::testing::ValuesIn(trajectoryFileNames));
+
+class TrjconvXtcCopy : public gmx::test::CommandLineTestBase
+{
+};
+
+TEST_F(TrjconvXtcCopy, KeepsCoordinatesAndChangesTime)
+{
+    auto&             cmdline    = commandLine();
+    const std::string inputFile  = gmx::test::TestFileManager::getInputFilePath("spc2-traj.xtc");
+    const std::string outputFile = fileManager().getTemporaryFilePath("copy.xtc");
+
+    cmdline.addOption("-f", inputFile);
+    cmdline.addOption("-o", outputFile);
+    cmdline.addOption("-t0", 10.0);
+    ASSERT_EQ(0, gmx_trjconv(cmdline.argc(), cmdline.argv()));
+
+    gmx_output_env_t* oenv;
+    output_env_init_default(&oenv);
+    t_trxstatus* inStatus;
+    t_trxstatus* outStatus;
+    t_trxframe   inFrame, outFrame;
+    ASSERT_TRUE(read_first_frame(oenv, &inStatus, inputFile.c_str(), &inFrame, TRX_NEED_X));
+    ASSERT_TRUE(read_first_frame(oenv, &outStatus, outputFile.c_str(), &outFrame, TRX_NEED_X));
+    const real timeShift = 10 - inFrame.time;
+    bool       bInFrame, bOutFrame;
+    do
+    {
+        ASSERT_EQ(inFrame.natoms, outFrame.natoms);
+        EXPECT_EQ(inFrame.step, outFrame.step);
+        EXPECT_REAL_EQ(inFrame.time + timeShift, outFrame.time);
+        for (int i = 0; i < inFrame.natoms; i++)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                EXPECT_EQ(inFrame.x[i][d], outFrame.x[i][d]);
+            }
+        }
+        bInFrame  = read_next_frame(oenv, inStatus, &inFrame);
+        bOutFrame = read_next_frame(oenv, outStatus, &outFrame);
+        EXPECT_EQ(bInFrame, bOutFrame);
+    } while (bInFrame && bOutFrame);
+    close_trx(inStatus);
+    close_trx(outStatus);
+    done_frame(&inFrame);
+    done_frame(&outFrame);
+    output_env_done(oenv);
+}
+
 } // namespace
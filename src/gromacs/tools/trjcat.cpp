@@ -428,6 +428,8 @@ int gmx_trjcat(int argc, char* argv[])
         "which implies you do not need to store double the amount of data.",
         "Obviously the file to append to has to be the one with lowest starting",
         "time since one can only append at the end of a file.[PAR]",
+        "Without [TT]-n[tt], [REF].xtc[ref] frames are copied without",
+        "decompressing the coordinates.[PAR]",
         "If the [TT]-demux[tt] option is given, the N trajectories that are",
         "read, are written in another order as specified in the [REF].xvg[ref] file.",
         "The [REF].xvg[ref] file should contain something like::",
@@ -639,6 +641,12 @@ int gmx_trjcat(int argc, char* argv[])
         /* Not checking input format, could be dangerous :-) */
         /* Not checking output format, equally dangerous :-) */
 
+        /* Without an index group, xtc frames are copied without
+         * decompressing and recompressing the coordinates.
+         */
+        const bool bCopyCompressed = (ftpin == efXTC && ftpout == efXTC && !bIndex);
+        const int  readFlags       = bCopyCompressed ? (FLAGS | TRX_READ_COMPRESSED_X) : FLAGS;
+
         frame     = -1;
         frame_out = -1;
         /* the default is not to change the time at all,
@@ -813,7 +821,7 @@ int gmx_trjcat(int argc, char* argv[])
             {
                 timestep = timest[i];
             }
-            read_first_frame(oenv, &status, inFilesEdited[i].c_str(), &fr, FLAGS);
+            read_first_frame(oenv, &status, inFilesEdited[i].c_str(), &fr, readFlags);
             if (!fr.bTime)
             {
                 fr.time = 0;
@@ -899,7 +907,11 @@ int gmx_trjcat(int argc, char* argv[])
                             bNewFile = FALSE;
                         }
 
-                        if (bIndex)
+                        if (bCopyCompressed)
+                        {
+                            write_trxframe_compressed(trxout, &frout, status);
+                        }
+                        else if (bIndex)
                         {
                             write_trxframe_indexed(trxout, &frout, isize, index, nullptr);
                         }
@@ -246,6 +246,8 @@ int gmx_trjconv(int argc, char* argv[])
         "input file for [REF].xtc[ref], [REF].gro[ref] and [REF].pdb[ref],",
         "and from the [TT]-ndec[tt] option for other input formats. The precision",
         "is always taken from [TT]-ndec[tt], when this option is set.",
+        "When [REF].xtc[ref] frames are only selected or their times changed,",
+        "the compressed coordinates are copied without decompressing them.",
         "All other formats have fixed precision. [REF].trr[ref]",
         "output can be single or double precision, depending on the precision",
         "of the [THISMODULE] binary.",
@@ -854,8 +856,32 @@ int gmx_trjconv(int argc, char* argv[])
             flags = flags | TRX_READ_F;
         }
 
+        /* When frames are only selected and their times changed, xtc frames
+         * are copied without decompressing and recompressing the coordinates.
+         */
+        bool bCopyCompressed = (ftpin == efXTC && ftp == efXTC && !bSetXtcPrec && !bSetBox
+                                && !bTrans && !bPBC && !bReset && !bCenter
+                                && !opt2parg_bSet("-shift", NPA, pa));
+        for (i = 0; i < nout && bCopyCompressed; i++)
+        {
+            bCopyCompressed = (index[i] == i);
+        }
+        if (bCopyCompressed)
+        {
+            flags = flags | TRX_READ_COMPRESSED_X;
+        }
+
         /* open trx file for reading */
         bHaveFirstFrame = read_first_frame(oenv, &trxin, in_file, &fr, flags);
+        if (bHaveFirstFrame && bCopyCompressed && fr.natoms != nout)
+        {
+            /* Writing a subset of the atoms needs the coordinates */
+            close_trx(trxin);
+            done_frame(&fr);
+            bCopyCompressed = false;
+            flags           = flags & ~TRX_READ_COMPRESSED_X;
+            bHaveFirstFrame = read_first_frame(oenv, &trxin, in_file, &fr, flags);
+        }
         if (fr.bPrec)
         {
             fprintf(stderr, "\nPrecision of %s is %g (nm)\n", in_file, 1 / fr.prec);
@@ -1338,7 +1364,14 @@ int gmx_trjconv(int argc, char* argv[])
                                     }
                                     trxout = open_trx(out_file2, filemode);
                                 }
-                                write_trxframe(trxout, &frout, gc);
+                                if (bCopyCompressed)
+                                {
+                                    write_trxframe_compressed(trxout, &frout, trxin);
+                                }
+                                else
+                                {
+                                    write_trxframe(trxout, &frout, gc);
+                                }
                                 break;
                             case efGRO:
                             case efG96:
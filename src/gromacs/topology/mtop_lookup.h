@@ -62,6 +62,8 @@ struct t_atom;
  * For subsequent calls to this function, e.g. in a loop, pass in the previously
  * returned value for best performance. Atoms in a group tend to be in the same
  * molecule(block), so this minimizes the search time.
+ * When the atom is not in \p moleculeBlock, only the molecule blocks with atoms
+ * in the same page of gmx_mtop_t::moleculeBlockOfAtomPage are searched.
  *
  * \param[in]     mtop                 The molecule topology
  * \param[in]     globalAtomIndex      The global atom index to look up
@@ -88,6 +90,19 @@ static inline void mtopGetMolblockIndex(const gmx_mtop_t* mtop,
     int molBlock0 = -1;
     int molBlock1 = mtop->molblock.size();
 
+    const MoleculeBlockIndices& hintIndices = mtop->moleculeBlockIndices[*moleculeBlock];
+    if ((globalAtomIndex < hintIndices.globalAtomStart || globalAtomIndex >= hintIndices.globalAtomEnd)
+        && !mtop->moleculeBlockOfAtomPage.empty())
+    {
+        /* Restrict the search to the molecule blocks with atoms in the page of the atom */
+        const int page = (globalAtomIndex >> c_moleculeBlockLookupPageShift);
+        GMX_ASSERT(page + 1 < gmx::ssize(mtop->moleculeBlockOfAtomPage),
+                   "The molecule block lookup table should cover all atoms");
+        molBlock0      = mtop->moleculeBlockOfAtomPage[page] - 1;
+        molBlock1      = mtop->moleculeBlockOfAtomPage[page + 1] + 1;
+        *moleculeBlock = mtop->moleculeBlockOfAtomPage[page];
+    }
+
     int globalAtomStart;
     while (TRUE)
     {
@@ -50,6 +50,7 @@
 #include "gromacs/topology/exclusionblocks.h"
 #include "gromacs/topology/idef.h"
 #include "gromacs/topology/ifunc.h"
+#include "gromacs/topology/mtop_lookup.h"
 #include "gromacs/topology/topology.h"
 #include "gromacs/topology/topsort.h"
 #include "gromacs/utility/arrayref.h"
@@ -107,6 +108,25 @@ static void buildMolblockIndices(gmx_mtop_t* mtop)
         indices.moleculeIndexStart = moleculeIndexStart;
         moleculeIndexStart += molb.nmol;
     }
+
+    mtop->moleculeBlockOfAtomPage.clear();
+    if (!mtop->molblock.empty())
+    {
+        const int pageSize = (1 << c_moleculeBlockLookupPageShift);
+        const int numPages = (atomIndex + pageSize - 1) / pageSize;
+        mtop->moleculeBlockOfAtomPage.resize(numPages + 1);
+        int mb = 0;
+        for (int page = 0; page < numPages; page++)
+        {
+            const int firstAtomInPage = page * pageSize;
+            while (firstAtomInPage >= mtop->moleculeBlockIndices[mb].globalAtomEnd)
+            {
+                mb++;
+            }
+            mtop->moleculeBlockOfAtomPage[page] = mb;
+        }
+        mtop->moleculeBlockOfAtomPage[numPages] = mtop->molblock.size() - 1;
+    }
 }
 
 void gmx_mtop_finalize(gmx_mtop_t* mtop)
@@ -199,8 +219,24 @@ AtomIterator::AtomIterator(const gmx_mtop_t& mtop, int globalAtomNumber) :
     localAtomNumber_(0),
     globalAtomNumber_(globalAtomNumber)
 {
-    GMX_ASSERT(globalAtomNumber == 0 || globalAtomNumber == mtop.natoms,
-               "Starting at other atoms not implemented yet");
+    GMX_ASSERT(globalAtomNumber >= 0 && globalAtomNumber <= mtop.natoms,
+               "The starting atom should be within range");
+    if (globalAtomNumber > 0 && globalAtomNumber < mtop.natoms)
+    {
+        int mb = 0;
+        mtopGetMolblockIndex(&mtop, globalAtomNumber, &mb, &currentMolecule_, &localAtomNumber_);
+        mblock_ = mb;
+        atoms_  = &mtop.moltype[mtop.molblock[mblock_].type].atoms;
+        /* Count the residue numbers as operator++() would have done */
+        for (int b = 0; b <= mb; b++)
+        {
+            const int nres = mtop.moltype[mtop.molblock[b].type].atoms.nres;
+            if (nres <= mtop.maxresnr)
+            {
+                highestResidueNumber_ += (b < mb ? mtop.molblock[b].nmol : currentMolecule_) * nres;
+            }
+        }
+    }
 }
 
 AtomIterator& AtomIterator::operator++()
@@ -124,7 +124,7 @@ private:
 class AtomIterator
 {
 public:
-    //! Construct from topology and optionalally a global atom number.
+    //! Construct from topology and optionally a global atom number.
     explicit AtomIterator(const gmx_mtop_t& mtop, int globalAtomNumber = 0);
 
     //! Prefix increment.
@@ -161,12 +161,22 @@ private:
     friend class AtomProxy;
 };
 
-//! Range over all atoms of topology.
+//! Range over all atoms of topology, or a range of global atom indices.
 class AtomRange
 {
 public:
     //! Default constructor.
     explicit AtomRange(const gmx_mtop_t& mtop) : begin_(mtop), end_(mtop, mtop.natoms) {}
+    /*! \brief Constructs a range over global atoms \p globalAtomBegin up to \p globalAtomEnd
+     *
+     * Only the start of the range is looked up, iterating over the atoms
+     * in the range then takes constant time per atom.
+     */
+    AtomRange(const gmx_mtop_t& mtop, int globalAtomBegin, int globalAtomEnd) :
+        begin_(mtop, globalAtomBegin),
+        end_(mtop, globalAtomEnd)
+    {
+    }
     //! Iterator to begin of range.
     AtomIterator& begin() { return begin_; }
     //! Iterator to end of range.
@@ -38,12 +38,14 @@
 #include "residuetypes.h"
 
 #include <cassert>
+#include <cctype>
 #include <cstdio>
 
 #include <algorithm>
 #include <iterator>
 #include <optional>
 #include <string>
+#include <unordered_map>
 
 #include "gromacs/utility/arrayref.h"
 #include "gromacs/utility/cstringutil.h"
@@ -70,12 +72,22 @@ struct ResidueTypeEntry
     std::string residueType;
 };
 
+//! Returns the key under which \p residueName is indexed, so lookups ignore case.
+static std::string residueNameKey(const std::string& residueName)
+{
+    std::string key(residueName);
+    std::transform(key.begin(), key.end(), key.begin(), [](char c) { return std::tolower(c); });
+    return key;
+}
+
 //! Implementation detail for ResidueTypes
 class ResidueType::Impl
 {
 public:
     //! Storage object for entries.
     std::vector<ResidueTypeEntry> entry;
+    //! Index of the entry for each case-folded residue name.
+    std::unordered_map<std::string, int> entryIndex;
 };
 
 ResidueType::ResidueType() : impl_(new Impl)
@@ -108,27 +120,28 @@ ResidueType::~ResidueType() {}
  * Return an optional const iterator to a residue entry that matches the given name.
  *
  * \param[in] entries Currently registered residue entries in the database.
+ * \param[in] entryIndex Index of the entries by case-folded residue name.
  * \param[in] residueName Name of a residue to compare to database.
  * \returns An optional iterator to the residue entry that was found.
  */
 static std::optional<gmx::ArrayRef<const ResidueTypeEntry>::const_iterator>
-findResidueEntryWithName(gmx::ArrayRef<const ResidueTypeEntry> entries, const std::string& residueName)
+findResidueEntryWithName(gmx::ArrayRef<const ResidueTypeEntry>       entries,
+                         const std::unordered_map<std::string, int>& entryIndex,
+                         const std::string&                          residueName)
 {
-    auto foundIt =
-            std::find_if(entries.begin(), entries.end(), [&residueName](const ResidueTypeEntry& old) {
-                return gmx::equalCaseInsensitive(residueName, old.residueName);
-            });
-    return (foundIt != entries.end()) ? std::make_optional(foundIt) : std::nullopt;
+    auto foundIt = entryIndex.find(residueNameKey(residueName));
+    return (foundIt != entryIndex.end()) ? std::make_optional(entries.begin() + foundIt->second)
+                                         : std::nullopt;
 }
 
 bool ResidueType::nameIndexedInResidueTypes(const std::string& residueName)
 {
-    return findResidueEntryWithName(impl_->entry, residueName).has_value();
+    return findResidueEntryWithName(impl_->entry, impl_->entryIndex, residueName).has_value();
 }
 
 void ResidueType::addResidue(const std::string& residueName, const std::string& residueType)
 {
-    if (auto foundIt = findResidueEntryWithName(impl_->entry, residueName))
+    if (auto foundIt = findResidueEntryWithName(impl_->entry, impl_->entryIndex, residueName))
     {
         if (!gmx::equalCaseInsensitive((*foundIt)->residueType, residueType))
         {
@@ -140,13 +153,14 @@ void ResidueType::addResidue(const std::string& residueName, const std::string&
     }
     else
     {
+        impl_->entryIndex.emplace(residueNameKey(residueName), impl_->entry.size());
         impl_->entry.emplace_back(residueName, residueType);
     }
 }
 
 bool ResidueType::namedResidueHasType(const std::string& residueName, const std::string& residueType)
 {
-    auto foundIt = findResidueEntryWithName(impl_->entry, residueName);
+    auto foundIt = findResidueEntryWithName(impl_->entry, impl_->entryIndex, residueName);
     return foundIt ? gmx::equalCaseInsensitive(residueType, (*foundIt)->residueType) : false;
 }
 
@@ -157,9 +171,8 @@ int ResidueType::numberOfEntries() const
 
 int ResidueType::indexFromResidueName(const std::string& residueName) const
 {
-    gmx::ArrayRef<const ResidueTypeEntry> temp(impl_->entry);
-    auto                                  foundIt = findResidueEntryWithName(temp, residueName);
-    return foundIt ? std::distance(temp.begin(), *foundIt) : -1;
+    auto foundIt = impl_->entryIndex.find(residueNameKey(residueName));
+    return (foundIt != impl_->entryIndex.end()) ? foundIt->second : -1;
 }
 
 std::string ResidueType::nameFromResidueIndex(int index) const
@@ -176,12 +189,12 @@ std::string ResidueType::nameFromResidueIndex(int index) const
 
 std::string ResidueType::typeOfNamedDatabaseResidue(const std::string& residueName)
 {
-    auto foundIt = findResidueEntryWithName(impl_->entry, residueName);
+    auto foundIt = findResidueEntryWithName(impl_->entry, impl_->entryIndex, residueName);
     return foundIt ? (*foundIt)->residueType : c_undefinedResidueType;
 }
 
 std::optional<std::string> ResidueType::optionalTypeOfNamedDatabaseResidue(const std::string& residueName)
 {
-    auto foundIt = findResidueEntryWithName(impl_->entry, residueName);
+    auto foundIt = findResidueEntryWithName(impl_->entry, impl_->entryIndex, residueName);
     return foundIt ? std::make_optional((*foundIt)->residueType) : std::nullopt;
 }
@@ -43,6 +43,7 @@
 
 #include <gtest/gtest.h>
 
+#include "gromacs/topology/mtop_lookup.h"
 #include "gromacs/topology/mtop_util.h"
 #include "gromacs/utility/basedefinitions.h"
 
@@ -119,6 +120,57 @@ TEST(MtopTest, RangeBasedLoop)
     EXPECT_EQ(count, 9);
 }
 
+TEST(MtopTest, RangeBasedLoopOverAtomRange)
+{
+    gmx_mtop_t mtop;
+    createBasicTop(&mtop);
+    int count = 4;
+    for (const AtomProxy atomP : AtomRange(mtop, 4, 8))
+    {
+        EXPECT_EQ(atomP.globalAtomNumber(), count);
+        EXPECT_EQ(atomP.atomNumberInMol(), count % 3);
+        ++count;
+    }
+    EXPECT_EQ(count, 8);
+}
+
+TEST(MtopTest, FindsMoleculeBlocksOfAtomsWithManyBlocks)
+{
+    gmx_mtop_t mtop;
+    for (int numAtoms : { 1, 3, 7 })
+    {
+        mtop.moltype.emplace_back().atoms.nr = numAtoms;
+    }
+    const int numBlocks = 600;
+    mtop.molblock.resize(numBlocks);
+    std::vector<int> molblockOfAtom;
+    for (int mb = 0; mb < numBlocks; mb++)
+    {
+        mtop.molblock[mb].type = mb % 3;
+        // Include empty blocks
+        mtop.molblock[mb].nmol = mb % 5;
+        const int numAtoms     = mtop.molblock[mb].nmol * mtop.moltype[mb % 3].atoms.nr;
+        molblockOfAtom.insert(molblockOfAtom.end(), numAtoms, mb);
+    }
+    mtop.natoms = molblockOfAtom.size();
+    gmx_mtop_finalize(&mtop);
+    ASSERT_GT(mtop.natoms, 2 << c_moleculeBlockLookupPageShift);
+
+    int molblock = 0;
+    for (int a = 0; a < mtop.natoms; a++)
+    {
+        // Use a stride to have a hint that is often wrong
+        const int atom = (a * 617) % mtop.natoms;
+        int       moleculeIndex;
+        int       atomIndexInMolecule;
+        mtopGetMolblockIndex(&mtop, atom, &molblock, &moleculeIndex, &atomIndexInMolecule);
+        ASSERT_EQ(molblock, molblockOfAtom[atom]);
+        const MoleculeBlockIndices& indices = mtop.moleculeBlockIndices[molblock];
+        EXPECT_EQ(indices.globalAtomStart + moleculeIndex * indices.numAtomsPerMolecule + atomIndexInMolecule,
+                  atom);
+    }
+}
+
 TEST(MtopTest, Operators)
 {
     gmx_mtop_t mtop;
@@ -111,6 +111,12 @@ struct MoleculeBlockIndices
     int moleculeIndexStart; /**< Global molecule indexing starts from this value */
 };
 
+/*! \brief The log2 of the number of global atoms per page in gmx_mtop_t::moleculeBlockOfAtomPage
+ *
+ * With 1024 atoms per page, the lookup table uses 4 bytes per 1024 atoms.
+ */
+static constexpr int c_moleculeBlockLookupPageShift = 10;
+
 /*! \brief Contains the simulation atom groups.
  *
  * Organized as containers for the different
@@ -197,6 +203,13 @@ struct gmx_mtop_t //NOLINT(clang-analyzer-optin.performance.Padding)
     /* Derived data  below */
     //! Indices for each molblock entry for fast lookup of atom properties
     std::vector<MoleculeBlockIndices> moleculeBlockIndices;
+    /*! \brief For each page of 2^c_moleculeBlockLookupPageShift global atoms, the molblock
+     * index of the first atom in the page, followed by the index of the last molblock
+     *
+     * Limits the search for the molblock of a global atom index to the molblocks
+     * with atoms in the same page, so lookups do not depend on the number of molblocks.
+     */
+    std::vector<int> moleculeBlockOfAtomPage;
 };
 
 /*! \brief
@@ -0,0 +1,547 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Implements gmx::analysismodules::Hbond.
+ *
+ * \ingroup module_trajectoryanalysis
+ */
+#include "gmxpre.h"
+
+#include "hbond.h"
+
+#include <cmath>
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gromacs/analysisdata/analysisdata.h"
+#include "gromacs/analysisdata/modules/average.h"
+#include "gromacs/analysisdata/modules/plot.h"
+#include "gromacs/math/units.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/options/basicoptions.h"
+#include "gromacs/options/filenameoption.h"
+#include "gromacs/options/ioptionscontainer.h"
+#include "gromacs/pbcutil/pbc.h"
+#include "gromacs/selection/nbsearch.h"
+#include "gromacs/selection/selection.h"
+#include "gromacs/selection/selectionoption.h"
+#include "gromacs/topology/ifunc.h"
+#include "gromacs/topology/topology.h"
+#include "gromacs/trajectory/trajectoryframe.h"
+#include "gromacs/trajectoryanalysis/analysissettings.h"
+#include "gromacs/trajectoryanalysis/topologyinformation.h"
+#include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/gmxomp.h"
+#include "gromacs/utility/listoflists.h"
+
+#include "hbondexistence.h"
+
+namespace gmx
+{
+
+namespace analysismodules
+{
+
+
+namespace
+{
+
+/********************************************************************
+ * Hbond
+ */
+
+/*! \brief
+ * Donors, their hydrogens, and acceptors within a selection.
+ *
+ * All indices are global atom indices.
+ */
+struct DonorsAndAcceptors
+{
+    //! Donor atoms.
+    std::vector<int> donors;
+    //! Hydrogens bonded to each donor.
+    ListOfLists<int> hydrogens;
+    //! Acceptor atoms.
+    std::vector<int> acceptors;
+};
+
+/*! \brief
+ * Finds donors and acceptors within a selection from the topology.
+ *
+ * Acceptors are oxygens (and nitrogens if \p bNitrogenAcceptors), donors are
+ * oxygens and nitrogens with a chemically bonded (or settled) hydrogen in
+ * the selection.  Elements are determined from the first character of the
+ * atom name.
+ */
+DonorsAndAcceptors findDonorsAndAcceptors(const Selection&      sel,
+                                          const gmx_localtop_t& top,
+                                          const t_atoms&        atoms,
+                                          bool                  bNitrogenAcceptors)
+{
+    std::vector<bool> inSelection(atoms.nr, false);
+    for (const int atom : sel.atomIndices())
+    {
+        inSelection[atom] = true;
+    }
+    auto isDonorElement = [&atoms](int atom) {
+        const char element = (*atoms.atomname[atom])[0];
+        return element == 'O' || element == 'N';
+    };
+    auto isHydrogen = [&atoms](int atom) { return (*atoms.atomname[atom])[0] == 'H'; };
+
+    // Collect (donor, hydrogen) pairs from the bonds.
+    std::vector<std::pair<int, int>> donorHydrogens;
+    for (int ftype = 0; ftype < F_NRE; ++ftype)
+    {
+        const InteractionList& il = top.idef.il[ftype];
+        if (ftype == F_SETTLE)
+        {
+            for (int i = 0; i < il.size(); i += 1 + NRAL(ftype))
+            {
+                const int oxygen = il.iatoms[i + 1];
+                for (int h = 2; h <= 3; ++h)
+                {
+                    const int hydrogen = il.iatoms[i + h];
+                    if (inSelection[oxygen] && inSelection[hydrogen])
+                    {
+                        donorHydrogens.emplace_back(oxygen, hydrogen);
+                    }
+                }
+            }
+        }
+        else if (IS_CHEMBOND(ftype))
+        {
+            for (int i = 0; i < il.size(); i += 1 + NRAL(ftype))
+            {
+                for (int j = 0; j < 2; ++j)
+                {
+                    const int hydrogen = il.iatoms[i + 1 + j];
+                    const int donor    = il.iatoms[i + 2 - j];
+                    if (isHydrogen(hydrogen) && isDonorElement(donor) && inSelection[hydrogen]
+                        && inSelection[donor])
+                    {
+                        donorHydrogens.emplace_back(donor, hydrogen);
+                    }
+                }
+            }
+        }
+    }
+    std::sort(donorHydrogens.begin(), donorHydrogens.end());
+    donorHydrogens.erase(std::unique(donorHydrogens.begin(), donorHydrogens.end()),
+                         donorHydrogens.end());
+
+    DonorsAndAcceptors result;
+    std::vector<int>   hydrogens;
+    for (size_t i = 0; i < donorHydrogens.size(); ++i)
+    {
+        hydrogens.push_back(donorHydrogens[i].second);
+        if (i + 1 == donorHydrogens.size()
+            || donorHydrogens[i + 1].first != donorHydrogens[i].first)
+        {
+            result.donors.push_back(donorHydrogens[i].first);
+            result.hydrogens.pushBack(hydrogens);
+            hydrogens.clear();
+        }
+    }
+    for (const int atom : sel.atomIndices())
+    {
+        const char element = (*atoms.atomname[atom])[0];
+        if (element == 'O' || (bNitrogenAcceptors && element == 'N'))
+        {
+            result.acceptors.push_back(atom);
+        }
+    }
+    return result;
+}
+
+class Hbond : public TrajectoryAnalysisModule
+{
+public:
+    Hbond();
+
+    void initOptions(IOptionsContainer* options, TrajectoryAnalysisSettings* settings) override;
+    void initAnalysis(const TrajectoryAnalysisSettings& settings,
+                      const TopologyInformation&        top) override;
+
+    void analyzeFrame(int                           frnr,
+                      const t_trxframe&             fr,
+                      t_pbc*                        pbc,
+                      TrajectoryAnalysisModuleData* pdata) override;
+
+    void finishAnalysis(int nframes) override;
+    void writeOutput() override;
+
+private:
+    /*! \brief
+     * Finds hydrogen bonds with donors in \p donors and acceptors in \p acceptors.
+     *
+     * Appends (hydrogen, acceptor) pairs to \p bonds.
+     */
+    void findBonds(const t_trxframe&                 fr,
+                   const t_pbc*                      pbc,
+                   const DonorsAndAcceptors&         donors,
+                   const DonorsAndAcceptors&         acceptors,
+                   std::vector<std::pair<int, int>>* bonds);
+
+    Selection   sel_;
+    Selection   refSel_;
+    std::string fnNumber_;
+    std::string fnLifetime_;
+    std::string fnAutocorrelation_;
+    double      cutoff_;
+    double      angleCutoff_;
+    int         maxLag_;
+    bool        bNitrogenAcceptors_;
+
+    std::vector<DonorsAndAcceptors> groups_;
+    AnalysisNeighborhood            nb_;
+
+    //! (hydrogen, acceptor) atom index pairs of the hydrogen bonds, one point set per bond.
+    AnalysisData                     bonds_;
+    AnalysisData                     bondCount_;
+    AnalysisDataAverageModulePointer averageModule_;
+    HydrogenBondExistencePointer     existence_;
+
+    // Copy and assign disallowed by base.
+};
+
+Hbond::Hbond() :
+    cutoff_(0.35),
+    angleCutoff_(30.0),
+    maxLag_(1000),
+    bNitrogenAcceptors_(true),
+    averageModule_(std::make_unique<AnalysisDataAverageModule>()),
+    existence_(std::make_shared<HydrogenBondExistence>())
+{
+    bonds_.addModule(existence_);
+    bondCount_.addModule(averageModule_);
+
+    registerAnalysisDataset(&bonds_, "hbonds");
+    registerAnalysisDataset(&bondCount_, "hbnum");
+    registerBasicDataset(&existence_->lifetimes(), "lifetime");
+    registerBasicDataset(&existence_->autocorrelation(), "autocorr");
+}
+
+
+void Hbond::initOptions(IOptionsContainer* options, TrajectoryAnalysisSettings* settings)
+{
+    static const char* const desc[] = {
+        "[THISMODULE] computes hydrogen bonds between donors and acceptors",
+        "as a function of time, and analyzes their lifetimes.[PAR]",
+        "Donors and acceptors are determined from [TT]-sel[tt] (and",
+        "[TT]-ref[tt]). Oxygens, and unless [TT]-nonitacc[tt] is given, also",
+        "nitrogens are acceptors. Oxygens and nitrogens that are bonded to a",
+        "hydrogen in the same selection are donors. Without [TT]-ref[tt],",
+        "hydrogen bonds within [TT]-sel[tt] are analyzed; with [TT]-ref[tt],",
+        "hydrogen bonds between the two selections are analyzed.[PAR]",
+        "A hydrogen bond exists when the donor-acceptor distance is at most",
+        "[TT]-r[tt] and the hydrogen-donor-acceptor angle is at most",
+        "[TT]-a[tt].[PAR]",
+        "[TT]-num[tt] writes the number of hydrogen bonds as a function of",
+        "time.",
+        "[TT]-life[tt] writes the distribution of continuous lifetimes of the",
+        "hydrogen bonds.",
+        "[TT]-ac[tt] writes the autocorrelation of the existence function of",
+        "the hydrogen bonds, averaged over all bonds, up to a lag of",
+        "[TT]-acmax[tt] frames.[PAR]",
+        "The memory use grows with the number of different hydrogen bonds",
+        "seen and with [TT]-acmax[tt], but not with the number of frames."
+    };
+
+    settings->setHelpText(desc);
+
+    options->addOption(FileNameOption("num")
+                               .filetype(eftPlot)
+                               .outputFile()
+                               .store(&fnNumber_)
+                               .defaultBasename("hbnum")
+                               .description("Number of hydrogen bonds as function of time"));
+    options->addOption(FileNameOption("life")
+                               .filetype(eftPlot)
+                               .outputFile()
+                               .store(&fnLifetime_)
+                               .defaultBasename("hblife")
+                               .description("Distribution of hydrogen bond lifetimes"));
+    options->addOption(FileNameOption("ac")
+                               .filetype(eftPlot)
+                               .outputFile()
+                               .store(&fnAutocorrelation_)
+                               .defaultBasename("hbac")
+                               .description("Hydrogen bond existence autocorrelation"));
+    options->addOption(SelectionOption("sel")
+                               .store(&sel_)
+                               .required()
+                               .onlyAtoms()
+                               .onlyStatic()
+                               .description("Atoms to analyze hydrogen bonds for"));
+    options->addOption(SelectionOption("ref")
+                               .store(&refSel_)
+                               .onlyAtoms()
+                               .onlyStatic()
+                               .description(
+                                       "Atoms to analyze hydrogen bonds with [TT]-sel[tt] for"));
+    options->addOption(DoubleOption("r").store(&cutoff_).description(
+            "Cutoff for the donor-acceptor distance (nm)"));
+    options->addOption(DoubleOption("a").store(&angleCutoff_).description(
+            "Cutoff for the hydrogen-donor-acceptor angle (degrees)"));
+    options->addOption(BooleanOption("nitacc").store(&bNitrogenAcceptors_).description(
+            "Regard nitrogen atoms as acceptors"));
+    options->addOption(IntegerOption("acmax").store(&maxLag_).description(
+            "Maximum lag for the autocorrelation (frames)"));
+
+    settings->setFlag(TrajectoryAnalysisSettings::efRequireTop);
+}
+
+
+void Hbond::initAnalysis(const TrajectoryAnalysisSettings& settings, const TopologyInformation& top)
+{
+    if (cutoff_ <= 0)
+    {
+        GMX_THROW(InvalidInputError("Distance cutoff should be positive"));
+    }
+    if (maxLag_ <= 0)
+    {
+        GMX_THROW(InvalidInputError("Maximum autocorrelation lag should be positive"));
+    }
+
+    // The bond data passes the atom indices as real values, which represent
+    // integers exactly up to 2/epsilon.
+    if (top.atoms()->nr > 2.0 / std::numeric_limits<real>::epsilon())
+    {
+        GMX_THROW(InconsistentInputError(
+                "Too many atoms for hydrogen bond analysis in this precision"));
+    }
+
+    const gmx_localtop_t* localTop = top.expandedTopology();
+    groups_.push_back(findDonorsAndAcceptors(sel_, *localTop, *top.atoms(), bNitrogenAcceptors_));
+    if (refSel_.isValid())
+    {
+        groups_.push_back(
+                findDonorsAndAcceptors(refSel_, *localTop, *top.atoms(), bNitrogenAcceptors_));
+    }
+    nb_.setCutoff(cutoff_);
+
+    bonds_.setMultipoint(true);
+    bonds_.setColumnCount(0, 2);
+    bondCount_.setColumnCount(0, 1);
+    existence_->setMaxLag(maxLag_);
+
+    if (!fnNumber_.empty())
+    {
+        AnalysisDataPlotModulePointer plotm(new AnalysisDataPlotModule(settings.plotSettings()));
+        plotm->setFileName(fnNumber_);
+        plotm->setTitle("Hydrogen bonds");
+        plotm->setXAxisIsTime();
+        plotm->setYLabel("Number");
+        bondCount_.addModule(plotm);
+    }
+
+    if (!fnLifetime_.empty())
+    {
+        AnalysisDataPlotModulePointer plotm(new AnalysisDataPlotModule(settings.plotSettings()));
+        plotm->setFileName(fnLifetime_);
+        plotm->setTitle("Hydrogen bond lifetime distribution");
+        plotm->setXAxisIsTime();
+        plotm->setYLabel("Probability");
+        existence_->lifetimes().addModule(plotm);
+    }
+
+    if (!fnAutocorrelation_.empty())
+    {
+        AnalysisDataPlotModulePointer plotm(new AnalysisDataPlotModule(settings.plotSettings()));
+        plotm->setFileName(fnAutocorrelation_);
+        plotm->setTitle("Hydrogen bond existence autocorrelation");
+        plotm->setXAxisIsTime();
+        plotm->setYLabel("C(t)");
+        existence_->autocorrelation().addModule(plotm);
+    }
+}
+
+
+void Hbond::findBonds(const t_trxframe&                 fr,
+                      const t_pbc*                      pbc,
+                      const DonorsAndAcceptors&         donors,
+                      const DonorsAndAcceptors&         acceptors,
+                      std::vector<std::pair<int, int>>* bonds)
+{
+    if (donors.donors.empty() || acceptors.acceptors.empty())
+    {
+        return;
+    }
+    AnalysisNeighborhoodPositions acceptorPos(fr.x, fr.natoms);
+    acceptorPos.indexed(acceptors.acceptors);
+    AnalysisNeighborhoodPositions donorPos(fr.x, fr.natoms);
+    donorPos.indexed(donors.donors);
+    AnalysisNeighborhoodSearch nbsearch = nb_.initSearch(pbc, acceptorPos);
+    ListOfLists<int>           candidates;
+    nbsearch.findAllPairs(donorPos, &candidates);
+
+    const real cosAngleCutoff = std::cos(angleCutoff_ * DEG2RAD);
+    const int  donorCount     = gmx::ssize(donors.donors);
+    const int  numThreads     = std::max(1, std::min(gmx_omp_get_max_threads(), donorCount / 64));
+
+    std::vector<std::vector<std::pair<int, int>>> threadBonds(numThreads);
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (int th = 0; th < numThreads; ++th)
+    {
+        try
+        {
+            const int donorStart = (donorCount * (th + 0)) / numThreads;
+            const int donorEnd   = (donorCount * (th + 1)) / numThreads;
+            for (int d = donorStart; d < donorEnd; ++d)
+            {
+                const int donor = donors.donors[d];
+                for (const int a : candidates[d])
+                {
+                    const int acceptor = acceptors.acceptors[a];
+                    if (acceptor == donor)
+                    {
+                        continue;
+                    }
+                    rvec dxDA;
+                    if (pbc != nullptr)
+                    {
+                        pbc_dx(pbc, fr.x[acceptor], fr.x[donor], dxDA);
+                    }
+                    else
+                    {
+                        rvec_sub(fr.x[acceptor], fr.x[donor], dxDA);
+                    }
+                    const real invDistanceDA = gmx::invsqrt(norm2(dxDA));
+                    for (const int hydrogen : donors.hydrogens[d])
+                    {
+                        rvec dxDH;
+                        if (pbc != nullptr)
+                        {
+                            pbc_dx(pbc, fr.x[hydrogen], fr.x[donor], dxDH);
+                        }
+                        else
+                        {
+                            rvec_sub(fr.x[hydrogen], fr.x[donor], dxDH);
+                        }
+                        const real cosAngle =
+                                iprod(dxDA, dxDH) * invDistanceDA * gmx::invsqrt(norm2(dxDH));
+                        if (cosAngle >= cosAngleCutoff)
+                        {
+                            threadBonds[th].emplace_back(hydrogen, acceptor);
+                        }
+                    }
+                }
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+    for (const auto& threadBond : threadBonds)
+    {
+        bonds->insert(bonds->end(), threadBond.begin(), threadBond.end());
+    }
+}
+
+
+void Hbond::analyzeFrame(int frnr, const t_trxframe& fr, t_pbc* pbc, TrajectoryAnalysisModuleData* pdata)
+{
+    AnalysisDataHandle bondHandle  = pdata->dataHandle(bonds_);
+    AnalysisDataHandle countHandle = pdata->dataHandle(bondCount_);
+
+    std::vector<std::pair<int, int>> bonds;
+    if (groups_.size() == 1)
+    {
+        findBonds(fr, pbc, groups_[0], groups_[0], &bonds);
+    }
+    else
+    {
+        findBonds(fr, pbc, groups_[0], groups_[1], &bonds);
+        findBonds(fr, pbc, groups_[1], groups_[0], &bonds);
+    }
+    // Bonds can be found twice if the selections overlap.
+    std::sort(bonds.begin(), bonds.end());
+    bonds.erase(std::unique(bonds.begin(), bonds.end()), bonds.end());
+
+    // The data framework passes the frames in order to existence_, which
+    // accumulates the lifetimes and the autocorrelation.
+    bondHandle.startFrame(frnr, fr.time);
+    for (const auto& bond : bonds)
+    {
+        bondHandle.setPoint(0, bond.first);
+        bondHandle.setPoint(1, bond.second);
+        bondHandle.finishPointSet();
+    }
+    bondHandle.finishFrame();
+
+    countHandle.startFrame(frnr, fr.time);
+    countHandle.setPoint(0, bonds.size());
+    countHandle.finishFrame();
+}
+
+
+void Hbond::finishAnalysis(int /*nframes*/) {}
+
+
+void Hbond::writeOutput()
+{
+    const char* refName = refSel_.isValid() ? refSel_.name() : sel_.name();
+    printf("Hydrogen bonds between '%s' and '%s':\n", sel_.name(), refName);
+    for (size_t g = 0; g < groups_.size(); ++g)
+    {
+        const Selection& sel = (g == 0) ? sel_ : refSel_;
+        printf("  '%s': %d donors, %d acceptors\n", sel.name(),
+               static_cast<int>(groups_[g].donors.size()),
+               static_cast<int>(groups_[g].acceptors.size()));
+    }
+    printf("  Average number of hydrogen bonds: %.3f\n", averageModule_->average(0, 0));
+    printf("  Different hydrogen bonds:         %d\n", existence_->bondCount());
+    printf("  Average continuous lifetime:      %.3f\n", existence_->averageLifetime());
+}
+
+} // namespace
+
+const char HbondInfo::name[] = "hbond-analysis";
+const char HbondInfo::shortDescription[] =
+        "Analyze hydrogen bond numbers and lifetimes for selections";
+
+TrajectoryAnalysisModulePointer HbondInfo::create()
+{
+    return TrajectoryAnalysisModulePointer(new Hbond);
+}
+
+} // namespace analysismodules
+
+} // namespace gmx
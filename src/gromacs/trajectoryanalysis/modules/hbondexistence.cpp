@@ -0,0 +1,219 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Implements gmx::analysismodules::HydrogenBondExistence.
+ *
+ * \ingroup module_trajectoryanalysis
+ */
+#include "gmxpre.h"
+
+#include "hbondexistence.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "gromacs/analysisdata/dataframe.h"
+#include "gromacs/utility/gmxassert.h"
+
+namespace gmx
+{
+
+namespace analysismodules
+{
+
+HydrogenBondExistence::HydrogenBondExistence() :
+    maxLag_(1),
+    wordsPerBond_(1),
+    firstx_(0.0),
+    lastx_(0.0),
+    frameCount_(0),
+    correlation_(1, 0.0),
+    averageLifetime_(0.0)
+{
+}
+
+void HydrogenBondExistence::setMaxLag(int maxLag)
+{
+    GMX_RELEASE_ASSERT(maxLag > 0, "Maximum lag must be positive");
+    maxLag_       = maxLag;
+    wordsPerBond_ = (maxLag + 63) / 64;
+    correlation_.assign(maxLag_, 0.0);
+}
+
+int HydrogenBondExistence::flags() const
+{
+    return efAllowMultipoint | efAllowMulticolumn;
+}
+
+int HydrogenBondExistence::findOrAddBond(int hydrogen, int acceptor)
+{
+    const int64_t key  = (static_cast<int64_t>(hydrogen) << 32) | static_cast<uint32_t>(acceptor);
+    const auto    bond = bondIndex_.emplace(key, bondCount());
+    if (bond.second)
+    {
+        lastFrame_.push_back(-1);
+        currentLifetime_.push_back(0);
+        presence_.resize(presence_.size() + wordsPerBond_, 0);
+    }
+    return bond.first->second;
+}
+
+void HydrogenBondExistence::addLifetime(int lifetime)
+{
+    if (gmx::ssize(lifetimeHistogram_) < lifetime)
+    {
+        lifetimeHistogram_.resize(lifetime, 0);
+    }
+    ++lifetimeHistogram_[lifetime - 1];
+}
+
+void HydrogenBondExistence::dataStarted(AbstractAnalysisData* data)
+{
+    GMX_RELEASE_ASSERT(data->dataSetCount() == 1 && data->columnCount(0) == 2,
+                       "Input data should have (hydrogen, acceptor) columns");
+}
+
+void HydrogenBondExistence::frameStarted(const AnalysisDataFrameHeader& header)
+{
+    if (header.index() == 0)
+    {
+        firstx_ = header.x();
+    }
+    lastx_ = header.x();
+    currentBonds_.clear();
+}
+
+void HydrogenBondExistence::pointsAdded(const AnalysisDataPointSetRef& points)
+{
+    GMX_ASSERT(points.firstColumn() == 0 && points.columnCount() == 2,
+               "Point set should contain a (hydrogen, acceptor) pair");
+    currentBonds_.push_back(
+            findOrAddBond(static_cast<int>(points.y(0)), static_cast<int>(points.y(1))));
+}
+
+void HydrogenBondExistence::frameFinished(const AnalysisDataFrameHeader& /*header*/)
+{
+    const int frame = frameCount_;
+    ++frameCount_;
+    for (const int bond : currentBonds_)
+    {
+        // Clear the bits of the frames where the bond was absent, and which
+        // are still within the lag window.
+        if (lastFrame_[bond] >= 0)
+        {
+            for (int f = std::max(lastFrame_[bond] + 1, frame - maxLag_ + 1); f < frame; ++f)
+            {
+                setPresent(bond, f, false);
+            }
+        }
+        setPresent(bond, frame, true);
+        currentLifetime_[bond] = (lastFrame_[bond] == frame - 1) ? currentLifetime_[bond] + 1 : 1;
+        lastFrame_[bond]       = frame;
+        const int maxLag       = std::min(maxLag_ - 1, frame);
+        for (int lag = 0; lag <= maxLag; ++lag)
+        {
+            if (isPresent(bond, frame - lag))
+            {
+                correlation_[lag] += 1.0;
+            }
+        }
+    }
+    for (const int bond : previousBonds_)
+    {
+        if (lastFrame_[bond] != frame)
+        {
+            addLifetime(currentLifetime_[bond]);
+            currentLifetime_[bond] = 0;
+        }
+    }
+    std::swap(previousBonds_, currentBonds_);
+}
+
+void HydrogenBondExistence::dataFinished()
+{
+    // Need to process the bonds present in the last frame explicitly.
+    for (const int bond : previousBonds_)
+    {
+        addLifetime(currentLifetime_[bond]);
+    }
+    previousBonds_.clear();
+
+    // X spacing is determined by averaging from the first and last frame
+    // instead of first two frames to avoid rounding issues.
+    const real spacing = (frameCount_ > 1) ? (lastx_ - firstx_) / (frameCount_ - 1) : 0.0;
+
+    int64_t lifetimeCount = 0;
+    double  lifetimeSum   = 0;
+    for (size_t i = 0; i < lifetimeHistogram_.size(); ++i)
+    {
+        lifetimeCount += lifetimeHistogram_[i];
+        lifetimeSum += static_cast<double>(i + 1) * lifetimeHistogram_[i];
+    }
+    averageLifetime_ = (lifetimeCount > 0) ? spacing * lifetimeSum / lifetimeCount : 0.0;
+
+    lifetimes_.setColumnCount(1);
+    lifetimes_.setRowCount(std::max<int>(lifetimeHistogram_.size(), 1));
+    lifetimes_.setXAxis(spacing, spacing);
+    lifetimes_.allocateValues();
+    for (int row = 0; row < lifetimes_.rowCount(); ++row)
+    {
+        const real value = (row < gmx::ssize(lifetimeHistogram_))
+                                   ? lifetimeHistogram_[row] / static_cast<real>(lifetimeCount)
+                                   : 0.0;
+        lifetimes_.value(row, 0).setValue(value);
+    }
+    lifetimes_.valuesReady();
+
+    // Normalize by the number of time origins for each lag, and by the
+    // value at zero lag.
+    const int lagCount = std::max(std::min(maxLag_, frameCount_), 1);
+    autocorrelation_.setColumnCount(1);
+    autocorrelation_.setRowCount(lagCount);
+    autocorrelation_.setXAxis(0.0, spacing);
+    autocorrelation_.allocateValues();
+    const double norm = (correlation_[0] > 0) ? frameCount_ / correlation_[0] : 0.0;
+    for (int lag = 0; lag < lagCount; ++lag)
+    {
+        const double value =
+                (lag < frameCount_) ? norm * correlation_[lag] / (frameCount_ - lag) : 0.0;
+        autocorrelation_.value(lag, 0).setValue(value);
+    }
+    autocorrelation_.valuesReady();
+}
+
+} // namespace analysismodules
+
+} // namespace gmx
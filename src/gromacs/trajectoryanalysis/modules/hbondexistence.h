@@ -0,0 +1,158 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Declares gmx::analysismodules::HydrogenBondExistence.
+ *
+ * \ingroup module_trajectoryanalysis
+ */
+#ifndef GMX_TRAJECTORYANALYSIS_MODULES_HBONDEXISTENCE_H
+#define GMX_TRAJECTORYANALYSIS_MODULES_HBONDEXISTENCE_H
+
+#include <cstdint>
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "gromacs/analysisdata/arraydata.h"
+#include "gromacs/analysisdata/datamodule.h"
+#include "gromacs/utility/real.h"
+
+namespace gmx
+{
+
+namespace analysismodules
+{
+
+/*! \internal \brief
+ * Data module for hydrogen bond lifetimes and existence autocorrelation.
+ *
+ * The input data should be multipoint data with two columns, where each
+ * point set in a frame is one (hydrogen, acceptor) atom index pair of a
+ * hydrogen bond present in that frame.  Each bond should appear at most once
+ * per frame.  Input data should have frames with evenly spaced x values.
+ *
+ * Only bonds that have been present at some point are tracked.  For each
+ * such bond, the memory use is constant: the current continuous lifetime and
+ * a ring buffer with one bit per frame for the last frames within the
+ * maximum autocorrelation lag.
+ *
+ * The output becomes available only after the input data has been finished.
+ * lifetimes() gives the normalized distribution of continuous lifetimes, and
+ * autocorrelation() the existence autocorrelation averaged over all bonds,
+ * normalized to one at zero lag.
+ *
+ * \ingroup module_trajectoryanalysis
+ */
+class HydrogenBondExistence : public AnalysisDataModuleSerial
+{
+public:
+    HydrogenBondExistence();
+
+    //! Sets the maximum lag (in frames) for the autocorrelation.
+    void setMaxLag(int maxLag);
+
+    //! Returns the distribution of continuous lifetimes.
+    AbstractAnalysisData& lifetimes() { return lifetimes_; }
+    //! Returns the normalized existence autocorrelation.
+    AbstractAnalysisData& autocorrelation() { return autocorrelation_; }
+    //! Returns the number of different bonds seen.
+    int bondCount() const { return static_cast<int>(lastFrame_.size()); }
+    //! Returns the average continuous lifetime (valid after the data is finished).
+    real averageLifetime() const { return averageLifetime_; }
+
+    int flags() const override;
+
+    void dataStarted(AbstractAnalysisData* data) override;
+    void frameStarted(const AnalysisDataFrameHeader& header) override;
+    void pointsAdded(const AnalysisDataPointSetRef& points) override;
+    void frameFinished(const AnalysisDataFrameHeader& header) override;
+    void dataFinished() override;
+
+private:
+    //! Returns the internal index of a bond, adding it if not yet seen.
+    int findOrAddBond(int hydrogen, int acceptor);
+    //! Adds a continuous lifetime (in frames) to the histogram.
+    void addLifetime(int lifetime);
+    //! Returns the presence bit of \p bond for \p frame.
+    bool isPresent(int bond, int frame) const
+    {
+        const int slot = frame % maxLag_;
+        return (presence_[bond * wordsPerBond_ + slot / 64] >> (slot % 64)) & 1U;
+    }
+    //! Sets the presence bit of \p bond for \p frame.
+    void setPresent(int bond, int frame, bool bPresent)
+    {
+        const int      slot = frame % maxLag_;
+        const uint64_t bit  = uint64_t(1) << (slot % 64);
+        uint64_t&      word = presence_[bond * wordsPerBond_ + slot / 64];
+        word                = bPresent ? (word | bit) : (word & ~bit);
+    }
+
+    int                              maxLag_;
+    int                              wordsPerBond_;
+    real                             firstx_;
+    real                             lastx_;
+    int                              frameCount_;
+    std::unordered_map<int64_t, int> bondIndex_;
+    //! Last frame where each bond was present.
+    std::vector<int> lastFrame_;
+    //! Length of the current continuous presence of each bond.
+    std::vector<int> currentLifetime_;
+    //! Presence bits of the last maxLag_ frames for each bond.
+    std::vector<uint64_t> presence_;
+    //! Bonds present in the current frame.
+    std::vector<int> currentBonds_;
+    //! Bonds present in the previous frame.
+    std::vector<int> previousBonds_;
+    //! Number of continuous lifetimes of each length (minus one).
+    std::vector<int64_t> lifetimeHistogram_;
+    //! Sum of s(t)s(t+lag) over bonds and time origins for each lag.
+    std::vector<double> correlation_;
+    real                averageLifetime_;
+
+    AnalysisArrayData lifetimes_;
+    AnalysisArrayData autocorrelation_;
+};
+
+//! Smart pointer to manage a HydrogenBondExistence object.
+typedef std::shared_ptr<HydrogenBondExistence> HydrogenBondExistencePointer;
+
+} // namespace analysismodules
+
+} // namespace gmx
+
+#endif
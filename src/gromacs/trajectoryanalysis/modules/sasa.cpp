@@ -379,6 +379,7 @@ private:
 
     double solsize_;
     int    ndots_;
+    double nblistBuffer_;
     // double                  minarea_;
     double dgsDefault_;
     bool   bIncludeSolute_;
@@ -405,6 +406,7 @@ private:
 Sasa::Sasa() :
     solsize_(0.14),
     ndots_(24),
+    nblistBuffer_(0),
     dgsDefault_(0),
     bIncludeSolute_(true),
     mtop_(nullptr),
@@ -453,7 +455,15 @@ void Sasa::initOptions(IOptionsContainer* options, TrajectoryAnalysisSettings* s
         "to keep in mind that the results for volume and density are very",
         "approximate. For example, in ice Ih, one can easily fit water molecules in the",
         "pores which would yield a volume that is too low, and surface area and density",
-        "that are both too high."
+        "that are both too high.[PAR]",
+
+        "[TT]-nlbuf[tt] can speed up the analysis of large systems with",
+        "closely spaced frames. When it is positive, the neighbors within",
+        "the search cutoff plus this buffer are stored and reused in later",
+        "frames, until the atoms have moved more than the buffer allows.",
+        "This needs memory proportional to the number of neighbor pairs",
+        "for each analysis thread.",
+        "With the default of 0, the neighbors are searched in every frame."
     };
 
     settings->setHelpText(desc);
@@ -505,6 +515,8 @@ void Sasa::initOptions(IOptionsContainer* options, TrajectoryAnalysisSettings* s
             DoubleOption("probe").store(&solsize_).description("Radius of the solvent probe (nm)"));
     options->addOption(IntegerOption("ndots").store(&ndots_).description(
             "Number of dots per sphere, more dots means more accuracy"));
+    options->addOption(DoubleOption("nlbuf").store(&nblistBuffer_).description(
+            "Buffer (nm) for reusing the neighbor list between frames"));
     // options->addOption(DoubleOption("minarea").store(&minarea_)
     //                       .description("The minimum area (nm^2) to count an atom as a surface atom when writing a position restraint file (see help)"));
     options->addOption(
@@ -547,6 +559,11 @@ void Sasa::initAnalysis(const TrajectoryAnalysisSettings& settings, const Topolo
         ndots_ = 20;
         fprintf(stderr, "Ndots too small, setting it to %d\n", ndots_);
     }
+    if (nblistBuffer_ < 0)
+    {
+        nblistBuffer_ = 0;
+        fprintf(stderr, "Negative neighbor list buffer, setting it to %g\n", nblistBuffer_);
+    }
 
     please_cite(stderr, "Eisenhaber95");
     // if ((top.pbcType() != PbcType::Xyz) || (TRICLINIC(fr.box)))
@@ -649,6 +666,7 @@ void Sasa::initAnalysis(const TrajectoryAnalysisSettings& settings, const Topolo
 
     calculator_.setDotCount(ndots_);
     calculator_.setRadii(radii_);
+    calculator_.setNeighborListBuffer(nblistBuffer_);
 
     // Initialize all the output data objects and initialize the output plotters.
 
@@ -810,6 +828,8 @@ public:
      * performed.
      */
     std::vector<real> res_a_;
+    //! Neighbor list reused between the frames analyzed with this data.
+    SurfaceAreaNeighborList neighborList_;
 };
 
 TrajectoryAnalysisModuleDataPointer Sasa::startFrames(const AnalysisDataParallelOptions& opt,
@@ -952,7 +972,7 @@ void Sasa::analyzeFrame(int frnr, const t_trxframe& fr, t_pbc* pbc, TrajectoryAn
     int   nsurfacedots;
     calculator_.calculate(surfaceSel.coordinates().data(), pbc, frameData.index_.size(),
                           frameData.index_.data(), flag, &totarea, &totvolume, &area, &surfacedots,
-                          &nsurfacedots);
+                          &nsurfacedots, &frameData.neighborList_);
     // Unpack the atomwise areas into the frameData.atomAreas_ array for easier
     // indexing in the case of dynamic surfaceSel.
     if (area != nullptr)
@@ -52,12 +52,15 @@
 #include "gromacs/math/vec.h"
 #include "gromacs/pbcutil/pbc.h"
 #include "gromacs/selection/nbsearch.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/utility/alignedallocator.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/gmxomp.h"
+#include "gromacs/utility/listoflists.h"
 #include "gromacs/utility/smalloc.h"
 
-using namespace gmx;
-
 #define UNSP_ICO_DOD 9
 #define UNSP_ICO_ARC 10
 
@@ -446,6 +449,11 @@ static std::vector<real> ico_dot_dod(int densit)
     return xus;
 } /* end of routine ico_dot_dod */
 
+/* Only used from here on, since the gmx scalar math overloads for the
+ * SIMD code would make the unqualified sin() and cos() calls above ambiguous.
+ */
+using namespace gmx;
+
 static int unsp_type(int densit)
 {
     int i1, i2;
@@ -581,11 +589,113 @@ static std::vector<real> make_unsp(int densit, int cubus)
     return xus;
 }
 
+//! Minimum number of atoms per OpenMP thread in nsc_dclm_pbc().
+static const int c_minAtomsPerThread = 32;
+
+#if GMX_SIMD_HAVE_REAL
+//! Padding of the number of surface dots for SIMD processing.
+static const int c_dotPadding = GMX_SIMD_REAL_WIDTH;
+#else
+//! Padding of the number of surface dots for SIMD processing.
+static const int c_dotPadding = 1;
+#endif
+
+/*! \brief
+ * Unit sphere surface dots in padded structure-of-arrays layout.
+ *
+ * The padding dots are never counted as surface dots: their entry in
+ * \p initialMask is zero.
+ */
+struct UnitSphereDots
+{
+    //! Number of actual dots.
+    int dotCount = 0;
+    //! Dot x coordinates.
+    std::vector<real, AlignedAllocator<real>> x;
+    //! Dot y coordinates.
+    std::vector<real, AlignedAllocator<real>> y;
+    //! Dot z coordinates.
+    std::vector<real, AlignedAllocator<real>> z;
+    //! Initial values for the dot work array: one for dots, zero for padding.
+    std::vector<real, AlignedAllocator<real>> initialMask;
+};
+
+//! Sets up \p dots from the x,y,z triplets in \p xus.
+static void initUnitSphereDots(ArrayRef<const real> xus, UnitSphereDots* dots)
+{
+    dots->dotCount        = xus.size() / 3;
+    const int paddedCount = ((dots->dotCount + c_dotPadding - 1) / c_dotPadding) * c_dotPadding;
+    dots->x.assign(paddedCount, 0);
+    dots->y.assign(paddedCount, 0);
+    dots->z.assign(paddedCount, 0);
+    dots->initialMask.assign(paddedCount, 0);
+    for (int l = 0; l < dots->dotCount; ++l)
+    {
+        dots->x[l]           = xus[3 * l];
+        dots->y[l]           = xus[3 * l + 1];
+        dots->z[l]           = xus[3 * l + 2];
+        dots->initialMask[l] = 1;
+    }
+}
+
+/*! \brief
+ * Marks dots covered by a neighbor sphere.
+ *
+ * \param[in]     dots    Unit sphere dots.
+ * \param[in]     dx      Vector from the sphere center to the neighbor.
+ * \param[in]     refdot  Dots with a projection on \p dx larger than this
+ *     are covered.
+ * \param[in,out] wkdot   Nonzero for each dot not yet covered.
+ * \returns Whether any dots remain uncovered.
+ */
+static bool markCoveredDots(const UnitSphereDots& dots, const rvec dx, real refdot, real* wkdot)
+{
+#if GMX_SIMD_HAVE_REAL
+    const SimdReal dxS(dx[XX]);
+    const SimdReal dyS(dx[YY]);
+    const SimdReal dzS(dx[ZZ]);
+    const SimdReal refdotS(refdot);
+    SimdReal       remaining = setZero();
+    for (size_t j = 0; j < dots.x.size(); j += GMX_SIMD_REAL_WIDTH)
+    {
+        SimdReal prod = dxS * load<SimdReal>(dots.x.data() + j);
+        prod          = fma(dyS, load<SimdReal>(dots.y.data() + j), prod);
+        prod          = fma(dzS, load<SimdReal>(dots.z.data() + j), prod);
+        SimdReal wk   = selectByNotMask(load<SimdReal>(wkdot + j), refdotS < prod);
+        store(wkdot + j, wk);
+        remaining = remaining + wk;
+    }
+    return reduce(remaining) > 0;
+#else
+    bool bRemaining = false;
+    for (int j = 0; j < dots.dotCount; ++j)
+    {
+        if (wkdot[j] != 0 && dots.x[j] * dx[XX] + dots.y[j] * dx[YY] + dots.z[j] * dx[ZZ] > refdot)
+        {
+            wkdot[j] = 0;
+        }
+        bRemaining = bRemaining || wkdot[j] != 0;
+    }
+    return bRemaining;
+#endif
+}
+
+/*! \brief
+ * Computes the surface area (and optionally volume and dots).
+ *
+ * The atoms are divided into contiguous blocks over OpenMP threads.  Each
+ * atom only writes its own contributions, and these are summed in atom
+ * order afterwards, so the result does not depend on the number of threads.
+ *
+ * If \p neighbors is not `NULL`, it should contain for each atom a list of
+ * all atoms (as indices into \p index) that can be within the sum of the
+ * radii, and no grid search is done.
+ */
 static void nsc_dclm_pbc(const rvec*                 coords,
                          const ArrayRef<const real>& radius,
                          int                         nat,
                          const real*                 xus,
-                         int                         n_dot,
+                         const UnitSphereDots&       unitDots,
                          int                         mode,
                          real*                       value_of_area,
                          real**                      at_area,
@@ -593,9 +703,11 @@ static void nsc_dclm_pbc(const rvec*                 coords,
                          real**                      lidots,
                          int*                        nu_dots,
                          int                         index[],
+                         const ListOfLists<int>*     neighbors,
                          AnalysisNeighborhood*       nb,
                          const t_pbc*                pbc)
 {
+    const int  n_dot   = unitDots.dotCount;
     const real dotarea = FOURPI / static_cast<real>(n_dot);
 
     if (debug)
@@ -609,23 +721,6 @@ static void nsc_dclm_pbc(const rvec*                 coords,
     {
         return;
     }
-    real  area = 0.0, vol = 0.0;
-    real *dots = nullptr, *atom_area = nullptr;
-    int   lfnr = 0, maxdots = 0;
-    if (mode & FLAG_VOLUME)
-    {
-        vol = 0.;
-    }
-    if (mode & FLAG_DOTS)
-    {
-        maxdots = (3 * n_dot * nat) / 10;
-        snew(dots, maxdots);
-        lfnr = 0;
-    }
-    if (mode & FLAG_ATOM_AREA)
-    {
-        snew(atom_area, nat);
-    }
 
     // Compute the center of the molecule for volume calculation.
     // In principle, the center should not influence the results, but that is
@@ -646,110 +741,156 @@ static void nsc_dclm_pbc(const rvec*                 coords,
     ys /= nat;
     zs /= nat;
 
-    AnalysisNeighborhoodPositions pos(coords, radius.size());
-    pos.indexed(constArrayRefFromArray(index, nat));
-    AnalysisNeighborhoodSearch nbsearch(nb->initSearch(pbc, pos));
-
-    std::vector<int> wkdot(n_dot);
+    AnalysisNeighborhoodSearch nbsearch;
+    if (neighbors == nullptr)
+    {
+        AnalysisNeighborhoodPositions pos(coords, radius.size());
+        pos.indexed(constArrayRefFromArray(index, nat));
+        nbsearch = nb->initSearch(pbc, pos);
+    }
 
-    for (int i = 0; i < nat; ++i)
+    const int numThreads =
+            std::max(1, std::min(gmx_omp_get_max_threads(), nat / c_minAtomsPerThread));
+    std::vector<real>              atomArea(nat);
+    std::vector<real>              atomVolume((mode & FLAG_VOLUME) ? nat : 0);
+    std::vector<std::vector<real>> threadDots((mode & FLAG_DOTS) ? numThreads : 0);
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (int th = 0; th < numThreads; ++th)
     {
-        const int                      iat  = index[i];
-        const real                     ai   = radius[iat];
-        const real                     aisq = ai * ai;
-        AnalysisNeighborhoodPairSearch pairSearch(nbsearch.startPairSearch(coords[iat]));
-        AnalysisNeighborhoodPair       pair;
-        std::fill(wkdot.begin(), wkdot.end(), 1);
-        int currDotCount = n_dot;
-        while (currDotCount > 0 && pairSearch.findNextPair(&pair))
+        try
         {
-            const int  jat = index[pair.refIndex()];
-            const real aj  = radius[jat];
-            const real d2  = pair.distance2();
-            if (iat == jat || d2 > gmx::square(ai + aj))
+            std::vector<real, AlignedAllocator<real>> wkdot(unitDots.initialMask.size());
+            const int                                 atomStart = (nat * (th + 0)) / numThreads;
+            const int                                 atomEnd   = (nat * (th + 1)) / numThreads;
+            for (int i = atomStart; i < atomEnd; ++i)
             {
-                continue;
-            }
-            const rvec& dx     = pair.dx();
-            const real  refdot = (d2 + aisq - aj * aj) / (2 * ai);
-            // TODO: Consider whether micro-optimizations from the old
-            // implementation would be useful, compared to the complexity that
-            // they bring: instead of this direct loop, the neighbors were
-            // stored into a temporary array, the loop order was
-            // reversed (first over dots, then over neighbors), and for each
-            // dot, it was first checked whether the same neighbor that
-            // resulted in marking the previous dot covered would also cover
-            // this dot. This presumably plays together with sorting of the
-            // surface dots (done in make_unsp) to avoid some of the looping.
-            // Alternatively, we could keep a skip list here to avoid
-            // repeatedly looping over dots that have already marked as
-            // covered.
-            for (int j = 0; j < n_dot; ++j)
-            {
-                if (wkdot[j] && iprod(&xus[3 * j], dx) > refdot)
+                const int  iat  = index[i];
+                const real ai   = radius[iat];
+                const real aisq = ai * ai;
+                std::copy(unitDots.initialMask.begin(), unitDots.initialMask.end(), wkdot.begin());
+                // Returns whether dots remain uncovered after considering jat.
+                auto coverDots = [&](int jat, const rvec dx, real d2) {
+                    const real aj = radius[jat];
+                    if (iat == jat || d2 > gmx::square(ai + aj))
+                    {
+                        return true;
+                    }
+                    const real refdot = (d2 + aisq - aj * aj) / (2 * ai);
+                    return markCoveredDots(unitDots, dx, refdot, wkdot.data());
+                };
+                if (neighbors != nullptr)
                 {
-                    --currDotCount;
-                    wkdot[j] = 0;
+                    for (const int j : (*neighbors)[i])
+                    {
+                        const int jat = index[j];
+                        rvec      dx;
+                        if (pbc != nullptr)
+                        {
+                            pbc_dx(pbc, coords[jat], coords[iat], dx);
+                        }
+                        else
+                        {
+                            rvec_sub(coords[jat], coords[iat], dx);
+                        }
+                        if (!coverDots(jat, dx, norm2(dx)))
+                        {
+                            break;
+                        }
+                    }
+                }
+                else
+                {
+                    AnalysisNeighborhoodPairSearch pairSearch(nbsearch.startPairSearch(coords[iat]));
+                    AnalysisNeighborhoodPair       pair;
+                    while (pairSearch.findNextPair(&pair)
+                           && coverDots(index[pair.refIndex()], pair.dx(), pair.distance2()))
+                    {
+                    }
                 }
-            }
-        }
 
-        const real a = aisq * dotarea * currDotCount;
-        area         = area + a;
-        if (mode & FLAG_ATOM_AREA)
-        {
-            atom_area[i] = a;
-        }
-        const real xi = coords[iat][XX];
-        const real yi = coords[iat][YY];
-        const real zi = coords[iat][ZZ];
-        if (mode & FLAG_DOTS)
-        {
-            for (int l = 0; l < n_dot; l++)
-            {
-                if (wkdot[l])
+                int currDotCount = 0;
+                for (int l = 0; l < n_dot; l++)
                 {
-                    lfnr++;
-                    if (maxdots <= 3 * lfnr + 1)
+                    if (wkdot[l] != 0)
                     {
-                        maxdots = maxdots + n_dot * 3;
-                        srenew(dots, maxdots);
+                        ++currDotCount;
                     }
-                    dots[3 * lfnr - 3] = ai * xus[3 * l] + xi;
-                    dots[3 * lfnr - 2] = ai * xus[1 + 3 * l] + yi;
-                    dots[3 * lfnr - 1] = ai * xus[2 + 3 * l] + zi;
                 }
-            }
-        }
-        if (mode & FLAG_VOLUME)
-        {
-            real dx = 0.0, dy = 0.0, dz = 0.0;
-            for (int l = 0; l < n_dot; l++)
-            {
-                if (wkdot[l])
+                atomArea[i]   = aisq * dotarea * currDotCount;
+                const real xi = coords[iat][XX];
+                const real yi = coords[iat][YY];
+                const real zi = coords[iat][ZZ];
+                if (mode & FLAG_DOTS)
                 {
-                    dx = dx + xus[3 * l];
-                    dy = dy + xus[1 + 3 * l];
-                    dz = dz + xus[2 + 3 * l];
+                    for (int l = 0; l < n_dot; l++)
+                    {
+                        if (wkdot[l] != 0)
+                        {
+                            threadDots[th].push_back(ai * xus[3 * l] + xi);
+                            threadDots[th].push_back(ai * xus[1 + 3 * l] + yi);
+                            threadDots[th].push_back(ai * xus[2 + 3 * l] + zi);
+                        }
+                    }
+                }
+                if (mode & FLAG_VOLUME)
+                {
+                    real dx = 0.0, dy = 0.0, dz = 0.0;
+                    for (int l = 0; l < n_dot; l++)
+                    {
+                        if (wkdot[l] != 0)
+                        {
+                            dx = dx + xus[3 * l];
+                            dy = dy + xus[1 + 3 * l];
+                            dz = dz + xus[2 + 3 * l];
+                        }
+                    }
+                    atomVolume[i] = aisq
+                                    * (dx * (xi - xs) + dy * (yi - ys) + dz * (zi - zs)
+                                       + ai * currDotCount);
                 }
             }
-            vol = vol + aisq * (dx * (xi - xs) + dy * (yi - ys) + dz * (zi - zs) + ai * currDotCount);
         }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
     }
 
+    real area = 0.0;
+    for (int i = 0; i < nat; ++i)
+    {
+        area = area + atomArea[i];
+    }
     if (mode & FLAG_VOLUME)
     {
+        real vol = 0.0;
+        for (int i = 0; i < nat; ++i)
+        {
+            vol = vol + atomVolume[i];
+        }
         *value_of_vol = vol * FOURPI / (3. * n_dot);
     }
     if (mode & FLAG_DOTS)
     {
+        size_t valueCount = 0;
+        for (const auto& dots : threadDots)
+        {
+            valueCount += dots.size();
+        }
+        real* dots = nullptr;
+        snew(dots, valueCount);
+        real* dotsEnd = dots;
+        for (const auto& tdots : threadDots)
+        {
+            dotsEnd = std::copy(tdots.begin(), tdots.end(), dotsEnd);
+        }
         GMX_RELEASE_ASSERT(nu_dots != nullptr, "Must have valid nu_dots pointer");
-        *nu_dots = lfnr;
+        *nu_dots = valueCount / 3;
         GMX_RELEASE_ASSERT(lidots != nullptr, "Must have valid lidots pointer");
         *lidots = dots;
     }
     if (mode & FLAG_ATOM_AREA)
     {
+        real* atom_area = nullptr;
+        snew(atom_area, nat);
+        std::copy(atomArea.begin(), atomArea.end(), atom_area);
         GMX_RELEASE_ASSERT(at_area != nullptr, "Must have valid at_area pointer");
         *at_area = atom_area;
     }
@@ -764,14 +905,121 @@ static void nsc_dclm_pbc(const rvec*                 coords,
 namespace gmx
 {
 
+class SurfaceAreaNeighborList::Impl
+{
+public:
+    Impl() : bListValid_(false), cutoffAtBuild_(0), bPbcAtBuild_(false) {}
+
+    //! Checks whether the list can be used for the given atoms, cutoff and buffer.
+    bool isValid(const rvec*  x,
+                 const t_pbc* pbc,
+                 int          nat,
+                 const int    index[],
+                 real         cutoff,
+                 real         buffer) const;
+    //! Builds the list for the given atoms with the given neighborhood search.
+    void build(AnalysisNeighborhood* nb,
+               real                  cutoff,
+               const rvec*           x,
+               int                   xCount,
+               const t_pbc*          pbc,
+               int                   nat,
+               int                   index[]);
+
+    //! Whether the members below describe a valid neighbor list.
+    bool bListValid_;
+    //! Cutoff used when building the list.
+    real cutoffAtBuild_;
+    //! Atom index array used for building the neighbor list.
+    std::vector<int> indexAtBuild_;
+    //! Positions of the atoms in the list when it was built.
+    std::vector<RVec> xAtBuild_;
+    //! Whether PBC was used when building the list.
+    bool bPbcAtBuild_;
+    //! Box used when building the list.
+    matrix boxAtBuild_;
+    //! For each atom, atoms within the buffered cutoff at build time.
+    ListOfLists<int> neighbors_;
+};
+
+bool SurfaceAreaNeighborList::Impl::isValid(const rvec*  x,
+                                            const t_pbc* pbc,
+                                            int          nat,
+                                            const int    index[],
+                                            real         cutoff,
+                                            real         buffer) const
+{
+    if (!bListValid_ || cutoff != cutoffAtBuild_ || nat != gmx::ssize(indexAtBuild_)
+        || !std::equal(indexAtBuild_.begin(), indexAtBuild_.end(), index)
+        || (pbc != nullptr) != bPbcAtBuild_)
+    {
+        return false;
+    }
+    real maxDisplacement2 = 0;
+    for (int i = 0; i < nat; ++i)
+    {
+        maxDisplacement2 = std::max(maxDisplacement2, distance2(x[index[i]], xAtBuild_[i]));
+    }
+    // Both atoms in a pair can have moved towards each other.
+    real maxDisplacement = 2 * std::sqrt(maxDisplacement2);
+    if (pbc != nullptr)
+    {
+        for (int dim = 0; dim < DIM; ++dim)
+        {
+            maxDisplacement += std::sqrt(distance2(pbc->box[dim], boxAtBuild_[dim]));
+        }
+    }
+    return maxDisplacement <= buffer;
+}
+
+void SurfaceAreaNeighborList::Impl::build(AnalysisNeighborhood* nb,
+                                          real                  cutoff,
+                                          const rvec*           x,
+                                          int                   xCount,
+                                          const t_pbc*          pbc,
+                                          int                   nat,
+                                          int                   index[])
+{
+    AnalysisNeighborhoodPositions pos(x, xCount);
+    pos.indexed(constArrayRefFromArray(index, nat));
+    AnalysisNeighborhoodSearch nbsearch(nb->initSearch(pbc, pos));
+    nbsearch.findAllPairs(pos, &neighbors_);
+
+    cutoffAtBuild_ = cutoff;
+    indexAtBuild_.assign(index, index + nat);
+    xAtBuild_.resize(nat);
+    for (int i = 0; i < nat; ++i)
+    {
+        copy_rvec(x[index[i]], xAtBuild_[i]);
+    }
+    bPbcAtBuild_ = (pbc != nullptr);
+    if (pbc != nullptr)
+    {
+        copy_mat(pbc->box, boxAtBuild_);
+    }
+    bListValid_ = true;
+}
+
+SurfaceAreaNeighborList::SurfaceAreaNeighborList() : impl_(new Impl()) {}
+
+SurfaceAreaNeighborList::~SurfaceAreaNeighborList() {}
+
 class SurfaceAreaCalculator::Impl
 {
 public:
-    Impl() : flags_(0) {}
+    Impl() : flags_(0), maxRadius_(0), buffer_(0) {}
+
+    //! Returns the cutoff of the neighborhood search from the radii and buffer.
+    real cutoff() const { return 2 * maxRadius_ + buffer_; }
+    //! Sets the cutoff of the neighborhood search from the radii and buffer.
+    void updateCutoff() { nb_.setCutoff(cutoff()); }
 
     std::vector<real>            unitSphereDots_;
+    UnitSphereDots               unitDots_;
     ArrayRef<const real>         radius_;
     int                          flags_;
+    real                         maxRadius_;
+    real                         buffer_;
     mutable AnalysisNeighborhood nb_;
 };
 
@@ -782,6 +1030,7 @@ SurfaceAreaCalculator::~SurfaceAreaCalculator() {}
 void SurfaceAreaCalculator::setDotCount(int dotCount)
 {
     impl_->unitSphereDots_ = make_unsp(dotCount, 4);
+    initUnitSphereDots(impl_->unitSphereDots_, &impl_->unitDots_);
 }
 
 void SurfaceAreaCalculator::setRadii(const ArrayRef<const real>& radius)
@@ -789,11 +1038,17 @@ void SurfaceAreaCalculator::setRadii(const ArrayRef<const real>& radius)
     impl_->radius_ = radius;
     if (!radius.empty())
     {
-        const real maxRadius = *std::max_element(radius.begin(), radius.end());
-        impl_->nb_.setCutoff(2 * maxRadius);
+        impl_->maxRadius_ = *std::max_element(radius.begin(), radius.end());
+        impl_->updateCutoff();
     }
 }
 
+void SurfaceAreaCalculator::setNeighborListBuffer(real buffer)
+{
+    impl_->buffer_ = std::max(buffer, 0.0_real);
+    impl_->updateCutoff();
+}
+
 void SurfaceAreaCalculator::setCalculateVolume(bool bVolume)
 {
     if (bVolume)
@@ -830,16 +1085,17 @@ void SurfaceAreaCalculator::setCalculateSurfaceDots(bool bDots)
     }
 }
 
-void SurfaceAreaCalculator::calculate(const rvec*  x,
-                                      const t_pbc* pbc,
-                                      int          nat,
-                                      int          index[],
-                                      int          flags,
-                                      real*        area,
-                                      real*        volume,
-                                      real**       at_area,
-                                      real**       lidots,
-                                      int*         n_dots) const
+void SurfaceAreaCalculator::calculate(const rvec*              x,
+                                      const t_pbc*             pbc,
+                                      int                      nat,
+                                      int                      index[],
+                                      int                      flags,
+                                      real*                    area,
+                                      real*                    volume,
+                                      real**                   at_area,
+                                      real**                   lidots,
+                                      int*                     n_dots,
+                                      SurfaceAreaNeighborList* neighborList) const
 {
     flags |= impl_->flags_;
     *area = 0;
@@ -875,8 +1131,18 @@ void SurfaceAreaCalculator::calculate(const rvec*  x,
     {
         *n_dots = 0;
     }
-    nsc_dclm_pbc(x, impl_->radius_, nat, &impl_->unitSphereDots_[0], impl_->unitSphereDots_.size() / 3,
-                 flags, area, at_area, volume, lidots, n_dots, index, &impl_->nb_, pbc);
+    const ListOfLists<int>* neighbors = nullptr;
+    if (impl_->buffer_ > 0 && nat > 0 && neighborList != nullptr)
+    {
+        SurfaceAreaNeighborList::Impl* list = neighborList->impl_.get();
+        if (!list->isValid(x, pbc, nat, index, impl_->cutoff(), impl_->buffer_))
+        {
+            list->build(&impl_->nb_, impl_->cutoff(), x, impl_->radius_.size(), pbc, nat, index);
+        }
+        neighbors = &list->neighbors_;
+    }
+    nsc_dclm_pbc(x, impl_->radius_, nat, impl_->unitSphereDots_.data(), impl_->unitDots_, flags,
+                 area, at_area, volume, lidots, n_dots, index, neighbors, &impl_->nb_, pbc);
 }
 
 } // namespace gmx
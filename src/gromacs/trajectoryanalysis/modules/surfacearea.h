@@ -51,6 +51,34 @@ struct t_pbc;
 namespace gmx
 {
 
+/*! \internal
+ * \brief
+ * Neighbor list that SurfaceAreaCalculator::calculate() can reuse between calls.
+ *
+ * Keeps the neighbors found in one calculation, and the positions they
+ * were found for, so that later calculations can skip the neighbor search
+ * while the atoms have moved less than the buffer set with
+ * SurfaceAreaCalculator::setNeighborListBuffer().
+ * The list is kept separate from the calculator, so that a single
+ * calculator can be used concurrently from several threads, each with
+ * its own list.
+ *
+ * \ingroup module_trajectoryanalysis
+ */
+class SurfaceAreaNeighborList
+{
+public:
+    SurfaceAreaNeighborList();
+    ~SurfaceAreaNeighborList();
+
+private:
+    class Impl;
+
+    PrivateImplPointer<Impl> impl_;
+
+    friend class SurfaceAreaCalculator;
+};
+
 /*! \internal
  * \brief
  * Computes surface areas for a group of atoms/spheres.
@@ -105,6 +133,23 @@ public:
      * Does not throw.
      */
     void setRadii(const ArrayRef<const real>& radius);
+    /*! \brief
+     * Sets a buffer for reusing the neighbor list between calculations.
+     *
+     * \param[in]  buffer  Buffer (in nm) added to the neighbor search cutoff.
+     *
+     * If \p buffer is positive, calculate() stores the neighbors within
+     * the cutoff plus \p buffer in the SurfaceAreaNeighborList passed to
+     * it, and reuses them in later calls with the same list and atoms
+     * until the atoms (or the box) have moved more than the buffer allows.
+     * This trades memory for speed when the atoms move little between
+     * calls, as for consecutive trajectory frames.
+     * With zero (the default), or without a list, the neighbors are
+     * searched in each call.
+     *
+     * Does not throw.
+     */
+    void setNeighborListBuffer(real buffer);
 
     /*! \brief
      * Requests calculation of volume.
@@ -151,6 +196,8 @@ public:
      *     (can be `NULL`).
      * \param[out] n_dots Number of surface dots in \p lidots
      *     (can be `NULL`).
+     * \param[in,out] neighborList  Neighbor list to reuse from earlier
+     *     calls with a buffer set (can be `NULL`).
      *
      * Calculates the surface area of spheres centered at `x[index[0]]`,
      * ..., `x[index[nat-1]]`, with radii `radii[index[0]]`, ..., where
@@ -163,20 +210,24 @@ public:
      * this particular calculation.  If any output is `NULL`, that output
      * is not calculated, irrespective of the calculation mode set.
      *
+     * The calculator itself is not modified, so concurrent calls are safe
+     * as long as each uses a different \p neighborList.
+     *
      * \todo
      * Make the output options more C++-like, in particular for the array
      * outputs.
      */
-    void calculate(const rvec*  x,
-                   const t_pbc* pbc,
-                   int          nat,
-                   int          index[],
-                   int          flags,
-                   real*        area,
-                   real*        volume,
-                   real**       at_area,
-                   real**       lidots,
-                   int*         n_dots) const;
+    void calculate(const rvec*              x,
+                   const t_pbc*             pbc,
+                   int                      nat,
+                   int                      index[],
+                   int                      flags,
+                   real*                    area,
+                   real*                    volume,
+                   real**                   at_area,
+                   real**                   lidots,
+                   int*                     n_dots,
+                   SurfaceAreaNeighborList* neighborList) const;
 
 private:
     class Impl;
@@ -0,0 +1,113 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for functionality of the "hbond-analysis" trajectory analysis module.
+ *
+ * \ingroup module_trajectoryanalysis
+ */
+#include "gmxpre.h"
+
+#include "gromacs/trajectoryanalysis/modules/hbond.h"
+
+#include <gtest/gtest.h>
+
+#include "testutils/cmdlinetest.h"
+#include "testutils/tprfilegenerator.h"
+
+#include "moduletest.h"
+
+namespace
+{
+
+using gmx::test::CommandLine;
+using gmx::test::TprAndFileManager;
+
+/********************************************************************
+ * Tests for gmx::analysismodules::Hbond.
+ */
+
+//! Cutoffs that fit into the small box of the spc5 system.
+const char* const c_spc5Mdp =
+        "rlist = 0.8\nrvdw = 0.8\nrcoulomb = 0.8\nverlet-buffer-tolerance = -1\n";
+
+//! Test fixture for the hbond analysis module.
+typedef gmx::test::TrajectoryAnalysisModuleTestFixture<gmx::analysismodules::HbondInfo>
+        HbondModuleTest;
+
+TEST_F(HbondModuleTest, ComputesHydrogenBondsInWater)
+{
+    const char* const cmdline[] = { "hbond-analysis", "-sel", "all", "-r", "0.5", "-a", "60" };
+    TprAndFileManager tprFileHandle("spc5", c_spc5Mdp);
+    commandLine().addOption("-s", tprFileHandle.tprName());
+    setTrajectory("spc5.pdb");
+    runTest(CommandLine(cmdline));
+}
+
+TEST_F(HbondModuleTest, ComputesHydrogenBondsBetweenSelections)
+{
+    const char* const cmdline[] = { "hbond-analysis", "-sel", "resnr 1 2", "-ref", "resnr 3 to 5",
+                                    "-r",             "0.5",  "-a",        "60" };
+    TprAndFileManager tprFileHandle("spc5", c_spc5Mdp);
+    commandLine().addOption("-s", tprFileHandle.tprName());
+    setTrajectory("spc5.pdb");
+    runTest(CommandLine(cmdline));
+}
+
+TEST_F(HbondModuleTest, HandlesShortAutocorrelation)
+{
+    const char* const cmdline[] = {
+        "hbond-analysis", "-sel", "all", "-r", "0.5", "-a", "60", "-acmax", "5"
+    };
+    TprAndFileManager tprFileHandle("spc5", c_spc5Mdp);
+    commandLine().addOption("-s", tprFileHandle.tprName());
+    setTrajectory("spc5.pdb");
+    excludeDataset("hbonds");
+    excludeDataset("hbnum");
+    excludeDataset("lifetime");
+    runTest(CommandLine(cmdline));
+}
+
+TEST_F(HbondModuleTest, ComputesHydrogenBondsInProtein)
+{
+    const char* const cmdline[] = { "hbond-analysis", "-sel", "all", "-nonitacc" };
+    TprAndFileManager tprFileHandle("lysozyme");
+    commandLine().addOption("-s", tprFileHandle.tprName());
+    setTrajectory("lysozyme.pdb");
+    excludeDataset("hbonds");
+    runTest(CommandLine(cmdline));
+}
+
+} // namespace
@@ -0,0 +1,148 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for gmx::analysismodules::HydrogenBondExistence.
+ *
+ * The input data are hand-built existence sequences, and the lifetimes and
+ * the autocorrelation are checked against values computed by hand.
+ *
+ * \ingroup module_trajectoryanalysis
+ */
+#include "gmxpre.h"
+
+#include "gromacs/trajectoryanalysis/modules/hbondexistence.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/analysisdata/analysisdata.h"
+
+#include "gromacs/analysisdata/tests/datatest.h"
+#include "testutils/testasserts.h"
+
+namespace
+{
+
+using gmx::analysismodules::HydrogenBondExistence;
+using gmx::analysismodules::HydrogenBondExistencePointer;
+using gmx::test::AnalysisDataTestFixture;
+using gmx::test::AnalysisDataTestInput;
+using gmx::test::AnalysisDataTestInputFrame;
+
+/*! \brief
+ * Builds multipoint (hydrogen, acceptor) input from existence sequences.
+ *
+ * \p existence[b][f] tells whether bond \p b, with hydrogen \p b + 1 and
+ * acceptor 10, is present in frame \p f.  Frames are at x = 0, 1, 2, ...
+ */
+void buildInput(const std::vector<std::vector<int>>& existence, AnalysisDataTestInput* input)
+{
+    input->setColumnCount(0, 2);
+    for (size_t f = 0; f < existence[0].size(); ++f)
+    {
+        AnalysisDataTestInputFrame& frame = input->addFrame(f);
+        for (size_t b = 0; b < existence.size(); ++b)
+        {
+            if (existence[b][f] != 0)
+            {
+                frame.addPointSetWithValues(0, 0, b + 1, 10);
+            }
+        }
+    }
+}
+
+//! Runs \p existence over \p input.
+void runModule(const AnalysisDataTestInput& input, const HydrogenBondExistencePointer& existence)
+{
+    gmx::AnalysisData data;
+    ASSERT_NO_THROW_GMX(AnalysisDataTestFixture::setupDataObject(input, &data));
+    data.addModule(existence);
+    ASSERT_NO_THROW_GMX(AnalysisDataTestFixture::presentAllData(input, &data));
+}
+
+TEST(HydrogenBondExistenceTest, ComputesLifetimesAndAutocorrelation)
+{
+    // Lifetimes are 2 and 3 for the first bond and 2 for the second.
+    AnalysisDataTestInput input(1, true);
+    buildInput({ { 1, 1, 0, 1, 1, 1 }, { 0, 1, 1, 0, 0, 0 } }, &input);
+    HydrogenBondExistencePointer existence(new HydrogenBondExistence);
+    existence->setMaxLag(3);
+    runModule(input, existence);
+
+    EXPECT_EQ(2, existence->bondCount());
+    EXPECT_REAL_EQ(7.0 / 3.0, existence->averageLifetime());
+
+    const gmx::AbstractAnalysisData& lifetimes = existence->lifetimes();
+    ASSERT_EQ(3, lifetimes.frameCount());
+    EXPECT_REAL_EQ(1.0, lifetimes.getDataFrame(0).x());
+    EXPECT_REAL_EQ(0.0, lifetimes.getDataFrame(0).y(0));
+    EXPECT_REAL_EQ(2.0 / 3.0, lifetimes.getDataFrame(1).y(0));
+    EXPECT_REAL_EQ(1.0 / 3.0, lifetimes.getDataFrame(2).y(0));
+
+    // Sums of s(t)s(t+lag) are 7, 4 and 2 over 6, 5 and 4 time origins.
+    const gmx::AbstractAnalysisData& autocorrelation = existence->autocorrelation();
+    ASSERT_EQ(3, autocorrelation.frameCount());
+    EXPECT_REAL_EQ(0.0, autocorrelation.getDataFrame(0).x());
+    EXPECT_REAL_EQ(1.0, autocorrelation.getDataFrame(0).y(0));
+    EXPECT_REAL_EQ(24.0 / 35.0, autocorrelation.getDataFrame(1).y(0));
+    EXPECT_REAL_EQ(3.0 / 7.0, autocorrelation.getDataFrame(2).y(0));
+}
+
+TEST(HydrogenBondExistenceTest, ForgetsPresenceOutsideLagWindow)
+{
+    // The bond returns after a gap longer than the lag window, so the
+    // presence bit of the first frame must not be seen at lag one.
+    AnalysisDataTestInput input(1, true);
+    buildInput({ { 1, 0, 0, 1 } }, &input);
+    HydrogenBondExistencePointer existence(new HydrogenBondExistence);
+    existence->setMaxLag(2);
+    runModule(input, existence);
+
+    EXPECT_EQ(1, existence->bondCount());
+    EXPECT_REAL_EQ(1.0, existence->averageLifetime());
+
+    const gmx::AbstractAnalysisData& lifetimes = existence->lifetimes();
+    ASSERT_EQ(1, lifetimes.frameCount());
+    EXPECT_REAL_EQ(1.0, lifetimes.getDataFrame(0).y(0));
+
+    const gmx::AbstractAnalysisData& autocorrelation = existence->autocorrelation();
+    ASSERT_EQ(2, autocorrelation.frameCount());
+    EXPECT_REAL_EQ(1.0, autocorrelation.getDataFrame(0).y(0));
+    EXPECT_REAL_EQ(0.0, autocorrelation.getDataFrame(1).y(0));
+}
+
+} // namespace
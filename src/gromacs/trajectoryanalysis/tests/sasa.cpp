@@ -88,6 +88,22 @@ TEST_F(SasaModuleTest, BasicTest)
     runTest(CommandLine(cmdline));
 }
 
+TEST_F(SasaModuleTest, HandlesNeighborListBuffer)
+{
+    const char* const cmdline[] = {
+        "sasa", "-surface", "all", "-output", "name N CA C O H", "-nlbuf", "0.1"
+    };
+    setTopology("lysozyme.gro");
+    setOutputFile("-o", ".xvg", XvgMatch().testData(false));
+    setOutputFile("-or", ".xvg", XvgMatch());
+    setOutputFile("-oa", ".xvg", XvgMatch());
+    setOutputFile("-tv", ".xvg", XvgMatch().testData(false));
+    excludeDataset("dgsolv");
+    setDatasetTolerance("area", gmx::test::ulpTolerance(8));
+    setDatasetTolerance("volume", gmx::test::ulpTolerance(8));
+    runTest(CommandLine(cmdline));
+}
+
 TEST_F(SasaModuleTest, HandlesSelectedResidues)
 {
     const char* const cmdline[] = { "sasa", "-surface", "resnr 2 4 to 5 8" };
@@ -148,8 +148,65 @@ public:
         calculator.setDotCount(ndots);
         calculator.setRadii(radius_);
         calculator.calculate(as_rvec_array(x_.data()), bPBC ? &pbc : nullptr, index_.size(),
-                             index_.data(), flags, &area_, &volume_, &atomArea_, &dots_, &dotCount_);
+                             index_.data(), flags, &area_, &volume_, &atomArea_, &dots_, &dotCount_,
+                             nullptr);
     }
+    /*! \brief
+     * Checks that a calculation reusing the neighbor list matches one without.
+     *
+     * Moves the points randomly by at most \p maxStep in each dimension for
+     * \p frameCount frames, and compares the results of a calculator with
+     * \p buffer to a calculator that searches the neighbors in each call.
+     */
+    void checkNeighborListReuse(int ndots, real buffer, real maxStep, int frameCount, bool bPBC)
+    {
+        t_pbc pbc;
+        if (bPBC)
+        {
+            set_pbc(&pbc, PbcType::Xyz, box_);
+        }
+        gmx::SurfaceAreaCalculator calculator;
+        calculator.setDotCount(ndots);
+        calculator.setRadii(radius_);
+        gmx::SurfaceAreaCalculator bufferedCalculator;
+        bufferedCalculator.setDotCount(ndots);
+        bufferedCalculator.setRadii(radius_);
+        bufferedCalculator.setNeighborListBuffer(buffer);
+        gmx::SurfaceAreaNeighborList       neighborList;
+        const int                          flags = FLAG_ATOM_AREA | FLAG_VOLUME;
+        gmx::UniformRealDistribution<real> dist;
+        for (int frame = 0; frame < frameCount; ++frame)
+        {
+            for (auto& x : x_)
+            {
+                for (int d = 0; d < DIM; ++d)
+                {
+                    x[d] += (2 * dist(rng_) - 1) * maxStep;
+                }
+            }
+            real  area, volume, bufferedArea, bufferedVolume;
+            real *atomArea = nullptr, *bufferedAtomArea = nullptr;
+            calculator.calculate(as_rvec_array(x_.data()), bPBC ? &pbc : nullptr, index_.size(),
+                                 index_.data(), flags, &area, &volume, &atomArea, nullptr, nullptr,
+                                 nullptr);
+            bufferedCalculator.calculate(as_rvec_array(x_.data()), bPBC ? &pbc : nullptr,
+                                         index_.size(), index_.data(), flags, &bufferedArea,
+                                         &bufferedVolume, &bufferedAtomArea, nullptr, nullptr,
+                                         &neighborList);
+            const gmx::test::FloatingPointTolerance tolerance(
+                    gmx::test::relativeToleranceAsFloatingPoint(1.0, 1e-4));
+            EXPECT_REAL_EQ_TOL(area, bufferedArea, tolerance) << "Frame " << frame;
+            EXPECT_REAL_EQ_TOL(volume, bufferedVolume, tolerance) << "Frame " << frame;
+            for (size_t i = 0; i < index_.size(); ++i)
+            {
+                EXPECT_REAL_EQ_TOL(atomArea[i], bufferedAtomArea[i], tolerance)
+                        << "Frame " << frame << ", atom " << i;
+            }
+            sfree(atomArea);
+            sfree(bufferedAtomArea);
+        }
+    }
+
     real resultArea() const { return area_; }
     real resultVolume() const { return volume_; }
     real atomArea(int index) const { return atomArea_[index]; }
@@ -363,4 +420,22 @@ TEST_F(SurfaceAreaTest, Computes100PointsWithTriclinicPBC)
     checkReference(&checker, "100Points", false);
 }
 
+TEST_F(SurfaceAreaTest, ReusesNeighborListWithBuffer)
+{
+    box_[XX][XX] = 10.0;
+    box_[YY][YY] = 10.0;
+    box_[ZZ][ZZ] = 10.0;
+    generateRandomPositions(100);
+    ASSERT_NO_FATAL_FAILURE(checkNeighborListReuse(24, 0.3, 0.05, 10, false));
+}
+
+TEST_F(SurfaceAreaTest, ReusesNeighborListWithBufferAndPBC)
+{
+    box_[XX][XX] = 10.0;
+    box_[YY][YY] = 10.0;
+    box_[ZZ][ZZ] = 10.0;
+    generateRandomPositions(100);
+    ASSERT_NO_FATAL_FAILURE(checkNeighborListReuse(24, 0.3, 0.05, 10, true));
+}
+
 } // namespace
@@ -428,6 +428,7 @@ void registerLegacyModules(gmx::CommandLineModuleManager* manager)
         group.addModule("clustsize");
         group.addModule("disre");
         group.addModule("hbond");
+        group.addModule("hbond-analysis");
         group.addModule("order");
         group.addModule("principal");
         group.addModule("rdf");
@@ -46,9 +46,14 @@
 
 #include <gtest/gtest.h>
 
+#include "gromacs/topology/ifunc.h"
+#include "gromacs/trajectory/energyframe.h"
+
 #include "testutils/cmdlinetest.h"
+#include "testutils/simulationdatabase.h"
 
 #include "moduletest.h"
+#include "simulatorcomparison.h"
 
 namespace
 {
@@ -74,4 +79,37 @@ TEST_F(DomainDecompositionSpecialCasesTest, AnEmptyDomainWorks)
     ASSERT_EQ(0, runner_.callMdrun());
 }
 
+/*! \brief When run with 2+ domains, checks that keeping update groups contiguous
+ * in the local atom order gives the same pair list coverage, and thus the
+ * same energies and trajectory, as the default sorting on atom coordinates */
+TEST_F(DomainDecompositionSpecialCasesTest, SortingOnUpdateGroupsGivesSameResults)
+{
+    using namespace gmx::test;
+
+    const std::string simulationName = "tip3p5";
+    auto mdpFieldValues = prepareMdpFieldValues(simulationName.c_str(), "md", "no", "no");
+
+    // Only the summation order differs, so we can be as strict as for
+    // comparing equivalent simulators.
+    EnergyTermsToCompare energyTermsToCompare{ {
+            { interaction_function[F_EPOT].longname, relativeToleranceAsPrecisionDependentUlp(10.0, 100, 80) },
+            { interaction_function[F_EKIN].longname, relativeToleranceAsPrecisionDependentUlp(60.0, 100, 80) },
+            { interaction_function[F_PRES].longname,
+              relativeToleranceAsPrecisionDependentFloatingPoint(10.0, 0.01, 0.001) },
+    } };
+    TrajectoryFrameMatchSettings trajectoryMatchSettings{ true,
+                                                          true,
+                                                          true,
+                                                          ComparisonConditions::MustCompare,
+                                                          ComparisonConditions::MustCompare,
+                                                          ComparisonConditions::MustCompare };
+    TrajectoryTolerances trajectoryTolerances = TrajectoryComparison::s_defaultTrajectoryTolerances;
+    trajectoryTolerances.velocities           = trajectoryTolerances.coordinates;
+    TrajectoryComparison trajectoryComparison{ trajectoryMatchSettings, trajectoryTolerances };
+
+    executeSimulatorComparisonTest("GMX_NBNXN_SORT_UPDATE_GROUPS", &fileManager_, &runner_,
+                                   simulationName, 0, mdpFieldValues, energyTermsToCompare,
+                                   trajectoryComparison);
+}
+
 } // namespace
@@ -54,10 +54,10 @@ namespace gmx
 namespace test
 {
 
-TprAndFileManager::TprAndFileManager(const std::string& name)
+TprAndFileManager::TprAndFileManager(const std::string& name, const std::string& mdpContents)
 {
     const std::string mdpInputFileName = fileManager_.getTemporaryFilePath(name + ".mdp");
-    gmx::TextWriter::writeFileFromString(mdpInputFileName, "");
+    gmx::TextWriter::writeFileFromString(mdpInputFileName, mdpContents);
     tprFileName_ = fileManager_.getTemporaryFilePath(name + ".tpr");
     {
         CommandLine caller;
@@ -63,9 +63,10 @@ public:
     /*! \brief
      * Generates the file when needed.
      *
-     * \param[in] name The basename of the input files and the generated TPR.
+     * \param[in] name        The basename of the input files and the generated TPR.
+     * \param[in] mdpContents Contents of the mdp file to use (empty uses defaults).
      */
-    TprAndFileManager(const std::string& name);
+    TprAndFileManager(const std::string& name, const std::string& mdpContents = "");
     //! Access to the string.
     const std::string& tprName() const { return tprFileName_; }
 